@@ -4,28 +4,57 @@
 %BFT_2D_ARRAY     - Create a 2D array
 %BFT_ADD_IMAGE    - Add a low resolution to hi resolution image.
 %BFT_APODIZATION  - Create an apodization time line.
+%BFT_AUTOTUNE     - Tune the threads of BFT_BEAMFORM for the current lines.
 %BFT_BEAMFORM     - Beamform a number of scan-lines.
+%BFT_BEAMFORM_COMPOUND - Beamform and compound plane or diverging waves.
+%BFT_BEAMFORM_ENSEMBLE - Beamform an ensemble of frames with the same geometry.
+%BFT_BEAMFORM_FK  - Plane wave reconstruction with f-k (Stolt) migration.
 %BFT_BEAMFORM_PIXELS - Beamform image (line) based on pixels definitions
+%BFT_CALC_SCAT    - Simulate the RF signals received from point scatterers.
 %BFT_CENTER_FOCUS - Set the center focus point for the focusing
+%BFT_CODE_CORR    - Correlation figures of merit of a set of binary codes.
+%BFT_CODE_DB_CLOSE - Close a database opened by BFT_CODE_DB_OPEN.
+%BFT_CODE_DB_CREATE - Create a database of complementary pairs.
+%BFT_CODE_DB_OPEN - Open a database of complementary pairs.
+%BFT_CODE_DB_QUERY - Find the best complementary pairs of a length.
+%BFT_CODE_ENUMERATE - All short code sets within limits on their correlations.
+%BFT_CODE_MULTISTART - Search for binary code sets from many random starts.
+%BFT_CODE_SEARCH  - Improve a set of binary codes by local search.
+%BFT_COLLECT      - Collect a frame submitted by BFT_SUBMIT.
 %BFT_CONVEX_ARRAY -  Create a convex array transducer
 %BFT_CREATE_FILTER1 - Create linear phase low pass filter. Method #1
 %BFT_DELAY        - Apply a delay on one line.
 %BFT_DYNAMIC_FOCUS - Set dynamic focusing for a line
 %BFT_END          - Release all resources, allocated by the beamforming toolbox.
 %BFT_FILTER       - Set a low pass filter, used for the delays in the beamforming.
+%BFT_FLOW         - Color flow estimation from a beamformed IQ ensemble.
 %BFT_FOCUS        - Create a focus time line defined by focal points.
 %BFT_FOCUS_2WAY   - Create a 2way focus time line defined by focal points.
 %BFT_FOCUS_PIXELS -BFT_FOCUS_PIXEL Set the coordinates of the focal pixels
 %BFT_FOCUS_TIMES  - Create a focus time line defined by focus delays.
+%BFT_FREE_SCAT_GRID - Release a grid created by BFT_SCAT_GRID.
 %BFT_FREE_XDC     - Free the memory allocated for a transducer definition
 %BFT_IMPORT_XDC   - Import transducer definition from Field II
 %BFT_INIT         - Initialize the BeamForming Toolbox. This command must be
 %BFT_LINEAR_ARRAY - Create a linear array.
+%BFT_METRICS      - Resolution and clutter figures of beamformed images.
 %BFT_NO_LINES     - Set the number of lines that will be beamformed in parallel.
 %BFT_PARAM        - Set a paramater of the BeamForming Toolbox
+%BFT_RF_APPEND    - Append frames to an RF data file.
+%BFT_RF_BEAMFORM  - Beamform frames directly from an RF data file.
+%BFT_RF_CLOSE     - Close an RF data file opened by BFT_RF_OPEN.
+%BFT_RF_CREATE    - Create an empty RF data file for BFT_RF_APPEND.
+%BFT_RF_OPEN      - Open an RF data file for beamforming.
 %BFT_SCAN_PHASED  - Define a phased-array sector scan.
+%BFT_SCAT_GRID    - Sort a phantom into a grid of bins for BFT_CALC_SCAT.
+%BFT_SETUP_LINES  - Set the focusing or the apodization of all lines at once.
+%BFT_STATS        - Timing and counters of the beamforming.
+%BFT_STREAM_METRICS - Rate the frames submitted by BFT_SUBMIT.
 %BFT_SUB_IMAGE    - Subtract one low-res image from  high-res one.
+%BFT_SUBMIT       - Submit a frame for asynchronous beamforming.
 %BFT_SUM_APODIZATION - Create a summation apodization time line.
 %BFT_SUM_IMAGES   - Sum 2 low resolution images in 1 high resolution.
+%BFT_SWEEP        - Simulate, decode, beamform and rate many code sets.
+%BFT_TRACE        - Record a timeline of the beamformer threads.
 %BFT_TRANSDUCER   - Create a new transducer definition.
 %MEX_BEAMFORM     - Compile the beamforming library for matlab
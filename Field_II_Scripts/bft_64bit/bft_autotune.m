@@ -0,0 +1,45 @@
+%BFT_AUTOTUNE Find the fastest settings of BFT_BEAMFORM for the lines.
+%   The images are beamformed with 1, 2, 4, ... threads up to the
+%   number set by bft_param('threads') (by default, one per
+%   processor), and with 1, 2, 4, ... lines per task. The
+%   fastest setting is kept for the current lines, and BFT_BEAMFORM
+%   uses it from then on, also in later sessions: the settings are
+%   stored in the file $BFT_AUTOTUNE_FILE, or else ~/.bft_autotune.
+%   The lines are recognized by their number, their kind (dynamic,
+%   fixed or pixel focusing), the number of focal zones and elements,
+%   the number of samples, 'fs' and 'c', not by the focal points.
+%     bft_param('autotune', 0) makes BFT_BEAMFORM ignore the settings.
+%
+%USAGE  : [best, results] = bft_autotune(time, rf_data, element_no, repeats)
+%         bft_autotune('file', file_name)
+%
+%INPUT  : time       - Time after transmission of the first sample [s]
+%         rf_data    - RF data as for BFT_BEAMFORM, or their size 
+%                      [no_samples no_elements] to tune on random data
+%         element_no - (Optional) Transmitting element, or [x y z] of
+%                      the transmit origin, as for BFT_BEAMFORM. [] 
+%                      is none.
+%         repeats    - (Optional) Images timed per setting. Default is 3.
+%         file_name  - File of the settings to use from now on
+%
+%OUTPUT : best    - Structure with 'threads', 'lines_per_task', 'time' 
+%                   (s per image) and 'hash' (key of the lines)
+%         results - One row [threads lines_per_task time] per setting
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [best, results] = bft_autotune(time, rf_data, element_no, repeats)
+
+if (ischar(time))
+  bft(48, time, rf_data);
+  return;
+end;
+
+if (nargin < 3)
+  element_no = [];
+end;
+if (nargin < 4)
+  repeats = 3;
+end;
+
+[best, results] = bft(48, time, rf_data, element_no, repeats);
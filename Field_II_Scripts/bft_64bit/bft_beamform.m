@@ -12,28 +12,64 @@
 %   
 %   For normal beamforming ELEMENT_NO must be skipped.
 %
+%   With SAMPLES and LINES only a region of the image is beamformed
+%   and returned, e.g. the samples around the focus. The sample k 
+%   corresponds to the depth  c/2*(time + (k-1)/fs).
+%     With DECIMATION only every DECIMATION-th sample of the region
+%   is beamformed. TAPS is an optional low-pass filter against 
+%   aliasing, applied while beamforming and centered on the kept
+%   samples. Only the samples under the filter are beamformed, so
+%   the work falls by DECIMATION/length(TAPS) for a filter shorter
+%   than DECIMATION.
+%     SAMPLES, LINES and DECIMATION cannot be combined with ELEMENT_NO,
+%   which must then be []. The offset of ELEMENT_NO moves samples into
+%   the region from outside of it. Beamform the whole image with 
+%   ELEMENT_NO and crop it instead.
+%
 %
 %USAGE  : bf_lines = bft_beamform(time, rf_data, [element_no])
+%         bf_lines = bft_beamform(time, rf_data, element_no, samples, [lines],
+%                                 [decimation], [taps])
 %
 %INPUT  : time    - The time of the first sampled value
 %         rf_data - The recorded RF data. The number of columns 
 %                   is equal to the number of elements.
-%         element_no - Number of element, used in transmit.
+%         element_no - Number of element, used in transmit, or [].
+%                   Must be [] with 'samples'
+%         samples - [first last] samples of the lines to beamform,
+%                   or [] for all of them
+%         lines   - Numbers of the lines to beamform, or a logical
+%                   mask with one value per line
+%         decimation - Axial decimation factor of the output
+%         taps    - Anti-alias filter applied before the decimation
 %       
 %OUTPUT :bf_lines - Matrix with the beamformed data. The number 
 %                   of rows of 'bf_lines' is equal to the number 
-%                   of rows of 'rf_data'. The number of columns 
-%                   is equal to the number of lines
+%                   of rows of 'rf_data', or to last-first+1, divided
+%                   by 'decimation' and rounded up. The 
+%                   number of columns is equal to the number of 
+%                   lines, or of the lines selected by 'lines'
 %
+%VERSION: 2.3, Oct 19, 2026, ELEMENT_NO is refused with a region
+%VERSION: 2.2, Oct 19, 2026, axial decimation
+%VERSION: 2.1, Oct 19, 2026, region of interest
 %VERSION: 2.0, 17 Apr 2000, Svetoslav Nikolov
 
 %VERSION: 1.0, 11 Feb 2000, Svetoslav Nikolov
 
-function bf_lines = bft_beamform(time, rf_data, element_no) 
+function bf_lines = bft_beamform(time, rf_data, element_no, samples, lines, decimation, taps) 
 
 if (~isa(rf_data,'double')) rf_data = double(rf_data);end;
 
-if nargin == 2,
+if nargin > 3,
+  if ~isempty(element_no),
+    error('ELEMENT_NO must be [] when SAMPLES, LINES or DECIMATION are given');
+  end;
+  if nargin < 5, lines = []; end;
+  if nargin < 6, decimation = []; end;
+  if nargin < 7, taps = []; end;
+  bf_lines = bft(11, time, rf_data, [], samples, lines, decimation, taps);
+elseif nargin == 2,
   bf_lines = bft(11, time, rf_data);
 else 
   bf_lines = bft(11, time, rf_data);
@@ -0,0 +1,33 @@
+%BFT_BEAMFORM_COMPOUND Beamform and compound plane or diverging waves.
+%   Every wave is recorded by all the elements. The images of all the 
+%   waves are beamformed in one pass and summed coherently. Only lines
+%   defined by BFT_DYNAMIC_FOCUS or BFT_FOCUS_PIXEL can be used. The time
+%   zero of a wave is when it passes the origin of the coordinate system
+%   (for a diverging wave, when the spherical front has traveled the
+%   distance from the virtual source to the origin).
+%
+%USAGE  : bf_lines = bft_beamform_compound(type, params, times, rf_data)
+%
+%INPUT  : type    - 'plane' or 'diverging'
+%         params  - For 'plane', the direction of every wave [rad]. Either
+%                   one angle in the xz plane per wave, or one row 
+%                   [dir_xz dir_yz] per wave.
+%                   For 'diverging', one row [x y z] per wave with the
+%                   position of the virtual source [m].
+%         times   - Time of the first sample. One value for all waves,
+%                   or one value per wave.
+%         rf_data - The recorded RF data, no_samples x no_elements x
+%                   no_waves.
+%       
+%OUTPUT : bf_lines - The compounded image. One column per line.
+%
+%EXAMPLE: angles = (-10:2:10)*pi/180;
+%         bf = bft_beamform_compound('plane', angles', 0, rf);
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bf_lines = bft_beamform_compound(type, params, times, rf_data) 
+
+if (~isa(rf_data,'double')) rf_data = double(rf_data);end;
+
+bf_lines = bft(30, type, params, times, rf_data);
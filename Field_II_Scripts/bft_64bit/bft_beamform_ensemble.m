@@ -0,0 +1,30 @@
+%BFT_BEAMFORM_ENSEMBLE Beamform an ensemble of frames with the same geometry.
+%   Used for flow imaging, where a number of frames (the slow-time
+%   ensemble) are recorded with the same focusing. The delays and the
+%   apodization are calculated once and applied to all frames, so the 
+%   call is much faster than BFT_BEAMFORM in a loop. Every page of the 
+%   result is equal to the output of BFT_BEAMFORM for that frame.
+%
+%USAGE  : bf_ens = bft_beamform_ensemble(time, rf_data, [element_no])
+%
+%INPUT  : time    - The time of the first sampled value of every frame
+%         rf_data - The recorded RF data, no_samples x no_elements x 
+%                   no_frames.
+%         element_no - Number of element used in transmit, or the
+%                   coordinates of the origin of transmission.
+%       
+%OUTPUT : bf_ens  - The beamformed data, no_samples x no_lines x 
+%                   no_frames. For a single line focused in pixels, the
+%                   first dimension is the number of pixels.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bf_ens = bft_beamform_ensemble(time, rf_data, element_no) 
+
+if (~isa(rf_data,'double')) rf_data = double(rf_data);end;
+
+if nargin == 2,
+  bf_ens = bft(28, time, rf_data);
+else 
+  bf_ens = bft(28, time, rf_data, element_no);
+end  
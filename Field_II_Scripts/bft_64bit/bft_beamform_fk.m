@@ -0,0 +1,30 @@
+%BFT_BEAMFORM_FK Plane wave reconstruction with f-k (Stolt) migration.
+%   A fast alternative to BFT_BEAMFORM_COMPOUND for plane waves recorded
+%   with a linear array. The images of all angles are reconstructed in
+%   the Fourier domain (D. Garcia et al., IEEE TUFFC, 2013) and summed.
+%   The speed of sound and the sampling frequency are set by BFT_PARAM.
+%   The time zero of a wave is when it passes the origin of the 
+%   coordinate system.
+%
+%USAGE  : image = bft_beamform_fk(xdc, angles, times, rf_data)
+%
+%INPUT  : xdc     - Pointer to a linear array. The elements must be 
+%                   equally spaced along x (see BFT_LINEAR_ARRAY).
+%         angles  - Angle of every plane wave in the xz plane [rad]
+%         times   - Time of the first sample. One value for all waves,
+%                   or one value per wave.
+%         rf_data - The recorded RF data, no_samples x no_elements x
+%                   no_angles.
+%       
+%OUTPUT : image   - The compounded image, no_samples x no_elements. 
+%                   Column j is below element j, and sample i is at the
+%                   depth (floor(min(times)*fs) + i - 1) * c/fs/2, as 
+%                   for dynamic lines in BFT_BEAMFORM_COMPOUND.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function image = bft_beamform_fk(xdc, angles, times, rf_data) 
+
+if (~isa(rf_data,'double')) rf_data = double(rf_data);end;
+
+image = bft(31, xdc, angles, times, rf_data);
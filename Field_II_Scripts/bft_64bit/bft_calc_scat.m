@@ -0,0 +1,40 @@
+%BFT_CALC_SCAT Simulate the RF signals received from point scatterers.
+%   A fast local stand-in for CALC_SCAT_MULTI in Field II. The elements
+%   are points: every transmit element emits 'pulse' at its own time, 
+%   and every receive element records the echoes of all scatterers.
+%   The amplitude falls as 1/r on the way to the scatterer and back.
+%   The speed of sound and the sampling frequency are set by BFT_PARAM.
+%
+%USAGE  : [rf_data, start_time] = bft_calc_scat(xmt, rcv, pulse, delays, ...
+%                                    pht_pos, pht_amp, xmt_apo, rcv_apo, window)
+%
+%INPUT  : xmt     - Pointer to the transmit aperture
+%         rcv     - Pointer to the receive aperture
+%         pulse   - The emitted pulse sampled at fs, e.g. the excitation
+%                   code convolved with the transmit and receive impulse
+%                   responses.
+%         delays  - Firing time of every transmit element [s]
+%         pht_pos - Positions of the scatterers, N x 3 [m], or a grid
+%                   from BFT_SCAT_GRID. With a grid and a 'window', only
+%                   the bins whose echoes reach the window are simulated.
+%         pht_amp - Amplitudes of the scatterers, N x 1, or [] for a grid
+%         xmt_apo - (Optional) Apodization of the transmit elements
+%         rcv_apo - (Optional) Apodization of the receive elements
+%         window  - (Optional) [start_time no_samples] of the result. By
+%                   default the window holds all echoes.
+%       
+%OUTPUT : rf_data    - The received signals, no_samples x no_elements
+%                      of 'rcv'.
+%         start_time - Time of the first sample [s]
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [rf_data, start_time] = bft_calc_scat(xmt, rcv, pulse, delays, pht_pos, pht_amp, xmt_apo, rcv_apo, window) 
+
+if (nargin < 7)
+  [rf_data, start_time] = bft(32, xmt, rcv, pulse, delays, pht_pos, pht_amp);
+elseif (nargin < 9)
+  [rf_data, start_time] = bft(32, xmt, rcv, pulse, delays, pht_pos, pht_amp, xmt_apo, rcv_apo);
+else
+  [rf_data, start_time] = bft(32, xmt, rcv, pulse, delays, pht_pos, pht_amp, xmt_apo, rcv_apo, window);
+end;
@@ -0,0 +1,44 @@
+%BFT_CODE_CORR Correlation figures of merit of a set of binary codes.
+%   A fast replacement of sumACF, maxXcorr, maxAllXCorr and maxSelfCCFun
+%   for +1/-1 codes. The codes are packed as bits and correlated with
+%   XOR and population count. The codes are taken in groups of 
+%   'set_size' consecutive rows, e.g. the two codes of a complementary
+%   pair, which are sent in separate transmit events. The groups are
+%   sent in parallel. No BFT_INIT is needed.
+%
+%USAGE  : [metrics, sum_acf] = bft_code_corr(codes, set_size)
+%
+%INPUT  : codes    - The codes, one per row. Negative values are -1,
+%                    all other values +1.
+%         set_size - (Optional) Number of codes per group. Default is 2.
+%       
+%OUTPUT : metrics  - Structure with the fields
+%                    acf_sidelobe - max over groups of the largest
+%                                   |sumACF| off the main lobe
+%                    max_ccf      - max over two groups of 
+%                                   |xcorr(A1,B1) + xcorr(A2,B2) + ...|
+%                                   as in maxXcorr
+%                    max_all_ccf  - max |xcorr| of any two codes, as in 
+%                                   maxAllXCorr
+%                    max_self_ccf - max |xcorr| of two codes of the same
+%                                   group, as in maxSelfCCFun
+%                    welch_ratio  - max(acf_sidelobe, max_ccf) with unit
+%                                   energy per group, divided by 
+%                                   welchBound(length, no_groups, 
+%                                   set_size). NaN if the bound is not
+%                                   positive.
+%         sum_acf  - The sum of the ACFs of every group, one row per
+%                    group, as returned by sumACF.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [metrics, sum_acf] = bft_code_corr(codes, set_size) 
+
+if (nargin < 2) set_size = 2; end;
+if (~isa(codes,'double')) codes = double(codes);end;
+
+if (nargout > 1)
+  [metrics, sum_acf] = bft(35, codes, set_size);
+else
+  metrics = bft(35, codes, set_size);
+end;
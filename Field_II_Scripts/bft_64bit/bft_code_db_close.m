@@ -0,0 +1,12 @@
+%BFT_CODE_DB_CLOSE Close a database opened by BFT_CODE_DB_OPEN.
+%
+%USAGE  : bft_code_db_close(db)
+%
+%INPUT  : db - Handle returned by BFT_CODE_DB_OPEN
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_code_db_close(db)
+bft(41, db);
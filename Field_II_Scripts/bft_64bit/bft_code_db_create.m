@@ -0,0 +1,39 @@
+%BFT_CODE_DB_CREATE Create a database of complementary pairs.
+%   Generates complementary pairs of many lengths, the lengths in 
+%   parallel on all threads (see BFT_PARAM 'threads'), and writes them
+%   to one file for BFT_CODE_DB_OPEN. The families are
+%
+%     'golay'     - Binary Golay pairs of length 2^a 10^b 26^c, built as
+%                   Turyn products of the pairs of length 2, 10 and 26.
+%                   Only distinct pairs are kept, so a length may have
+%                   fewer than 'no_per_length' pairs, or none.
+%     'recursive' - Multilevel pairs as genCompPair(ones(1,length-1)),
+%                   as made by createPairsDB.
+%
+%   The pairs are indexed by length, family, largest cross-correlation
+%   (max_ccf) and sidelobe of the summed ACF, both relative to the
+%   main lobe of the summed ACF. No BFT_INIT is needed.
+%
+%USAGE  : no_pairs = bft_code_db_create(file_name, lengths, family, 
+%             no_per_length, seed)
+%
+%INPUT  : file_name     - Name of the database
+%         lengths       - Code lengths, e.g. 101:300
+%         family        - (Optional) 'golay', 'recursive' or 'all'
+%                         (default)
+%         no_per_length - (Optional) Pairs per length and family. 
+%                         Default is 100.
+%         seed          - (Optional) Seed of the random choices. 
+%                         Default is 1.
+%       
+%OUTPUT : no_pairs - Number of pairs written
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function no_pairs = bft_code_db_create(file_name, lengths, family, no_per_length, seed) 
+
+if (nargin < 3) family = 'all'; end;
+if (nargin < 4) no_per_length = 100; end;
+if (nargin < 5) seed = 1; end;
+
+no_pairs = bft(39, file_name, lengths, family, no_per_length, seed);
@@ -0,0 +1,15 @@
+%BFT_CODE_DB_OPEN Open a database of complementary pairs.
+%   The file is memory mapped, so opening it does not read the pairs,
+%   and queries only read the index and the pairs returned. No 
+%   BFT_INIT is needed.
+%
+%USAGE  : db = bft_code_db_open(file_name)
+%
+%INPUT  : file_name - Name of a file created by BFT_CODE_DB_CREATE
+%
+%OUTPUT : db - Handle to the opened database. Do not alter this value !!!
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function db = bft_code_db_open(file_name)
+db = bft(40, file_name);
@@ -0,0 +1,34 @@
+%BFT_CODE_DB_QUERY Find the best complementary pairs of a length.
+%   Returns the pairs of the given length with the lowest max_ccf,
+%   among the pairs with max_ccf below 'ccf_limit' and a sidelobe of 
+%   at most 'sidelobe_limit'. The pairs are found by binary search in
+%   the index of the database.
+%
+%USAGE  : [pairs, info] = bft_code_db_query(db, length, no_pairs, 
+%             ccf_limit, family, sidelobe_limit)
+%
+%INPUT  : db             - Handle returned by BFT_CODE_DB_OPEN
+%         length         - Code length
+%         no_pairs       - (Optional) Most pairs returned. Default is 10.
+%         ccf_limit      - (Optional) max_ccf must be below it. 
+%                          Default is Inf.
+%         family         - (Optional) 'golay', 'recursive' or 'all'
+%                          (default)
+%         sidelobe_limit - (Optional) Largest sidelobe. Default is 1e-9,
+%                          the complementary pairs up to rounding.
+%       
+%OUTPUT : pairs - The pairs, 2 x length x number of pairs. Every page
+%                 is one pair, as 'x' in the files of createPairsDB.
+%         info  - Structure array with the family, max_ccf and sidelobe
+%                 of every pair, relative to the main lobe
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [pairs, info] = bft_code_db_query(db, length, no_pairs, ccf_limit, family, sidelobe_limit) 
+
+if (nargin < 3) no_pairs = 10; end;
+if (nargin < 4) ccf_limit = Inf; end;
+if (nargin < 5) family = 'all'; end;
+if (nargin < 6) sidelobe_limit = 1e-9; end;
+
+[pairs, info] = bft(42, db, length, no_pairs, ccf_limit, family, sidelobe_limit);
@@ -0,0 +1,53 @@
+%BFT_CODE_ENUMERATE All short code sets within limits on their correlations.
+%   Searches all sets of 'no_codes' +1/-1 codes of 'length' chips, and
+%   returns the sets whose summed ACF sidelobe of every group (as 
+%   sumACF), summed cross-correlation of every two groups (as maxXcorr)
+%   and cross-correlation of every two codes (as maxAllXCorr) are within
+%   the limits. With acf_limit = 0 and set_size = 2 these are the 
+%   complementary pairs. Sets that only differ by negating groups, by
+%   reversing or by alternating the codes (chip i times (-1)^i) have
+%   the same correlations, and only one of them is returned.
+%
+%   Branches are cut as soon as a limit is broken for all values of the
+%   remaining chips, and the search tree is spread over all threads (see
+%   BFT_PARAM 'threads'). The search is exhaustive and grows quickly
+%   with the number of chips; for long runs give a checkpoint file. The
+%   finished part of the search is saved there, and a new call with the
+%   same arguments continues from it. No BFT_INIT is needed.
+%
+%USAGE  : [sets, stats] = bft_code_enumerate(no_codes, length, set_size,
+%             acf_limit, ccf_limit, all_limit, max_solutions, 
+%             checkpoint, interval)
+%
+%INPUT  : no_codes      - Number of codes in a set, at most 16
+%         length        - Chips per code, at most 32
+%         set_size      - (Optional) Codes per group. Default is 2.
+%         acf_limit     - (Optional) Largest summed ACF sidelobe. 
+%                         Default is 0.
+%         ccf_limit     - (Optional) Largest summed CCF of two groups.
+%                         Default is -1, no limit.
+%         all_limit     - (Optional) Largest CCF of two codes. Default is
+%                         -1, no limit.
+%         max_solutions - (Optional) Most sets returned. All are counted.
+%                         Default is 10000.
+%         checkpoint    - (Optional) Checkpoint file. Default is '', none.
+%         interval      - (Optional) Seconds between checkpoints. 
+%                         Default is 60.
+%       
+%OUTPUT : sets  - The sets, no_codes x length x number of sets
+%         stats - Structure with the number of sets (no_solutions) and
+%                 of visited nodes of the search tree (no_nodes)
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [sets, stats] = bft_code_enumerate(no_codes, length, set_size, acf_limit, ccf_limit, all_limit, max_solutions, checkpoint, interval) 
+
+if (nargin < 3) set_size = 2; end;
+if (nargin < 4) acf_limit = 0; end;
+if (nargin < 5) ccf_limit = -1; end;
+if (nargin < 6) all_limit = -1; end;
+if (nargin < 7) max_solutions = 10000; end;
+if (nargin < 8) checkpoint = ''; end;
+if (nargin < 9) interval = 60; end;
+
+[sets, stats] = bft(38, no_codes, length, set_size, acf_limit, ccf_limit, all_limit, max_solutions, checkpoint, interval);
@@ -0,0 +1,52 @@
+%BFT_CODE_MULTISTART Search for binary code sets from many random starts.
+%   Runs 'no_restarts' independent searches of BFT_CODE_SEARCH from
+%   random +1/-1 codes on all threads (see BFT_PARAM 'threads'). The goal
+%   is the lowest summed ACF sidelobe (as ACFSumFuncConst) among the sets
+%   whose largest summed cross-correlation between groups (as maxXcorr)
+%   is at most 'ccf_limit'. The best result so far is shared: a search 
+%   is run in 4 stages, and is abandoned when its sidelobe is more than
+%   1.5 times the best sidelobe. No BFT_INIT is needed.
+%
+%USAGE  : [codes, metrics, stats] = bft_code_multistart(no_codes, length, 
+%             set_size, no_restarts, method, max_iter, ccf_weight, 
+%             ccf_limit, prefix, seed)
+%
+%INPUT  : no_codes    - Number of codes in a set, e.g. 2*numPairs
+%         length      - Chips per code
+%         set_size    - (Optional) Codes per group. Default is 2.
+%         no_restarts - (Optional) Number of searches. Default is 100.
+%         method      - (Optional) 'tabu' (default) or 'anneal'
+%         max_iter    - (Optional) Iterations per search. Default is
+%                       1000 for 'tabu' and 10^6 for 'anneal'.
+%         ccf_weight  - (Optional) Weight of the cross-correlations in 
+%                       the cost of the search. Default is 1.
+%         ccf_limit   - (Optional) Largest allowed max_ccf. Default is
+%                       -1, no limit.
+%         prefix      - (Optional) Every new best set is saved as 'x' in
+%                       [prefix num2str(acf_sidelobe) '_' 
+%                       num2str(max_ccf) '.mat'] when found. Default is
+%                       '', nothing saved.
+%         seed        - (Optional) Base seed. Default is 1.
+%       
+%OUTPUT : codes   - The best set, or [] if no search met 'ccf_limit'
+%         metrics - Its figures of merit, as from BFT_CODE_CORR
+%         stats   - Structure with the number of searches that met 
+%                   'ccf_limit' (no_feasible) and that were abandoned
+%                   (no_pruned)
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [codes, metrics, stats] = bft_code_multistart(no_codes, length, set_size, no_restarts, method, max_iter, ccf_weight, ccf_limit, prefix, seed) 
+
+if (nargin < 3) set_size = 2; end;
+if (nargin < 4) no_restarts = 100; end;
+if (nargin < 5) method = 'tabu'; end;
+if (nargin < 6) 
+  if (strcmp(method,'anneal')) max_iter = 1e6; else max_iter = 1000; end;
+end;
+if (nargin < 7) ccf_weight = 1; end;
+if (nargin < 8) ccf_limit = -1; end;
+if (nargin < 9) prefix = ''; end;
+if (nargin < 10) seed = 1; end;
+
+[codes, metrics, stats] = bft(37, no_codes, length, set_size, no_restarts, method, max_iter, ccf_weight, ccf_limit, prefix, seed);
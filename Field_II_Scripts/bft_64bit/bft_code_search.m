@@ -0,0 +1,45 @@
+%BFT_CODE_SEARCH Improve a set of binary codes by local search.
+%   Chips are flipped one at a time to lower the cost
+%
+%     E = sum of the squared sidelobes of the summed ACF of every group
+%         + ccf_weight * sum of the squared summed CCF of every two
+%         groups,
+%
+%   with the groups as in BFT_CODE_CORR. The correlations are updated
+%   with every flip, so a flip costs O(length) per group. This replaces
+%   re-evaluating sumACF/maxXcorr inside patternsearch for long codes.
+%   No BFT_INIT is needed.
+%
+%USAGE  : [codes, cost, metrics] = bft_code_search(codes0, set_size, method,
+%                                           max_iter, ccf_weight, seed)
+%
+%INPUT  : codes0     - The initial codes, one per row. Negative values
+%                      are -1, all other values +1.
+%         set_size   - (Optional) Number of codes per group. Default is 2.
+%         method     - (Optional) 'tabu' (default) or 'anneal'. Every
+%                      tabu iteration tries all flips; an annealing
+%                      iteration tries one random flip.
+%         max_iter   - (Optional) Number of iterations. Default is 1000
+%                      for 'tabu' and 10^6 for 'anneal'.
+%         ccf_weight - (Optional) Weight of the cross-correlations.
+%                      Default is 1.
+%         seed       - (Optional) Seed of the random numbers. Default 1.
+%       
+%OUTPUT : codes   - The best codes found, +1/-1
+%         cost    - The cost E of 'codes'
+%         metrics - Figures of merit of 'codes', as from BFT_CODE_CORR
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [codes, cost, metrics] = bft_code_search(codes0, set_size, method, max_iter, ccf_weight, seed) 
+
+if (nargin < 2) set_size = 2; end;
+if (nargin < 3) method = 'tabu'; end;
+if (nargin < 4) 
+  if (strcmp(method,'anneal')) max_iter = 1e6; else max_iter = 1000; end;
+end;
+if (nargin < 5) ccf_weight = 1; end;
+if (nargin < 6) seed = 1; end;
+if (~isa(codes0,'double')) codes0 = double(codes0);end;
+
+[codes, cost, metrics] = bft(36, codes0, set_size, method, max_iter, ccf_weight, seed);
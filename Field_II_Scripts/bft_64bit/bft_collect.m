@@ -0,0 +1,21 @@
+%BFT_COLLECT Collect a frame submitted by BFT_SUBMIT.
+%   Waits until the frame is beamformed. 
+%
+%USAGE  : [bf_lines, m] = bft_collect(ticket)
+%
+%INPUT  : ticket - Value returned by BFT_SUBMIT
+%       
+%OUTPUT : bf_lines - Matrix with the beamformed data, as returned 
+%                    by BFT_BEAMFORM
+%         m        - Figures of the frame as returned by BFT_METRICS,
+%                    if it was rated (see BFT_STREAM_METRICS), or []
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [bf_lines, m] = bft_collect(ticket) 
+
+if (nargout > 1)
+  [bf_lines, m] = bft(27, ticket);
+else
+  bf_lines = bft(27, ticket);
+end;
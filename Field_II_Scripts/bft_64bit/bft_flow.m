@@ -0,0 +1,34 @@
+%BFT_FLOW Color flow estimation from a beamformed IQ ensemble.
+%   The lag-one autocorrelation (Kasai) estimator. The slow-time signal 
+%   of every sample is filtered with a polynomial regression wall filter,
+%   and the lag-0 and lag-1 autocorrelations R0 and R1 are averaged with
+%   a boxcar kernel in depth and across the lines. The speed of sound is
+%   the one set by BFT_PARAM.
+%
+%USAGE  : [v, var, power] = bft_flow(iq_data, prf, f0, [wall_order, kernel])
+%
+%INPUT  : iq_data - Complex beamformed ensemble, no_samples x no_lines x
+%                   no_frames, e.g. hilbert() applied along the first
+%                   dimension of the output of BFT_BEAMFORM_ENSEMBLE.
+%         prf     - Pulse repetition frequency [Hz]
+%         f0      - Center frequency [Hz]
+%         wall_order - Order of the regression wall filter. -1 turns off
+%                   the filter, 0 (default) removes the mean.
+%         kernel  - Size of the averaging kernel, [samples lines]. 
+%                   Default is [1 1].
+%       
+%OUTPUT : v       - Axial velocity [m/s], positive towards the transducer
+%         var     - Normalized variance, 1 - |R1|/R0
+%         power   - Power after the wall filter, R0
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [v, var, power] = bft_flow(iq_data, prf, f0, wall_order, kernel) 
+
+if (~isa(iq_data,'double')) iq_data = double(iq_data);end;
+if (isreal(iq_data)) iq_data = complex(iq_data);end;
+
+if nargin < 4, wall_order = 0; end
+if nargin < 5, kernel = [1 1]; end
+
+[v, var, power] = bft(29, iq_data, prf, f0, wall_order, kernel);
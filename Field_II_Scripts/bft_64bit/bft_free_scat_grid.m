@@ -0,0 +1,12 @@
+%BFT_FREE_SCAT_GRID Release a grid created by BFT_SCAT_GRID.
+%
+%USAGE  : bft_free_scat_grid(grid)
+%
+%INPUT  : grid - Pointer returned by BFT_SCAT_GRID
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_free_scat_grid(grid)
+bft(34, grid);
@@ -0,0 +1,45 @@
+%BFT_METRICS Resolution and clutter figures of beamformed images.
+%   A native replacement of maxToAvg, the WidthToThresh scripts and the
+%   central-line plots. The point spread function is measured around 
+%   the peak of abs(images) in the signal region, and only inside it.
+%   The main lobe is the rectangle between the first minima on both 
+%   sides of the peak, along and across the lines. The images are 
+%   rated in parallel. The toolbox state is not used.
+%
+%USAGE  : m = bft_metrics(images, signal, clutter, envelope)
+%
+%INPUT  : images   - Beamformed images, no_samples x no_lines x no_images,
+%                    as returned by BFT_BEAMFORM
+%         signal   - Region with the point target, [first_sample 
+%                    last_sample first_line last_line]
+%         clutter  - (Optional) Region with the clutter, as 'signal', 
+%                    or [] 
+%         envelope - (Optional) Rate the envelope of the lines instead
+%                    of the lines. Default is 1.
+%       
+%OUTPUT : m - Structure array with one element per image:
+%               peak         - Largest abs value in 'signal'
+%               peak_sample, peak_line - Its position
+%               axial_fwhm   - Width at half the peak along the line
+%                              [samples]
+%               lateral_fwhm - Width at half the peak across the lines
+%                              [lines]
+%               psl          - Peak sidelobe over the peak [dB]
+%               isl          - Energy outside the main lobe over the
+%                              energy in it [dB]
+%               max_to_avg   - max(signal)/mean(clutter), or 0 without
+%                              'clutter'
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function m = bft_metrics(images, signal, clutter, envelope) 
+
+if (nargin < 3)
+  clutter = [];
+end;
+if (nargin < 4)
+  envelope = 1;
+end;
+if (~isa(images,'double')) images = double(images);end;
+
+m = bft(44, images, signal, clutter, envelope);
@@ -9,6 +9,29 @@
 %                -----+-----------------------+--------------+------
 %                 'c' | Speed of sound.       | 1540         |  m/s 
 %                 'fs'| Sampling frequency    | 40,000,000   |  Hz
+%       'queue_depth' | Frames held by        | 2            |  -
+%                     | BFT_SUBMIT            |              |
+%           'threads' | Worker threads. 0 is  | 0            |  -
+%                     | one per processor     |              |
+%          'affinity' | Pinning of the worker | 0            |  -
+%                     | threads. 0 - none,    |              |
+%                     | 1 - compact (fill one |              |
+%                     | NUMA node first),     |              |
+%                     | 2 - scatter (nodes in |              |
+%                     | turn)                 |              |
+%              'numa' | With pinned workers,  | 0            |  -
+%                     | sum of: 1 - each node |              |
+%                     | takes a contiguous    |              |
+%                     | block of lines, 2 -   |              |
+%                     | each node beamforms   |              |
+%                     | from its own copy of  |              |
+%                     | the RF data           |              |
+%             'stats' | Collect the timing of | 1            |  -
+%                     | BFT_STATS             |              |
+%              'perf' | Collect the hardware  | 0            |  -
+%                     | counters of BFT_STATS |              |
+%          'autotune' | Use the settings of   | 1            |  -
+%                     | BFT_AUTOTUNE          |              |
 %                -----+-----------------------+--------------+------
 %         value - New value for the parameter. Must be scalar. 
 %
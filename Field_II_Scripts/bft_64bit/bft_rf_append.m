@@ -0,0 +1,58 @@
+%BFT_RF_APPEND Append frames to an RF data file.
+%   The file must be created by BFT_RF_CREATE. The frames are written
+%   first, and the frame index is updated afterwards, so a file opened
+%   with BFT_RF_OPEN never contains partially written frames.
+%
+%USAGE  : bft_rf_append(file_name, rf_data, times)
+%
+%INPUT  : file_name - Name of the file
+%         rf_data   - The recorded RF data. One column per element, and
+%                     one page per frame (no_samples x no_elements x no_frames)
+%         times     - The time of the first sample of every frame [s]
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_rf_append(file_name, rf_data, times)
+
+fid = fopen(file_name, 'r+', 'l');
+if (fid < 0) error(['Cannot open ' file_name]); end;
+
+fseek(fid, 16, 'bof');
+hdr = fread(fid, 4, 'uint32');      % no_elements no_samples no_frames max_frames
+fseek(fid, 56, 'bof');
+offsets = fread(fid, 4, 'uint64');  % geometry times codes index
+
+no_elements = hdr(1); no_samples = hdr(2);
+no_frames = hdr(3); max_frames = hdr(4);
+no_new = size(rf_data,3);
+
+if (size(rf_data,1) ~= no_samples || size(rf_data,2) ~= no_elements)
+   fclose(fid);
+   error('The frames must be %d by %d', no_samples, no_elements);
+end
+if (numel(times) ~= no_new)
+   fclose(fid);
+   error('One time per frame is needed');
+end
+if (no_frames + no_new > max_frames)
+   fclose(fid);
+   error('The file can hold only %d frames', max_frames);
+end
+
+for k = 1:no_new
+   fseek(fid, 0, 'eof');
+   offset = ftell(fid);
+   fwrite(fid, double(rf_data(:,:,k)), 'double');
+
+   fseek(fid, offsets(2) + 8*no_frames, 'bof');
+   fwrite(fid, times(k), 'double');
+   fseek(fid, offsets(4) + 8*no_frames, 'bof');
+   fwrite(fid, offset, 'uint64');
+
+   no_frames = no_frames + 1;
+   fseek(fid, 24, 'bof');
+   fwrite(fid, no_frames, 'uint32');
+end
+fclose(fid);
@@ -0,0 +1,25 @@
+%BFT_RF_BEAMFORM Beamform frames directly from an RF data file.
+%   The lines are set up as for BFT_BEAMFORM. The channel data of every 
+%   frame is read from the memory mapped file, and the next frame is 
+%   prefetched while the current one is beamformed. 'c' and 'fs' set by
+%   BFT_PARAM must be equal to the values in the file.
+%
+%USAGE  : bf_lines = bft_rf_beamform(rf, frames, [element_no])
+%
+%INPUT  : rf     - Handle returned by BFT_RF_OPEN
+%         frames - Numbers of the frames to beamform (e.g. 10:20)
+%         element_no - Number of element used in transmit, or the
+%                  coordinates of the origin of transmission.
+%
+%OUTPUT : bf_lines - The beamformed data. One column per line, and one
+%                    page per frame.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bf_lines = bft_rf_beamform(rf, frames, element_no)
+
+if (nargin == 2)
+  bf_lines = bft(25, rf, frames);
+else
+  bf_lines = bft(25, rf, frames, element_no);
+end
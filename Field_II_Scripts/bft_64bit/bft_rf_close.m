@@ -0,0 +1,12 @@
+%BFT_RF_CLOSE Close an RF data file opened by BFT_RF_OPEN.
+%
+%USAGE  : bft_rf_close(rf)
+%
+%INPUT  : rf - Handle returned by BFT_RF_OPEN
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_rf_close(rf)
+bft(23, rf);
@@ -0,0 +1,53 @@
+%BFT_RF_CREATE Create an empty RF data file for BFT_RF_APPEND.
+%   The file holds a header with the geometry of the transducer, the
+%   sampling frequency, the speed of sound and the excitation codes,
+%   followed by a frame index and the frames themselves. Frames are
+%   added with BFT_RF_APPEND and beamformed with BFT_RF_BEAMFORM
+%   directly from the file, without loading them in MATLAB.
+%
+%USAGE  : bft_rf_create(file_name, centers, no_samples, max_frames, fs, c, codes)
+%
+%INPUT  : file_name  - Name of the file to create
+%         centers    - Matrix with the centers of the elements. It has 3
+%                      columns (x,y,z) and one row per element      [m]
+%         no_samples - Number of samples per channel in one frame
+%         max_frames - Maximal number of frames the file can hold
+%         fs         - Sampling frequency                           [Hz]
+%         c          - Speed of sound                               [m/s]
+%         codes      - Optional. Excitation codes, one column per code
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_rf_create(file_name, centers, no_samples, max_frames, fs, c, codes)
+
+if (nargin < 7) codes = []; end;
+if (size(centers,2) ~= 3) centers = centers'; end;
+
+no_elements = size(centers,1);
+header_size = 104;
+page = 4096;
+
+geometry_offset = header_size;
+times_offset = geometry_offset + 24*no_elements;
+codes_offset = times_offset + 8*max_frames;
+index_offset = codes_offset + 8*numel(codes);
+data_offset = ceil((index_offset + 8*max_frames)/page)*page;
+frame_size = 8*no_samples*no_elements;
+
+fid = fopen(file_name, 'w', 'l');
+if (fid < 0) error(['Cannot create ' file_name]); end;
+
+fwrite(fid, ['BFTRF' 0 0 0], 'uint8');
+fwrite(fid, [1 header_size no_elements no_samples 0 max_frames ...
+             size(codes,2) size(codes,1)], 'uint32');
+fwrite(fid, [fs c], 'double');
+fwrite(fid, [geometry_offset times_offset codes_offset index_offset ...
+             data_offset frame_size], 'uint64');
+fwrite(fid, centers', 'double');
+fwrite(fid, zeros(max_frames,1), 'double');
+fwrite(fid, codes, 'double');
+fwrite(fid, zeros(max_frames,1), 'uint64');
+fwrite(fid, zeros(data_offset - ftell(fid),1), 'uint8');
+fclose(fid);
@@ -0,0 +1,18 @@
+%BFT_RF_OPEN Open an RF data file for beamforming.
+%   The file is memory mapped. Only the frames that are beamformed 
+%   are read from the disk.
+%
+%USAGE  : [rf, info] = bft_rf_open(file_name)
+%
+%INPUT  : file_name - Name of a file created by BFT_RF_CREATE
+%
+%OUTPUT : rf   - Handle to the opened file. Do not alter this value !!!
+%         info - Structure with the header of the file : no_elements,
+%                no_samples, no_frames, fs, c, geometry (one row per 
+%                element), times (one per frame) and codes.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [rf, info] = bft_rf_open(file_name)
+rf = bft(22, file_name);
+if (nargout > 1) info = bft(24, rf); end;
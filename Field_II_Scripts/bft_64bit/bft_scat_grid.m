@@ -0,0 +1,23 @@
+%BFT_SCAT_GRID Sort a phantom into a grid of bins for BFT_CALC_SCAT.
+%   The scatterers are sorted once into bins in x (lateral) and z
+%   (depth). A simulation with BFT_CALC_SCAT and a given window then 
+%   only visits the bins whose echoes can reach the window, so that the
+%   time depends on the imaged region rather than on the whole phantom.
+%
+%USAGE  : grid = bft_scat_grid(pht_pos, pht_amp, bin_size)
+%
+%INPUT  : pht_pos  - Positions of the scatterers, N x 3 [m]
+%         pht_amp  - Amplitudes of the scatterers, N x 1
+%         bin_size - (Optional) Size of the bins in x and z [m]. 
+%                    Default is 2 mm. At most 1024 bins are made in
+%                    each direction.
+%       
+%OUTPUT : grid - Pointer to the grid. Release it with BFT_FREE_SCAT_GRID.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function grid = bft_scat_grid(pht_pos, pht_amp, bin_size) 
+
+if (nargin < 3) bin_size = 2e-3; end;
+
+grid = bft(33, pht_pos, pht_amp, bin_size);
@@ -0,0 +1,45 @@
+%BFT_SETUP_LINES Set the focusing or the apodization of all lines at once.
+%   One call replaces a call of BFT_CENTER_FOCUS, BFT_DYNAMIC_FOCUS,
+%   BFT_FOCUS, BFT_FOCUS_2WAY, BFT_FOCUS_TIMES, BFT_FOCUS_PIXELS, 
+%   BFT_APODIZATION or BFT_SUM_APODIZATION per line. The lines are set
+%   in parallel, and the transducer is checked once. The values are
+%   given for all the lines defined by BFT_NO_LINES, line 1 first.
+%   Every line has the same number of focal zones (apodizations, 
+%   pixels).
+%
+%USAGE  : bft_setup_lines('center', centers)
+%         bft_setup_lines('dynamic', xdc, dir_xz, dir_yz)
+%         bft_setup_lines('focus', xdc, times, points)
+%         bft_setup_lines('focus_2way', xdc, times, points)
+%         bft_setup_lines('focus_times', xdc, times, delays)
+%         bft_setup_lines('pixels', xdc, points)
+%         bft_setup_lines('apodization', xdc, times, values)
+%         bft_setup_lines('sum_apodization', xdc, times, values)
+%
+%INPUT  : centers - Centers of the focus, one row [x y z] per line.
+%         xdc     - Pointer to a transducer aperture.
+%         dir_xz, dir_yz - Directions of the dynamic focus [rad]. One
+%                   value for all the lines, or one per line.
+%         times   - Times after which the zones are valid [s]. A
+%                   vector for all the lines, or one column per line.
+%         points  - Focal points or pixels, one row [x y z] per zone:
+%                   the zones of line 1, then those of line 2, ...
+%         delays, values - Delays [s] or apodization values, one row 
+%                   per zone as 'points', one column per element.
+%
+%OUTPUT : None
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_setup_lines(kind, xdc, arg1, arg2)
+
+switch kind
+  case 'center'
+    bft(49, kind, xdc');
+  case 'dynamic'
+    bft(49, kind, xdc, arg1, arg2);
+  case 'pixels'
+    bft(49, kind, xdc, arg1');
+  otherwise
+    bft(49, kind, xdc, arg1, arg2');
+end;
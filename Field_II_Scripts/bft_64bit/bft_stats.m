@@ -0,0 +1,49 @@
+%BFT_STATS Timing and counters of the beamforming.
+%   Every BFT_BEAMFORM command is timed stage by stage, and every 
+%   beamformed line (also from BFT_SUBMIT and the other commands that
+%   beamform) is timed and counted. The collection is switched with
+%   BFT_PARAM('stats', 0 or 1). A toolbox built with -DBFT_NO_STATS has
+%   no statistics at all.
+%
+%USAGE  : s = bft_stats(reset)
+%
+%INPUT  : reset - (Optional) If 1, start again from zero after the
+%                 statistics are returned. Default is 0.
+%       
+%OUTPUT : s - Structure with the fields below. The stages are
+%             structures with the fields calls, total, min, max and
+%             mean, in seconds.
+%               total    - The whole BFT_BEAMFORM command
+%               marshal  - Checks of the arguments
+%               rf_setup - Pointers to the channels
+%               spawn    - Creation of the worker threads
+%               lines    - All lines of an image
+%               line     - One line. The times of all threads are
+%                          added, so the total can exceed 'lines'.
+%               copy     - Copy of the result to Matlab
+%               samples  - Samples x channels processed
+%               bytes    - Bytes read and written by the line kernels
+%               threads  - Threads used by the parallel loops
+%               max_threads - Most threads used by one loop
+%               perf     - Hardware counters, collected after
+%                          BFT_PARAM('perf', 1) on Linux. One structure
+%                          for whole images ('image'), and one per 
+%                          focusing mode of the lines ('times', 
+%                          'dynamic', 'sta', 'pixels'), with the fields
+%                          calls, time, cycles, instructions, 
+%                          l1d_misses, llc_misses, ipc, dram_bytes 
+%                          (64 bytes per LLC miss) and bandwidth 
+%                          [bytes/s]. Counters that the system does not
+%                          allow (see /proc/sys/kernel/perf_event_paranoid)
+%                          are NaN.
+%             Use jsonencode(s) to store the results with a benchmark.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function s = bft_stats(reset) 
+
+if (nargin < 1)
+  reset = 0;
+end;
+
+s = bft(46, reset);
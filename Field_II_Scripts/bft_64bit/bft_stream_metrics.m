@@ -0,0 +1,30 @@
+%BFT_STREAM_METRICS Rate the frames submitted by BFT_SUBMIT.
+%   Every frame submitted afterwards is rated by the background thread
+%   as soon as it is beamformed, as with BFT_METRICS. The figures are
+%   returned by BFT_COLLECT. Without arguments the rating is stopped.
+%
+%USAGE  : bft_stream_metrics(signal, clutter, envelope)
+%         bft_stream_metrics
+%
+%INPUT  : signal   - Region with the point target, [first_sample 
+%                    last_sample first_line last_line]
+%         clutter  - (Optional) Region with the clutter, or []
+%         envelope - (Optional) Rate the envelope of the lines instead
+%                    of the lines. Default is 1.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function bft_stream_metrics(signal, clutter, envelope) 
+
+if (nargin == 0)
+  bft(45);
+  return;
+end;
+if (nargin < 2)
+  clutter = [];
+end;
+if (nargin < 3)
+  envelope = 1;
+end;
+
+bft(45, signal, clutter, envelope);
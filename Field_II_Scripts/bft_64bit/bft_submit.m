@@ -0,0 +1,30 @@
+%BFT_SUBMIT Submit a frame for asynchronous beamforming.
+%   The frame is copied and beamformed by a background thread, while
+%   MATLAB loads or simulates the next frame. The result is obtained
+%   with BFT_COLLECT. At most 'queue_depth' frames (see BFT_PARAM, the
+%   default is 2) can be submitted and not yet collected. 
+%     The lines are beamformed with the settings at the time of the
+%   submission. Any other BFT command waits for the submitted frames 
+%   to be beamformed before it is executed.
+%
+%USAGE  : ticket = bft_submit(time, rf_data, [element_no])
+%
+%INPUT  : time    - The time of the first sampled value
+%         rf_data - The recorded RF data. The number of columns 
+%                   is equal to the number of elements.
+%         element_no - Number of element used in transmit, or the
+%                   coordinates of the origin of transmission.
+%       
+%OUTPUT : ticket  - Number identifying the frame for BFT_COLLECT
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function ticket = bft_submit(time, rf_data, element_no) 
+
+if (~isa(rf_data,'double')) rf_data = double(rf_data);end;
+
+if nargin == 2,
+  ticket = bft(26, time, rf_data);
+else 
+  ticket = bft(26, time, rf_data, element_no);
+end  
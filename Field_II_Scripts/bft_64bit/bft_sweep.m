@@ -0,0 +1,65 @@
+%BFT_SWEEP Simulate, decode, beamform and rate many code sets.
+%   Every code set is sent through the whole chain of imageAndGetMetric:
+%   the phantom is simulated as in BFT_CALC_SCAT, the received signals
+%   are correlated with the codes, the lines are beamformed with the
+%   current focusing and apodization (as in BFT_BEAMFORM) and the image
+%   is rated. Nothing is returned to Matlab between the steps, and the
+%   code sets are evaluated in parallel.
+%
+%   The codes are grouped as in BFT_CODE_CORR. All groups are sent at
+%   the same time, group g with the firing times in column g of 'delays'
+%   and with its code e in transmit event e. The lines of group g are 
+%   beamformed from the sum over the events of the signals correlated
+%   with the codes of group g.
+%
+%USAGE  : [metric, images] = bft_sweep(xmt, rcv, impulse, delays, pht_pos, pht_amp, ...
+%                 window, chip_samples, codes, set_size, signal, clutter, ...
+%                 line_groups, envelope, metric)
+%
+%INPUT  : xmt          - Pointer to the transmit aperture
+%         rcv          - Pointer to the receive aperture
+%         impulse      - Two-way impulse response of the transducer,
+%                        sampled at fs
+%         delays       - Firing times [s], no_xmt_elements x no_groups
+%         pht_pos      - Positions of the scatterers, N x 3 [m], or a grid
+%                        from BFT_SCAT_GRID
+%         pht_amp      - Amplitudes of the scatterers, or [] for a grid
+%         window       - [start_time no_samples] of the decoded signals
+%         chip_samples - Samples per chip
+%         codes        - Code sets, (no_groups*set_size) x length x no_sets
+%         set_size     - Number of codes per group
+%         signal       - Region with the target, [first_sample last_sample
+%                        first_line last_line] of the image
+%         clutter      - Region with the clutter, as 'signal'
+%         line_groups  - (Optional) Group of every line, from 1. By default
+%                        all lines belong to group 1.
+%         envelope     - (Optional) Rate the envelope of the lines instead
+%                        of the lines. Default is 1.
+%         metric       - (Optional) Figure to return, a field name of
+%                        BFT_METRICS: 'max_to_avg' (default), 
+%                        'axial_fwhm', 'lateral_fwhm', 'psl' or 'isl'. 
+%                        'clutter' can be [] for the others.
+%       
+%OUTPUT : values - The figure, one value per code set
+%         images - (Optional) The rated images, no_samples x no_lines x
+%                  no_sets
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function [values, images] = bft_sweep(xmt, rcv, impulse, delays, pht_pos, pht_amp, window, chip_samples, codes, set_size, signal, clutter, line_groups, envelope, metric) 
+
+if (nargin < 13)
+  line_groups = [];
+end;
+if (nargin < 14)
+  envelope = 1;
+end;
+if (nargin < 15)
+  metric = 'max_to_avg';
+end;
+
+if (nargout > 1)
+  [values, images] = bft(43, xmt, rcv, impulse, delays, pht_pos, pht_amp, window, chip_samples, codes, set_size, signal, clutter, line_groups, envelope, metric);
+else
+  values = bft(43, xmt, rcv, impulse, delays, pht_pos, pht_amp, window, chip_samples, codes, set_size, signal, clutter, line_groups, envelope, metric);
+end;
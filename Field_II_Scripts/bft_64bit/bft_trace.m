@@ -0,0 +1,31 @@
+%BFT_TRACE Record a timeline of the beamformer threads.
+%   While tracing, every BFT command, every beamformed image, every
+%   line kernel and every frame of the BFT_SUBMIT pipeline is recorded
+%   with its begin and end time and its thread. The timeline is
+%   written as Chrome trace JSON, to be opened in chrome://tracing or
+%   ui.perfetto.dev. It shows the balance of the lines between the
+%   threads and the gaps between the calls from Matlab.
+%     Every thread keeps its last 'events' events. A toolbox built 
+%   with -DBFT_NO_STATS has no tracing.
+%
+%USAGE  : bft_trace('start', events)
+%         bft_trace('stop')
+%         bft_trace('clear')
+%         no_events = bft_trace('dump', file_name)
+%
+%INPUT  : events    - (Optional) Events kept per thread. Default is 4096.
+%         file_name - File for the JSON timeline
+%       
+%OUTPUT : no_events - Number of events written
+%
+%VERSION: 1.0, Oct 19, 2026
+
+function no_events = bft_trace(action, arg) 
+
+if (nargin < 2)
+  bft(47, action);
+elseif (nargout > 0 || strcmp(action, 'dump'))
+  no_events = bft(47, action, arg);
+else
+  bft(47, action, arg);
+end;
@@ -0,0 +1,387 @@
+/*********************************************************************
+ * NAME     : autotune.c
+ * ABSTRACT : Tuning of beamform_image() per geometry, and the table
+ *            of the tuned settings with its file.
+ *
+ *            The file has one line per geometry:
+ *               <hash, 16 hex digits> <threads> <lines per task> <s>
+ *            It is rewritten as a whole (through a temporary file)
+ *            after every tuning, merged with its current content.
+ *********************************************************************/
+
+#include "../h/autotune.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+/*
+ *  One tuned geometry
+ */
+typedef struct{
+   ui64 hash;
+   TBeamformConfig cfg;
+   double time;
+}TTuneEntry;
+
+static TTuneEntry *entries = NULL;
+static ui32 no_entries = 0;
+static ui32 max_entries = 0;
+static si32 enabled = TRUE;
+static si32 loaded = FALSE;        /* The file has been read            */
+static char file[1024] = "";
+
+
+static void lock_table()
+{
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+#endif
+}
+
+
+static void unlock_table()
+{
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&lock);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : hash_add
+ * ABSTRACT : FNV-1a over the bytes of a value.
+ *********************************************************************/
+static ui64 hash_add(ui64 h, const void *data, size_t size)
+{
+  const ui8 *p = (const ui8*)data;
+  size_t i;
+
+  for (i = 0; i < size; i++){
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_hash
+ * RETURNS  : The key of a geometry. 'sta' is TRUE if a transmitting
+ *            element or origin is given to the beamforming.
+ *********************************************************************/
+ui64 autotune_hash(TFocusLineCollection *flc, TApoLineCollection *alc,
+                   TSysParams *sys, ui32 no_samples, si32 sta)
+{
+  ui64 h = 14695981039346656037ULL;
+  ui32 i, v[5];
+
+  h = hash_add(h, &flc->no_focus_time_lines, sizeof(ui32));
+  h = hash_add(h, &no_samples, sizeof(ui32));
+  h = hash_add(h, &sta, sizeof(si32));
+  h = hash_add(h, &sys->c, sizeof(double));
+  h = hash_add(h, &sys->fs, sizeof(double));
+  for (i = 0; i < flc->no_focus_time_lines; i++){
+    v[0] = flc->ftl[i].dynamic;
+    v[1] = flc->ftl[i].pixel;
+    v[2] = flc->ftl[i].no_times;
+    v[3] = (flc->ftl[i].xdc != NULL) ? flc->ftl[i].xdc->no_elements : 0;
+    v[4] = (i < alc->no_apo_time_lines) ? alc->atl[i].no_times : 0;
+    h = hash_add(h, v, sizeof(v));
+  }
+  return h;
+}
+
+
+/*********************************************************************
+ * FUNCTION : store_entry
+ * ABSTRACT : Add or replace a geometry. The table must be locked.
+ *********************************************************************/
+static si32 store_entry(ui64 hash, TBeamformConfig *cfg, double time)
+{
+  TTuneEntry *e;
+  ui32 i;
+
+  for (i = 0; i < no_entries && entries[i].hash != hash; i++);
+  if (i == no_entries){
+    if (no_entries == max_entries){
+      e = (TTuneEntry*)realloc(entries, (2*max_entries + 16) * sizeof(TTuneEntry));
+      if (e == NULL) return FALSE;
+      entries = e;
+      max_entries = 2*max_entries + 16;
+    }
+    no_entries ++;
+  }
+  entries[i].hash = hash;
+  entries[i].cfg = *cfg;
+  entries[i].time = time;
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : default_file
+ * ABSTRACT : Set 'file' to $BFT_AUTOTUNE_FILE, or else to the file in
+ *            the home directory, if no file has been chosen.
+ *********************************************************************/
+static void default_file()
+{
+  char *home;
+
+  if (file[0] != 0) return;
+  home = getenv("BFT_AUTOTUNE_FILE");
+  if (home != NULL && strlen(home) + 5 < sizeof(file)){
+    strcpy(file, home);
+    return;
+  }
+  home = getenv("HOME");
+  if (home == NULL) home = getenv("USERPROFILE");
+  if (home != NULL && strlen(home) + strlen(TUNE_DEFAULT_FILE) + 2 < sizeof(file))
+    sprintf(file, "%s/%s", home, TUNE_DEFAULT_FILE);
+  else
+    strcpy(file, TUNE_DEFAULT_FILE);
+}
+
+
+/*********************************************************************
+ * FUNCTION : load_file
+ * ABSTRACT : Read the entries of the file into the table. A missing
+ *            file is an empty table. The table must be locked.
+ *********************************************************************/
+static void load_file()
+{
+  FILE *f;
+  char line[256];
+  unsigned long long hash;
+  TBeamformConfig cfg;
+  double time;
+
+  loaded = TRUE;
+  default_file();
+  f = fopen(file, "r");
+  if (f == NULL) return;
+  while (fgets(line, sizeof(line), f) != NULL){
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%llx %u %u %lf", &hash, &cfg.no_threads,
+               &cfg.lines_per_task, &time) == 4)
+      store_entry((ui64)hash, &cfg, time);
+  }
+  fclose(f);
+}
+
+
+/*********************************************************************
+ * FUNCTION : save_file
+ * ABSTRACT : Write the table. The table must be locked.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+static si32 save_file()
+{
+  FILE *f;
+  char tmp[1100];
+  ui32 i;
+
+  sprintf(tmp, "%s.tmp", file);
+  f = fopen(tmp, "w");
+  if (f == NULL){
+    errprintf(": cannot create \"%s\"\n", tmp);
+    return FALSE;
+  }
+  fprintf(f, "# bft_autotune: geometry threads lines_per_task seconds\n");
+  for (i = 0; i < no_entries; i++)
+    fprintf(f, "%016llx %u %u %.9g\n", (unsigned long long)entries[i].hash,
+            entries[i].cfg.no_threads, entries[i].cfg.lines_per_task,
+            entries[i].time);
+  if (fclose(f) != 0 || rename(tmp, file) != 0){
+    remove(tmp);
+    errprintf(": cannot write \"%s\"\n", file);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_config
+ * ABSTRACT : Settings of beamform_image() for a geometry: the tuned
+ *            ones, or all threads and one line per task.
+ *********************************************************************/
+void autotune_config(TFocusLineCollection *flc, TApoLineCollection *alc,
+                     TSysParams *sys, ui32 no_samples, si32 sta,
+                     TBeamformConfig *cfg)
+{
+  ui64 hash;
+  ui32 i;
+
+  cfg->no_threads = 0;
+  cfg->lines_per_task = 1;
+  if (!enabled) return;
+
+  hash = autotune_hash(flc, alc, sys, no_samples, sta);
+  lock_table();
+  if (!loaded) load_file();
+  for (i = 0; i < no_entries; i++)
+    if (entries[i].hash == hash){
+      *cfg = entries[i].cfg;
+      break;
+    }
+  unlock_table();
+}
+
+
+/*********************************************************************
+ * FUNCTION : now
+ * RETURNS  : A monotonic time in s. Not from stats.c, which may be
+ *            compiled out.
+ *********************************************************************/
+static double now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*********************************************************************
+ * FUNCTION : time_config
+ * RETURNS  : The shortest time of 'repeats' images, in s, or a
+ *            negative value if the beamforming fails.
+ *********************************************************************/
+static double time_config(TFocusLineCollection *flc, TApoLineCollection *alc,
+                          TSysParams *sys, double time, double **rf_data,
+                          ui32 no_samples, ui32 element_no, TPoint3D *xmt,
+                          ui32 repeats, TBeamformConfig *cfg)
+{
+  double **bf, best = -1, t, start;
+  ui32 r, i;
+
+  for (r = 0; r <= repeats; r++){
+    start = now();
+    bf = beamform_image_config(flc, alc, sys, time, rf_data, no_samples,
+                               element_no, xmt, NULL, cfg);
+    t = now() - start;
+    if (bf == NULL) return -1;
+    for (i = 0; i < flc->no_focus_time_lines; i++) free(bf[i]);
+    free(bf);
+    /* The first image warms the caches up */
+    if (r > 0 && (best < 0 || t < best)) best = t;
+  }
+  return best;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_run
+ * ABSTRACT : Time the candidates on the current geometry, keep the
+ *            fastest in the table and write the file. The candidates
+ *            are 1, 2, 4, ... threads up to bft_get_no_threads(),
+ *            with 1, 2, 4, ... lines per task as long as every thread
+ *            gets a task.
+ * ARGUMENTS: The arguments of beamform_image(), and the number of
+ *            timed images per candidate.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 autotune_run(TFocusLineCollection *flc, TApoLineCollection *alc,
+                  TSysParams *sys, double time, double **rf_data,
+                  ui32 no_samples, ui32 element_no, TPoint3D *xmt,
+                  ui32 repeats, TTuneResult *res)
+{
+  TBeamformConfig cfg;
+  ui32 no_cpus, no_lines = flc->no_focus_time_lines, last;
+  double t;
+  si32 ok;
+
+  PFUNC
+  no_cpus = bft_get_no_threads();
+  if (repeats == 0) repeats = 1;
+
+  memset(res, 0, sizeof(TTuneResult));
+  res->hash = autotune_hash(flc, alc, sys, no_samples,
+                            xmt != NULL || beamform_is_element(flc, element_no));
+  res->best_time = -1;
+
+  for (cfg.no_threads = 1, last = FALSE; !last; cfg.no_threads *= 2){
+    if (cfg.no_threads >= no_cpus){
+      cfg.no_threads = no_cpus;
+      last = TRUE;
+    }
+    for (cfg.lines_per_task = 1; res->no_tried < TUNE_MAX_CANDIDATES;
+         cfg.lines_per_task *= 2){
+      t = time_config(flc, alc, sys, time, rf_data, no_samples, element_no,
+                      xmt, repeats, &cfg);
+      if (t < 0){
+        printf("\007 autotune_run:\n");
+        printf("Error : the beamforming is unsuccessful\n");
+        return FALSE;
+      }
+      res->tried[res->no_tried] = cfg;
+      res->time[res->no_tried ++] = t;
+      if (res->best_time < 0 || t < res->best_time){
+        res->best = cfg;
+        res->best_time = t;
+      }
+      if (cfg.lines_per_task * 2 * cfg.no_threads > no_lines) break;
+    }
+  }
+
+  lock_table();
+  if (!loaded) load_file();
+  ok = store_entry(res->hash, &res->best, res->best_time) && save_file();
+  unlock_table();
+  return ok;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_enable
+ * ABSTRACT : Use the tuned settings in beamform_image(), or not.
+ *********************************************************************/
+void autotune_enable(si32 on)
+{
+  enabled = on;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_set_file
+ * ABSTRACT : Use another file. The table is read again from it.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 autotune_set_file(char *file_name)
+{
+  if (strlen(file_name) + 5 > sizeof(file)){
+    errprintf(": the name \"%s\" is too long\n", file_name);
+    return FALSE;
+  }
+  lock_table();
+  strcpy(file, file_name);
+  no_entries = 0;
+  loaded = FALSE;
+  unlock_table();
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : autotune_clear
+ * ABSTRACT : Release the table. It is read again when needed.
+ *********************************************************************/
+void autotune_clear()
+{
+  lock_table();
+  free(entries);
+  entries = NULL;
+  no_entries = max_entries = 0;
+  loaded = FALSE;
+  unlock_table();
+}
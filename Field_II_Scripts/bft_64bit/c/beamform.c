@@ -6,6 +6,11 @@
 
 #include "../h/beamform.h" 
 #include "../h/error.h"
+#include "../h/stats.h"
+#include "../h/trace.h"
+#include "../h/perfctr.h"
+#include "../h/threads.h"
+#include "../h/autotune.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -14,6 +19,84 @@
 #include <pthread.h>
 #endif
 
+/*********************************************************************
+ * FUNCTION  : window_whole
+ * ABSTRACT  : A window with all the 'no_out' samples of a line.
+ *********************************************************************/
+static void window_whole(TLineWindow *w, ui32 no_out)
+{
+  w->first = 0;
+  w->count = no_out;
+  w->step = 1;
+  w->taps = NULL;
+  w->no_taps = 0;
+}
+
+
+/*********************************************************************
+ * FUNCTION  : window_start, window_end
+ * RETURNS   : The range of full rate samples that the window uses, 
+ *             with the margins of the filter. The end is at most 
+ *             'limit'.
+ *********************************************************************/
+static ui32 window_start(TLineWindow *w)
+{
+  ui32 half = (w->taps != NULL) ? (w->no_taps - 1) / 2 : 0;
+
+  return (w->first > half) ? w->first - half : 0;
+}
+
+static ui32 window_end(TLineWindow *w, ui32 limit)
+{
+  ui32 end;
+
+  if (w->count == 0) return 0;
+  end = w->first + (w->count - 1) * w->step + 1;
+  if (w->taps != NULL) end += w->no_taps - 1 - (w->no_taps - 1) / 2;
+  return (end < limit) ? end : limit;
+}
+
+
+/*********************************************************************
+ * FUNCTION  : window_needed
+ * RETURNS   : TRUE if the full rate sample 'os' goes into the output
+ *             of the window. Without a filter these are the samples 
+ *             first + m*step, with one the 'no_taps' around each.
+ *********************************************************************/
+static si32 window_needed(TLineWindow *w, ui32 os)
+{
+  ui32 t;
+
+  if (w->step == 1 && w->taps == NULL) return os >= w->first;
+  if (w->taps == NULL)
+    return os >= w->first && (os - w->first) % w->step == 0;
+  t = os + (w->no_taps - 1) / 2;
+  return t >= w->first && (t - w->first) % w->step < w->no_taps;
+}
+
+
+/*********************************************************************
+ * FUNCTION  : window_store
+ * ABSTRACT  : Put the full rate sample 'os' of value 'v' in the output
+ *             'out' of the window. With a filter, output m is
+ *             sum_j taps[j] * x(first + m*step - (no_taps-1)/2 + j),
+ *             and 'out' must be cleared before.
+ *********************************************************************/
+static void window_store(TLineWindow *w, double *out, ui32 os, double v)
+{
+  ui32 t, j;
+
+  if (w->taps == NULL){
+    t = (os - w->first) / w->step;
+    if (t < w->count) out[t] = v;
+    return;
+  }
+  t = os + (w->no_taps - 1) / 2 - w->first;
+  for (j = t % w->step; j < w->no_taps && j <= t; j += w->step)
+    if ((t - j) / w->step < w->count) out[(t - j) / w->step] += w->taps[j] * v;
+}
+
+
 /*********************************************************************
  * FUNCTION  : beamform_line_times(ftl, sys, time, rf_data, no_samples )
  * ABSTRACT  : beamform one line, which has multiple focal points in
@@ -34,14 +117,36 @@
 
 double* beamform_line_times(TFocusTimeLine *ftl, TSysParams* sys,
 			    double time, double **rf_data, ui32 no_samples) 
+{
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_line_times_window(ftl, sys, time, rf_data, no_samples, &w);
+}
+
+
+/*********************************************************************
+ * FUNCTION  : beamform_line_times_window
+ * ABSTRACT  : As beamform_line_times(), but only the output samples
+ *             of the window 'w' are beamformed. The focal zones are
+ *             walked to the window without touching the data, so the
+ *             result is equal to the same samples of the whole line.
+ * RETURNS   : 'w->count' samples, allocated here. The samples past
+ *             the end of the line are 0.
+ *********************************************************************/
+double* beamform_line_times_window(TFocusTimeLine *ftl, TSysParams* sys,
+                                   double time, double **rf_data, 
+                                   ui32 no_samples, TLineWindow *w)
 {
   double *bf_line;
   ui32 os;         /*  Index of output sample       */
+  ui32 end;        /*  End of the output window     */
   ui32 o_abs_s;    /*  Output absolut index         */
   ui32 is1;        /*  Index of input sample1       */
   si32 *d;         /*  Pointer to the delays        */
   double *a;       /*  Coefficient for linear interpolation */
   double A;        /*  One apodization value        */
+  double sum;      /*  The current output sample    */
   ui32 id;         /*  Index of delay               */
   ui32 ind;        /*  Index of next delay          */
   ui32 no_elements;/*  Number of XDC elements       */
@@ -49,7 +154,9 @@ double* beamform_line_times(TFocusTimeLine *ftl, TSysParams* sys,
 
   PFUNC;
   
-  bf_line = (double *) malloc(no_samples * sizeof(double));
+  bf_line = (double *) calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
+  end = window_end(w, no_samples);
   o_abs_s = (ui32)floor(time * sys->fs);
   id = 0;
   ind = id + 1;
@@ -60,34 +167,40 @@ double* beamform_line_times(TFocusTimeLine *ftl, TSysParams* sys,
    *   which  is less than 'time'
    */  
   while( (ftl->delay[ind].time < o_abs_s)) {  ind ++; id ++;}
+  for (os = 0; os < window_start(w) && os < end; o_abs_s++, os ++)
+    if (o_abs_s > ftl->delay[ind].time) { ind ++; id ++; }
+  if (os >= end) return bf_line;
+  focus_prepare_zones(ftl, id, o_abs_s + (end - os) - 1);
 
   d = ftl->delay[id].d;
   a = ftl->delay[id].a;
   /*
    *   Beamform the output line one sample at a time. 
    */    
-  for (os = 0; os < no_samples; o_abs_s++, os ++)
+  for (; os < end; o_abs_s++, os ++)
     {
-      bf_line[os] = 0;
+      sum = 0;
       if (o_abs_s > ftl->delay[ind].time) 
 	{
 	  ind ++; id ++;
 	  d = ftl->delay[id].d;
 	  a = ftl->delay[id].a;
 	}
+      if (!window_needed(w, os)) continue;
       for (ic = 0; ic < no_elements; ic ++ )
 	{  
           is1  = os - d[ic];
 	  if (is1 == 0) {
-	    bf_line[os] += rf_data[ic][is1];
+	    sum += rf_data[ic][is1];
 	  } 
 	  else if (is1 < no_samples-1)
 	    {
 	      A = a[ic];
-	      bf_line[os] +=  (double)rf_data[ic][is1] * (1-A)
+	      sum +=  (double)rf_data[ic][is1] * (1-A)
 		+ (double)rf_data[ic][is1-1] * A;
 	    }
 	}  
+      window_store(w, bf_line, os, sum);
     }
   return bf_line;
 }
@@ -144,14 +257,34 @@ double** apodize_fix(TApoTimeLine *atl, double **rf_data,
 double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
 				TSysParams* sys, double time, 
 				double **rf_data, ui32 no_samples) 
+{
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_apo_line_times_window(ftl, atl, sys, time, rf_data, 
+                                        no_samples, &w);
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_apo_line_times_window
+ * ABSTRACT : As beamform_apo_line_times(), for the output samples
+ *            in the window 'w' only.
+ *********************************************************************/
+double* beamform_apo_line_times_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+                                       TSysParams* sys, double time, 
+                                       double **rf_data, ui32 no_samples,
+                                       TLineWindow *w) 
 {
   double *bf_line;
   ui32 os;                /*  Index of output sample       */
+  ui32 end;               /*  End of the output window     */
   ui32 o_abs_s;           /*  Output absolut index         */
   ui32 is1;               /*  Index of input sample1       */
   si32 *d;                /*  Pointer to the delays        */
   double *a;              /*  Apodization array            */
   double A;               /*  One apodization value        */
+  double sum;             /*  The current output sample    */
   ui32 id;                /*  Index of delay               */
   ui32 ind;               /*  Index of next delay          */
   ui32 no_elements;       /*  No of elements in XDC        */
@@ -162,10 +295,11 @@ double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
 
   
   if (atl->no_times == 0){
-    return beamform_line_times(ftl,sys,time,rf_data,no_samples);
+    return beamform_line_times_window(ftl,sys,time,rf_data,no_samples,w);
   }
   
-  bf_line = (double *) malloc(no_samples * sizeof(double));
+  bf_line = (double *) calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
   o_abs_s = (ui32)floor(time * sys->fs);
   id = 0; ind = 1; 
   ia = 0; ina = 1;
@@ -180,19 +314,27 @@ double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
   while( ftl->delay[ind].time < o_abs_s ) {  ind ++; id ++;}
   while( atl->a[ina].time < o_abs_s) {ina ++; ia ++;}
   
+  /*
+   *   The last sample of the line is always 0
+   */
+  no_samples--;
+  end = window_end(w, no_samples);
+  for (os = 0; os < window_start(w) && os < end; o_abs_s++, os ++){
+    if (o_abs_s > ftl->delay[ind].time) { ind ++; id ++; }
+    if (o_abs_s > atl->a[ina].time) { ina ++; ia ++; }
+  }
+  if (os >= end) return bf_line;
+  focus_prepare_zones(ftl, id, o_abs_s + (end - os) - 1);
+
   d = ftl->delay[id].d;
   a = ftl->delay[id].a;
   apo = atl->a[ia].a;
   
- 
-  
   /*
    *   Beamform the output line one sample at a time. 
    */    
-  no_samples--;
-  bf_line[no_samples] = 0;  
-  for (os = 0; os < no_samples; o_abs_s++, os ++){  
-    bf_line[os] = 0;
+  for (; os < end; o_abs_s++, os ++){  
+    sum = 0;
     if (o_abs_s > ftl->delay[ind].time) 
       {
         ind ++; id ++;
@@ -206,6 +348,7 @@ double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
         ina ++; ia ++;
         apo = atl->a[ia].a;
       }
+    if (!window_needed(w, os)) continue;
 
     for (ic = 0; ic < no_elements; ic ++ ){  
       is1  = os - d[ic];
@@ -214,15 +357,17 @@ double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
 	A = a[ic];
 	d =  (double)rf_data[ic][is1] * (1-A)
 	  + (double)rf_data[ic][is1-1] * A;           
-	bf_line[os] += d*apo[ic];
+	sum += d*apo[ic];
       }
     }  
+    window_store(w, bf_line, os, sum);
   }
   return bf_line;
 }
 
 
 
+
 /**********************************************************************
  * FUNCTION : beamform_apo_line_dynamic
  * ABSTRACT : Dynamically focus and apodize a scan line
@@ -230,6 +375,24 @@ double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
 double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
 				  TSysParams* sys, double time,  double **rf_data, ui32 no_samples)
 {
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_apo_line_dynamic_window(ftl, atl, sys, time, rf_data,
+                                          no_samples, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_apo_line_dynamic_window
+ * ABSTRACT : Dynamically focus and apodize the output samples 
+ *            in the window 'w' of a scan line
+ **********************************************************************/
+double* beamform_apo_line_dynamic_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+                                         TSysParams* sys, double time,  
+                                         double **rf_data, ui32 no_samples,
+                                         TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -240,8 +403,10 @@ double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
   double dR;
   
   double sample_index; /* The true value of the input index            */
+  double sum;          /* The current output sample                    */
   ui32 o_abs_s;        /* Absolute output index                        */
   ui32 os;             /* Output index for bf_line                     */
+  ui32 end;            /* End of the output window                     */
   ui32 is1;            /*is1, is2 - Input indeces of the used  samples */
   ui32 ia;             /* Index of the currently used apodization      */
   ui32 ina;            /* Index of the next apodization value          */
@@ -251,9 +416,15 @@ double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
   double *apo;         /* Array with the current apodization values    */
 
 
-
+  if (atl->no_times==0){
+    printf("\007 For the time being the dynamic focusing is ");
+    printf("performed only on lines for which apodization is ");
+    printf("specified.\n");
+    return NULL;
+  }
   
-  bf_line = (double*)malloc(no_samples*sizeof(double));
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
   xdc = ftl->xdc;
   
   dR = sys->c / sys->fs / 2;
@@ -270,28 +441,33 @@ double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
   p.y = ftl->center.y + dY*o_abs_s;
   p.z = ftl->center.z + dZ*o_abs_s;
   
-
-  if (atl->no_times==0){
-    printf("\007 For the time being the dynamic focusing is ");
-    printf("performed only on lines for which apodization is ");
-    printf("specified.\n");
-    return NULL;
-  }
-  
-  
   ia = 0; ina = 1;
   while( atl->a[ina].time < o_abs_s) {ina ++; ia ++;}
-  apo = atl->a[ia].a;
   
   no_samples--;
-  bf_line[no_samples] = 0;
-  for (os = 0; os < no_samples; o_abs_s++, os ++){
+  end = window_end(w, no_samples);
+  /* Move the focal point and the apodization to the window */
+  for (os = 0; os < window_start(w) && os < end; o_abs_s++, os ++){
+    if (o_abs_s > atl->a[ina].time) { ina ++; ia ++; }
+    p.x+=dX;
+    p.y+=dY;
+    p.z+=dZ;     
+  }
+  apo = atl->a[ia].a;
+
+  for (; os < end; o_abs_s++, os ++){
     if (o_abs_s > atl->a[ina].time) {
       ina ++; ia ++;
       apo = atl->a[ia].a;
     }
+    if (!window_needed(w, os)){
+      p.x+=dX;
+      p.y+=dY;
+      p.z+=dZ;
+      continue;
+    }
 
-    bf_line[os] = 0;
+    sum = 0;
      
     for(ic = 0; ic < xdc->no_elements; ic ++){
       sample_index = distance(&ftl->center, &p)*sys->fs;
@@ -300,10 +476,11 @@ double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
       is1 = (ui32)floor(sample_index);
       if (is1 < no_samples-1){
 	A = sample_index - is1;
-	bf_line[os] += apo[ic]*(rf_data[ic][is1]*(1-A)
-				+ rf_data[ic][is1+1]*A);
+	sum += apo[ic]*(rf_data[ic][is1]*(1-A)
+			+ rf_data[ic][is1+1]*A);
       }
     }
+    window_store(w, bf_line, os, sum);
 
     p.x+=dX;
     p.y+=dY;
@@ -319,6 +496,22 @@ double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
 double* beamform_line_dynamic(TFocusTimeLine *ftl, 
 			      TSysParams* sys, double time,  double **rf_data, ui32 no_samples)
 {
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_line_dynamic_window(ftl, sys, time, rf_data, no_samples, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_line_dynamic_window
+ * ABSTRACT : Dynamically focus the output samples in the window 'w'
+ *            of a scan line
+ **********************************************************************/
+double* beamform_line_dynamic_window(TFocusTimeLine *ftl, TSysParams* sys,
+                                     double time,  double **rf_data, 
+                                     ui32 no_samples, TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -329,14 +522,17 @@ double* beamform_line_dynamic(TFocusTimeLine *ftl,
   double dR;
   
   double sample_index; /* The true value of the input index            */
+  double sum;          /* The current output sample                    */
   ui32 o_abs_s;        /* Absolute output index                        */
   ui32 os;             /* Output index for bf_line                     */
+  ui32 end;            /* End of the output window                     */
   ui32 is1;            /*is1, is2 - Input indeces of the used  samples */
   ui32 ic;             /* Index of channel                             */
   double A;            /* Coefficient for linear interpolation         */
   
   
-  bf_line = (double*)malloc(no_samples*sizeof(double));
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
   xdc = ftl->xdc;
   
   dR = sys->c / sys->fs / 2;
@@ -355,10 +551,21 @@ double* beamform_line_dynamic(TFocusTimeLine *ftl,
   
   
   no_samples--;
-  bf_line[no_samples] = 0;
-  for (os = 0; os < no_samples; o_abs_s++, os ++){
+  end = window_end(w, no_samples);
+  for (os = 0; os < window_start(w) && os < end; o_abs_s++, os ++){
+    p.x+=dX;
+    p.y+=dY;
+    p.z+=dZ;     
+  }
+  for (; os < end; o_abs_s++, os ++){
+    if (!window_needed(w, os)){
+      p.x+=dX;
+      p.y+=dY;
+      p.z+=dZ;
+      continue;
+    }
 
-    bf_line[os] = 0;
+    sum = 0;
      
     for(ic = 0; ic < xdc->no_elements; ic ++){
       sample_index = distance(&ftl->center, &p)*sys->fs;
@@ -367,10 +574,11 @@ double* beamform_line_dynamic(TFocusTimeLine *ftl,
       is1 = (ui32)floor(sample_index);
       if (is1 < no_samples-1){
 	A = sample_index - is1;
-	bf_line[os] += (rf_data[ic][is1]*(1-A)
-			+ rf_data[ic][is1+1]*A);
+	sum += (rf_data[ic][is1]*(1-A)
+		+ rf_data[ic][is1+1]*A);
       }
     }
+    window_store(w, bf_line, os, sum);
 
     p.x+=dX;
     p.y+=dY;
@@ -390,6 +598,24 @@ double* beamform_line_dynamic(TFocusTimeLine *ftl,
 double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
 				      TSysParams* sys, double time,  double **rf_data, ui32 no_samples, TPoint3D *xmt)
 {
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_apo_line_dynamic_sta_window(ftl, atl, sys, time, rf_data,
+                                              no_samples, xmt, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_apo_line_dynamic_sta_window
+ * ABSTRACT : Dynamically focus and apodize the output samples 
+ *            in the window 'w' of a scan line
+ **********************************************************************/
+double* beamform_apo_line_dynamic_sta_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+                                             TSysParams* sys, double time,  
+                                             double **rf_data, ui32 no_samples, 
+                                             TPoint3D *xmt, TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -402,6 +628,7 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
   double sample_index; /* The true value of the input index            */
   ui32 o_abs_s;        /* Absolute output index                        */
   ui32 os;             /* Output index for bf_line                     */
+  ui32 end;            /* End of the output window                     */
   ui32 is1;            /*is1, is2 - Input indeces of the used  samples */
   ui32 ia;             /* Index of the currently used apodization      */
   ui32 ina;            /* Index of the next apodization value          */
@@ -416,7 +643,16 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
 	
   PFUNC;
   
-  bf_line = (double*)malloc(no_samples*sizeof(double));
+  /* Apodization is always set when this function is used. */
+  if (atl->no_times==0){
+    printf("\007 For the time being the dynamic focusing is ");
+    printf("performed only on lines for which apodization is ");
+    printf("specified.\n");
+    return NULL;
+  }
+  
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
   xdc = ftl->xdc;
   
   /* Radial distance per sample */
@@ -438,29 +674,28 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
   p.y = ftl->center.y + dY*o_abs_s;
   p.z = ftl->center.z + dZ*o_abs_s;
   
-  /* Apodization is always set when this function is used. */
-  if (atl->no_times==0){
-    printf("\007 For the time being the dynamic focusing is ");
-    printf("performed only on lines for which apodization is ");
-    printf("specified.\n");
-    return NULL;
-  }
-  
   /* Seems like apodization time has to be in samples, not documented. */
   ia = 0; ina = 1;
   while( atl->a[ina].time < o_abs_s) {ina ++; ia ++;}
-  apo = atl->a[ia].a;
   
   /* Only want to iterate until 2nd last sample (last is always 0) */
   no_samples--;
+  end = window_end(w, no_samples);
   
   scaler = sys->fs / sys->c;  /* Scaler converts from distance to samples */
   time_sample = time * sys->fs; /* Start of data in samples. */
   
-  bf_line[no_samples] = 0;
+  /* Move the point and the apodization to the start of the window */
+  for (os = 0; os < window_start(w) && os < end; o_abs_s++, os ++){
+    if (o_abs_s > atl->a[ina].time) { ina ++; ia ++; }
+    p.x+=dX;
+    p.y+=dY;
+    p.z+=dZ;
+  }
+  apo = atl->a[ia].a;
   sample_base_index = 0;
   
-  for (os = 0; os < no_samples; o_abs_s++, os ++){
+  for (; os < end; o_abs_s++, os ++){
     double d;
 
     /* Advance the apodization if necessary */
@@ -468,6 +703,12 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
       ina ++; ia ++;
       apo = atl->a[ia].a;
     }
+    if (!window_needed(w, os)){
+      p.x+=dX;
+      p.y+=dY;
+      p.z+=dZ;
+      continue;
+    }
 
     /* Find number of samples (along beam-line) from transmit location and
        offset to start of data (i.e. initial travel). */
@@ -489,7 +730,7 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
     }
     
     /* Store data, move to next point. */
-    bf_line[os] = d;
+    window_store(w, bf_line, os, d);
 
     p.x+=dX;
     p.y+=dY;
@@ -507,6 +748,24 @@ double* beamform_apo_line_dynamic_sta(TFocusTimeLine *ftl, TApoTimeLine* atl,
 double* beamform_line_dynamic_sta(TFocusTimeLine *ftl, 
 				  TSysParams* sys, double time,  double **rf_data, ui32 no_samples, TPoint3D* xmt)
 {
+  TLineWindow w;
+
+  window_whole(&w, no_samples);
+  return beamform_line_dynamic_sta_window(ftl, sys, time, rf_data, no_samples,
+                                          xmt, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_line_dynamic_sta_window
+ * ABSTRACT : Dynamically focus the output samples in the window 'w'
+ *            of a scan line
+ **********************************************************************/
+double* beamform_line_dynamic_sta_window(TFocusTimeLine *ftl, TSysParams* sys,
+                                         double time,  double **rf_data, 
+                                         ui32 no_samples, TPoint3D* xmt,
+                                         TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -518,6 +777,7 @@ double* beamform_line_dynamic_sta(TFocusTimeLine *ftl,
   
   double sample_index; /* The true value of the input index            */
   ui32 os;             /* Output index for bf_line                     */
+  ui32 end;            /* End of the output window                     */
   ui32 is1;            /*is1, is2 - Input indeces of the used  samples */
   ui32 ic;             /* Index of channel                             */
   double A;            /* Coefficient for linear interpolation         */
@@ -527,7 +787,8 @@ double* beamform_line_dynamic_sta(TFocusTimeLine *ftl,
   
   PFUNC
   
-    bf_line = (double*)malloc(no_samples*sizeof(double));
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
   xdc = ftl->xdc;
   
   dR = sys->c / sys->fs / 2;
@@ -548,12 +809,24 @@ double* beamform_line_dynamic_sta(TFocusTimeLine *ftl,
   
   
   no_samples--;
-  bf_line[no_samples] = 0;
+  end = window_end(w, no_samples);
   scaler = sys->fs / sys->c;
   
+  for (os = 0; os < window_start(w) && os < end; os ++){
+    p.x+=dX;
+    p.y+=dY;
+    p.z+=dZ;     
+  }
   
-  for (os = 0; os < no_samples; os ++){
+  for (; os < end; os ++){
     double d;
+
+    if (!window_needed(w, os)){
+      p.x+=dX;
+      p.y+=dY;
+      p.z+=dZ;
+      continue;
+    }
      
     d = 0;
     sample_base_index = distance(xmt, &p) * scaler - time_sample;
@@ -563,11 +836,11 @@ double* beamform_line_dynamic_sta(TFocusTimeLine *ftl,
       is1 = (ui32)floor(sample_index);
       if (is1 < no_samples-1){
 	A = sample_index - is1;
-	bf_line[os] += (rf_data[ic][is1]*(1-A)
-			+ rf_data[ic][is1+1]*A);
+	d += (rf_data[ic][is1]*(1-A)
+	      + rf_data[ic][is1+1]*A);
       }
     }
-    bf_line[os] = d;
+    window_store(w, bf_line, os, d);
     p.x+=dX;
     p.y+=dY;
     p.z+=dZ;     
@@ -576,6 +849,7 @@ double* beamform_line_dynamic_sta(TFocusTimeLine *ftl,
 }
 
 
+
 /**********************************************************************
  * FUNCTION : beamform_line_pixels
  * ABSTRACT : Beamform a line using pixel-based focusing.
@@ -584,6 +858,24 @@ double* beamform_line_pixels(TFocusTimeLine *ftl, TSysParams* sys,
 			     double time,  double **rf_data, ui32 no_samples
 			     ,ui32 element_no)
 {
+  TLineWindow w;
+
+  window_whole(&w, ftl->no_times);
+  return beamform_line_pixels_window(ftl, sys, time, rf_data, no_samples,
+                                     element_no, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_line_pixels_window
+ * ABSTRACT : Beamform the pixels in the window 'w' of a line 
+ *            using pixel-based focusing.
+ **********************************************************************/
+double* beamform_line_pixels_window(TFocusTimeLine *ftl, TSysParams* sys,
+                                    double time,  double **rf_data, 
+                                    ui32 no_samples, ui32 element_no,
+                                    TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -592,10 +884,12 @@ double* beamform_line_pixels(TFocusTimeLine *ftl, TSysParams* sys,
   double xmt_index=0;    /* Index of the sample connected with the transmit */
   double sample_index=0;
   double start_index;
+  double sum;          /* The current output sample                    */
   TPoint3D *p;        /* Focal point  */
   ui32 is1;           /* Input sample */
   ui32 is2;           /* Input sample  */
   ui32 os;            /* Output sample */
+  ui32 end;           /* End of the output window */
   ui32 ic;            /* Index of channel */
   int flag; 
   
@@ -612,15 +906,18 @@ double* beamform_line_pixels(TFocusTimeLine *ftl, TSysParams* sys,
     assert(ftl->pixels);
   }
   printf("beamform_pixels:\n");
-  bf_line = (double*)malloc(ftl->no_times*sizeof(double));
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
+  end = window_end(w, ftl->no_times);
   
   start_index = time * sys->fs;
   xdc = ftl->xdc;
   
   flag = element_no >= xdc->no_elements;
     
-  for (os = 0; os < ftl->no_times;  os ++){
-    bf_line[os] = 0;
+  for (os = window_start(w); os < end;  os ++){
+    if (!window_needed(w, os)) continue;
+    sum = 0;
     p = ftl->pixels + os;
       
     if (element_no < xdc->no_elements){
@@ -641,10 +938,11 @@ double* beamform_line_pixels(TFocusTimeLine *ftl, TSysParams* sys,
       is2 = is1 - 1;
       if (is2 < no_samples && is1 < no_samples){
 	A = sample_index - is1;
-	bf_line[os] += (rf_data[ic][is1]*(1-A)
-			+ rf_data[ic][is2]*A);
+	sum += (rf_data[ic][is1]*(1-A)
+		+ rf_data[ic][is2]*A);
       }
     }
+    window_store(w, bf_line, os, sum);
   }
   return bf_line;
 }
@@ -658,6 +956,24 @@ double* beamform_apo_line_pixels(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysPar
 				 double time,  double **rf_data, ui32 no_samples,
 				 ui32 element_no)
 {
+  TLineWindow w;
+
+  window_whole(&w, ftl->no_times);
+  return beamform_apo_line_pixels_window(ftl, atl, sys, time, rf_data, 
+                                         no_samples, element_no, &w);
+}
+
+
+/**********************************************************************
+ * FUNCTION : beamform_apo_line_pixels_window
+ * ABSTRACT : Beamform and apodize the pixels in the window 'w' of
+ *            a line using pixel-based focusing.
+ **********************************************************************/
+double* beamform_apo_line_pixels_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+                                        TSysParams* sys, double time,  
+                                        double **rf_data, ui32 no_samples,
+                                        ui32 element_no, TLineWindow *w)
+{
 
   double *bf_line;     /* The beamformed line                          */
   TTransducer* xdc;    /* Pointer to the transducer used to calc delays*/
@@ -667,11 +983,13 @@ double* beamform_apo_line_pixels(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysPar
   double sample_index=0;
   double start_index=0;
   double xmt_index = 0;
+  double sum;         /* The current output sample */
   TPoint3D *p;        /* Focal point  */
   ui32 ia, ina;       /* Index of apodization value and next apodization value */
   ui32 is1;           /* Input sample */
   ui32 is2;           /* Input sample  */
   ui32 os;            /* Output sample */
+  ui32 end;           /* End of the output window */
   ui32 ic;            /* Index of channel */
   double apo=1;         /* The apodization value to apply  */
   int flag;  
@@ -687,14 +1005,17 @@ double* beamform_apo_line_pixels(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysPar
     assert(ftl->pixels);
   }
   
-  bf_line = (double*)malloc(ftl->no_times*sizeof(double));
+  bf_line = (double*)calloc(w->count > 0 ? w->count : 1, sizeof(double));
+  if (bf_line == NULL) return NULL;
+  end = window_end(w, ftl->no_times);
   
   start_index = time * sys->fs;
   
   xdc = ftl->xdc;
   flag =element_no >= xdc->no_elements ;
-  for (os = 0; os < ftl->no_times;  os ++){
-    bf_line[os] = 0;
+  for (os = window_start(w); os < end;  os ++){
+    if (!window_needed(w, os)) continue;
+    sum = 0;
     p = ftl->pixels + os;
     if (element_no < xdc->no_elements){
       xmt_index = distance(xdc->c+element_no, p)*sys->fs;
@@ -715,10 +1036,11 @@ double* beamform_apo_line_pixels(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysPar
       is2 = is1 + 1;
       if (is2 < no_samples && is1 < no_samples){
 	A = sample_index - is1;
-	bf_line[os] += apo*(rf_data[ic][is1]*(1-A)
-                            + rf_data[ic][is2]*A);
+	sum += apo*(rf_data[ic][is1]*(1-A)
+                    + rf_data[ic][is2]*A);
       }
     }
+    window_store(w, bf_line, os, sum);
   }
   return bf_line;
 }
@@ -727,6 +1049,7 @@ double* beamform_apo_line_pixels(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysPar
 
 
 
+
 /*********************************************************************
  * FUNCTION : sum_lines_time
  * ABSTRACT : Sum 2 already beamformed lines into a new one.
@@ -780,6 +1103,7 @@ double* sum_lines_time(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysParams* sys,
    
   /* Find the first delay and apodization to apply      */
   id = 0; ind = 1;
+  focus_prepare(ftl, sys, time, no_samples);
   while( ftl->delay[ind].time < o_abs_s) {ind ++; id ++;}
   d1 = ftl->delay[id].d[element1]; A1 = ftl->delay[id].a[element1];
   d2 = ftl->delay[id].d[element2]; A2 = ftl->delay[id].a[element1];
@@ -862,50 +1186,318 @@ double **sum_images(TFocusLineCollection *flc, TApoLineCollection *alc,
 /*Thread helper functions for beamforming image at once.*/
 void *beamform_thread_apo(void *param) {
   BFT_ThreadData *info = (BFT_ThreadData *)param;
+  STATS_VAR(t)
+  TRACE_VAR(tr)
+  PERF_VAR(pc)
+
+  STATS_START(t)
+  TRACE_START(tr)
+  PERF_BEGIN(pc, FALSE)
   if (info->flc->ftl[info->i].dynamic == TRUE){
     if (info->elem!=NULL)
-       *info->line = beamform_apo_line_dynamic_sta(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->elem);
+       *info->line = beamform_apo_line_dynamic_sta_window(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->elem,info->window);
     else
-      *info->line = beamform_apo_line_dynamic(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples);
+      *info->line = beamform_apo_line_dynamic_window(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->window);
   }else if(info->flc->ftl[info->i].pixel == TRUE){
-    *info->line = beamform_apo_line_pixels(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,-1);
+    *info->line = beamform_apo_line_pixels_window(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,-1,info->window);
   }else{
-    *info->line = beamform_apo_line_times(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples);
+    *info->line = beamform_apo_line_times_window(info->flc->ftl+info->i,info->alc->atl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->window);
   }
+  PERF_END(pc, TRACE_LINE_MODE(info->flc->ftl + info->i, info->elem))
+  STATS_STOP(STAT_LINE, t)
+  TRACE_END(TRACE_LINE, tr, info->i, TRACE_LINE_MODE(info->flc->ftl + info->i, info->elem),
+            info->window->count, info->flc->ftl[info->i].xdc->no_elements)
+  STATS_COUNT(STAT_SAMPLES, (ui64)info->window->count * info->flc->ftl[info->i].xdc->no_elements)
+  STATS_COUNT(STAT_BYTES, ((ui64)info->window->count * info->flc->ftl[info->i].xdc->no_elements
+                           + info->window->count) * sizeof(double))
+  return NULL;
 }
 
 
 void *beamform_thread_noapo(void *param) {
   BFT_ThreadData *info = (BFT_ThreadData *)param;
+  STATS_VAR(t)
+  TRACE_VAR(tr)
+  PERF_VAR(pc)
+
+  STATS_START(t)
+  TRACE_START(tr)
+  PERF_BEGIN(pc, FALSE)
   if (info->flc->ftl[info->i].dynamic == TRUE){
     if (info->elem!=NULL)
-       *info->line = beamform_line_dynamic_sta(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->elem);
+       *info->line = beamform_line_dynamic_sta_window(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->elem,info->window);
     else
-      *info->line = beamform_line_dynamic(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples);
+      *info->line = beamform_line_dynamic_window(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->window);
   }else if(info->flc->ftl[info->i].pixel == TRUE){
-    *info->line = beamform_line_pixels(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,-1);
+    *info->line = beamform_line_pixels_window(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,-1,info->window);
   }else{
-    *info->line = beamform_line_times(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples);
+    *info->line = beamform_line_times_window(info->flc->ftl+info->i,info->sys,info->time,info->rf_data,info->no_samples,info->window);
+  }
+  PERF_END(pc, TRACE_LINE_MODE(info->flc->ftl + info->i, info->elem))
+  STATS_STOP(STAT_LINE, t)
+  TRACE_END(TRACE_LINE, tr, info->i, TRACE_LINE_MODE(info->flc->ftl + info->i, info->elem),
+            info->window->count, info->flc->ftl[info->i].xdc->no_elements)
+  STATS_COUNT(STAT_SAMPLES, (ui64)info->window->count * info->flc->ftl[info->i].xdc->no_elements)
+  STATS_COUNT(STAT_BYTES, ((ui64)info->window->count * info->flc->ftl[info->i].xdc->no_elements
+                           + info->window->count) * sizeof(double))
+  return NULL;
+}
+
+/*
+ *  Lines of one beamform_image_config()
+ */
+typedef struct{
+  BFT_ThreadData *info;
+  ui32 no_lines;
+  ui32 lines_per_task;
+  si32 apo;               /* TRUE: the lines have apodization          */
+  double **rf_data;       /* Channel data, as given                    */
+  ui32 no_samples;
+  ui32 no_elements;
+  double ***replica;      /* Copy of rf_data per node, or NULL         */
+#ifndef NOTHREAD
+  pthread_mutex_t *lock;  /* One per node                              */
+#endif
+}TLinesJob;
+
+
+/*********************************************************************
+ * FUNCTION : node_rf_data
+ * ABSTRACT : The channel data for the calling worker. With 
+ *            BFT_NUMA_REPLICATE the first worker of a node copies
+ *            them, so that the copy lies in the memory of the node.
+ *            A copy that is already made is read without the lock.
+ * RETURNS  : The copy, or the given data if there is none.
+ *********************************************************************/
+static double **node_rf_data(TLinesJob *job)
+{
+  si32 node = bft_worker_node();
+  double **copy, *block;
+  ui32 e;
+
+  if (job->replica == NULL || node < 0 || node >= BFT_MAX_NODES)
+    return job->rf_data;
+
+  copy = __atomic_load_n(job->replica + node, __ATOMIC_ACQUIRE);
+  if (copy != NULL) return copy;
+
+#ifndef NOTHREAD
+  pthread_mutex_lock(job->lock + node);
+#endif
+  if (job->replica[node] == NULL){
+    copy = (double**)malloc(job->no_elements * sizeof(double*));
+    block = (double*)malloc((size_t)job->no_elements * job->no_samples * sizeof(double));
+    if (copy != NULL && block != NULL){
+      for (e = 0; e < job->no_elements; e++){
+        copy[e] = block + (size_t)e * job->no_samples;
+        memcpy(copy[e], job->rf_data[e], job->no_samples * sizeof(double));
+      }
+      __atomic_store_n(job->replica + node, copy, __ATOMIC_RELEASE);
+    }else{
+      free(copy);
+      free(block);
+    }
+  }
+  copy = job->replica[node];
+#ifndef NOTHREAD
+  pthread_mutex_unlock(job->lock + node);
+#endif
+  return (copy != NULL) ? copy : job->rf_data;
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_lines_task
+ * ABSTRACT : Beamform one group of lines.
+ *********************************************************************/
+static void beamform_lines_task(void *ctx, ui32 item)
+{
+  TLinesJob *job = (TLinesJob*)ctx;
+  double **rf_data = node_rf_data(job);
+  ui32 i, last;
+
+  last = (item + 1) * job->lines_per_task;
+  if (last > job->no_lines) last = job->no_lines;
+  for (i = item * job->lines_per_task; i < last; i++){
+    job->info[i].rf_data = rf_data;
+    if (job->apo)
+      beamform_thread_apo(job->info + i);
+    else
+      beamform_thread_noapo(job->info + i);
   }
 }
 
+
+/*********************************************************************
+ * FUNCTION : replicate_begin
+ * ABSTRACT : Prepare the copies of the channel data per node, if
+ *            BFT_NUMA_REPLICATE is set, the workers are pinned and
+ *            there are several nodes, and more than one of the
+ *            'no_threads' works on the image. The copies are made on
+ *            demand by node_rf_data().
+ *********************************************************************/
+static void replicate_begin(TLinesJob *job, TFocusLineCollection *flc,
+                            ui32 no_threads)
+{
+  ui32 i, no_nodes;
+
+  job->replica = NULL;
+  if (no_threads == 0) no_threads = bft_get_no_threads();
+  if (!(bft_get_numa() & BFT_NUMA_REPLICATE) 
+      || no_threads < 2
+      || bft_get_affinity() == BFT_AFFINITY_NONE
+      || (no_nodes = bft_no_nodes()) < 2)
+    return;
+
+  job->no_elements = 0;
+  for (i = 0; i < flc->no_focus_time_lines; i++)
+    if (flc->ftl[i].xdc->no_elements > job->no_elements)
+      job->no_elements = flc->ftl[i].xdc->no_elements;
+
+  job->replica = (double***)calloc(no_nodes, sizeof(double**));
+#ifndef NOTHREAD
+  job->lock = (pthread_mutex_t*)malloc(no_nodes * sizeof(pthread_mutex_t));
+  if (job->lock == NULL){
+    free(job->replica);
+    job->replica = NULL;
+    return;
+  }
+  for (i = 0; i < no_nodes; i++) pthread_mutex_init(job->lock + i, NULL);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : replicate_end
+ * ABSTRACT : Free the copies of the channel data.
+ *********************************************************************/
+static void replicate_end(TLinesJob *job)
+{
+  ui32 i, no_nodes = bft_no_nodes();
+
+  if (job->replica == NULL) return;
+  for (i = 0; i < no_nodes; i++){
+    if (job->replica[i] != NULL){
+      free(job->replica[i][0]);
+      free(job->replica[i]);
+    }
+#ifndef NOTHREAD
+    pthread_mutex_destroy(job->lock + i);
+#endif
+  }
+#ifndef NOTHREAD
+  free(job->lock);
+#endif
+  free(job->replica);
+}
+
+/*********************************************************************
+ * FUNCTION : beamform_no_out
+ * RETURNS  : The number of samples in one beamformed line. A single
+ *            line focused in pixels has one sample per pixel.
+ *********************************************************************/
+ui32 beamform_no_out(TFocusLineCollection *flc, ui32 no_samples)
+{
+  if (flc->no_focus_time_lines == 1 && flc->ftl[0].pixel == TRUE)
+    return flc->ftl[0].no_times;
+  return no_samples;
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_is_element
+ * RETURNS  : TRUE if 'element_no' is an element of the transducer of
+ *            the lines, i.e. the data are from the emission of that
+ *            element. Any other value, as (ui32)-1, means none.
+ *********************************************************************/
+si32 beamform_is_element(TFocusLineCollection *flc, ui32 element_no)
+{
+  return flc->no_focus_time_lines > 0 && flc->ftl[0].xdc != NULL
+         && element_no < flc->ftl[0].xdc->no_elements;
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_roi_samples
+ * RETURNS  : The number of samples per line beamformed for 'roi' (NULL
+ *            - the whole image), after the decimation, or 0 if the 
+ *            window lies past the end of the lines.
+ *********************************************************************/
+ui32 beamform_roi_samples(TFocusLineCollection *flc, ui32 no_samples,
+                          TBeamformROI *roi)
+{
+  ui32 no_out = beamform_no_out(flc, no_samples), n, step;
+
+  if (roi == NULL) return no_out;
+  if (roi->first_sample >= no_out) return 0;
+  n = no_out - roi->first_sample;
+  if (roi->no_samples > 0 && roi->no_samples < n) n = roi->no_samples;
+  step = (roi->decimation > 1) ? roi->decimation : 1;
+  return (n + step - 1) / step;
+}
+
+
 /*********************************************************************
  * FUNCTION  : beamform_image()
- * ABSTRACT  : beamforms a whole image
+ * ABSTRACT  : beamforms a whole image, with the settings found by 
+ *             the auto-tuner for this geometry, if any
  *
  *********************************************************************/
 double** beamform_image(TFocusLineCollection *flc, TApoLineCollection* alc,
 			TSysParams* sys, double time, double **rf_data, ui32 no_samples,
 			ui32 element_no, TPoint3D *xmt)
+{
+  return beamform_image_roi(flc, alc, sys, time, rf_data, no_samples,
+                            element_no, xmt, NULL);
+}
+
+
+/*********************************************************************
+ * FUNCTION  : beamform_image_roi()
+ * ABSTRACT  : beamforms the part 'roi' of an image (NULL - all of it),
+ *             with the settings of the auto-tuner.
+ * RETURNS   : One pointer per line. The lines left out by 'roi' are
+ *             NULL, the others have beamform_roi_samples() samples.
+ *********************************************************************/
+double** beamform_image_roi(TFocusLineCollection *flc, TApoLineCollection* alc,
+			TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+			ui32 element_no, TPoint3D *xmt, TBeamformROI *roi)
+{
+  TBeamformConfig cfg;
+
+  autotune_config(flc, alc, sys, no_samples, 
+                  xmt != NULL || beamform_is_element(flc, element_no), &cfg);
+  return beamform_image_config(flc, alc, sys, time, rf_data, no_samples,
+                               element_no, xmt, roi, &cfg);
+}
+
+
+/*********************************************************************
+ * FUNCTION  : beamform_image_config()
+ * ABSTRACT  : beamforms the part 'roi' of an image (NULL - all of it)
+ *             with 'cfg->no_threads' threads (0 - as 
+ *             bft_get_no_threads()), that take the lines in groups of
+ *             'cfg->lines_per_task'. Only the samples and lines in 
+ *             'roi' are computed, and with a decimation only the 
+ *             samples that go into the decimated output.
+ *
+ *********************************************************************/
+double** beamform_image_config(TFocusLineCollection *flc, TApoLineCollection* alc,
+			TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+			ui32 element_no, TPoint3D *xmt, TBeamformROI *roi,
+			TBeamformConfig *cfg)
 {
   double **bf_lines;      /* The collection of beamformed lines         */
   ui32 max_no_apo_times=0;
-  ui32 i;
+  ui32 i, n;
+  TLineWindow window;     /* Output samples of every line               */
   TPoint3D* elem;
-#ifndef NOTHREAD
-  pthread_t *bf_threads;
-#endif
   BFT_ThreadData *bf_thread_info;
+  TLinesJob job;
+  STATS_VAR(t_lines)
+  TRACE_VAR(tr_image)
+  PERF_VAR(pc_image)
+  PERF_VAR(pc_line)
 
   PFUNC
     /*
@@ -923,6 +1515,21 @@ double** beamform_image(TFocusLineCollection *flc, TApoLineCollection* alc,
     return NULL;
   }
   
+  window_whole(&window, beamform_roi_samples(flc, no_samples, roi));
+  if (roi != NULL){
+    window.first = roi->first_sample;
+    window.step = (roi->decimation > 1) ? roi->decimation : 1;
+    if (roi->taps != NULL && roi->no_taps > 0){
+      window.taps = roi->taps;
+      window.no_taps = roi->no_taps;
+    }
+  }
+  if (window.count == 0){
+    printf("\007 beamform_image:\n");
+    printf("Error : the region of interest starts past the end of the lines\n");
+    return NULL;
+  }
+
   bf_lines = (double**)calloc(flc->no_focus_time_lines,sizeof(double*));
   if (bf_lines == NULL){
     printf("\007 beamform_image:\n");
@@ -937,101 +1544,97 @@ double** beamform_image(TFocusLineCollection *flc, TApoLineCollection* alc,
   /*
    *   Take decision which beamforming routine will be used
    */
-  if (flc->no_focus_time_lines == 1){
-    if (element_no < 64000 && elem==NULL) {
+  STATS_START(t_lines)
+  TRACE_START(tr_image)
+  PERF_BEGIN(pc_image, TRUE)
+  if (flc->no_focus_time_lines == 1 
+      && (roi == NULL || roi->lines == NULL || roi->lines[0])){
+    if (beamform_is_element(flc, element_no) && elem==NULL) {
       elem = flc->ftl->xdc->c+element_no;	
     }
+    PERF_BEGIN(pc_line, FALSE)
     if( flc->ftl->dynamic == TRUE){
       if (alc->atl->no_times > 0)
 	if (elem!=NULL)
-	  bf_lines[0] = beamform_apo_line_dynamic_sta(flc->ftl,alc->atl,sys,time,rf_data,no_samples, elem);
+	  bf_lines[0] = beamform_apo_line_dynamic_sta_window(flc->ftl,alc->atl,sys,time,rf_data,no_samples, elem,&window);
 	else
-	  bf_lines[0] = beamform_apo_line_dynamic(flc->ftl,alc->atl,sys,time,rf_data,no_samples);
+	  bf_lines[0] = beamform_apo_line_dynamic_window(flc->ftl,alc->atl,sys,time,rf_data,no_samples,&window);
       else
 	if (elem != NULL)
-	  bf_lines[0] = beamform_line_dynamic_sta(flc->ftl,sys,time,rf_data,no_samples, elem);
+	  bf_lines[0] = beamform_line_dynamic_sta_window(flc->ftl,sys,time,rf_data,no_samples, elem,&window);
 	else
-	  bf_lines[0] = beamform_line_dynamic(flc->ftl,sys,time,rf_data,no_samples);
+	  bf_lines[0] = beamform_line_dynamic_window(flc->ftl,sys,time,rf_data,no_samples,&window);
 				
     }else if(flc->ftl->pixel == TRUE){
       if (alc->atl->no_times > 0)
-	bf_lines[0] = beamform_apo_line_pixels(flc->ftl,alc->atl,sys,time,rf_data,no_samples,element_no);
+	bf_lines[0] = beamform_apo_line_pixels_window(flc->ftl,alc->atl,sys,time,rf_data,no_samples,element_no,&window);
       else
-	bf_lines[0] = beamform_line_pixels(flc->ftl,sys,time,rf_data,no_samples,element_no);
+	bf_lines[0] = beamform_line_pixels_window(flc->ftl,sys,time,rf_data,no_samples,element_no,&window);
     }else{
       if (alc->atl->no_times > 0)
-	bf_lines[0] = beamform_apo_line_times(flc->ftl,alc->atl,sys,time,rf_data,no_samples);
+	bf_lines[0] = beamform_apo_line_times_window(flc->ftl,alc->atl,sys,time,rf_data,no_samples,&window);
       else
-	bf_lines[0] = beamform_line_times(flc->ftl,sys,time,rf_data,no_samples);
+	bf_lines[0] = beamform_line_times_window(flc->ftl,sys,time,rf_data,no_samples,&window);
     }
+    PERF_END(pc_line, TRACE_LINE_MODE(flc->ftl, elem))
+    STATS_STOP(STAT_LINE, t_lines)
+    STATS_STOP(STAT_LINES, t_lines)
+    TRACE_END(TRACE_LINE, tr_image, 0, TRACE_LINE_MODE(flc->ftl, elem), window.count,
+              flc->ftl->xdc->no_elements)
+    STATS_COUNT(STAT_SAMPLES, (ui64)window.count * flc->ftl->xdc->no_elements)
+    STATS_COUNT(STAT_BYTES, ((ui64)window.count * flc->ftl->xdc->no_elements
+                             + window.count) * sizeof(double))
+    STATS_THREADS(1)
   }else{
     /* First determine whether we have to call apodize or beamform_apo_ ... */
     for (i = 0; i < alc->no_apo_time_lines; i++)
       if(alc->atl[i].no_times > max_no_apo_times)
 	max_no_apo_times = alc->atl[i].no_times;
-    if (element_no < 64000 && elem==NULL) {
+    if (beamform_is_element(flc, element_no) && elem==NULL) {
       elem = flc->ftl[0].xdc->c+element_no;	
     }
-    /* Set up for threading*/
-#ifndef NOTHREAD
-    bf_threads = calloc(flc->no_focus_time_lines,sizeof(pthread_t));
-#endif
     bf_thread_info = calloc(flc->no_focus_time_lines,sizeof(BFT_ThreadData));
+    if (bf_thread_info == NULL){
+      free(bf_lines);
+      printf("\007 beamform_image:\n");
+      printf("Error : cannot allocate memory for the threads\n");
+      return NULL;
+    }
+    /* Only the lines in the region are handed out */
+    for(i = 0, n = 0; i < flc->no_focus_time_lines; i++){
+      if (roi != NULL && roi->lines != NULL && !roi->lines[i]) continue;
+      bf_thread_info[n].flc = flc;
+      bf_thread_info[n].alc = alc;
+      bf_thread_info[n].sys = sys;
+      bf_thread_info[n].time = time;
+      bf_thread_info[n].rf_data = rf_data;
+      bf_thread_info[n].no_samples = no_samples;
+      bf_thread_info[n].window = &window;
+      bf_thread_info[n].elem = elem;
+      bf_thread_info[n].line = &bf_lines[i];
+      bf_thread_info[n].i = i;
+      n++;
+    }
 
-    bf_thread_info->flc = flc;
-    bf_thread_info->alc = alc;
-    bf_thread_info->sys = sys;
-    bf_thread_info->time = time;
-    bf_thread_info->rf_data = rf_data;
-    bf_thread_info->no_samples = no_samples;
-    bf_thread_info->elem = elem;
-    if (max_no_apo_times > 0){
-      /* Create threads/run function */
-      for(i = 0; i < flc->no_focus_time_lines; i++){
-	bf_thread_info[i] = bf_thread_info[0];
-	bf_thread_info[i].line = &bf_lines[i];
-	bf_thread_info[i].i = i;
-#ifndef NOTHREAD
-	if (pthread_create(&bf_threads[i],NULL,beamform_thread_apo, (void *)&bf_thread_info[i])) {
-	  mexErrMsgTxt("Error creating threads.\n");
-	}
-#else
-	beamform_thread_apo((void *)&bf_thread_info[i]);
-#endif
-      }
-#ifndef NOTHREAD
-      /*Join all the threads*/
-      for(i = 0; i < flc->no_focus_time_lines; i++){
-	pthread_join(bf_threads[i],NULL);
-      }
-#endif
-    }else{
-
-      /* Create threads */
-      for(i = 0; i < flc->no_focus_time_lines; i++){
-	bf_thread_info[i] = bf_thread_info[0];
-	bf_thread_info[i].line = &bf_lines[i];
-	bf_thread_info[i].i = i;
-#ifndef NOTHREAD
-	if (pthread_create(&bf_threads[i],NULL,beamform_thread_noapo, (void *)&bf_thread_info[i])) {
-	  mexErrMsgTxt("Error creating threads.\n");
-	}
-#else
-	beamform_thread_noapo((void *)&bf_thread_info[i]);
-#endif
-      }
-#ifndef NOTHREAD
-      /*Join all the threads*/
-      for(i = 0; i < flc->no_focus_time_lines; i++){
-	pthread_join(bf_threads[i],NULL);
-      }
-#endif
+    /* Groups of 'lines_per_task' lines are handed to the workers */
+    job.info = bf_thread_info;
+    job.no_lines = n;
+    job.lines_per_task = (cfg->lines_per_task > 0) ? cfg->lines_per_task : 1;
+    job.apo = (max_no_apo_times > 0);
+    job.rf_data = rf_data;
+    job.no_samples = no_samples;
+    if (n > 0){
+      replicate_begin(&job, flc, cfg->no_threads);
+      bft_parallel_for_n((job.no_lines + job.lines_per_task - 1) / job.lines_per_task,
+                         beamform_lines_task, &job, cfg->no_threads);
+      replicate_end(&job);
     }
-#ifndef NOTHREAD
-    free(bf_threads);
-#endif
     free(bf_thread_info);
+    STATS_STOP(STAT_LINES, t_lines)
   }
+  PERF_END(pc_image, PERF_IMAGE)
+  TRACE_END(TRACE_IMAGE, tr_image, flc->no_focus_time_lines, TRACE_MODE_NONE, window.count,
+            flc->ftl->xdc->no_elements)
   return bf_lines;
 }
 
@@ -1086,6 +1689,7 @@ void add_apo_lines_time(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysParams* sys,
    
   /* Find the first delay and apodization to apply      */
   id = 0; ind = 1;
+  focus_prepare(ftl, sys, time, no_samples);
   while( ftl->delay[ind].time < o_abs_s) {ind ++; id ++;}
   d1 = ftl->delay[id].d[element]; A1 = ftl->delay[id].a[element];
    
@@ -1153,6 +1757,7 @@ void add_lines_time(TFocusTimeLine *ftl, TSysParams* sys,
    
   /* Find the first delay and apodization to apply      */
   id = 0; ind = 1;
+  focus_prepare(ftl, sys, time, no_samples);
   while( ftl->delay[ind].time < o_abs_s) {ind ++; id ++;}
   d1 = ftl->delay[id].d[element]; A1 = ftl->delay[id].a[element];
    
@@ -1262,6 +1867,7 @@ void sub_lines_time(TFocusTimeLine *ftl,  TSysParams* sys,
    
   /* Find the first delay and apodization to apply      */
   id = 0; ind = 1;
+  focus_prepare(ftl, sys, time, no_samples);
   while( ftl->delay[ind].time < o_abs_s) {ind ++; id ++;}
   d1 = ftl->delay[id].d[element]; A1 = ftl->delay[id].a[element];
    
@@ -1330,6 +1936,7 @@ void sub_apo_lines_time(TFocusTimeLine *ftl, TApoTimeLine* atl, TSysParams* sys,
    
   /* Find the first delay and apodization to apply      */
   id = 0; ind = 1;
+  focus_prepare(ftl, sys, time, no_samples);
   while( ftl->delay[ind].time < o_abs_s) {ind ++; id ++;}
   d1 = ftl->delay[id].d[element]; A1 = ftl->delay[id].a[element];
    
@@ -0,0 +1,701 @@
+/*********************************************************************
+ * NAME     : codedb.c
+ * ABSTRACT : Database of complementary pairs. The pairs are generated
+ *            in parallel, one length at a time, sorted and written in
+ *            one file. The file is memory mapped when opened, and the
+ *            queries are binary searches in its index.
+ *********************************************************************/
+
+#include "../h/codedb.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef __MSCVC_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static TCodeDB *code_dbs = NULL;   /* Chain of the opened databases */
+
+
+/*
+ *  Primitive Golay pairs
+ */
+static const si8 golay_2[2][2] = {{1, 1}, {1, -1}};
+static const si8 golay_10[2][10] = {{1, 1, -1, 1, -1, 1, -1, -1, 1, 1},
+                                    {1, 1, -1, 1, 1, 1, 1, 1, -1, -1}};
+static const si8 golay_26[2][26] =
+  {{1, 1, 1, 1, -1, 1, 1, -1, -1, 1, -1, 1, -1, 1, -1, -1, 1, -1, 1, 1, 1, -1, -1, 1, 1, 1},
+   {1, 1, 1, 1, -1, 1, 1, -1, -1, 1, -1, 1, 1, 1, 1, 1, -1, 1, -1, -1, -1, 1, 1, -1, -1, -1}};
+
+
+/*
+ *  Pairs of one length and family, made by one thread
+ */
+typedef struct{
+  ui32 length;
+  ui32 family;
+  ui32 no_pairs;
+  double *codes;          /* no_pairs x 2 x length                      */
+  TCodeDBEntry *entries;  /* Metrics of the pairs                       */
+}TCodeDBBlock;
+
+typedef struct{
+  TCodeDBBlock *blocks;
+  ui32 no_per_length;
+  ui64 seed;
+  ui32 failed;
+}TCodeDBJob;
+
+
+/*********************************************************************
+ * FUNCTION : next_random
+ * ABSTRACT : xorshift64* generator, one state per block.
+ *********************************************************************/
+static ui64 next_random(ui64 *state)
+{
+  ui64 x = *state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : normal_random
+ * RETURNS  : Normal random number with mean 0 and variance 1
+ *            (Box-Muller)
+ *********************************************************************/
+static double normal_random(ui64 *state)
+{
+  double u1, u2;
+
+  u1 = ((next_random(state) >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+  u2 = (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+
+/*********************************************************************
+ * FUNCTION : pair_metrics
+ * ABSTRACT : Sidelobe of the summed ACF and largest |CCF| of a pair,
+ *            relative to the main lobe.
+ *********************************************************************/
+static void pair_metrics(const double *a, const double *b, ui32 n,
+                         TCodeDBEntry *e)
+{
+  double peak = 0, s, c;
+  ui32 i, m;
+
+  for (i = 0; i < n; i ++) peak += a[i]*a[i] + b[i]*b[i];
+  if (peak <= 0) peak = 1;
+
+  e->sidelobe = 0;
+  e->max_ccf = 0;
+  for (m = 0; m < n; m ++){
+    s = 0;
+    for (i = 0; i + m < n; i ++) s += a[i + m]*a[i] + b[i + m]*b[i];
+    if (m > 0 && fabs(s) > e->sidelobe) e->sidelobe = fabs(s);
+
+    c = 0;                                   /* Lag m */
+    for (i = 0; i + m < n; i ++) c += a[i + m]*b[i];
+    if (fabs(c) > e->max_ccf) e->max_ccf = fabs(c);
+    c = 0;                                   /* Lag -m */
+    for (i = 0; i + m < n; i ++) c += a[i]*b[i + m];
+    if (fabs(c) > e->max_ccf) e->max_ccf = fabs(c);
+  }
+  e->sidelobe /= peak;
+  e->max_ccf /= peak;
+}
+
+
+/*********************************************************************
+ * FUNCTION : turyn_product
+ * ABSTRACT : Golay pair of length m*k from the pairs (a,b) of length m
+ *            (inner) and (c,d) of length k (outer):
+ *              e = p x a + q x rev(b),  f = p x b - q x rev(a)
+ *            with p = (c+d)/2, q = (c-d)/2 and x the Kronecker product.
+ *********************************************************************/
+static void turyn_product(const double *a, const double *b, ui32 m,
+                          const double *c, const double *d, ui32 k,
+                          double *e, double *f)
+{
+  double p, q;
+  ui32 i, j;
+
+  for (i = 0; i < k; i ++){
+    p = 0.5*(c[i] + d[i]);
+    q = 0.5*(c[i] - d[i]);
+    for (j = 0; j < m; j ++){
+      e[i*m + j] = p*a[j] + q*b[m - 1 - j];
+      f[i*m + j] = p*b[j] - q*a[m - 1 - j];
+    }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : canonical_pair
+ * ABSTRACT : Replace a pair by the first of the pairs with the same
+ *            correlation magnitudes (negated codes, swapped codes,
+ *            both codes reversed, both codes alternated), so that
+ *            equal pairs can be found by comparison. 'tmp' must have
+ *            room for 4 x n values.
+ *********************************************************************/
+static void canonical_pair(double *a, double *b, ui32 n, double *tmp)
+{
+  double *x = tmp, *best = tmp + 2*n, s;
+  ui32 v, i, k;
+
+  memcpy(best, a, n*sizeof(double));
+  memcpy(best + n, b, n*sizeof(double));
+  for (v = 0; v < 8; v ++){
+    for (i = 0; i < n; i ++){
+      x[i] = (v & 1) ? b[i] : a[i];
+      x[n + i] = (v & 1) ? a[i] : b[i];
+    }
+    for (k = 0; k < 2; k ++){
+      if (v & 2)
+        for (i = 0; i < n/2; i ++){
+          s = x[k*n + i]; x[k*n + i] = x[k*n + n - 1 - i]; x[k*n + n - 1 - i] = s;
+        }
+      if (v & 4)
+        for (i = 1; i < n; i += 2) x[k*n + i] = -x[k*n + i];
+      if (x[k*n] < 0)
+        for (i = 0; i < n; i ++) x[k*n + i] = -x[k*n + i];
+    }
+    for (i = 0; i < 2*n && x[i] == best[i]; i ++);
+    if (v == 0 || (i < 2*n && x[i] < best[i]))
+      memcpy(best, x, 2*n*sizeof(double));
+  }
+  memcpy(a, best, n*sizeof(double));
+  memcpy(b, best + n, n*sizeof(double));
+}
+
+
+/*********************************************************************
+ * FUNCTION : golay_pair
+ * ABSTRACT : Random Golay pair of length n from the primitive pairs of
+ *            length 2, 10 and 26. The factors are taken in random order,
+ *            each primitive pair is randomly negated, swapped, reversed
+ *            or alternated, and is used as inner or outer pair.
+ *            'tmp' must have room for 4 x n values.
+ * RETURNS  : FALSE if n is not of the form 2^a 10^b 26^c.
+ *********************************************************************/
+static si32 golay_pair(ui32 n, ui64 *rng, double *a, double *b, double *tmp)
+{
+  ui32 factors[64], no_factors = 0, rest = n, len, k, i, j, bits;
+  double c[26], d[26], s, *e = tmp, *f = tmp + n;
+  const si8 *kc, *kd;
+
+  while (rest % 26 == 0){ factors[no_factors ++] = 26; rest /= 26; }
+  while (rest % 10 == 0){ factors[no_factors ++] = 10; rest /= 10; }
+  while (rest % 2 == 0){ factors[no_factors ++] = 2; rest /= 2; }
+  if (rest != 1) return FALSE;
+
+  for (i = no_factors; i > 1; i --){
+    j = (ui32)(next_random(rng) % i);
+    k = factors[i - 1]; factors[i - 1] = factors[j]; factors[j] = k;
+  }
+
+  a[0] = b[0] = 1;
+  len = 1;
+  for (i = 0; i < no_factors; i ++){
+    k = factors[i];
+    kc = (k == 2) ? golay_2[0] : (k == 10) ? golay_10[0] : golay_26[0];
+    kd = (k == 2) ? golay_2[1] : (k == 10) ? golay_10[1] : golay_26[1];
+    bits = (ui32)(next_random(rng) >> 32);
+    for (j = 0; j < k; j ++){
+      c[j] = kc[(bits & 4) ? k - 1 - j : j] * ((bits & 1) ? -1 : 1);
+      d[j] = kd[(bits & 8) ? k - 1 - j : j] * ((bits & 2) ? -1 : 1);
+      if ((bits & 16) && (j & 1)){ c[j] = -c[j]; d[j] = -d[j]; }
+    }
+    if (bits & 32)
+      for (j = 0; j < k; j ++){ s = c[j]; c[j] = d[j]; d[j] = s; }
+
+    if (bits & 64) turyn_product(a, b, len, c, d, k, e, f);
+    else           turyn_product(c, d, k, a, b, len, e, f);
+    len *= k;
+    memcpy(a, e, len*sizeof(double));
+    memcpy(b, f, len*sizeof(double));
+  }
+  canonical_pair(a, b, n, tmp);
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : recursive_pair
+ * ABSTRACT : Multilevel pair as genCompPair(ones(1,n-1)): the pair
+ *            (a,b) becomes (a + w*b', w*a - b'), with b' delayed by
+ *            one chip and w normal with standard deviation 0.5.
+ *********************************************************************/
+static void recursive_pair(ui32 n, ui64 *rng, double *a, double *b)
+{
+  double w, x, y;
+  ui32 it, i;
+
+  memset(a, 0, n*sizeof(double));
+  memset(b, 0, n*sizeof(double));
+  a[0] = 1;
+  for (it = 0; it < n; it ++){
+    w = 0.5 * normal_random(rng);
+    for (i = n; i-- > 0;){
+      x = a[i];
+      y = (it == 0) ? b[i] : (i > 0) ? b[i - 1] : 0;
+      a[i] = x + w*y;
+      b[i] = w*x - y;
+    }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : generate_block
+ * ABSTRACT : Make the pairs of one length and family.
+ *********************************************************************/
+static void generate_block(void *ctx, ui32 block_no)
+{
+  TCodeDBJob *job = (TCodeDBJob*)ctx;
+  TCodeDBBlock *blk = job->blocks + block_no;
+  ui32 n = blk->length, attempt, max_attempts, i;
+  double *a, *b, *tmp;
+  ui64 rng;
+
+  if (blk->family == 0) return;            /* Family not wanted */
+  blk->codes = (double*)malloc(((size_t)job->no_per_length + 3) * 2 * n * sizeof(double));
+  blk->entries = (TCodeDBEntry*)malloc((job->no_per_length + 1) * sizeof(TCodeDBEntry));
+  if (blk->codes == NULL || blk->entries == NULL){
+    job->failed = TRUE;
+    return;
+  }
+  tmp = blk->codes + (size_t)(job->no_per_length + 1) * 2 * n;
+
+  /* Seed from the base seed, the length and the family (splitmix64) */
+  rng = job->seed + 0x9E3779B97F4A7C15ULL * ((ui64)n * 4 + blk->family);
+  rng = (rng ^ (rng >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  rng = (rng ^ (rng >> 27)) * 0x94D049BB133111EBULL;
+  rng ^= rng >> 31;
+  if (rng == 0) rng = 1;
+
+  max_attempts = (blk->family == CODE_FAMILY_GOLAY) ? 20*job->no_per_length + 64
+                                                    : job->no_per_length;
+  for (attempt = 0; attempt < max_attempts && blk->no_pairs < job->no_per_length;
+       attempt ++){
+    a = blk->codes + (size_t)blk->no_pairs * 2 * n;
+    b = a + n;
+    if (blk->family == CODE_FAMILY_GOLAY){
+      if (!golay_pair(n, &rng, a, b, tmp)) break;
+
+      /* The Golay pairs of a length are few; keep the new ones only */
+      for (i = 0; i < blk->no_pairs; i ++)
+        if (!memcmp(blk->codes + (size_t)i * 2 * n, a, 2*n*sizeof(double))) break;
+      if (i < blk->no_pairs) continue;
+    }else
+      recursive_pair(n, &rng, a, b);
+
+    pair_metrics(a, b, n, blk->entries + blk->no_pairs);
+    blk->entries[blk->no_pairs].length = n;
+    blk->entries[blk->no_pairs].family = blk->family;
+    blk->no_pairs ++;
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : compare_entries
+ * ABSTRACT : Order of the index: length, family, max_ccf, sidelobe
+ *********************************************************************/
+static int compare_entries(const void *p1, const void *p2)
+{
+  const TCodeDBEntry *e1 = (const TCodeDBEntry*)p1, *e2 = (const TCodeDBEntry*)p2;
+
+  if (e1->length != e2->length) return (e1->length < e2->length) ? -1 : 1;
+  if (e1->family != e2->family) return (e1->family < e2->family) ? -1 : 1;
+  if (e1->max_ccf != e2->max_ccf) return (e1->max_ccf < e2->max_ccf) ? -1 : 1;
+  if (e1->sidelobe != e2->sidelobe) return (e1->sidelobe < e2->sidelobe) ? -1 : 1;
+  return (e1->offset < e2->offset) ? -1 : (e1->offset > e2->offset);
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_create
+ * ABSTRACT : Generate pairs of the given lengths and families, and
+ *            write them to a new database. The lengths are generated
+ *            in parallel.
+ * ARGUMENTS: file_name - Name of the database
+ *            lengths - Code lengths
+ *            no_lengths - Number of lengths
+ *            families - Bit (1 << CODE_FAMILY_...) for every family
+ *            no_per_length - Pairs per length and family. Fewer Golay
+ *                            pairs are stored if fewer are found.
+ *            seed - Seed of the random choices
+ *            no_records - Receives the number of pairs written
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 code_db_create(const char *file_name, ui32 *lengths, ui32 no_lengths,
+                    ui32 families, ui32 no_per_length, ui64 seed,
+                    ui32 *no_records)
+{
+  TCodeDBJob job;
+  TCodeDBHeader hdr;
+  TCodeDBEntry *index = NULL;
+  double **codes = NULL;
+  ui32 no_blocks = no_lengths * CODE_DB_NO_FAMILIES, i, j, k, total = 0;
+  ui64 offset;
+  si32 ok;
+  FILE *f;
+
+  PFUNC
+  job.blocks = (TCodeDBBlock*)calloc(no_blocks + 1, sizeof(TCodeDBBlock));
+  if (job.blocks == NULL) goto cdc_fail_1;
+  job.no_per_length = no_per_length;
+  job.seed = seed;
+  job.failed = FALSE;
+  for (i = 0; i < no_blocks; i ++){
+    job.blocks[i].length = lengths[i / CODE_DB_NO_FAMILIES];
+    job.blocks[i].family = i % CODE_DB_NO_FAMILIES + 1;
+    if (lengths[i / CODE_DB_NO_FAMILIES] == 0 || !(families & (1u << job.blocks[i].family)))
+      job.blocks[i].family = 0;
+  }
+  bft_parallel_for(no_blocks, generate_block, &job);
+  if (job.failed) goto cdc_fail_2;
+
+  /* Sort the index. 'offset' holds the number of the pair until then */
+  for (i = 0; i < no_blocks; i ++) total += job.blocks[i].no_pairs;
+  index = (TCodeDBEntry*)malloc((total + 1) * sizeof(TCodeDBEntry));
+  codes = (double**)malloc(2 * ((size_t)total + 1) * sizeof(double*));
+  if (index == NULL || codes == NULL) goto cdc_fail_2;
+  for (i = 0, k = 0; i < no_blocks; i ++)
+    for (j = 0; j < job.blocks[i].no_pairs; j ++, k ++){
+      index[k] = job.blocks[i].entries[j];
+      index[k].offset = k;
+      codes[k] = job.blocks[i].codes + (size_t)j * 2 * job.blocks[i].length;
+    }
+  qsort(index, total, sizeof(TCodeDBEntry), compare_entries);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CODE_DB_MAGIC, sizeof(hdr.magic));
+  hdr.version = CODE_DB_VERSION;
+  hdr.header_size = sizeof(TCodeDBHeader);
+  hdr.no_records = total;
+  hdr.index_offset = sizeof(TCodeDBHeader);
+  hdr.data_offset = hdr.index_offset + (ui64)total * sizeof(TCodeDBEntry);
+
+  /* The codes are stored in the order of the index */
+  offset = hdr.data_offset;
+  for (k = 0; k < total; k ++){
+    codes[total + k] = codes[index[k].offset];
+    index[k].offset = offset;
+    offset += 2 * (ui64)index[k].length * sizeof(double);
+  }
+
+  f = fopen(file_name, "wb");
+  if (f == NULL){
+    errprintf("Cannot create '%s'\n", file_name);
+    goto cdc_fail_2;
+  }
+  ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+       && (total == 0 || fwrite(index, sizeof(TCodeDBEntry), total, f) == total);
+  for (k = 0; k < total && ok; k ++)
+    ok = fwrite(codes[total + k], 2 * sizeof(double), index[k].length, f)
+         == index[k].length;
+  ok = (fclose(f) == 0) && ok;
+  if (!ok){
+    errprintf("Cannot write '%s'\n", file_name);
+    goto cdc_fail_2;
+  }
+
+  *no_records = total;
+  free(codes);
+  free(index);
+  for (i = 0; i < no_blocks; i ++){
+    free(job.blocks[i].codes);
+    free(job.blocks[i].entries);
+  }
+  free(job.blocks);
+  return TRUE;
+
+cdc_fail_2:
+  free(codes);
+  free(index);
+  for (i = 0; i < no_blocks; i ++){
+    free(job.blocks[i].codes);
+    free(job.blocks[i].entries);
+  }
+  free(job.blocks);
+cdc_fail_1:
+  printf("\007 code_db_create:\n");
+  printf("Error : cannot create the database\n");
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_check
+ * ABSTRACT : Check that the index of a mapped database is consistent
+ *            with the size of the file.
+ *********************************************************************/
+static si32 code_db_check(TCodeDB *db)
+{
+  TCodeDBHeader *h = db->hdr;
+  ui32 i;
+
+  if (db->size < sizeof(TCodeDBHeader)){
+    errprintf("%s", "The file is too short to be a code database\n");
+    return FALSE;
+  }
+  if (memcmp(h->magic, CODE_DB_MAGIC, sizeof(h->magic))){
+    errprintf("%s", "The file is not a code database (bad magic)\n");
+    return FALSE;
+  }
+  if (h->version != CODE_DB_VERSION || h->header_size != sizeof(TCodeDBHeader)){
+    errprintf("Unsupported version %d of the code database\n", h->version);
+    return FALSE;
+  }
+  if ((h->index_offset & (sizeof(double) - 1))
+      || h->index_offset + (ui64)h->no_records * sizeof(TCodeDBEntry) > db->size){
+    errprintf("%s", "The index exceeds the file\n");
+    return FALSE;
+  }
+
+  db->index = (TCodeDBEntry*)(db->base + h->index_offset);
+  for (i = 0; i < h->no_records; i ++){
+    if ((db->index[i].offset & (sizeof(double) - 1))
+        || db->index[i].offset + 2 * (ui64)db->index[i].length * sizeof(double) > db->size){
+      errprintf("Pair %d lies outside the file\n", i + 1);
+      return FALSE;
+    }
+    if (i > 0 && compare_entries(db->index + i - 1, db->index + i) > 0){
+      errprintf("%s", "The index is not sorted\n");
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_open
+ * ABSTRACT : Map a database and add it to the chain of opened ones.
+ * RETURNS  : Pointer to the opened database, or NULL on error.
+ *********************************************************************/
+TCodeDB* code_db_open(const char *file_name)
+{
+#ifdef __MSCVC_
+  printf("code_db_open: memory mapped files are not supported on this platform\n");
+  return NULL;
+#else
+  TCodeDB *db;
+  struct stat st;
+
+  PFUNC
+  db = (TCodeDB*)calloc(1, sizeof(TCodeDB));
+  if (db == NULL){
+    errprintf("%s", "Cannot allocate memory\n");
+    goto cdo_fail_1;
+  }
+
+  db->fd = open(file_name, O_RDONLY);
+  if (db->fd < 0){
+    errprintf("Cannot open '%s'\n", file_name);
+    goto cdo_fail_2;
+  }
+
+  if (fstat(db->fd, &st) || st.st_size == 0){
+    errprintf("Cannot determine the size of '%s'\n", file_name);
+    goto cdo_fail_3;
+  }
+  db->size = (ui64)st.st_size;
+
+  db->base = (ui8*)mmap(NULL, db->size, PROT_READ, MAP_SHARED, db->fd, 0);
+  if (db->base == (ui8*)MAP_FAILED){
+    errprintf("Cannot map '%s'\n", file_name);
+    goto cdo_fail_3;
+  }
+  madvise(db->base, db->size, MADV_RANDOM);
+
+  db->hdr = (TCodeDBHeader*)db->base;
+  if (!code_db_check(db)) goto cdo_fail_4;
+
+  db->next = code_dbs;
+  code_dbs = db;
+  return db;
+
+cdo_fail_4:
+  munmap(db->base, db->size);
+cdo_fail_3:
+  close(db->fd);
+cdo_fail_2:
+  free(db);
+cdo_fail_1:
+  return NULL;
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_close
+ * ABSTRACT : Unmap a database and remove it from the chain.
+ *********************************************************************/
+void code_db_close(TCodeDB *db)
+{
+  TCodeDB *c, *p = NULL;
+
+  PFUNC
+  c = code_dbs;
+  while (c != NULL && c != db){ p = c; c = c->next; }
+  if (c == NULL){
+    printf("code_db_close: Cannot find database to close \n");
+    return;
+  }
+  if (p == NULL) code_dbs = c->next;
+  else p->next = c->next;
+
+#ifndef __MSCVC_
+  munmap(db->base, db->size);
+  close(db->fd);
+#endif
+  free(db);
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_close_all
+ *********************************************************************/
+void code_db_close_all()
+{
+  while (code_dbs != NULL) code_db_close(code_dbs);
+}
+
+
+/*********************************************************************
+ * FUNCTION : is_code_db_valid
+ * ABSTRACT : Check if a pointer points to an opened database
+ *********************************************************************/
+si32 is_code_db_valid(TCodeDB *db)
+{
+  TCodeDB *c;
+
+  for (c = code_dbs; c != NULL; c = c->next)
+    if (c == db) return TRUE;
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : lower_bound
+ * RETURNS  : First entry that is not before (length, family, max_ccf)
+ *********************************************************************/
+static ui32 lower_bound(TCodeDB *db, ui32 length, ui32 family, double max_ccf)
+{
+  ui32 lo = 0, hi = db->hdr->no_records, mid;
+  TCodeDBEntry *e;
+
+  while (lo < hi){
+    mid = lo + (hi - lo)/2;
+    e = db->index + mid;
+    if (e->length < length || (e->length == length && (e->family < family
+        || (e->family == family && e->max_ccf < max_ccf))))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_range
+ * ABSTRACT : Find the pairs of a length and family with max_ccf below
+ *            a limit. They follow each other in the index, with the
+ *            lowest max_ccf first.
+ * ARGUMENTS: db - Opened database
+ *            length, family - Wanted pairs. With CODE_FAMILY_ANY the
+ *                             pairs of all families are counted, and
+ *                             'first' is the first pair of the length.
+ *            ccf_limit - max_ccf must be below it
+ *            first - Receives the number of the first pair
+ * RETURNS  : The number of pairs
+ *********************************************************************/
+ui32 code_db_range(TCodeDB *db, ui32 length, ui32 family, double ccf_limit,
+                   ui32 *first)
+{
+  ui32 f, n = 0;
+
+  *first = lower_bound(db, length, family, -HUGE_VAL);
+  if (family != CODE_FAMILY_ANY)
+    return lower_bound(db, length, family, ccf_limit) - *first;
+  for (f = 1; f <= CODE_DB_NO_FAMILIES; f ++)
+    n += lower_bound(db, length, f, ccf_limit) - lower_bound(db, length, f, -HUGE_VAL);
+  return n;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_query
+ * ABSTRACT : The pairs of a length with the lowest max_ccf, among the
+ *            pairs with max_ccf below 'ccf_limit' and sidelobe at most
+ *            'sidelobe_limit'. The ranges of the families are found by
+ *            binary search and merged; pairs above the sidelobe limit
+ *            are skipped on the way.
+ * ARGUMENTS: found - Receives the numbers of at most no_wanted pairs
+ * RETURNS  : The number of pairs found
+ *********************************************************************/
+ui32 code_db_query(TCodeDB *db, ui32 length, ui32 family, double ccf_limit,
+                   double sidelobe_limit, ui32 no_wanted, ui32 *found)
+{
+  ui32 next[CODE_DB_NO_FAMILIES + 1], end[CODE_DB_NO_FAMILIES + 1];
+  ui32 f, best, no_found = 0;
+  TCodeDBEntry *e;
+
+  for (f = 1; f <= CODE_DB_NO_FAMILIES; f ++){
+    next[f] = end[f] = 0;
+    if (family != CODE_FAMILY_ANY && family != f) continue;
+    next[f] = lower_bound(db, length, f, -HUGE_VAL);
+    end[f] = lower_bound(db, length, f, ccf_limit);
+  }
+
+  while (no_found < no_wanted){
+    best = 0;
+    for (f = 1; f <= CODE_DB_NO_FAMILIES; f ++){
+      while (next[f] < end[f] && db->index[next[f]].sidelobe > sidelobe_limit)
+        next[f] ++;
+      if (next[f] == end[f]) continue;
+      e = db->index + next[f];
+      if (best == 0 || e->max_ccf < db->index[next[best]].max_ccf
+          || (e->max_ccf == db->index[next[best]].max_ccf
+              && e->sidelobe < db->index[next[best]].sidelobe))
+        best = f;
+    }
+    if (best == 0) break;
+    found[no_found ++] = next[best] ++;
+  }
+  return no_found;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_db_codes
+ * RETURNS  : The two codes of a pair, one after the other. The
+ *            pointer is into the mapping, and is valid until the
+ *            database is closed.
+ *********************************************************************/
+double* code_db_codes(TCodeDB *db, ui32 record_no)
+{
+  return (double*)(db->base + db->index[record_no].offset);
+}
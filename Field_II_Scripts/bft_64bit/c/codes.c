@@ -0,0 +1,320 @@
+/*********************************************************************
+ * NAME     : codes.c
+ * ABSTRACT : Aperiodic correlation of binary codes packed as bits.
+ *
+ *            For two +1/-1 codes the correlation at a lag is the
+ *            number of overlapping chips minus twice the number of
+ *            chips that differ, and the chips that differ are the set
+ *            bits of the XOR of the (shifted) bit vectors. One lag of
+ *            a code of N chips thus costs N/64 shifts, XORs and
+ *            population counts. With AVX-512 VPOPCNTDQ eight words are
+ *            handled at a time.
+ *
+ *            The figures of merit are found group pair by group pair,
+ *            so that the work can be spread over the threads when the
+ *            set is large.
+ *********************************************************************/
+
+#include "../h/codes.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __AVX512VPOPCNTDQ__
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define POPCOUNT64(x)  ((ui32)__builtin_popcountll(x))
+#else
+static ui32 POPCOUNT64(ui64 x)
+{
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (ui32)((x * 0x0101010101010101ULL) >> 56);
+}
+#endif
+
+#define CODE_PARALLEL_WORK  (1 << 18)   /* Word operations worth a thread */
+
+
+/*
+ *  One evaluation of code_metrics()
+ */
+typedef struct{
+  TCodeSet *s;
+  ui32 set_size;
+  ui32 no_sets;
+  ui32 no_lags;           /* 2*length - 1                              */
+  si32 *sum_acf;          /* no_lags x no_sets, or NULL                */
+  double *result;         /* 4 per group pair: acf, ccf, all, self     */
+  ui32 failed;            /* A pair found no memory                    */
+}TCodeJob;
+
+
+/*********************************************************************
+ * FUNCTION : code_pack
+ * ABSTRACT : Pack codes given as a no_codes x length matrix, stored
+ *            column by column. Negative chips are set bits.
+ * RETURNS  : The packed codes, or NULL on error.
+ *********************************************************************/
+TCodeSet* code_pack(double *codes, ui32 no_codes, ui32 length)
+{
+  TCodeSet *s;
+  ui32 i, n;
+
+  PFUNC
+  s = (TCodeSet*)malloc(sizeof(TCodeSet));
+  if (s == NULL) goto cp_fail_1;
+  s->no_codes = no_codes;
+  s->length = length;
+  s->no_words = (length + 63) / 64;
+  s->bits = (ui64*)calloc((size_t)no_codes * s->no_words + 1, sizeof(ui64));
+  if (s->bits == NULL) goto cp_fail_2;
+
+  for (n = 0; n < length; n ++)
+    for (i = 0; i < no_codes; i ++)
+      if (codes[(size_t)n * no_codes + i] < 0)
+        s->bits[(size_t)i * s->no_words + n/64] |= (ui64)1 << (n % 64);
+  return s;
+
+cp_fail_2:
+  free(s);
+cp_fail_1:
+  printf("\007 code_pack:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_free
+ *********************************************************************/
+void code_free(TCodeSet *s)
+{
+  free(s->bits);
+  free(s);
+}
+
+
+/*********************************************************************
+ * FUNCTION : corr_shifted
+ * ABSTRACT : sum over n < len of x[n+k]*y[n], for bit vectors x and y
+ *            of no_words words, and len = length - k.
+ *********************************************************************/
+static si32 corr_shifted(const ui64 *x, const ui64 *y, ui32 no_words,
+                         ui32 k, ui32 len)
+{
+  ui32 q = k / 64, r = k % 64, nw = (len + 63) / 64;
+  ui32 w = 0, differ = 0;
+  ui64 d;
+
+#ifdef __AVX512VPOPCNTDQ__
+  /* Whole words with the next source word inside the vector */
+  if (nw >= 9){
+    __m512i acc = _mm512_setzero_si512();
+    __m128i sr = _mm_cvtsi32_si128(r), sl = _mm_cvtsi32_si128(64 - r);
+    for (; w + 8 < nw && w + q + 9 <= no_words; w += 8){
+      __m512i lo = _mm512_loadu_si512((const void*)(x + w + q));
+      __m512i hi = _mm512_loadu_si512((const void*)(x + w + q + 1));
+      __m512i xs = _mm512_or_si512(_mm512_srl_epi64(lo, sr), _mm512_sll_epi64(hi, sl));
+      __m512i yv = _mm512_loadu_si512((const void*)(y + w));
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_xor_si512(xs, yv)));
+    }
+    differ = (ui32)_mm512_reduce_add_epi64(acc);
+  }
+#endif
+
+  for (; w < nw; w ++){
+    d = x[w + q] >> r;
+    if (r > 0 && w + q + 1 < no_words) d |= x[w + q + 1] << (64 - r);
+    d ^= y[w];
+    if (w == nw - 1 && (len % 64) != 0) d &= ((ui64)1 << (len % 64)) - 1;
+    differ += POPCOUNT64(d);
+  }
+  return (si32)len - 2*(si32)differ;
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_xcorr
+ * ABSTRACT : Aperiodic cross-correlation of codes i and j, as
+ *            xcorr(code_i, code_j) in Matlab:
+ *            c[length-1+m] = sum over n of code_i[n+m]*code_j[n],
+ *            for -(length-1) <= m <= length-1.
+ *********************************************************************/
+void code_xcorr(TCodeSet *s, ui32 i, ui32 j, si32 *c)
+{
+  const ui64 *a = s->bits + (size_t)i * s->no_words;
+  const ui64 *b = s->bits + (size_t)j * s->no_words;
+  ui32 N = s->length, k;
+
+  for (k = 0; k < N; k ++){
+    c[N - 1 + k] = corr_shifted(a, b, s->no_words, k, N - k);
+    if (k > 0) c[N - 1 - k] = corr_shifted(b, a, s->no_words, k, N - k);
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_welch_bound
+ * ABSTRACT : Welch bound on the largest sidelobe or cross-correlation
+ *            of no_parallel groups of no_events codes, normalized to
+ *            unit energy per group (welchBound.m). Not positive if
+ *            no_parallel <= no_events.
+ *********************************************************************/
+double code_welch_bound(ui32 length, ui32 no_parallel, ui32 no_events)
+{
+  double M = no_parallel, K = no_events, N = length;
+
+  if (M <= K) return 0;
+  return sqrt((M/K - 1) / (M*(2*N - 1) - 1));
+}
+
+
+/*********************************************************************
+ * FUNCTION : metrics_pair
+ * ABSTRACT : Figures of merit of one pair of groups (g <= h).
+ *********************************************************************/
+static void metrics_pair(void *ctx, ui32 item)
+{
+  TCodeJob *job = (TCodeJob*)ctx;
+  ui32 K = job->set_size, L = job->no_lags, N = job->s->length;
+  si32 *sum, *c;
+  double *res = job->result + 4 * (size_t)item;
+  ui32 g, h, k, l, m;
+
+  /* The work of a pair outweighs the allocation by far */
+  sum = (si32*)malloc((size_t)2 * L * sizeof(si32));
+  if (sum == NULL){
+    job->failed = TRUE;
+    return;
+  }
+  c = sum + L;
+
+  /* item enumerates g <= h row by row */
+  g = 0; h = item;
+  while (h >= job->no_sets - g){ h -= job->no_sets - g; g ++; }
+  h += g;
+
+  res[0] = res[1] = res[2] = res[3] = 0;
+  for (m = 0; m < L; m ++) sum[m] = 0;
+
+  for (k = 0; k < K; k ++){
+    for (l = (g == h) ? k : 0; l < K; l ++){
+      code_xcorr(job->s, g*K + k, h*K + l, c);
+      if (k == l)
+        for (m = 0; m < L; m ++) sum[m] += c[m];
+      if (g != h || k != l){
+        for (m = 0; m < L; m ++){
+          if (abs(c[m]) > res[2]) res[2] = abs(c[m]);
+          if (g == h && abs(c[m]) > res[3]) res[3] = abs(c[m]);
+        }
+      }
+    }
+  }
+
+  if (g == h){
+    for (m = 0; m < L; m ++)
+      if (m != N - 1 && abs(sum[m]) > res[0]) res[0] = abs(sum[m]);
+    if (job->sum_acf != NULL)
+      for (m = 0; m < L; m ++) job->sum_acf[(size_t)g * L + m] = sum[m];
+  }else
+    for (m = 0; m < L; m ++)
+      if (abs(sum[m]) > res[1]) res[1] = abs(sum[m]);
+  free(sum);
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_metrics
+ * ABSTRACT : Figures of merit of a code set made of groups of
+ *            'set_size' consecutive codes.
+ * ARGUMENTS: s - The codes
+ *            set_size - Codes per group, i.e. transmit events
+ *            m - Result
+ *            sum_acf - If not NULL, the sum of the ACFs of every group,
+ *                      (2*length-1) x no_sets
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 code_metrics(TCodeSet *s, ui32 set_size, TCodeMetrics *m, si32 *sum_acf)
+{
+  return code_metrics_n(s, set_size, m, sum_acf, 0);
+}
+
+
+/*********************************************************************
+ * FUNCTION : code_metrics_n
+ * ABSTRACT : code_metrics() with at most 'no_threads' threads (0 - as
+ *            bft_get_no_threads()). Callers that already run in a
+ *            worker of bft_parallel_for() pass 1.
+ *********************************************************************/
+si32 code_metrics_n(TCodeSet *s, ui32 set_size, TCodeMetrics *m,
+                    si32 *sum_acf, ui32 no_threads)
+{
+  TCodeJob job;
+  double bound, work, *res;
+  ui64 no_pairs;
+  ui32 no_items, i;
+
+  PFUNC
+  if (set_size == 0 || s->no_codes % set_size != 0 || s->length == 0){
+    printf("\007 code_metrics_n:\n");
+    printf("Error : the number of codes must be a multiple of the group size\n");
+    return FALSE;
+  }
+
+  job.s = s;
+  job.set_size = set_size;
+  job.no_sets = s->no_codes / set_size;
+  job.no_lags = 2*s->length - 1;
+  job.sum_acf = sum_acf;
+  job.failed = FALSE;
+  no_pairs = (ui64)job.no_sets * (job.no_sets + 1) / 2;
+  if (no_pairs > 0xFFFFFFFFULL){
+    printf("\007 code_metrics_n:\n");
+    printf("Error : too many groups\n");
+    return FALSE;
+  }
+  no_items = (ui32)no_pairs;
+
+  job.result = (double*)malloc((size_t)4 * no_items * sizeof(double));
+  if (job.result == NULL) goto cm_fail_1;
+
+  /* Threads only pay off for large sets */
+  work = (double)s->no_codes * s->no_codes * s->length * s->no_words;
+  if (work >= CODE_PARALLEL_WORK && no_threads != 1)
+    bft_parallel_for_n(no_items, metrics_pair, &job, no_threads);
+  else
+    for (i = 0; i < no_items; i ++) metrics_pair(&job, i);
+  if (job.failed) goto cm_fail_2;
+
+  m->acf_sidelobe = m->max_ccf = m->max_all_ccf = m->max_self_ccf = 0;
+  for (i = 0; i < no_items; i ++){
+    res = job.result + 4*(size_t)i;
+    if (res[0] > m->acf_sidelobe) m->acf_sidelobe = res[0];
+    if (res[1] > m->max_ccf) m->max_ccf = res[1];
+    if (res[2] > m->max_all_ccf) m->max_all_ccf = res[2];
+    if (res[3] > m->max_self_ccf) m->max_self_ccf = res[3];
+  }
+
+  bound = code_welch_bound(s->length, job.no_sets, set_size);
+  if (bound > 0)
+    m->welch_ratio = ((m->acf_sidelobe > m->max_ccf) ? m->acf_sidelobe : m->max_ccf)
+                     / ((double)set_size * s->length) / bound;
+  else
+    m->welch_ratio = -1;
+
+  free(job.result);
+  return TRUE;
+
+cm_fail_2:
+  free(job.result);
+cm_fail_1:
+  printf("\007 code_metrics_n:\n");
+  printf("Error : cannot allocate memory\n");
+  return FALSE;
+}
@@ -0,0 +1,261 @@
+/*********************************************************************
+ * NAME     : compound.c
+ * ABSTRACT : Beamforming and coherent compounding of plane and
+ *            diverging waves.
+ *
+ *            The image is traversed once. For every image point the
+ *            receive delays and the apodization of all channels are
+ *            calculated once, and are reused for all transmitted waves.
+ *            Only the transmit delay, which is one value per point and
+ *            wave, depends on the wave.
+ *
+ *            Dynamically focused lines and lines focused in pixels are
+ *            supported. The points of a dynamic line are placed as in
+ *            beamform_apo_line_dynamic_sta(), starting from the earliest
+ *            time of the waves.
+ *********************************************************************/
+
+#include "../h/compound.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+
+/*
+ *  The recorded waves and the image, shared by all lines
+ */
+typedef struct{
+  TFocusLineCollection *flc;
+  TApoLineCollection *alc;
+  TSysParams *sys;
+  TTransmitWave *waves;
+  ui32 no_waves;
+  double *wave_ref;       /* Per wave: distance => transmit delay      */
+  double time;            /* Time of the first output sample           */
+  double *rf;             /* no_samples x no_channels x no_waves       */
+  ui32 no_samples;
+  ui32 no_channels;
+  ui32 no_out;            /* Samples per beamformed line               */
+  double *image;          /* no_out x no_lines                         */
+  ui32 failed;
+}TCompoundJob;
+
+
+/*********************************************************************
+ * FUNCTION : transmit_index
+ * ABSTRACT : Transmit delay from time zero to the point 'p', minus
+ *            the time of the first sample, in samples.
+ *********************************************************************/
+static double transmit_index(TCompoundJob *job, ui32 iw, TPoint3D *p)
+{
+  TTransmitWave *w = job->waves + iw;
+  double *ref = job->wave_ref + 4*iw;
+  double dist;
+
+  if (w->type == XMT_PLANE)
+    dist = p->x*ref[0] + p->y*ref[1] + p->z*ref[2];
+  else
+    dist = distance(&w->source, p) - ref[3];
+
+  return (dist / job->sys->c - w->time) * job->sys->fs;
+}
+
+
+/*********************************************************************
+ * FUNCTION : compound_line
+ * ABSTRACT : Beamform and compound one line.
+ *********************************************************************/
+static void compound_line(void *ctx, ui32 line_no)
+{
+  TCompoundJob *job = (TCompoundJob*)ctx;
+  TFocusTimeLine *ftl = job->flc->ftl + line_no;
+  TApoTimeLine *atl = job->alc->atl + line_no;
+  TTransducer *xdc = ftl->xdc;
+  TSysParams *sys = job->sys;
+  ui32 no_elements = xdc->no_elements;
+  size_t wave_size = (size_t)job->no_samples * job->no_channels;
+  double *rx, *apo, *out, *x;
+  double scaler, sample_index, tx, A, d;
+  double dR, dX, dY, dZ;
+  TPoint3D p;
+  ui32 o_abs_s, os, no_points, ia, ina, ic, iw, is1;
+
+  rx = (double*)malloc(2 * no_elements * sizeof(double));
+  if (rx == NULL){
+    job->failed = TRUE;
+    return;
+  }
+  apo = rx + no_elements;
+  for (ic = 0; ic < no_elements; ic++) apo[ic] = 1;
+
+  out = job->image + (size_t)line_no * job->no_out;
+  scaler = sys->fs / sys->c;
+  o_abs_s = (ui32)floor(job->time * sys->fs);
+
+  dR = sys->c / sys->fs / 2;
+  dX = tan(ftl->dir_xz);
+  dY = tan(ftl->dir_yz);
+  dZ = dR/sqrt(1 + dX*dX + dY*dY);
+  dX *= dZ;
+  dY *= dZ;
+  p.x = ftl->center.x + dX*o_abs_s;
+  p.y = ftl->center.y + dY*o_abs_s;
+  p.z = ftl->center.z + dZ*o_abs_s;
+
+  no_points = (ftl->pixel == TRUE) ? ftl->no_times : job->no_out;
+  if (no_points > job->no_out) no_points = job->no_out;
+
+  ia = 0; ina = 1;
+  if (atl->no_times > 0 && ftl->pixel != TRUE)
+    while (atl->a[ina].time < o_abs_s){ ina ++; ia ++;}
+
+  for (os = 0; os < job->no_out; os ++, o_abs_s ++){
+    out[os] = 0;
+    if (os >= no_points) continue;
+    if (ftl->pixel == TRUE) p = ftl->pixels[os];
+
+    /* Receive part of the delays and the apodization */
+    for (ic = 0; ic < no_elements; ic ++)
+      rx[ic] = distance(xdc->c+ic, &p) * scaler;
+
+    if (atl->no_times > 0){
+      if (ftl->pixel == TRUE){
+        for (ic = 0; ic < no_elements; ic ++){
+          sample_index = 2*rx[ic] - job->time * sys->fs;
+          ia = 0; ina = 1;
+          while (atl->a[ina].time < sample_index){ ina ++; ia ++;}
+          apo[ic] = atl->a[ia].a[ic];
+        }
+      }else{
+        if (o_abs_s > atl->a[ina].time){ ina ++; ia ++;}
+        memcpy(apo, atl->a[ia].a, no_elements * sizeof(double));
+      }
+    }
+
+    /* Sum over the waves */
+    d = 0;
+    for (iw = 0; iw < job->no_waves; iw ++){
+      tx = transmit_index(job, iw, &p);
+      x = job->rf + iw * wave_size;
+      for (ic = 0; ic < no_elements; ic ++, x += job->no_samples){
+        sample_index = rx[ic] + tx;
+        if (sample_index < 0) continue;
+        is1 = (ui32)sample_index;
+        if (is1 + 1 < job->no_samples){
+          A = sample_index - is1;
+          d += apo[ic]*(x[is1]*(1-A) + x[is1+1]*A);
+        }
+      }
+    }
+    out[os] = d;
+
+    p.x += dX;
+    p.y += dY;
+    p.z += dZ;
+  }
+  free(rx);
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_compound
+ * ABSTRACT : Beamform the recordings of a number of plane or diverging
+ *            waves and sum them into one image. The lines are
+ *            distributed over the worker threads.
+ * ARGUMENTS: flc, alc, sys - Settings, as for beamform_image()
+ *            waves - The transmitted waves
+ *            rf - The channel data, no_samples x no_channels x no_waves
+ *            image - Result, no_out x no_lines, where no_out is given
+ *                    by beamform_no_out(). Allocated if NULL.
+ * RETURNS  : 'image', or NULL on error.
+ *********************************************************************/
+double* beamform_compound(TFocusLineCollection *flc, TApoLineCollection *alc,
+                          TSysParams *sys, TTransmitWave *waves, ui32 no_waves,
+                          double *rf, ui32 no_samples, ui32 no_channels,
+                          double *image)
+{
+  TCompoundJob job;
+  double *ref, tx, ty, n;
+  ui32 i;
+
+  PFUNC
+  if (flc->no_focus_time_lines != alc->no_apo_time_lines){
+    printf("\007 beamform_compound:\n");
+    printf("Error : the number of apodization lines and the number of ");
+    printf("focus lines must be the same \n");
+    return NULL;
+  }
+  if (flc->no_focus_time_lines == 0 || no_waves == 0){
+    printf("\007 beamform_compound:\n");
+    printf("Error : the number of defined lines or waves is 0\n");
+    return NULL;
+  }
+  for (i = 0; i < flc->no_focus_time_lines; i++){
+    if (flc->ftl[i].dynamic != TRUE && flc->ftl[i].pixel != TRUE){
+      printf("\007 beamform_compound:\n");
+      printf("Error : line %d is focused with fixed delays. Only dynamic ", i + 1);
+      printf("and pixel based focusing are supported\n");
+      return NULL;
+    }
+    if (flc->ftl[i].xdc == NULL || flc->ftl[i].xdc->no_elements > no_channels){
+      printf("\007 beamform_compound:\n");
+      printf("Error : line %d needs more channels than recorded\n", i + 1);
+      return NULL;
+    }
+  }
+
+  job.flc = flc;
+  job.alc = alc;
+  job.sys = sys;
+  job.waves = waves;
+  job.no_waves = no_waves;
+  job.rf = rf;
+  job.no_samples = no_samples;
+  job.no_channels = no_channels;
+  job.no_out = beamform_no_out(flc, no_samples);
+  job.failed = FALSE;
+
+  job.wave_ref = (double*)malloc(4 * no_waves * sizeof(double));
+  if (job.wave_ref == NULL) goto bc_fail_1;
+
+  /* Propagation direction of the plane waves, distance of the virtual
+     sources from the origin, and the earliest recording */
+  job.time = waves[0].time;
+  for (i = 0; i < no_waves; i++){
+    ref = job.wave_ref + 4*i;
+    tx = tan(waves[i].dir_xz);
+    ty = tan(waves[i].dir_yz);
+    n = sqrt(1 + tx*tx + ty*ty);
+    ref[0] = tx/n;
+    ref[1] = ty/n;
+    ref[2] = 1/n;
+    ref[3] = sqrt(waves[i].source.x*waves[i].source.x
+                  + waves[i].source.y*waves[i].source.y
+                  + waves[i].source.z*waves[i].source.z);
+    if (waves[i].time < job.time) job.time = waves[i].time;
+  }
+
+  job.image = image;
+  if (job.image == NULL){
+    job.image = (double*)malloc((size_t)job.no_out * flc->no_focus_time_lines
+                                * sizeof(double));
+    if (job.image == NULL) goto bc_fail_2;
+  }
+
+  bft_parallel_for(flc->no_focus_time_lines, compound_line, &job);
+  if (job.failed) goto bc_fail_3;
+
+  free(job.wave_ref);
+  return job.image;
+
+bc_fail_3:
+  if (image == NULL) free(job.image);
+bc_fail_2:
+  free(job.wave_ref);
+bc_fail_1:
+  printf("\007 beamform_compound:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
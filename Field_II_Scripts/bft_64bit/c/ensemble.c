@@ -0,0 +1,439 @@
+/*********************************************************************
+ * NAME     : ensemble.c
+ * ABSTRACT : Beamforming of a slow-time ensemble of frames.
+ *
+ *            For every output sample the contributing channels are
+ *            found once, as a list of "taps" (channel, input sample,
+ *            interpolation and apodization weights). The taps are then
+ *            applied to all the frames of the ensemble in the innermost
+ *            loop. The taps reproduce the arithmetic of the single frame
+ *            routines in beamform.c, so that every frame of the result
+ *            is equal to the output of beamform_image().
+ *
+ *            Lines without apodization are beamformed with unit
+ *            weights. For dynamic focusing with a transmit origin this
+ *            follows beamform_apo_line_dynamic_sta().
+ *********************************************************************/
+
+#include "../h/ensemble.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define ENS_TIMES     0
+#define ENS_DYNAMIC   1
+#define ENS_PIXEL     2
+
+
+/*
+ *  The ensemble and its result, shared by all lines
+ */
+typedef struct{
+  TFocusLineCollection *flc;
+  TApoLineCollection *alc;
+  TSysParams *sys;
+  double time;            /* Time of the first sample                  */
+  double *rf;             /* no_samples x no_channels x no_frames      */
+  ui32 no_samples;
+  ui32 no_channels;
+  ui32 no_frames;
+  ui32 element_no;        /* Transmitting element, for pixel focusing  */
+  TPoint3D *elem;         /* Origin of transmission, or NULL           */
+  ui32 no_out;            /* Samples per beamformed line               */
+  double *ens;            /* no_out x no_lines x no_frames             */
+  ui32 failed;
+}TEnsembleJob;
+
+
+/*
+ *  Focusing state of one line, advanced one output sample at a time,
+ *  and the taps of the current output sample
+ */
+typedef struct{
+  TFocusTimeLine *ftl;
+  TApoTimeLine *atl;      /* NULL if the line is not apodized          */
+  TSysParams *sys;
+  ui32 mode;              /* ENS_TIMES, ENS_DYNAMIC or ENS_PIXEL       */
+  ui32 no_samples;
+  ui32 o_abs_s;           /* Absolute index of the output sample       */
+  ui32 id, ind;           /* Current and next delay                    */
+  ui32 ia, ina;           /* Current and next apodization              */
+  double *apo;            /* Current apodization values                */
+  TPoint3D p;             /* Current focal point (dynamic focusing)    */
+  double dX, dY, dZ;      /* Increments of the focal point per sample  */
+  TPoint3D *elem;         /* Origin of transmission, or NULL           */
+  double scaler;          /* Distance => samples                       */
+  double time_sample;     /* Time of the first sample in samples       */
+  ui32 element_no;        /* Transmitting element (pixel focusing)     */
+  double xmt_index;
+
+  ui32 no_taps;
+  ui32 *ch;               /* Channel                                   */
+  ui32 *ix;               /* First of the two interpolated samples     */
+  double *a0, *a1;        /* Interpolation weights of the two samples  */
+  double *w;              /* Apodization                               */
+}TEnsembleLine;
+
+
+/*********************************************************************
+ * FUNCTION : add_tap
+ *********************************************************************/
+static void add_tap(TEnsembleLine *el, ui32 ch, ui32 ix, double a0,
+                    double a1, double w)
+{
+  ui32 k = el->no_taps++;
+
+  el->ch[k] = ch;
+  el->ix[k] = ix;
+  el->a0[k] = a0;
+  el->a1[k] = a1;
+  el->w[k] = w;
+}
+
+
+/*********************************************************************
+ * FUNCTION : ensemble_line_init
+ * ABSTRACT : Set the focusing state for the first output sample. The
+ *            same as in the prologue of the single frame routines.
+ *********************************************************************/
+static void ensemble_line_init(TEnsembleLine *el, TEnsembleJob *job,
+                               ui32 line_no)
+{
+  TFocusTimeLine *ftl = job->flc->ftl + line_no;
+  TApoTimeLine *atl = job->alc->atl + line_no;
+  TSysParams *sys = job->sys;
+  double dR;
+
+  el->ftl = ftl;
+  el->atl = (atl->no_times > 0) ? atl : NULL;
+  el->sys = sys;
+  el->no_samples = job->no_samples;
+  el->elem = job->elem;
+  el->element_no = job->element_no;
+  el->xmt_index = 0;
+  el->o_abs_s = (ui32)floor(job->time * sys->fs);
+  el->time_sample = job->time * sys->fs;
+  el->scaler = sys->fs / sys->c;
+
+  if (ftl->dynamic == TRUE){
+    el->mode = ENS_DYNAMIC;
+    dR = sys->c / sys->fs / 2;
+    el->dX = tan(ftl->dir_xz);
+    el->dY = tan(ftl->dir_yz);
+    el->dZ = dR/sqrt(1 + el->dX*el->dX + el->dY*el->dY);
+    el->dX *= el->dZ;
+    el->dY *= el->dZ;
+    el->p.x = ftl->center.x + el->dX*el->o_abs_s;
+    el->p.y = ftl->center.y + el->dY*el->o_abs_s;
+    el->p.z = ftl->center.z + el->dZ*el->o_abs_s;
+  }else if (ftl->pixel == TRUE){
+    el->mode = ENS_PIXEL;
+  }else{
+    el->mode = ENS_TIMES;
+    focus_prepare(ftl, sys, job->time, job->no_samples);
+    el->id = 0; el->ind = 1;
+    while (ftl->delay[el->ind].time < el->o_abs_s){ el->ind ++; el->id ++;}
+  }
+
+  if (el->atl != NULL && el->mode != ENS_PIXEL){
+    el->ia = 0; el->ina = 1;
+    while (atl->a[el->ina].time < el->o_abs_s){ el->ina ++; el->ia ++;}
+    el->apo = atl->a[el->ia].a;
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : ensemble_taps_times
+ * ABSTRACT : Taps of one output sample for a line focused with delays.
+ *            See beamform_apo_line_times() and beamform_line_times().
+ *********************************************************************/
+static void ensemble_taps_times(TEnsembleLine *el, ui32 os)
+{
+  TFocusTimeLine *ftl = el->ftl;
+  ui32 no_samples = el->no_samples;
+  ui32 no_elements = ftl->xdc->no_elements;
+  ui32 ic, is1;
+  si32 *d;
+  double *a;
+
+  if (el->atl != NULL && os >= no_samples - 1) return;
+
+  if (el->o_abs_s > ftl->delay[el->ind].time){
+    el->ind ++; el->id ++;
+  }
+  d = ftl->delay[el->id].d;
+  a = ftl->delay[el->id].a;
+
+  if (el->atl != NULL){
+    if (el->o_abs_s > el->atl->a[el->ina].time){
+      el->ina ++; el->ia ++;
+      el->apo = el->atl->a[el->ia].a;
+    }
+    for (ic = 0; ic < no_elements; ic ++){
+      is1 = os - d[ic];
+      if ((is1-1) < no_samples-1)
+        add_tap(el, ic, is1-1, a[ic], 1-a[ic], el->apo[ic]);
+    }
+  }else{
+    for (ic = 0; ic < no_elements; ic ++){
+      is1 = os - d[ic];
+      if (is1 == 0)
+        add_tap(el, ic, 0, 1, 0, 1);
+      else if (is1 < no_samples-1)
+        add_tap(el, ic, is1-1, a[ic], 1-a[ic], 1);
+    }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : ensemble_taps_dynamic
+ * ABSTRACT : Taps of one output sample for a dynamically focused line.
+ *            See beamform_apo_line_dynamic[_sta]().
+ *********************************************************************/
+static void ensemble_taps_dynamic(TEnsembleLine *el, ui32 os)
+{
+  TFocusTimeLine *ftl = el->ftl;
+  TTransducer *xdc = ftl->xdc;
+  TSysParams *sys = el->sys;
+  ui32 no_samples = el->no_samples - 1;
+  double sample_index, sample_base_index, A, w;
+  ui32 ic, is1;
+
+  if (os >= no_samples) return;
+
+  if (el->atl != NULL && el->o_abs_s > el->atl->a[el->ina].time){
+    el->ina ++; el->ia ++;
+    el->apo = el->atl->a[el->ia].a;
+  }
+
+  if (el->elem != NULL){
+    sample_base_index = distance(el->elem, &el->p) * el->scaler - el->time_sample;
+    for (ic = 0; ic < xdc->no_elements; ic ++){
+      sample_index = distance(xdc->c+ic, &el->p)*el->scaler + sample_base_index;
+      is1 = (ui32)floor(sample_index);
+      if (is1 < no_samples-1){
+        A = sample_index - is1;
+        w = (el->atl != NULL) ? el->apo[ic] : 1;
+        add_tap(el, ic, is1, 1-A, A, w);
+      }
+    }
+  }else{
+    for (ic = 0; ic < xdc->no_elements; ic ++){
+      sample_index = distance(&ftl->center, &el->p)*sys->fs;
+      sample_index -= distance(xdc->c+ic, &el->p)*sys->fs;
+      sample_index = os - (sample_index / sys->c);
+      is1 = (ui32)floor(sample_index);
+      if (is1 < no_samples-1){
+        A = sample_index - is1;
+        w = (el->atl != NULL) ? el->apo[ic] : 1;
+        add_tap(el, ic, is1, 1-A, A, w);
+      }
+    }
+  }
+
+  el->p.x += el->dX;
+  el->p.y += el->dY;
+  el->p.z += el->dZ;
+}
+
+
+/*********************************************************************
+ * FUNCTION : ensemble_taps_pixel
+ * ABSTRACT : Taps of one output sample for a line focused in pixels.
+ *            See beamform_apo_line_pixels() and beamform_line_pixels().
+ *********************************************************************/
+static void ensemble_taps_pixel(TEnsembleLine *el, ui32 os)
+{
+  TFocusTimeLine *ftl = el->ftl;
+  TTransducer *xdc = ftl->xdc;
+  TSysParams *sys = el->sys;
+  ui32 no_samples = el->no_samples;
+  double sample_index, A, apo = 1;
+  TPoint3D *p;
+  ui32 ic, is1, ia, ina;
+  int flag;
+
+  if (os >= ftl->no_times) return;
+
+  flag = el->element_no >= xdc->no_elements;
+  p = ftl->pixels + os;
+  if (el->element_no < xdc->no_elements){
+    el->xmt_index = distance(xdc->c+el->element_no, p)*sys->fs;
+    el->xmt_index = (el->xmt_index / sys->c);
+  }
+
+  for (ic = 0; ic < xdc->no_elements; ic ++){
+    sample_index = distance(xdc->c+ic, p)*sys->fs;
+    if (flag)
+      sample_index = 2*sample_index / sys->c - el->time_sample;
+    else
+      sample_index = (sample_index / sys->c) - el->time_sample;
+    if (el->atl != NULL){
+      ia = 0; ina = 1;
+      while (el->atl->a[ina].time < sample_index){ ina ++; ia ++;}
+      apo = el->atl->a[ia].a[ic];
+    }
+    sample_index += el->xmt_index;
+    is1 = (ui32)floor(sample_index);
+    A = sample_index - is1;
+    if (el->atl != NULL){
+      if (is1 + 1 < no_samples && is1 < no_samples)
+        add_tap(el, ic, is1, 1-A, A, apo);
+    }else{
+      if (is1 - 1 < no_samples && is1 < no_samples)
+        add_tap(el, ic, is1-1, A, 1-A, 1);
+    }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : ensemble_line
+ * ABSTRACT : Beamform one line of all the frames of the ensemble.
+ *********************************************************************/
+static void ensemble_line(void *ctx, ui32 line_no)
+{
+  TEnsembleJob *job = (TEnsembleJob*)ctx;
+  TEnsembleLine el;
+  ui32 no_elements = job->flc->ftl[line_no].xdc->no_elements;
+  ui32 no_lines = job->flc->no_focus_time_lines;
+  size_t frame_size = (size_t)job->no_samples * job->no_channels;
+  size_t out_stride = (size_t)job->no_out * no_lines;
+  double *acc, *out;
+  const double *x;
+  ui32 os, k, f;
+
+  el.no_taps = 0;
+  el.ch = (ui32*)malloc(no_elements * sizeof(ui32));
+  el.ix = (ui32*)malloc(no_elements * sizeof(ui32));
+  el.a0 = (double*)malloc(no_elements * sizeof(double));
+  el.a1 = (double*)malloc(no_elements * sizeof(double));
+  el.w = (double*)malloc(no_elements * sizeof(double));
+  acc = (double*)malloc(job->no_frames * sizeof(double));
+
+  if (el.ch == NULL || el.ix == NULL || el.a0 == NULL || el.a1 == NULL
+      || el.w == NULL || acc == NULL){
+    job->failed = TRUE;
+    goto el_exit;
+  }
+
+  ensemble_line_init(&el, job, line_no);
+  out = job->ens + (size_t)line_no * job->no_out;
+
+  for (os = 0; os < job->no_out; os ++, el.o_abs_s ++){
+    el.no_taps = 0;
+    switch (el.mode){
+      case ENS_DYNAMIC: ensemble_taps_dynamic(&el, os); break;
+      case ENS_PIXEL: ensemble_taps_pixel(&el, os); break;
+      default: ensemble_taps_times(&el, os); break;
+    }
+
+    memset(acc, 0, job->no_frames * sizeof(double));
+    for (k = 0; k < el.no_taps; k ++){
+      x = job->rf + (size_t)el.ch[k] * job->no_samples + el.ix[k];
+      for (f = 0; f < job->no_frames; f ++, x += frame_size)
+        acc[f] += el.w[k]*(x[0]*el.a0[k] + x[1]*el.a1[k]);
+    }
+
+    for (f = 0; f < job->no_frames; f ++)
+      out[os + f*out_stride] = acc[f];
+  }
+
+el_exit:
+  free(acc);
+  free(el.w);
+  free(el.a1);
+  free(el.a0);
+  free(el.ix);
+  free(el.ch);
+}
+
+
+/*********************************************************************
+ * FUNCTION : beamform_ensemble
+ * ABSTRACT : Beamform all lines of an ensemble of frames. The lines
+ *            are distributed over the worker threads.
+ * ARGUMENTS: flc, alc, sys - Settings, as for beamform_image()
+ *            time - Time of the first sample of every frame
+ *            rf - The channel data, no_samples x no_channels x no_frames
+ *            element_no - Transmitting element or -1
+ *            xmt - Origin of transmission or NULL
+ *            ens - Result, no_out x no_lines x no_frames, where no_out
+ *                  is given by beamform_no_out(). Allocated if NULL.
+ * RETURNS  : 'ens', or NULL on error.
+ *********************************************************************/
+double* beamform_ensemble(TFocusLineCollection *flc, TApoLineCollection *alc,
+                          TSysParams *sys, double time, double *rf,
+                          ui32 no_samples, ui32 no_channels, ui32 no_frames,
+                          ui32 element_no, TPoint3D *xmt, double *ens)
+{
+  TEnsembleJob job;
+  ui32 i;
+
+  PFUNC
+  if (flc->no_focus_time_lines != alc->no_apo_time_lines){
+    printf("\007 beamform_ensemble:\n");
+    printf("Error : the number of apodization lines and the number of ");
+    printf("focus lines must be the same \n");
+    return NULL;
+  }
+  if (flc->no_focus_time_lines == 0){
+    printf("\007 beamform_ensemble:\n");
+    printf("Error : the number of defined lines is 0\n");
+    return NULL;
+  }
+  if (no_samples < 2){
+    printf("\007 beamform_ensemble:\n");
+    printf("Error : at least 2 samples per channel are needed\n");
+    return NULL;
+  }
+  for (i = 0; i < flc->no_focus_time_lines; i++){
+    if (flc->ftl[i].xdc == NULL || flc->ftl[i].xdc->no_elements > no_channels){
+      printf("\007 beamform_ensemble:\n");
+      printf("Error : line %d needs more channels than recorded\n", i + 1);
+      return NULL;
+    }
+  }
+
+  job.flc = flc;
+  job.alc = alc;
+  job.sys = sys;
+  job.time = time;
+  job.rf = rf;
+  job.no_samples = no_samples;
+  job.no_channels = no_channels;
+  job.no_frames = no_frames;
+  job.no_out = beamform_no_out(flc, no_samples);
+  job.failed = FALSE;
+
+  /* The same choice of transmit origin as in beamform_image() */
+  job.elem = xmt;
+  if (beamform_is_element(flc, element_no) && job.elem == NULL)
+    job.elem = flc->ftl[0].xdc->c + element_no;
+  job.element_no = (flc->no_focus_time_lines == 1) ? element_no : (ui32)-1;
+
+  job.ens = ens;
+  if (job.ens == NULL){
+    job.ens = (double*)malloc((size_t)job.no_out * flc->no_focus_time_lines
+                              * no_frames * sizeof(double));
+    if (job.ens == NULL){
+      printf("\007 beamform_ensemble:\n");
+      printf("Error : cannot allocate memory for the output\n");
+      return NULL;
+    }
+  }
+
+  bft_parallel_for(flc->no_focus_time_lines, ensemble_line, &job);
+
+  if (job.failed){
+    printf("\007 beamform_ensemble:\n");
+    printf("Error : cannot allocate memory for the taps\n");
+    if (ens == NULL) free(job.ens);
+    return NULL;
+  }
+  return job.ens;
+}
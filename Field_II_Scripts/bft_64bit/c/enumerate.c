@@ -0,0 +1,586 @@
+/*********************************************************************
+ * NAME     : enumerate.c
+ * ABSTRACT : Branch and bound enumeration of short binary code sets.
+ *
+ *            The chips are assigned one position at a time for all
+ *            codes, from the ends of the codes inwards (0, N-1, 1,
+ *            N-2, ...). The terms of a correlation whose two chips are
+ *            assigned are summed as the positions are added, and the
+ *            remaining terms are at most 1 in magnitude each. A branch
+ *            is cut as soon as the known part of a lag exceeds its
+ *            limit by more than the number of unknown terms. The
+ *            highest lags are complete first, and they are the most
+ *            likely to break a limit.
+ *
+ *            Symmetries: the first chip of the first code of every
+ *            group is fixed to +1 (negation of groups). A set is only
+ *            kept if it comes first, chip by chip in the order of
+ *            assignment and with +1 before -1, among its reversed,
+ *            alternated and reversed-alternated copies (each with the
+ *            groups negated to start with +1). Since the assigned
+ *            positions are closed under reversal, the comparison is
+ *            made on every node, and cuts the branches that can only
+ *            give copies.
+ *
+ *            The tree is cut at a fixed depth into at least 4096
+ *            subtrees, and the threads take the subtrees one at a time
+ *            from bft_parallel_for(), so that a thread that finishes
+ *            early continues with the remaining work. A finished
+ *            subtree is marked in the checkpoint file together with
+ *            its sets, so that an interrupted run continues where it
+ *            stopped.
+ *********************************************************************/
+
+#include "../h/enumerate.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#endif
+
+#define ENUM_MIN_TASKS  4096   /* Subtrees to spread over the threads  */
+
+
+/*
+ *  The enumeration, shared by all threads
+ */
+typedef struct{
+  TEnumParams *p;
+  ui32 R, N, K, M;        /* Codes, length, group size, groups         */
+  ui32 no_gpairs;         /* Group pairs                               */
+  ui32 no_cpairs;         /* Code pairs, 0 without all_limit           */
+  ui32 order[ENUM_MAX_LENGTH];     /* Position assigned at every level */
+  ui32 pos_level[ENUM_MAX_LENGTH]; /* Level at which a position is set */
+  ui32 free_codes[ENUM_MAX_LENGTH];/* Codes with a free chip per level */
+  ui32 no_options[ENUM_MAX_LENGTH];/* 2^(number of free codes)         */
+  si32 unknown[ENUM_MAX_LENGTH + 1][ENUM_MAX_LENGTH];
+                          /* Terms of lag m that are unknown after the */
+                          /*   first l levels                          */
+  ui32 state_size;        /* Sums per level                            */
+  ui32 split_depth;       /* Levels assigned by the task number        */
+  ui32 no_tasks;
+  ui8 *done;              /* Finished tasks, one bit each              */
+  ui64 no_solutions;
+  ui64 no_nodes;
+  ui32 no_stored;
+  si8 *solutions;         /* no_stored x R x N                         */
+  ui32 room;              /* Sets that fit in 'solutions'              */
+  time_t last_checkpoint;
+  ui32 failed;
+#ifndef NOTHREAD
+  pthread_mutex_t lock;
+#endif
+}TEnumJob;
+
+
+/*
+ *  One subtree
+ */
+typedef struct{
+  TEnumJob *job;
+  si8 x[ENUM_MAX_CODES][ENUM_MAX_LENGTH];
+  si32 *sums;             /* (N+1) x state_size. Sums after l levels   */
+  ui64 no_nodes;
+  ui64 no_solutions;
+  ui32 no_stored;
+  si8 *stored;            /* Sets found in the subtree                 */
+  ui32 room;
+}TEnumTask;
+
+
+/*
+ *  Header of a checkpoint file
+ */
+typedef struct{
+  char magic[8];
+  ui32 no_codes, length, set_size;
+  si32 acf_limit, ccf_limit, all_limit;
+  ui32 split_depth, no_tasks, no_stored, reserved;
+  ui64 no_solutions, no_nodes;
+}TEnumCheckpoint;
+
+static const char enum_magic[8] = "BFTENUM1";
+
+
+static void lock_job(TEnumJob *job)
+{
+#ifndef NOTHREAD
+  pthread_mutex_lock(&job->lock);
+#endif
+}
+
+static void unlock_job(TEnumJob *job)
+{
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&job->lock);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : reserve_sets
+ * ABSTRACT : Make room for 'needed' sets of 'size' chips, doubling the
+ *            buffer as it fills.
+ *********************************************************************/
+static si32 reserve_sets(si8 **sets, ui32 *room, ui32 needed, size_t size)
+{
+  ui32 new_room = (*room > 0) ? *room : 64;
+  si8 *p;
+
+  if (needed <= *room) return TRUE;
+  while (new_room < needed) new_room *= 2;
+  p = (si8*)realloc(*sets, (size_t)new_room * size);
+  if (p == NULL) return FALSE;
+  *sets = p;
+  *room = new_room;
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : assign_level
+ * ABSTRACT : Add the terms of the position of 'level' (already set in
+ *            t->x) to the sums of the level before.
+ *********************************************************************/
+static void assign_level(TEnumTask *t, ui32 level)
+{
+  TEnumJob *job = t->job;
+  ui32 N = job->N, K = job->K, L = 2*N - 1;
+  ui32 p = job->order[level], q, j, g, h, k, r, s, m;
+  si32 *sums = t->sums + (size_t)(level + 1) * job->state_size;
+  si32 *acf = sums, *ccf = acf + job->M*N, *all = ccf + job->no_gpairs*L;
+  si32 d, e;
+
+  memcpy(sums, sums - job->state_size, job->state_size * sizeof(si32));
+
+  for (j = 0; j <= level; j ++){
+    q = job->order[j];
+
+    /* Summed ACF of the groups */
+    if (q != p){
+      m = (p > q) ? p - q : q - p;
+      for (g = 0; g < job->M; g ++){
+        d = 0;
+        for (k = 0; k < K; k ++) d += t->x[g*K + k][p] * t->x[g*K + k][q];
+        acf[g*N + m] += d;
+      }
+    }
+
+    /* Summed CCF of the group pairs, lag p-q and q-p */
+    for (g = 0, s = 0; g < job->M; g ++)
+      for (h = g + 1; h < job->M; h ++, s ++){
+        d = e = 0;
+        for (k = 0; k < K; k ++){
+          d += t->x[g*K + k][p] * t->x[h*K + k][q];
+          e += t->x[g*K + k][q] * t->x[h*K + k][p];
+        }
+        ccf[s*L + (N - 1) + p - q] += d;
+        if (q != p) ccf[s*L + (N - 1) + q - p] += e;
+      }
+
+    /* CCF of the code pairs */
+    if (job->no_cpairs > 0)
+      for (r = 0, s = 0; r < job->R; r ++)
+        for (h = r + 1; h < job->R; h ++, s ++){
+          all[s*L + (N - 1) + p - q] += t->x[r][p] * t->x[h][q];
+          if (q != p) all[s*L + (N - 1) + q - p] += t->x[r][q] * t->x[h][p];
+        }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : out_of_bounds
+ * ABSTRACT : Check if a limit is broken whatever the unassigned chips
+ *            are, once 'no_levels' levels are assigned.
+ *********************************************************************/
+static si32 out_of_bounds(TEnumTask *t, ui32 no_levels)
+{
+  TEnumJob *job = t->job;
+  TEnumParams *p = job->p;
+  ui32 N = job->N, K = job->K, L = 2*N - 1, i, m;
+  si32 *sums = t->sums + (size_t)no_levels * job->state_size;
+  si32 *acf = sums, *ccf = acf + job->M*N, *all = ccf + job->no_gpairs*L;
+  si32 *u = job->unknown[no_levels];
+
+  if (p->acf_limit >= 0)
+    for (i = 0; i < job->M; i ++)
+      for (m = 1; m < N; m ++)
+        if (abs(acf[i*N + m]) - (si32)K*u[m] > p->acf_limit) return TRUE;
+
+  if (p->ccf_limit >= 0)
+    for (i = 0; i < job->no_gpairs; i ++)
+      for (m = 0; m < L; m ++)
+        if (abs(ccf[i*L + m]) - (si32)K*u[(m >= N - 1) ? m - (N - 1) : (N - 1) - m]
+            > p->ccf_limit) return TRUE;
+
+  for (i = 0; i < job->no_cpairs; i ++)
+    for (m = 0; m < L; m ++)
+      if (abs(all[i*L + m]) - u[(m >= N - 1) ? m - (N - 1) : (N - 1) - m]
+          > p->all_limit) return TRUE;
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : has_smaller_copy
+ * ABSTRACT : Check if the reversed, alternated or reversed-alternated
+ *            copy of the assigned chips comes before them.
+ *********************************************************************/
+static si32 has_smaller_copy(TEnumTask *t, ui32 no_levels)
+{
+  TEnumJob *job = t->job;
+  ui32 N = job->N, K = job->K, v, j, r, pos, src, t0;
+  si32 a, w, y, sign[ENUM_MAX_CODES];
+
+  for (v = 1; v < 4; v ++){
+    t0 = (v & 1) ? N - 1 : 0;
+    if (job->pos_level[t0] >= no_levels) continue;
+    for (r = 0; r < job->M; r ++) sign[r] = t->x[r*K][t0];
+
+    for (j = 0; j < no_levels; j ++){
+      pos = job->order[j];
+      src = (v & 1) ? N - 1 - pos : pos;
+      if (job->pos_level[src] >= no_levels) break;
+      a = ((v & 2) && (pos & 1)) ? -1 : 1;
+      for (r = 0; r < job->R; r ++){
+        w = t->x[r][pos];
+        y = sign[r / K] * a * t->x[r][src];
+        if (y != w) break;
+      }
+      if (r < job->R){
+        if (y > w) return TRUE;        /* +1 in the copy, -1 here */
+        break;
+      }
+    }
+  }
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : set_level
+ * ABSTRACT : Set the chips of one level from the bits of 'option',
+ *            one bit per free code, and check the bounds.
+ * RETURNS  : TRUE if the branch can hold sets.
+ *********************************************************************/
+static si32 set_level(TEnumTask *t, ui32 level, ui32 option)
+{
+  TEnumJob *job = t->job;
+  ui32 p = job->order[level], r, b = 0;
+
+  for (r = 0; r < job->R; r ++){
+    if (job->free_codes[level] & (1u << r)){
+      t->x[r][p] = (option & (1u << b)) ? -1 : 1;
+      b ++;
+    }else
+      t->x[r][p] = 1;
+  }
+  t->no_nodes ++;
+  assign_level(t, level);
+  if (out_of_bounds(t, level + 1)) return FALSE;
+  return !has_smaller_copy(t, level + 1);
+}
+
+
+/*********************************************************************
+ * FUNCTION : store_set
+ *********************************************************************/
+static void store_set(TEnumTask *t)
+{
+  TEnumJob *job = t->job;
+  ui32 r;
+  si8 *dst;
+
+  t->no_solutions ++;
+  if (job->no_stored + t->no_stored >= job->p->max_solutions) return;
+  if (!reserve_sets(&t->stored, &t->room, t->no_stored + 1, (size_t)job->R * job->N)){
+    job->failed = TRUE;
+    return;
+  }
+  dst = t->stored + (size_t)t->no_stored * job->R * job->N;
+  for (r = 0; r < job->R; r ++)
+    memcpy(dst + r*job->N, t->x[r], job->N);
+  t->no_stored ++;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_level
+ * ABSTRACT : Depth first search from 'level'.
+ *********************************************************************/
+static void search_level(TEnumTask *t, ui32 level)
+{
+  TEnumJob *job = t->job;
+  ui32 option;
+
+  if (level == job->N){
+    store_set(t);
+    return;
+  }
+  for (option = 0; option < job->no_options[level]; option ++)
+    if (set_level(t, level, option))
+      search_level(t, level + 1);
+}
+
+
+/*********************************************************************
+ * FUNCTION : write_checkpoint
+ * ABSTRACT : Write the state to a new file and rename it, so that an
+ *            interruption leaves the previous checkpoint intact.
+ *            Called with the lock held.
+ *********************************************************************/
+static void write_checkpoint(TEnumJob *job)
+{
+  TEnumParams *p = job->p;
+  TEnumCheckpoint hdr;
+  char *tmp_name;
+  FILE *f;
+  si32 ok;
+
+  tmp_name = (char*)malloc(strlen(p->checkpoint) + 5);
+  if (tmp_name == NULL) return;
+  sprintf(tmp_name, "%s.tmp", p->checkpoint);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, enum_magic, sizeof(hdr.magic));
+  hdr.no_codes = p->no_codes;
+  hdr.length = p->length;
+  hdr.set_size = p->set_size;
+  hdr.acf_limit = p->acf_limit;
+  hdr.ccf_limit = p->ccf_limit;
+  hdr.all_limit = p->all_limit;
+  hdr.split_depth = job->split_depth;
+  hdr.no_tasks = job->no_tasks;
+  hdr.no_stored = job->no_stored;
+  hdr.no_solutions = job->no_solutions;
+  hdr.no_nodes = job->no_nodes;
+
+  f = fopen(tmp_name, "wb");
+  if (f == NULL){
+    printf("write_checkpoint: Cannot create '%s'\n", tmp_name);
+    free(tmp_name);
+    return;
+  }
+  ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+       && fwrite(job->done, (job->no_tasks + 7)/8, 1, f) == 1
+       && (job->no_stored == 0
+           || fwrite(job->solutions, (size_t)job->no_stored * job->R * job->N, 1, f) == 1);
+  ok = (fclose(f) == 0) && ok;
+#ifdef __MSCVC_
+  if (ok) remove(p->checkpoint);
+#endif
+  if (!ok || rename(tmp_name, p->checkpoint) != 0)
+    printf("write_checkpoint: Cannot write '%s'\n", p->checkpoint);
+  free(tmp_name);
+  job->last_checkpoint = time(NULL);
+}
+
+
+/*********************************************************************
+ * FUNCTION : read_checkpoint
+ * ABSTRACT : Continue from a checkpoint file, if there is one.
+ * RETURNS  : FALSE if the file belongs to another enumeration.
+ *********************************************************************/
+static si32 read_checkpoint(TEnumJob *job)
+{
+  TEnumParams *p = job->p;
+  TEnumCheckpoint hdr;
+  FILE *f;
+  si32 ok;
+
+  f = fopen(p->checkpoint, "rb");
+  if (f == NULL) return TRUE;              /* A new enumeration */
+
+  ok = fread(&hdr, sizeof(hdr), 1, f) == 1
+       && memcmp(hdr.magic, enum_magic, sizeof(hdr.magic)) == 0
+       && hdr.no_codes == p->no_codes && hdr.length == p->length
+       && hdr.set_size == p->set_size && hdr.acf_limit == p->acf_limit
+       && hdr.ccf_limit == p->ccf_limit && hdr.all_limit == p->all_limit
+       && hdr.split_depth == job->split_depth && hdr.no_tasks == job->no_tasks
+       && fread(job->done, (job->no_tasks + 7)/8, 1, f) == 1;
+  if (ok){
+    job->no_stored = (hdr.no_stored < p->max_solutions) ? hdr.no_stored : p->max_solutions;
+    ok = job->no_stored == 0
+         || (reserve_sets(&job->solutions, &job->room, job->no_stored,
+                          (size_t)job->R * job->N)             && fread(job->solutions, (size_t)job->no_stored * job->R * job->N, 1, f) == 1);
+    job->no_solutions = hdr.no_solutions;
+    job->no_nodes = hdr.no_nodes;
+  }
+  fclose(f);
+  if (!ok){
+    printf("\007 read_checkpoint:\n");
+    printf("Error : '%s' is not a checkpoint of this enumeration\n", p->checkpoint);
+  }
+  return ok;
+}
+
+
+/*********************************************************************
+ * FUNCTION : run_task
+ * ABSTRACT : Enumerate one subtree, and add its sets to the result.
+ *********************************************************************/
+static void run_task(void *ctx, ui32 task_no)
+{
+  TEnumJob *job = (TEnumJob*)ctx;
+  TEnumTask t;
+  ui32 level, rest;
+  si32 alive = TRUE;
+
+  if (job->done[task_no/8] & (1u << (task_no % 8))) return;
+
+  t.job = job;
+  t.no_nodes = 0;
+  t.no_solutions = 0;
+  t.no_stored = 0;
+  t.stored = NULL;
+  t.room = 0;
+  t.sums = (si32*)calloc((size_t)(job->N + 1) * job->state_size, sizeof(si32));
+  if (t.sums == NULL){
+    job->failed = TRUE;
+    return;
+  }
+
+  /* The task number is the choice on every level above the split */
+  rest = task_no;
+  for (level = 0; level < job->split_depth && alive; level ++){
+    alive = set_level(&t, level, rest % job->no_options[level]);
+    rest /= job->no_options[level];
+  }
+  if (alive) search_level(&t, job->split_depth);
+
+  lock_job(job);
+  job->no_nodes += t.no_nodes;
+  job->no_solutions += t.no_solutions;
+  if (t.no_stored > job->p->max_solutions - job->no_stored)
+    t.no_stored = job->p->max_solutions - job->no_stored;
+  if (!reserve_sets(&job->solutions, &job->room, job->no_stored + t.no_stored,
+                    (size_t)job->R * job->N))
+    job->failed = TRUE;
+  else if (t.no_stored > 0){
+    memcpy(job->solutions + (size_t)job->no_stored * job->R * job->N, t.stored,
+           (size_t)t.no_stored * job->R * job->N);
+    job->no_stored += t.no_stored;
+  }
+  if (!job->failed) job->done[task_no/8] |= (ui8)(1u << (task_no % 8));
+  if (job->p->checkpoint != NULL && !job->failed
+      && time(NULL) - job->last_checkpoint >= (time_t)job->p->checkpoint_interval)
+    write_checkpoint(job);
+  unlock_job(job);
+
+  free(t.stored);
+  free(t.sums);
+}
+
+
+/*********************************************************************
+ * FUNCTION : enumerate_sets
+ * ABSTRACT : Find all code sets within the limits, up to symmetry.
+ * ARGUMENTS: p - Settings
+ *            r - Result. Release with enumerate_free_result().
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 enumerate_sets(TEnumParams *p, TEnumResult *r)
+{
+  TEnumJob job;
+  ui32 N = p->length, level, j, m, i;
+  ui64 no_tasks;
+
+  PFUNC
+  if (p->set_size == 0 || p->no_codes % p->set_size != 0 || N == 0
+      || N > ENUM_MAX_LENGTH || p->no_codes > ENUM_MAX_CODES){
+    printf("\007 enumerate_sets:\n");
+    printf("Error : expecting at most %d codes of at most %d chips, in groups\n",
+           ENUM_MAX_CODES, ENUM_MAX_LENGTH);
+    return FALSE;
+  }
+
+  memset(&job, 0, sizeof(job));
+  job.p = p;
+  job.R = p->no_codes;
+  job.N = N;
+  job.K = p->set_size;
+  job.M = job.R / job.K;
+  job.no_gpairs = job.M*(job.M - 1)/2;
+  job.no_cpairs = (p->all_limit >= 0) ? job.R*(job.R - 1)/2 : 0;
+  job.state_size = job.M*N + (job.no_gpairs + job.no_cpairs)*(2*N - 1);
+
+  /* Outside-in order, and the unknown terms after every level */
+  for (level = 0; level < N; level ++){
+    job.order[level] = (level % 2 == 0) ? level/2 : N - 1 - level/2;
+    job.pos_level[job.order[level]] = level;
+    job.free_codes[level] = (1u << job.R) - 1;
+  }
+  for (i = 0; i < job.M; i ++)
+    job.free_codes[job.pos_level[0]] &= ~(1u << (i*job.K));
+  for (level = 0; level < N; level ++){
+    job.no_options[level] = 1;
+    for (i = 0; i < job.R; i ++)
+      if (job.free_codes[level] & (1u << i)) job.no_options[level] <<= 1;
+  }
+  for (level = 0; level <= N; level ++)
+    for (m = 0; m < N; m ++){
+      job.unknown[level][m] = 0;
+      for (j = 0; j + m < N; j ++)
+        if (job.pos_level[j] >= level || job.pos_level[j + m] >= level)
+          job.unknown[level][m] ++;
+    }
+
+  /* Cut the tree */
+  no_tasks = 1;
+  for (job.split_depth = 0; job.split_depth < N && no_tasks < ENUM_MIN_TASKS;
+       job.split_depth ++)
+    no_tasks *= job.no_options[job.split_depth];
+  job.no_tasks = (ui32)no_tasks;
+
+  job.done = (ui8*)calloc((job.no_tasks + 7)/8, 1);
+  if (job.done == NULL) goto es_fail_1;
+
+  if (p->checkpoint != NULL && !read_checkpoint(&job)){
+    free(job.solutions);
+    free(job.done);
+    return FALSE;
+  }
+  job.last_checkpoint = time(NULL);
+
+#ifndef NOTHREAD
+  pthread_mutex_init(&job.lock, NULL);
+#endif
+  bft_parallel_for(job.no_tasks, run_task, &job);
+#ifndef NOTHREAD
+  pthread_mutex_destroy(&job.lock);
+#endif
+  if (job.failed) goto es_fail_1;
+  if (p->checkpoint != NULL) write_checkpoint(&job);
+
+  free(job.done);
+  r->no_solutions = job.no_solutions;
+  r->no_nodes = job.no_nodes;
+  r->no_stored = job.no_stored;
+  r->solutions = job.solutions;
+  return TRUE;
+
+es_fail_1:
+  free(job.solutions);
+  free(job.done);
+  printf("\007 enumerate_sets:\n");
+  printf("Error : cannot allocate memory\n");
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : enumerate_free_result
+ *********************************************************************/
+void enumerate_free_result(TEnumResult *r)
+{
+  free(r->solutions);
+  r->solutions = NULL;
+  r->no_stored = 0;
+}
@@ -0,0 +1,212 @@
+/*********************************************************************
+ * NAME     : fft.c
+ * ABSTRACT : Iterative radix-2 FFT, and a batch of transforms
+ *            distributed over the worker threads.
+ *********************************************************************/
+
+#include "../h/fft.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*
+ *  A batch of transforms, see fft_many()
+ */
+typedef struct{
+  TFftPlan *plan;
+  double *re, *im;
+  ui32 dist;              /* Distance between the first samples        */
+  ui32 stride;            /* Distance between the samples of one       */
+  si32 direction;
+  ui32 failed;
+}TFftBatch;
+
+
+/*********************************************************************
+ * FUNCTION : fft_next_pow2
+ * RETURNS  : The smallest power of 2 which is not less than 'n'
+ *********************************************************************/
+ui32 fft_next_pow2(ui32 n)
+{
+  ui32 p = 1;
+
+  while (p < n) p <<= 1;
+  return p;
+}
+
+
+/*********************************************************************
+ * FUNCTION : fft_plan
+ * ABSTRACT : Calculate the tables for transforms of length 'n'.
+ * RETURNS  : The plan, or NULL if 'n' is not a power of 2 or there is
+ *            not enough memory.
+ *********************************************************************/
+TFftPlan* fft_plan(ui32 n)
+{
+  TFftPlan *plan;
+  ui32 i, j, bits;
+
+  if (n == 0 || (n & (n - 1))){
+    errprintf("The length of the FFT (%d) is not a power of 2\n", n);
+    return NULL;
+  }
+
+  plan = (TFftPlan*)calloc(1, sizeof(TFftPlan));
+  if (plan == NULL) goto fp_fail;
+  plan->n = n;
+  plan->bitrev = (ui32*)malloc(n * sizeof(ui32));
+  plan->cos_tab = (double*)malloc((n/2 + 1) * sizeof(double));
+  plan->sin_tab = (double*)malloc((n/2 + 1) * sizeof(double));
+  if (plan->bitrev == NULL || plan->cos_tab == NULL || plan->sin_tab == NULL){
+    fft_free_plan(plan);
+    goto fp_fail;
+  }
+
+  for (bits = 0; (1u << bits) < n; bits++);
+  for (i = 0; i < n; i++){
+    for (j = 0, plan->bitrev[i] = 0; j < bits; j++)
+      if (i & (1u << j)) plan->bitrev[i] |= 1u << (bits - 1 - j);
+  }
+  for (i = 0; i <= n/2; i++){
+    plan->cos_tab[i] = cos(2*M_PI*i/n);
+    plan->sin_tab[i] = sin(2*M_PI*i/n);
+  }
+  return plan;
+
+fp_fail:
+  errprintf("%s", "Cannot allocate memory for the FFT tables\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : fft_free_plan
+ *********************************************************************/
+void fft_free_plan(TFftPlan *plan)
+{
+  if (plan == NULL) return;
+  free(plan->bitrev);
+  free(plan->cos_tab);
+  free(plan->sin_tab);
+  free(plan);
+}
+
+
+/*********************************************************************
+ * FUNCTION : fft_run
+ * ABSTRACT : In place transform of 'plan->n' contiguous samples.
+ *            FFT_FORWARD uses exp(-2*pi*i*k*n/N), FFT_INVERSE uses
+ *            exp(+2*pi*i*k*n/N) and scales by 1/N, as fft() and
+ *            ifft() in MATLAB.
+ *********************************************************************/
+void fft_run(TFftPlan *plan, double *re, double *im, si32 direction)
+{
+  ui32 n = plan->n;
+  ui32 i, j, k, half, step;
+  double wr, wi, tr, ti, scale;
+
+  for (i = 0; i < n; i++){
+    j = plan->bitrev[i];
+    if (j > i){
+      tr = re[i]; re[i] = re[j]; re[j] = tr;
+      ti = im[i]; im[i] = im[j]; im[j] = ti;
+    }
+  }
+
+  for (half = 1; half < n; half <<= 1){
+    step = n / (2*half);
+    for (k = 0; k < half; k++){
+      wr = plan->cos_tab[k*step];
+      wi = direction * plan->sin_tab[k*step];
+      for (i = k; i < n; i += 2*half){
+        j = i + half;
+        tr = re[j]*wr - im[j]*wi;
+        ti = re[j]*wi + im[j]*wr;
+        re[j] = re[i] - tr;
+        im[j] = im[i] - ti;
+        re[i] += tr;
+        im[i] += ti;
+      }
+    }
+  }
+
+  if (direction == FFT_INVERSE){
+    scale = 1.0/n;
+    for (i = 0; i < n; i++){
+      re[i] *= scale;
+      im[i] *= scale;
+    }
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : fft_batch_one
+ * ABSTRACT : One transform of a batch. Strided data is gathered in a
+ *            contiguous buffer.
+ *********************************************************************/
+static void fft_batch_one(void *ctx, ui32 t)
+{
+  TFftBatch *b = (TFftBatch*)ctx;
+  ui32 n = b->plan->n;
+  double *re = b->re + (size_t)t * b->dist;
+  double *im = b->im + (size_t)t * b->dist;
+  double *buf;
+  ui32 i;
+
+  if (b->stride == 1){
+    fft_run(b->plan, re, im, b->direction);
+    return;
+  }
+
+  buf = (double*)malloc(2 * n * sizeof(double));
+  if (buf == NULL){
+    b->failed = TRUE;
+    return;
+  }
+  for (i = 0; i < n; i++){
+    buf[i] = re[(size_t)i * b->stride];
+    buf[n + i] = im[(size_t)i * b->stride];
+  }
+  fft_run(b->plan, buf, buf + n, b->direction);
+  for (i = 0; i < n; i++){
+    re[(size_t)i * b->stride] = buf[i];
+    im[(size_t)i * b->stride] = buf[n + i];
+  }
+  free(buf);
+}
+
+
+/*********************************************************************
+ * FUNCTION : fft_many
+ * ABSTRACT : A batch of in place transforms, distributed over the 
+ *            worker threads. Transform 't' uses the samples
+ *            re[t*dist + i*stride], i = 0 .. plan->n-1. 
+ *            For the columns of a column-major matrix dist is the
+ *            number of rows and stride is 1, and for the rows dist is
+ *            1 and stride is the number of rows.
+ *********************************************************************/
+void fft_many(TFftPlan *plan, double *re, double *im, ui32 no_transforms,
+              ui32 dist, ui32 stride, si32 direction)
+{
+  TFftBatch b;
+
+  b.plan = plan;
+  b.re = re;
+  b.im = im;
+  b.dist = dist;
+  b.stride = stride;
+  b.direction = direction;
+  b.failed = FALSE;
+
+  bft_parallel_for(no_transforms, fft_batch_one, &b);
+  if (b.failed)
+    errprintf("%s", "Cannot allocate memory for the FFT\n");
+}
@@ -0,0 +1,320 @@
+/*********************************************************************
+ * NAME     : fk.c
+ * ABSTRACT : f-k (Stolt) migration of plane wave recordings.
+ *
+ *            Follows D. Garcia et al., "Stolt's f-k migration for
+ *            plane wave ultrasound imaging", IEEE TUFFC 60(9), 2013.
+ *            A plane wave transmitted at the angle A is treated with
+ *            the exploding reflector model and the velocity
+ *            v = c/sqrt(1+cos(A)+sin(A)^2). For every angle:
+ *
+ *              1. FFT in time of every channel.
+ *              2. Compensation of the start time of the recording and
+ *                 of the steering of the plane wave.
+ *              3. FFT across the channels.
+ *              4. Stolt mapping f -> v*sqrt(kx^2 + 4*f^2/(beta*c)^2),
+ *                 by linear interpolation, and the obliquity factor.
+ *              5. Inverse FFT in time, which gives the depth, z = c*t/2
+ *              6. Lateral shift by sin(A)/(2-cos(A))*z, which
+ *                 compensates for the steering.
+ *              7. Inverse FFT across the channels.
+ *
+ *            The images of all angles are summed (compounded). The
+ *            transforms are distributed over the worker threads.
+ *
+ *            The result is sampled as the output of beamform_compound()
+ *            for dynamic lines centered on the elements, so that the
+ *            two can be compared directly. Time zero is when the plane
+ *            wave passes the origin of the coordinate system.
+ *********************************************************************/
+
+#include "../h/fk.h"
+#include "../h/fft.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+
+/*
+ *  The spectrum of one angle and the settings of the migration
+ */
+typedef struct{
+  TSysParams *sys;
+  ui32 nf;                /* Samples in time (FFT length)              */
+  ui32 nkx;               /* Samples across the array (FFT length)     */
+  ui32 nx;                /* Number of elements                        */
+  double pitch;
+  double *x;              /* Lateral position of every element         */
+  double *re, *im;        /* nf x nkx                                  */
+  double sin_a, cos_a;    /* Angle of the current plane wave           */
+  double time;            /* Start of the recording of the current one */
+  ui32 first_row;         /* Rows of the result: first_row ..           */
+  ui32 no_rows;           /*   first_row + no_rows - 1                 */
+  ui32 failed;
+}TFkJob;
+
+
+/*********************************************************************
+ * FUNCTION : fk_kx
+ * RETURNS  : The lateral wave number of column 'j' of the spectrum
+ *********************************************************************/
+static double fk_kx(TFkJob *job, ui32 j)
+{
+  si32 k = (j <= job->nkx/2) ? (si32)j : (si32)j - (si32)job->nkx;
+
+  return k / (job->pitch * job->nkx);
+}
+
+
+/*********************************************************************
+ * FUNCTION : fk_shift_time
+ * ABSTRACT : Delay channel 'j' by the start of the recording minus the
+ *            transmit delay of the plane wave at the element, and
+ *            clear the negative frequencies.
+ *********************************************************************/
+static void fk_shift_time(void *ctx, ui32 j)
+{
+  TFkJob *job = (TFkJob*)ctx;
+  double *re = job->re + (size_t)j * job->nf;
+  double *im = job->im + (size_t)j * job->nf;
+  double tau, ph, cr, ci, t;
+  ui32 i;
+
+  tau = job->time - job->x[j] * job->sin_a / job->sys->c;
+  for (i = 0; i <= job->nf/2; i++){
+    ph = -2*M_PI * i * job->sys->fs / job->nf * tau;
+    cr = cos(ph);
+    ci = sin(ph);
+    t = re[i]*cr - im[i]*ci;
+    im[i] = re[i]*ci + im[i]*cr;
+    re[i] = t;
+  }
+  for (; i < job->nf; i++) re[i] = im[i] = 0;
+}
+
+
+/*********************************************************************
+ * FUNCTION : fk_stolt
+ * ABSTRACT : Stolt mapping of the column 'j' of the spectrum.
+ *********************************************************************/
+static void fk_stolt(void *ctx, ui32 j)
+{
+  TFkJob *job = (TFkJob*)ctx;
+  ui32 nf2 = job->nf/2;
+  double *re = job->re + (size_t)j * job->nf;
+  double *im = job->im + (size_t)j * job->nf;
+  double *sr, *si;
+  double c = job->sys->c;
+  double df = job->sys->fs / job->nf;
+  double kx = fk_kx(job, j);
+  double v, beta, f, fkz, idx, A;
+  ui32 i, k;
+
+  sr = (double*)malloc(2 * (nf2 + 1) * sizeof(double));
+  if (sr == NULL){
+    job->failed = TRUE;
+    return;
+  }
+  si = sr + nf2 + 1;
+
+  /* Copy the positive frequencies without the evanescent part */
+  for (i = 0; i <= nf2; i++){
+    f = i * df;
+    if (f < c * fabs(kx)) sr[i] = si[i] = 0;
+    else { sr[i] = re[i]; si[i] = im[i]; }
+  }
+
+  v = c / sqrt(1 + job->cos_a + job->sin_a*job->sin_a);
+  beta = pow(1 + job->cos_a, 1.5) / (1 + job->cos_a + job->sin_a*job->sin_a);
+
+  re[0] = im[0] = 0;
+  for (i = 1; i <= nf2; i++){
+    f = i * df;
+    fkz = v * sqrt(kx*kx + 4*f*f/(beta*beta*c*c));
+    idx = fkz / df;
+    k = (ui32)idx;
+    if (idx >= nf2){
+      re[i] = im[i] = 0;
+      continue;
+    }
+    A = idx - k;
+    /* Linear interpolation and the obliquity factor */
+    re[i] = (sr[k]*(1-A) + sr[k+1]*A) * f / fkz;
+    im[i] = (si[k]*(1-A) + si[k+1]*A) * f / fkz;
+  }
+  free(sr);
+}
+
+
+/*********************************************************************
+ * FUNCTION : fk_shift_lateral
+ * ABSTRACT : Shift every depth of the column 'j' laterally by
+ *            sin(A)/(2-cos(A))*z, in the kx domain.
+ *********************************************************************/
+static void fk_shift_lateral(void *ctx, ui32 j)
+{
+  TFkJob *job = (TFkJob*)ctx;
+  double *re = job->re + (size_t)j * job->nf;
+  double *im = job->im + (size_t)j * job->nf;
+  double gamma = job->sin_a / (2 - job->cos_a);
+  double kx = fk_kx(job, j);
+  double dz = job->sys->c / job->sys->fs / 2;
+  double ph, cr, ci, t;
+  ui32 i;
+
+  if (gamma == 0) return;
+  for (i = job->first_row; i < job->first_row + job->no_rows; i++){
+    ph = 2*M_PI * kx * gamma * i * dz;
+    cr = cos(ph);
+    ci = sin(ph);
+    t = re[i]*cr - im[i]*ci;
+    im[i] = re[i]*ci + im[i]*cr;
+    re[i] = t;
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : fk_migrate
+ * ABSTRACT : Migrate and compound the recordings of plane waves.
+ * ARGUMENTS: xdc - Linear array. The elements must be equally spaced
+ *                  along the x axis.
+ *            sys - Speed of sound and sampling frequency
+ *            angles - Angle of every plane wave in the xz plane [rad]
+ *            times - Time of the first sample of every recording [s]
+ *            rf - Channel data, no_samples x no_elements x no_angles
+ *            image - Result, no_samples x no_elements. Sample 'i' of
+ *                    column 'j' is at x of element 'j', and at the
+ *                    depth (floor(min(times)*fs) + i) * c/fs/2.
+ *                    Allocated if NULL.
+ * RETURNS  : 'image', or NULL on error.
+ *********************************************************************/
+double* fk_migrate(TTransducer *xdc, TSysParams *sys, double *angles,
+                   double *times, ui32 no_angles, double *rf,
+                   ui32 no_samples, double *image)
+{
+  TFkJob job;
+  TFftPlan *plan_t = NULL, *plan_x = NULL;
+  double t_min, t_max, x_max, *out, *in;
+  ui32 nx, ia, i, j, pad;
+
+  PFUNC
+  nx = xdc->no_elements;
+  if (nx < 2 || no_angles == 0 || no_samples == 0){
+    printf("\007 fk_migrate:\n");
+    printf("Error : at least 2 elements, 1 angle and 1 sample are needed\n");
+    return NULL;
+  }
+
+  /* The migration needs an equally spaced linear array */
+  job.pitch = (xdc->c[nx-1].x - xdc->c[0].x) / (nx - 1);
+  x_max = 0;
+  for (j = 0; j < nx; j++){
+    if (fabs(xdc->c[j].x - xdc->c[0].x - j*job.pitch) > 1e-3*fabs(job.pitch)
+        || fabs(xdc->c[j].y) > 1e-3*fabs(job.pitch)
+        || fabs(xdc->c[j].z) > 1e-3*fabs(job.pitch) || job.pitch <= 0){
+      printf("\007 fk_migrate:\n");
+      printf("Error : the elements must be equally spaced along x, at y = z = 0\n");
+      return NULL;
+    }
+    if (fabs(xdc->c[j].x) > x_max) x_max = fabs(xdc->c[j].x);
+  }
+
+  t_min = t_max = times[0];
+  for (ia = 0; ia < no_angles; ia++){
+    if (times[ia] < t_min) t_min = times[ia];
+    if (times[ia] > t_max) t_max = times[ia];
+  }
+  if (t_min < 0){
+    printf("\007 fk_migrate:\n");
+    printf("Error : the recordings must start at a positive time\n");
+    return NULL;
+  }
+
+  /* The recordings, shifted to absolute time, must not wrap around */
+  pad = (ui32)ceil(t_max * sys->fs + x_max * sys->fs / sys->c);
+  job.sys = sys;
+  job.nx = nx;
+  job.nf = fft_next_pow2(2*(no_samples + pad));
+  job.nkx = fft_next_pow2((3*nx + 1)/2);
+  job.first_row = (ui32)floor(t_min * sys->fs);
+  job.no_rows = no_samples;
+  job.failed = FALSE;
+
+  job.x = (double*)malloc(nx * sizeof(double));
+  job.re = (double*)malloc((size_t)job.nf * job.nkx * sizeof(double));
+  job.im = (double*)malloc((size_t)job.nf * job.nkx * sizeof(double));
+  plan_t = fft_plan(job.nf);
+  plan_x = fft_plan(job.nkx);
+  if (job.x == NULL || job.re == NULL || job.im == NULL
+      || plan_t == NULL || plan_x == NULL)
+    goto fk_fail;
+
+  out = image;
+  if (out == NULL){
+    out = (double*)malloc((size_t)no_samples * nx * sizeof(double));
+    if (out == NULL) goto fk_fail;
+  }
+  memset(out, 0, (size_t)no_samples * nx * sizeof(double));
+
+  for (j = 0; j < nx; j++) job.x[j] = xdc->c[j].x;
+
+  for (ia = 0; ia < no_angles; ia++){
+    job.sin_a = sin(angles[ia]);
+    job.cos_a = cos(angles[ia]);
+    job.time = times[ia];
+
+    memset(job.re, 0, (size_t)job.nf * job.nkx * sizeof(double));
+    memset(job.im, 0, (size_t)job.nf * job.nkx * sizeof(double));
+    in = rf + (size_t)ia * no_samples * nx;
+    for (j = 0; j < nx; j++)
+      memcpy(job.re + (size_t)j * job.nf, in + (size_t)j * no_samples,
+             no_samples * sizeof(double));
+
+    fft_many(plan_t, job.re, job.im, nx, job.nf, 1, FFT_FORWARD);
+    bft_parallel_for(nx, fk_shift_time, &job);
+    fft_many(plan_x, job.re, job.im, job.nf/2 + 1, 1, job.nf, FFT_FORWARD);
+    bft_parallel_for(job.nkx, fk_stolt, &job);
+    fft_many(plan_t, job.re, job.im, job.nkx, job.nf, 1, FFT_INVERSE);
+    bft_parallel_for(job.nkx, fk_shift_lateral, &job);
+    fft_many(plan_x, job.re + job.first_row, job.im + job.first_row,
+             job.no_rows, 1, job.nf, FFT_INVERSE);
+    if (job.failed) break;
+
+    /* Only the positive frequencies were kept: the real signal is
+       twice the real part */
+    for (j = 0; j < nx; j++)
+      for (i = 0; i < no_samples; i++)
+        out[i + (size_t)j * no_samples] +=
+          2 * job.re[job.first_row + i + (size_t)j * job.nf];
+  }
+
+  if (job.failed){
+    if (image == NULL) free(out);
+    goto fk_fail;
+  }
+
+  fft_free_plan(plan_t);
+  fft_free_plan(plan_x);
+  free(job.x);
+  free(job.re);
+  free(job.im);
+  return out;
+
+fk_fail:
+  fft_free_plan(plan_t);
+  fft_free_plan(plan_x);
+  free(job.x);
+  free(job.re);
+  free(job.im);
+  printf("\007 fk_migrate:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
@@ -0,0 +1,346 @@
+/*********************************************************************
+ * NAME     : flow.c
+ * ABSTRACT : Lag-one autocorrelation (Kasai) color flow estimator.
+ *
+ *            The estimation is done in two passes, each distributed
+ *            over the lines:
+ *              1. Wall filtering and the lag-0 and lag-1
+ *                 autocorrelations R0 and R1 of every sample.
+ *              2. Averaging of R0 and R1 with a boxcar kernel in depth
+ *                 and across the lines, and calculation of velocity,
+ *                 normalized variance and power.
+ *            All inner loops run along the depth, which is the
+ *            contiguous dimension of the ensemble, so that they can be
+ *            vectorized by the compiler.
+ *********************************************************************/
+
+#include "../h/flow.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Tells the compiler that the depth arrays do not overlap */
+#define RESTRICT __restrict
+
+
+/*
+ *  Data shared by all lines
+ */
+typedef struct{
+  TFlowParams *fp;
+  const double *iq_re, *iq_im; /* no_depth x no_lines x no_frames       */
+  ui32 no_depth;
+  ui32 no_lines;
+  ui32 no_frames;
+  ui32 kernel_z, kernel_x;    /* fp->kernel_z and _x, 0 taken as 1     */
+  double *wall;               /* no_frames x no_frames projection, or NULL */
+  double *r0;                 /* no_depth x no_lines                   */
+  double *r1_re, *r1_im;
+  double *v, *var, *power;    /* The result, no_depth x no_lines       */
+  ui32 failed;
+}TFlowJob;
+
+
+/*********************************************************************
+ * FUNCTION : wall_filter_matrix
+ * ABSTRACT : Projection matrix of the polynomial regression wall
+ *            filter. The slow-time signal is projected on the space
+ *            orthogonal to the polynomials of order 0 .. 'order'.
+ *            The polynomial basis is orthonormalized by Gram-Schmidt.
+ * RETURNS  : no_frames x no_frames matrix (row major), or NULL
+ *********************************************************************/
+static double* wall_filter_matrix(si32 order, ui32 no_frames)
+{
+  double *basis, *wall, *b, *bj;
+  double s, t;
+  ui32 k, j, f, g;
+
+  basis = (double*)malloc((size_t)(order + 1) * no_frames * sizeof(double));
+  wall = (double*)malloc((size_t)no_frames * no_frames * sizeof(double));
+  if (basis == NULL || wall == NULL){
+    free(basis); free(wall);
+    return NULL;
+  }
+
+  for (k = 0; k <= (ui32)order; k++){
+    b = basis + k*no_frames;
+    for (f = 0; f < no_frames; f++){
+      t = 2.0*f/(no_frames - 1) - 1;          /* Slow time in [-1, 1] */
+      b[f] = pow(t, k);
+    }
+    for (j = 0; j < k; j++){
+      bj = basis + j*no_frames;
+      for (s = 0, f = 0; f < no_frames; f++) s += b[f]*bj[f];
+      for (f = 0; f < no_frames; f++) b[f] -= s*bj[f];
+    }
+    for (s = 0, f = 0; f < no_frames; f++) s += b[f]*b[f];
+    s = 1/sqrt(s);
+    for (f = 0; f < no_frames; f++) b[f] *= s;
+  }
+
+  for (f = 0; f < no_frames; f++)
+    for (g = 0; g < no_frames; g++){
+      s = (f == g) ? 1 : 0;
+      for (k = 0; k <= (ui32)order; k++)
+        s -= basis[k*no_frames + f]*basis[k*no_frames + g];
+      wall[f*no_frames + g] = s;
+    }
+
+  free(basis);
+  return wall;
+}
+
+
+/*********************************************************************
+ * FUNCTION : flow_autocorr
+ * ABSTRACT : Wall filter one line and find R0 and R1 for every depth.
+ *********************************************************************/
+static void flow_autocorr(void *ctx, ui32 line_no)
+{
+  TFlowJob *job = (TFlowJob*)ctx;
+  ui32 nz = job->no_depth;
+  ui32 nf = job->no_frames;
+  size_t frame_stride = (size_t)nz * job->no_lines;
+  const double *in_re = job->iq_re + (size_t)line_no * nz;
+  const double *in_im = job->iq_im + (size_t)line_no * nz;
+  double *x_re = NULL, *x_im = NULL;
+  double *RESTRICT r0 = job->r0 + (size_t)line_no * nz;
+  double *RESTRICT r1_re = job->r1_re + (size_t)line_no * nz;
+  double *RESTRICT r1_im = job->r1_im + (size_t)line_no * nz;
+  const double *RESTRICT a_re, *RESTRICT a_im;
+  const double *RESTRICT b_re, *RESTRICT b_im;
+  double *RESTRICT y_re, *RESTRICT y_im;
+  double p;
+  ui32 f, g, z;
+  size_t x_stride;
+
+  /* Wall filter into a private copy of the line */
+  if (job->wall != NULL){
+    x_re = (double*)malloc((size_t)nz * nf * sizeof(double));
+    x_im = (double*)malloc((size_t)nz * nf * sizeof(double));
+    if (x_re == NULL || x_im == NULL){
+      job->failed = TRUE;
+      goto fa_exit;
+    }
+    for (f = 0; f < nf; f++){
+      y_re = x_re + (size_t)f*nz;
+      y_im = x_im + (size_t)f*nz;
+      memset(y_re, 0, nz*sizeof(double));
+      memset(y_im, 0, nz*sizeof(double));
+      for (g = 0; g < nf; g++){
+        p = job->wall[f*nf + g];
+        if (p == 0) continue;
+        a_re = in_re + g*frame_stride;
+        a_im = in_im + g*frame_stride;
+        for (z = 0; z < nz; z++){
+          y_re[z] += p*a_re[z];
+          y_im[z] += p*a_im[z];
+        }
+      }
+    }
+    in_re = x_re;
+    in_im = x_im;
+    x_stride = nz;
+  }else
+    x_stride = frame_stride;
+
+  memset(r0, 0, nz*sizeof(double));
+  memset(r1_re, 0, nz*sizeof(double));
+  memset(r1_im, 0, nz*sizeof(double));
+
+  for (f = 0; f < nf; f++){
+    b_re = in_re + f*x_stride;
+    b_im = in_im + f*x_stride;
+    for (z = 0; z < nz; z++)
+      r0[z] += b_re[z]*b_re[z] + b_im[z]*b_im[z];
+    if (f == 0) continue;
+
+    /* R1 += conj(x[f-1]) * x[f] */
+    a_re = in_re + (f-1)*x_stride;
+    a_im = in_im + (f-1)*x_stride;
+    for (z = 0; z < nz; z++){
+      r1_re[z] += a_re[z]*b_re[z] + a_im[z]*b_im[z];
+      r1_im[z] += a_re[z]*b_im[z] - a_im[z]*b_re[z];
+    }
+  }
+
+  for (z = 0; z < nz; z++){
+    r0[z] /= nf;
+    r1_re[z] /= nf - 1;
+    r1_im[z] /= nf - 1;
+  }
+
+fa_exit:
+  free(x_re);
+  free(x_im);
+}
+
+
+/*********************************************************************
+ * FUNCTION : boxcar_depth
+ * ABSTRACT : Average over 'kernel' samples centered on every sample.
+ *            The kernel is truncated at the ends of the line. 'sum'
+ *            must have room for no_depth+1 values.
+ *********************************************************************/
+static void boxcar_depth(double *x, double *sum, ui32 no_depth, ui32 kernel)
+{
+  ui32 z, lo, hi;
+
+  sum[0] = 0;
+  for (z = 0; z < no_depth; z++) sum[z+1] = sum[z] + x[z];
+  for (z = 0; z < no_depth; z++){
+    lo = (z >= kernel/2) ? z - kernel/2 : 0;
+    hi = z + (kernel - 1)/2 + 1;
+    if (hi > no_depth) hi = no_depth;
+    x[z] = (sum[hi] - sum[lo]) / (hi - lo);
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : flow_estimate_line
+ * ABSTRACT : Average the autocorrelations around one line and find
+ *            velocity, variance and power.
+ *********************************************************************/
+static void flow_estimate_line(void *ctx, ui32 line_no)
+{
+  TFlowJob *job = (TFlowJob*)ctx;
+  TFlowParams *fp = job->fp;
+  ui32 nz = job->no_depth;
+  double *s0, *s1_re, *s1_im, *sum;
+  double *RESTRICT v = job->v + (size_t)line_no * nz;
+  double *RESTRICT var = job->var + (size_t)line_no * nz;
+  double *RESTRICT power = job->power + (size_t)line_no * nz;
+  const double *RESTRICT a0, *RESTRICT a1_re, *RESTRICT a1_im;
+  double v_scale, r1;
+  ui32 first, last, l, z;
+
+  s0 = (double*)malloc((size_t)(4*nz + 1) * sizeof(double));
+  if (s0 == NULL){
+    job->failed = TRUE;
+    return;
+  }
+  s1_re = s0 + nz;
+  s1_im = s1_re + nz;
+  sum = s1_im + nz;
+
+  /* Lateral part of the kernel */
+  first = (line_no >= job->kernel_x/2) ? line_no - job->kernel_x/2 : 0;
+  last = line_no + (job->kernel_x - 1)/2;
+  if (last >= job->no_lines) last = job->no_lines - 1;
+
+  memset(s0, 0, 3*nz*sizeof(double));
+  for (l = first; l <= last; l++){
+    a0 = job->r0 + (size_t)l * nz;
+    a1_re = job->r1_re + (size_t)l * nz;
+    a1_im = job->r1_im + (size_t)l * nz;
+    for (z = 0; z < nz; z++){
+      s0[z] += a0[z];
+      s1_re[z] += a1_re[z];
+      s1_im[z] += a1_im[z];
+    }
+  }
+  for (z = 0; z < 3*nz; z++) s0[z] /= last - first + 1;
+
+  /* Axial part of the kernel */
+  if (job->kernel_z > 1){
+    boxcar_depth(s0, sum, nz, job->kernel_z);
+    boxcar_depth(s1_re, sum, nz, job->kernel_z);
+    boxcar_depth(s1_im, sum, nz, job->kernel_z);
+  }
+
+  v_scale = fp->c * fp->prf / (4 * M_PI * fp->f0);
+  for (z = 0; z < nz; z++){
+    r1 = sqrt(s1_re[z]*s1_re[z] + s1_im[z]*s1_im[z]);
+    v[z] = v_scale * atan2(s1_im[z], s1_re[z]);
+    var[z] = (s0[z] > 0) ? 1 - r1/s0[z] : 0;
+    power[z] = s0[z];
+  }
+  free(s0);
+}
+
+
+/*********************************************************************
+ * FUNCTION : flow_estimate
+ * ABSTRACT : Estimate velocity, variance and power from an IQ ensemble
+ * ARGUMENTS: fp - Settings of the estimator
+ *            iq_re, iq_im - The ensemble, no_depth x no_lines x no_frames
+ *            v - Axial velocity, positive towards the transducer [m/s]
+ *            var - Normalized variance, 1 - |R1|/R0
+ *            power - Power of the filtered signal, R0
+ *            The results are no_depth x no_lines.
+ * RETURNS  : TRUE on success
+ *********************************************************************/
+si32 flow_estimate(TFlowParams *fp, double *iq_re, double *iq_im,
+                   ui32 no_depth, ui32 no_lines, ui32 no_frames,
+                   double *v, double *var, double *power)
+{
+  TFlowJob job;
+  size_t n = (size_t)no_depth * no_lines;
+
+  PFUNC
+  if (no_frames < 2){
+    printf("\007 flow_estimate:\n");
+    printf("Error : at least 2 frames are needed\n");
+    return FALSE;
+  }
+  if (fp->wall_order >= 0 && (ui32)fp->wall_order + 2 > no_frames){
+    printf("\007 flow_estimate:\n");
+    printf("Error : the order of the wall filter must be less than ");
+    printf("the number of frames minus one\n");
+    return FALSE;
+  }
+  if (fp->prf <= 0 || fp->f0 <= 0){
+    printf("\007 flow_estimate:\n");
+    printf("Error : the pulse repetition and center frequencies must be positive\n");
+    return FALSE;
+  }
+  job.fp = fp;
+  job.kernel_z = (fp->kernel_z > 0) ? fp->kernel_z : 1;
+  job.kernel_x = (fp->kernel_x > 0) ? fp->kernel_x : 1;
+  job.iq_re = iq_re;
+  job.iq_im = iq_im;
+  job.no_depth = no_depth;
+  job.no_lines = no_lines;
+  job.no_frames = no_frames;
+  job.v = v;
+  job.var = var;
+  job.power = power;
+  job.failed = FALSE;
+  job.wall = NULL;
+
+  job.r0 = (double*)malloc(3 * n * sizeof(double));
+  if (job.r0 == NULL) goto fe_fail_1;
+  job.r1_re = job.r0 + n;
+  job.r1_im = job.r1_re + n;
+
+  if (fp->wall_order >= 0){
+    job.wall = wall_filter_matrix(fp->wall_order, no_frames);
+    if (job.wall == NULL) goto fe_fail_2;
+  }
+
+  bft_parallel_for(no_lines, flow_autocorr, &job);
+  if (!job.failed)
+    bft_parallel_for(no_lines, flow_estimate_line, &job);
+  if (job.failed) goto fe_fail_3;
+
+  free(job.wall);
+  free(job.r0);
+  return TRUE;
+
+fe_fail_3:
+  free(job.wall);
+fe_fail_2:
+  free(job.r0);
+fe_fail_1:
+  printf("\007 flow_estimate:\n");
+  printf("Error : cannot allocate memory\n");
+  return FALSE;
+}
@@ -11,9 +11,15 @@
 #include "../h/focus.h"
 #include "../h/sys_params.h"
 #include "../h/geometry.h"
+#include "../h/threads.h"
 #include "../h/error.h"
 
 #include <math.h>
+#include <string.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#endif
 
 
 
@@ -38,6 +44,7 @@ void del_apo_time_line(TApoTimeLine* al)
 {
   PFUNC
   if (al->a!=NULL) {
+     del_apodization(al->a + al->no_times);   /* The last, zero one */
      for(;al->no_times>0;al->no_times--)
         del_apodization(al->a + al->no_times - 1);
      free(al->a);
@@ -103,12 +110,18 @@ void del_focus_time_line(TFocusTimeLine* p)
    PFUNC
    if(p->delay!=NULL)
    {
+     del_delay(p->delay + p->no_times);   /* The last, zero delay */
      for(; p->no_times > 0; p->no_times--)
         del_delay(p->delay + p->no_times-1);
      free(p->delay);
      p->delay = NULL;
    }
    if(p->pixels!=NULL) free(p->pixels);
+   p->pixels = NULL;
+   if(p->zones!=NULL) free(p->zones);
+   p->zones = NULL;
+   p->zone_elements = NULL;
+   p->no_times = 0;
 }
 
 
@@ -173,6 +186,21 @@ void set_center_focus(TFocusLineCollection *flc, TPoint3D *p, ui32 line_no)
 }
 
 
+/*********************************************************************
+ * FUNCTION  : dynamic_line
+ * ABSTRACT  : Body of set_dynamic_focus(), without the checks.
+ *********************************************************************/
+static void dynamic_line(TFocusTimeLine *ftl, TTransducer* xdc,
+                         double dir_xz, double dir_yz)
+{
+   ftl->dir_xz = dir_xz;
+   ftl->dir_yz = dir_yz;
+   ftl->dynamic = TRUE;
+   ftl->pixel = FALSE;
+   ftl->xdc = xdc;
+}
+
+
 /*********************************************************************
  * FUNCTION  : set_dynamic_focus
  *********************************************************************/ 
@@ -182,17 +210,73 @@ void set_dynamic_focus(TFocusLineCollection *flc, TTransducer* xdc,
    PFUNC
    assert_xdc(xdc);
    if (line_no < flc->no_focus_time_lines){
-      flc->ftl[line_no].dir_xz = dir_xz;
-      flc->ftl[line_no].dir_yz = dir_yz;
-      flc->ftl[line_no].dynamic = TRUE;
-      flc->ftl[line_no].pixel = FALSE;
-      flc->ftl[line_no].xdc = xdc;
+      dynamic_line(flc->ftl + line_no, xdc, dir_xz, dir_yz);
    }else{
       errprintf("%s,","\"line_no\" is out of range \n");
    }
 }
 
 
+/*********************************************************************
+ * FUNCTION : new_delays
+ * ABSTRACT : Replace the delays of a line by no_times + 1 delays. The
+ *            last one is zero and valid from MAX_SAMPLE_NO on. The
+ *            others are allocated if 'allocate' is TRUE.
+ *********************************************************************/
+static void new_delays(TFocusTimeLine *ftl, TTransducer* xdc, ui32 no_times,
+                       si32 allocate)
+{
+   ui32 i;
+
+   if(ftl->no_times > 0 || ftl->pixels != NULL || ftl->delay != NULL) 
+      del_focus_time_line(ftl);
+   ftl->delay = (TDelay*)calloc(no_times + 1,sizeof(TDelay));
+   assert(ftl->delay);
+   ftl->no_times = no_times;
+   ftl->dynamic = FALSE;
+   ftl->pixel = FALSE;
+   ftl->xdc = xdc;
+   for (i = 0; allocate && i < no_times; i++ ){
+      ftl->delay[i].d = (si32*) malloc(xdc->no_elements*sizeof(si32));
+      assert(ftl->delay[i].d);
+      ftl->delay[i].a = (double*) malloc(xdc->no_elements*sizeof(double));
+      assert(ftl->delay[i].a);
+   }
+   ftl->delay[no_times].d = (si32*) calloc(xdc->no_elements,sizeof(si32));
+   assert(ftl->delay[no_times].d);
+   ftl->delay[no_times].a = (double*) calloc(xdc->no_elements,sizeof(double));
+   assert(ftl->delay[no_times].a);
+   ftl->delay[no_times].time = MAX_SAMPLE_NO;
+}
+
+
+/*********************************************************************
+ * FUNCTION : focus_times_line
+ * ABSTRACT : Body of set_focus_times(), without the checks.
+ *********************************************************************/
+static void focus_times_line(TFocusTimeLine *ftl, TSysParams* sys, 
+                             TTransducer* xdc, double* times, double *delays, 
+                             ui32 no_times)
+{
+   ui32 i, j;
+   double sample_delay;
+
+   new_delays(ftl, xdc, no_times, TRUE);
+   for (i = 0; i < no_times; i++ )
+   {
+      ftl->delay[i].time = *times * sys->fs;
+      for(j = 0; j < xdc->no_elements; j ++)
+      {  
+         sample_delay = *delays ++;
+         sample_delay *= sys->fs;
+         ftl->delay[i].d[j] = (si32)floor(sample_delay);
+         ftl->delay[i].a[j] = ceil(sample_delay) - sample_delay;
+      }
+      times ++;
+   }
+}
+
+
 /*********************************************************************
  * FUNCTION : set_focus_times(flc,sys,xdc,times,delays,no_times,line_no)
  * ABSTRACT : Set the delays for focusing one line
@@ -208,50 +292,148 @@ void set_focus_times(TFocusLineCollection *flc, TSysParams* sys,
                      TTransducer* xdc, double* times, double *delays, 
                      ui32 no_times,  ui32 line_no)
 {
-   ui32 i, j;
-   double sample_delay;
    PFUNC
    assert_xdc(xdc);
    if (line_no < flc->no_focus_time_lines){
-      if(flc->ftl[line_no].no_times > 0) 
-         del_focus_time_line(flc->ftl + line_no);
-      flc->ftl[line_no].delay = (TDelay*)calloc(no_times + 1,sizeof(TDelay));
-      
-		
-		flc->ftl[line_no].no_times = no_times;
-      flc->ftl[line_no].dynamic = FALSE;
-      flc->ftl[line_no].pixel = FALSE;
-      flc->ftl[line_no].xdc = xdc;
-      for (i = 0; i < no_times; i++ )
-      {
-         flc->ftl[line_no].delay[i].d = 
-                       (si32*) malloc(xdc->no_elements*sizeof(si32));
-         assert(flc->ftl[line_no].delay[i].d);
-         flc->ftl[line_no].delay[i].a = 
-                       (double*) malloc(xdc->no_elements*sizeof(double));
-         assert(flc->ftl[line_no].delay[i].a);
-         flc->ftl[line_no].delay[i].time = *times * sys->fs;
-         for(j = 0; j < xdc->no_elements; j ++)
-         {  
-            sample_delay = *delays ++;
-            sample_delay *= sys->fs;
-            flc->ftl[line_no].delay[i].d[j] = (si32)floor(sample_delay);
-            flc->ftl[line_no].delay[i].a[j] = ceil(sample_delay) - sample_delay;
-         }
-         times ++;
-      }
-      
-      flc->ftl[line_no].delay[no_times].d = (si32*) calloc(xdc->no_elements,sizeof(si32));
-      assert(flc->ftl[line_no].delay[no_times].d);
-      flc->ftl[line_no].delay[no_times].a = (double*) calloc(xdc->no_elements,sizeof(double));
-      assert(flc->ftl[line_no].delay[no_times].a);
-      flc->ftl[line_no].delay[no_times].time = MAX_SAMPLE_NO;
+      focus_times_line(flc->ftl + line_no, sys, xdc, times, delays, no_times);
    }else{
       errprintf("%s","\"line_no\" is out of range \n");
    }
 }                     
 
 
+/**********************************************************************
+ * FUNCTION  : focus_line
+ * ABSTRACT  : Body of set_focus() (ways = 1) and set_focus_2way() 
+ *             (ways = 2), without the checks. Only the times and the
+ *             points are stored, see focus_prepare(), with the center
+ *             and the element positions as they are now.
+ **********************************************************************/
+static void focus_line(TFocusTimeLine *ftl, TSysParams* sys, 
+                       TTransducer* xdc, double* times, TPoint3D *points, 
+                       ui32 no_times, double ways)
+{
+   ui32 i;
+
+   new_delays(ftl, xdc, no_times, FALSE);
+   ftl->zones = (TPoint3D*)malloc((no_times + xdc->no_elements) * sizeof(TPoint3D));
+   assert(ftl->zones);
+   memcpy(ftl->zones, points, no_times * sizeof(TPoint3D));
+   ftl->zone_elements = ftl->zones + no_times;
+   memcpy(ftl->zone_elements, xdc->c, xdc->no_elements * sizeof(TPoint3D));
+   ftl->zone_center = ftl->center;
+   ftl->ways = ways;
+   ftl->zone_sys = *sys;
+   for (i = 0; i < no_times; i++ )
+      ftl->delay[i].time = times[i] * sys->fs;
+}
+
+
+/**********************************************************************
+ * FUNCTION  : compute_zone
+ * ABSTRACT  : Compute the delays of zone 'i' of a line set by
+ *             focus_line(), as set_focus() did at the setting.
+ **********************************************************************/
+static void compute_zone(TFocusTimeLine *ftl, ui32 i)
+{
+   TTransducer *xdc = ftl->xdc;
+   TSysParams *sys = &ftl->zone_sys;
+   TPoint3D *points = ftl->zones + i;
+   double sample_delay, *a;
+   si32 *d;
+   ui32 j;
+
+   d = (si32*) malloc(xdc->no_elements*sizeof(si32));
+   assert(d);
+   a = (double*) malloc(xdc->no_elements*sizeof(double));
+   assert(a);
+   for(j = 0; j < xdc->no_elements; j ++)
+   {  
+      sample_delay = distance(&ftl->zone_center, points)*sys->fs;
+      sample_delay -= distance(ftl->zone_elements+j, points)*sys->fs;
+      sample_delay = ftl->ways*sample_delay / sys->c;
+       
+      d[j] = (si32)floor(sample_delay);
+      a[j] = sample_delay - floor(sample_delay);
+   }
+   ftl->delay[i].a = a;
+   __sync_synchronize();      /* 'd' is published last */
+   ftl->delay[i].d = d;
+}
+
+
+#ifndef NOTHREAD
+#define NO_ZONE_LOCKS 16
+static pthread_mutex_t zone_lock[NO_ZONE_LOCKS];
+static pthread_once_t zone_once = PTHREAD_ONCE_INIT;
+
+static void init_zone_locks()
+{
+   ui32 i;
+
+   for (i = 0; i < NO_ZONE_LOCKS; i++) pthread_mutex_init(zone_lock + i, NULL);
+}
+#endif
+
+
+/**********************************************************************
+ * FUNCTION  : focus_prepare
+ * ABSTRACT  : Compute the missing delays of the zones used for the 
+ *             samples [time, time + no_samples/fs) of a line. The 
+ *             zones are found as the beamforming kernels walk them.
+ **********************************************************************/
+void focus_prepare(TFocusTimeLine *ftl, TSysParams *sys, double time,
+                   ui32 no_samples)
+{
+   ui32 first, o_first;
+
+   if (ftl->zones == NULL || ftl->dynamic || ftl->pixel) return;
+
+   o_first = (ui32)floor(time * sys->fs);
+   for (first = 0; first + 1 < ftl->no_times && ftl->delay[first + 1].time < o_first; first++);
+   focus_prepare_zones(ftl, first, o_first + (no_samples > 0 ? no_samples - 1 : 0));
+}
+
+
+/**********************************************************************
+ * FUNCTION  : focus_prepare_zones
+ * ABSTRACT  : Compute the missing delays of the zones from 'first' to
+ *             the zone of the absolute sample 'o_last'. Used by the 
+ *             kernels that walk the zones to the start of their output
+ *             window before they use the delays. Lines beamformed at 
+ *             the same time by several threads are computed once, 
+ *             under a lock.
+ **********************************************************************/
+void focus_prepare_zones(TFocusTimeLine *ftl, ui32 first, ui32 o_last)
+{
+   ui32 last, i;
+#ifndef NOTHREAD
+   pthread_mutex_t *lock;
+#endif
+
+   if (ftl->zones == NULL || ftl->dynamic || ftl->pixel) return;
+
+   for (last = first; last + 1 < ftl->no_times && ftl->delay[last + 1].time < o_last; last++);
+
+   for (i = first; i <= last && i < ftl->no_times && ftl->delay[i].d != NULL; i++);
+   if (i > last || i >= ftl->no_times){
+      __sync_synchronize();
+      return;
+   }
+
+#ifndef NOTHREAD
+   pthread_once(&zone_once, init_zone_locks);
+   lock = zone_lock + ((size_t)ftl / sizeof(TFocusTimeLine)) % NO_ZONE_LOCKS;
+   pthread_mutex_lock(lock);
+#endif
+   for (; i <= last && i < ftl->no_times; i++)
+      if (ftl->delay[i].d == NULL) compute_zone(ftl, i);
+#ifndef NOTHREAD
+   pthread_mutex_unlock(lock);
+#endif
+}
+
+
 /**********************************************************************
  * FUNCTION  : set_focus(flc,sys,xdc,times,points,no_times,line_no)
  * ABSTRACT  : Set the focus points.
@@ -268,49 +450,10 @@ void set_focus(TFocusLineCollection *flc, TSysParams* sys,
                      TTransducer* xdc, double* times, TPoint3D *points, 
                      ui32 no_times,  ui32 line_no)
 {
-   ui32 i, j;
-   double sample_delay;
-   TPoint3D *center;
-
    PFUNC
    assert_xdc(xdc);
    if (line_no < flc->no_focus_time_lines){
-      if(flc->ftl[line_no].no_times > 0) 
-              del_focus_time_line(flc->ftl + line_no);
-      flc->ftl[line_no].delay = (TDelay*)calloc(no_times+1,sizeof(TDelay));
-      flc->ftl[line_no].no_times = no_times;
-      flc->ftl[line_no].dynamic = FALSE;
-      flc->ftl[line_no].pixel = FALSE;
-      flc->ftl[line_no].xdc = xdc;
-      
-      center = &flc->ftl[line_no].center;
-      
-      for (i = 0; i < no_times; i++ )
-      {
-         flc->ftl[line_no].delay[i].d = (si32*) malloc(xdc->no_elements*sizeof(si32));
-         assert(flc->ftl[line_no].delay[i].d);
-         flc->ftl[line_no].delay[i].a = (double*) malloc(xdc->no_elements*sizeof(double));
-         assert(flc->ftl[line_no].delay[i].a);
-
-         flc->ftl[line_no].delay[i].time = *times * sys->fs;
-         for(j = 0; j < xdc->no_elements; j ++)
-         {  
-            sample_delay = distance(center, points)*sys->fs;
-            sample_delay -= distance(xdc->c+j, points)*sys->fs;
-            sample_delay = sample_delay / sys->c;
-             
-            flc->ftl[line_no].delay[i].d[j] = (si32)floor(sample_delay);
-            flc->ftl[line_no].delay[i].a[j] = sample_delay - floor(sample_delay);
-         }
-         
-         points ++;
-         times ++;
-      }
-      flc->ftl[line_no].delay[no_times].d = (si32*) calloc(xdc->no_elements,sizeof(si32));
-      assert(flc->ftl[line_no].delay[no_times].d);
-      flc->ftl[line_no].delay[no_times].a = (double*) calloc(xdc->no_elements,sizeof(double));
-      assert(flc->ftl[line_no].delay[no_times].a);
-      flc->ftl[line_no].delay[no_times].time = MAX_SAMPLE_NO;
+      focus_line(flc->ftl + line_no, sys, xdc, times, points, no_times, 1);
    }else{
       errprintf("%s", "\"line_no\" is out of range \n");
    }
@@ -333,49 +476,10 @@ void set_focus_2way(TFocusLineCollection *flc, TSysParams* sys,
                       TTransducer* xdc, double* times, TPoint3D *points, 
                       ui32 no_times,  ui32 line_no)
 {
-   ui32 i, j;
-   double sample_delay;
-   TPoint3D *center;
-   
    PFUNC
    assert_xdc(xdc);
    if (line_no < flc->no_focus_time_lines){
-      if(flc->ftl[line_no].no_times > 0) 
-              del_focus_time_line(flc->ftl + line_no);
-      flc->ftl[line_no].delay = (TDelay*)calloc(no_times+1,sizeof(TDelay));
-      flc->ftl[line_no].no_times = no_times;
-      flc->ftl[line_no].dynamic = FALSE;
-      flc->ftl[line_no].pixel = FALSE;
-      flc->ftl[line_no].xdc = xdc;
-      
-      center = &flc->ftl[line_no].center;
-      
-      for (i = 0; i < no_times; i++ )
-      {
-         flc->ftl[line_no].delay[i].d = (si32*) malloc(xdc->no_elements*sizeof(si32));
-         assert(flc->ftl[line_no].delay[i].d);
-         flc->ftl[line_no].delay[i].a = (double*) malloc(xdc->no_elements*sizeof(double));
-         assert(flc->ftl[line_no].delay[i].a);
-
-         flc->ftl[line_no].delay[i].time = *times * sys->fs;
-         for(j = 0; j < xdc->no_elements; j ++)
-         {  
-            sample_delay = distance(center, points)*sys->fs;
-            sample_delay -= distance(xdc->c+j, points)*sys->fs;
-            sample_delay = 2*sample_delay / sys->c;
-             
-            flc->ftl[line_no].delay[i].d[j] = (si32)floor(sample_delay);
-            flc->ftl[line_no].delay[i].a[j] = sample_delay - floor(sample_delay);
-         }
-         
-         points ++;
-         times ++;
-      }
-      flc->ftl[line_no].delay[no_times].d = (si32*) calloc(xdc->no_elements,sizeof(si32));
-      assert(flc->ftl[line_no].delay[no_times].d);
-      flc->ftl[line_no].delay[no_times].a = (double*) calloc(xdc->no_elements,sizeof(double));
-      assert(flc->ftl[line_no].delay[no_times].a);
-      flc->ftl[line_no].delay[no_times].time = MAX_SAMPLE_NO;
+      focus_line(flc->ftl + line_no, sys, xdc, times, points, no_times, 2);
    }else{
       errprintf("%s", "\"line_no\" is out of range \n");
    }
@@ -383,6 +487,29 @@ void set_focus_2way(TFocusLineCollection *flc, TSysParams* sys,
 }
 
 
+/**********************************************************************
+ * FUNCTION  : pixel_line
+ * ABSTRACT  : Body of set_focus_pixel(), without the checks.
+ **********************************************************************/
+static void pixel_line(TFocusTimeLine *ftl, TTransducer* xdc,
+                       TPoint3D *points, ui32 no_times)
+{
+   if(ftl->no_times > 0 || ftl->pixels != NULL || ftl->delay != NULL) 
+      del_focus_time_line(ftl);
+           
+   ftl->no_times = no_times;
+   ftl->dynamic = FALSE;
+   ftl->pixel = TRUE;
+   ftl->xdc = xdc;
+   ftl->pixels = (TPoint3D *)malloc(no_times * sizeof(TPoint3D));
+   if (ftl->pixels == NULL){
+      errprintf("%s", "Cannot allocate memory \n");
+      assert(ftl->pixels);
+   }
+   memcpy(ftl->pixels, points, no_times * sizeof(TPoint3D));
+}
+
+
 /**********************************************************************
  * FUNCTION  : set_focus_pixel(flc,sys,xdc, points, no_times,line_no)
  * ABSTRACT  : Set the focus points. The focal points correspond to 
@@ -399,32 +526,50 @@ void set_focus_pixel(TFocusLineCollection *flc, TSysParams* sys,
                       TTransducer* xdc, TPoint3D *points, 
                       ui32 no_times,  ui32 line_no)
 {
-   ui32 i;
-   
    PFUNC
    assert_xdc(xdc);
    if (line_no < flc->no_focus_time_lines){
-      if(flc->ftl[line_no].no_times > 0) 
-              del_focus_time_line(flc->ftl + line_no);
-              
-      flc->ftl[line_no].no_times = no_times;
-      flc->ftl[line_no].dynamic = FALSE;
-      flc->ftl[line_no].pixel = TRUE;
-      flc->ftl[line_no].xdc = xdc;
-      flc->ftl[line_no].pixels = (TPoint3D *)malloc(no_times * sizeof(TPoint3D));
-      if (flc->ftl[line_no].pixels == NULL){
-         errprintf("%s", "Cannot allocate memory \n");
-         assert(flc->ftl[line_no].pixels);
-      }
-      for (i = 0; i < no_times; i++ )
-         flc->ftl[line_no].pixels[i] = *points ++;
-
+      pixel_line(flc->ftl + line_no, xdc, points, no_times);
    }else{
       errprintf("%s", "\"line_no\" is out of range \n");
    }
 }
 
 
+/*********************************************************************
+ * FUNCTION : apodization_line
+ * ABSTRACT : Body of set_apodization(), without the checks. The 
+ *            apodizations are reused if their number is the same.
+ *********************************************************************/
+static void apodization_line(TApoTimeLine *atl, TSysParams* sys, 
+                             TTransducer* xdc, double* times, double *apo, 
+                             ui32 no_times)
+{
+  ui32 i, j;
+		
+  if (atl->a == NULL || atl->no_times != no_times){
+    if (atl->a != NULL) del_apo_time_line(atl);
+    atl->a = (TApodization*)calloc(no_times + 1,sizeof(TApodization));
+    assert(atl->a);
+    atl->no_times = no_times;
+    for (i = 0; i < no_times; i++ ){
+      atl->a[i].a = (double*) malloc(xdc->no_elements*sizeof(double));
+      assert(atl->a[i].a);
+    }
+    atl->a[no_times].a= (double*) calloc(xdc->no_elements,sizeof(double));
+    assert(atl->a[no_times].a);
+    atl->a[no_times].time = MAX_SAMPLE_NO;
+  }
+
+  for (i = 0; i < no_times; i++ ){
+    atl->a[i].time = *times * sys->fs;
+    for(j = 0; j < xdc->no_elements; j ++)
+      atl->a[i].a[j] = *apo++;
+    times ++;
+  }
+}
+
+
 /*********************************************************************
  * FUNCTION : set_apodization(alc,sys,xdc,times,apo ,no_times,line_no)
  * ABSTRACT : Set the delays for focusing one line
@@ -440,53 +585,104 @@ void set_apodization(TApoLineCollection *alc, TSysParams* sys,
                      TTransducer* xdc, double* times, double *apo, 
                      ui32 no_times,  ui32 line_no)
 {
-  ui32 i, j;
-  int different;
-  int zero_times;
-  int to_delete;
-		
   PFUNC
-    assert_xdc(xdc);
+  assert_xdc(xdc);
 	
   if (line_no < alc->no_apo_time_lines){
-    zero_times = alc->atl[line_no].no_times == 0;
-    different = alc->atl[line_no].no_times != no_times;
-    to_delete = !zero_times && different;
-    if(!zero_times && different) del_apo_time_line(alc->atl + line_no);
-		
-    if (zero_times || to_delete){
-      alc->atl[line_no].a = (TApodization*)calloc(no_times + 1,sizeof(TApodization));
-      alc->atl[line_no].no_times = no_times;
-      for (i = 0; i < no_times; i++ )
-      	{
-	  alc->atl[line_no].a[i].a = 
-	    (double*) malloc(xdc->no_elements*sizeof(double));
-	  assert(alc->atl[line_no].a[i].a);
-         
-	  alc->atl[line_no].a[i].time = *times * sys->fs;
-         
-	  for(j = 0; j < xdc->no_elements; j ++)
-	    alc->atl[line_no].a[i].a[j] = *apo++;
-	  times ++;
-	}
-    }else{
-      for (i = 0; i < no_times; i++ )
-      	{
-	  alc->atl[line_no].a[i].time = *times * sys->fs;
-	  for(j = 0; j < xdc->no_elements; j ++)
-	    alc->atl[line_no].a[i].a[j] = *apo++;
-	  times ++;
-	}
-    }
-    alc->atl[line_no].a[no_times].a= (double*) calloc(xdc->no_elements,sizeof(double));
-    assert(alc->atl[line_no].a[no_times].a);
-    alc->atl[line_no].a[no_times].time = MAX_SAMPLE_NO;
+    apodization_line(alc->atl + line_no, sys, xdc, times, apo, no_times);
   }else{
     errprintf("%s", "\"line_no\" is out of range \n");
   }
 }                     
 
 
+/*
+ *  One set_lines()
+ */
+typedef struct{
+   TLineSetup *setup;
+   TFocusLineCollection *flc;
+   TApoLineCollection *alc;
+   TSysParams *sys;
+}TSetupJob;
+
+
+static void setup_task(void *ctx, ui32 line)
+{
+   TSetupJob *job = (TSetupJob*)ctx;
+   TLineSetup *s = job->setup;
+   double *times = s->times + (size_t)line * s->times_stride;
+   size_t n = s->no_times;
+   TFocusTimeLine *ftl = job->flc->ftl + line;
+
+   switch (s->kind){
+      case SETUP_CENTER:
+         ftl->center = s->points[line];
+         break;
+      case SETUP_DYNAMIC:
+         dynamic_line(ftl, s->xdc, s->dir_xz[line * s->dir_stride],
+                      s->dir_yz[line * s->dir_stride]);
+         break;
+      case SETUP_FOCUS:
+      case SETUP_FOCUS_2WAY:
+         focus_line(ftl, job->sys, s->xdc, times, s->points + line * n, s->no_times,
+                    (s->kind == SETUP_FOCUS_2WAY) ? 2 : 1);
+         break;
+      case SETUP_FOCUS_TIMES:
+         focus_times_line(ftl, job->sys, s->xdc, times,
+                          s->values + line * n * s->xdc->no_elements, s->no_times);
+         break;
+      case SETUP_PIXELS:
+         pixel_line(ftl, s->xdc, s->points + line * n, s->no_times);
+         break;
+      case SETUP_APODIZATION:
+         apodization_line(job->alc->atl + line, job->sys, s->xdc, times,
+                          s->values + line * n * s->xdc->no_elements, s->no_times);
+         break;
+   }
+}
+
+
+/*********************************************************************
+ * FUNCTION : set_lines
+ * ABSTRACT : Set one property of all the lines at once, in parallel.
+ *            The transducer is checked once.
+ * ARGUMENTS: flc, alc - The collections. 'alc' is used by
+ *                       SETUP_APODIZATION only, 'flc' by the others.
+ *            setup - What to set. Its arrays hold all the lines, one
+ *                    after the other (see TLineSetup).
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 set_lines(TFocusLineCollection *flc, TApoLineCollection *alc,
+               TSysParams *sys, TLineSetup *setup)
+{
+   TSetupJob job;
+   ui32 no_lines;
+
+   PFUNC
+   no_lines = (setup->kind == SETUP_APODIZATION) ? alc->no_apo_time_lines
+                                                 : flc->no_focus_time_lines;
+   if (setup->no_lines != no_lines){
+      printf("\007 set_lines:\n");
+      printf("Error : values are given for %u lines, but there are %u lines\n",
+             setup->no_lines, no_lines);
+      return FALSE;
+   }
+   if (setup->kind != SETUP_CENTER && !is_xdc_valid(setup->xdc)){
+      printf("\007 set_lines:\n");
+      printf("Error : the transducer is not valid\n");
+      return FALSE;
+   }
+
+   job.setup = setup;
+   job.flc = flc;
+   job.alc = alc;
+   job.sys = sys;
+   bft_parallel_for(no_lines, setup_task, &job);
+   return TRUE;
+}
+
+
 
 /**********************************************************************
  * FUNCTION : set filter bank
@@ -0,0 +1,103 @@
+/*********************************************************************
+ * NAME     : matfile.c
+ * ABSTRACT : Minimal writer of Matlab MAT files (level 5).
+ *
+ *            A file is a 128 byte header followed by one miMATRIX
+ *            element per variable, holding the array flags, the
+ *            dimensions, the name and the real part. The data are
+ *            written in the byte order of the machine, which the
+ *            endian indicator of the header tells the reader.
+ *********************************************************************/
+
+#include "../h/matfile.h"
+#include "../h/error.h"
+
+#include <string.h>
+
+#define miINT8        1
+#define miINT32       5
+#define miUINT32      6
+#define miDOUBLE      9
+#define miMATRIX     14
+#define mxDOUBLE_CLASS 6
+
+
+/*********************************************************************
+ * FUNCTION : write_tag
+ *********************************************************************/
+static si32 write_tag(FILE *f, ui32 type, ui32 no_bytes)
+{
+  ui32 tag[2];
+
+  tag[0] = type;
+  tag[1] = no_bytes;
+  return fwrite(tag, sizeof(tag), 1, f) == 1;
+}
+
+
+/*********************************************************************
+ * FUNCTION : mat_create
+ * ABSTRACT : Create a MAT file and write its header.
+ * RETURNS  : The opened file, or NULL on error.
+ *********************************************************************/
+FILE* mat_create(const char *file_name)
+{
+  char text[124];
+  ui16 version = 0x0100, endian = ('M' << 8) | 'I';
+  FILE *f;
+
+  PFUNC
+  f = fopen(file_name, "wb");
+  if (f == NULL){
+    printf("\007 mat_create:\n");
+    printf("Error : cannot create '%s'\n", file_name);
+    return NULL;
+  }
+
+  memset(text, ' ', sizeof(text));
+  memcpy(text, "MATLAB 5.0 MAT-file, Platform: BFT", 34);
+  memset(text + 116, 0, 8);                  /* No subsystem data */
+  if (fwrite(text, sizeof(text), 1, f) != 1
+      || fwrite(&version, sizeof(version), 1, f) != 1
+      || fwrite(&endian, sizeof(endian), 1, f) != 1){
+    fclose(f);
+    printf("\007 mat_create:\n");
+    printf("Error : cannot write to '%s'\n", file_name);
+    return NULL;
+  }
+  return f;
+}
+
+
+/*********************************************************************
+ * FUNCTION : mat_write_matrix
+ * ABSTRACT : Append a real double matrix, stored column by column.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 mat_write_matrix(FILE *f, const char *name, ui32 no_rows, ui32 no_cols,
+                      double *data)
+{
+  ui32 name_len = (ui32)strlen(name), name_pad = (8 - name_len % 8) % 8;
+  ui32 no_bytes = (ui32)(no_rows * no_cols * sizeof(double));
+  ui32 flags[2], dims[2];
+  char zeros[8];
+
+  memset(zeros, 0, sizeof(zeros));
+  flags[0] = mxDOUBLE_CLASS;
+  flags[1] = 0;
+  dims[0] = no_rows;
+  dims[1] = no_cols;
+
+  if (!write_tag(f, miMATRIX, 16 + 16 + 8 + name_len + name_pad + 8 + no_bytes)
+      || !write_tag(f, miUINT32, 8) || fwrite(flags, sizeof(flags), 1, f) != 1
+      || !write_tag(f, miINT32, 8) || fwrite(dims, sizeof(dims), 1, f) != 1
+      || !write_tag(f, miINT8, name_len) || fwrite(name, 1, name_len, f) != name_len
+      || fwrite(zeros, 1, name_pad, f) != name_pad
+      || !write_tag(f, miDOUBLE, no_bytes)
+      || fwrite(data, 1, no_bytes, f) != no_bytes){
+    printf("\007 mat_write_matrix:\n");
+    printf("Error : cannot write '%s'\n", name);
+    return FALSE;
+  }
+  return TRUE;
+}
@@ -0,0 +1,329 @@
+/*********************************************************************
+ * NAME     : metrics.c
+ * ABSTRACT : Image quality figures, as in the QuantClutter scripts.
+ *********************************************************************/
+
+#include "../h/metrics.h"
+#include "../h/fft.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+/*********************************************************************
+ * FUNCTION : metric_envelope
+ * ABSTRACT : Replace every line by its envelope, abs(hilbert(line)).
+ *            The analytic signal is found with an FFT of the line
+ *            padded with zeros to a power of 2.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 metric_envelope(double **lines, ui32 no_lines, ui32 no_samples)
+{
+  TFftPlan *plan;
+  double *re, *im;
+  ui32 n, i, k;
+
+  if (no_samples == 0) return TRUE;
+  n = fft_next_pow2(2 * no_samples);
+  plan = fft_plan(n);
+  re = (double*)malloc(2 * (size_t)n * sizeof(double));
+  if (plan == NULL || re == NULL){
+    free(re);
+    if (plan != NULL) fft_free_plan(plan);
+    printf("\007 metric_envelope:\n");
+    printf("Error : cannot allocate memory\n");
+    return FALSE;
+  }
+  im = re + n;
+
+  for (i = 0; i < no_lines; i++){
+    memcpy(re, lines[i], no_samples * sizeof(double));
+    memset(re + no_samples, 0, (n - no_samples) * sizeof(double));
+    memset(im, 0, n * sizeof(double));
+    fft_run(plan, re, im, FFT_FORWARD);
+
+    /* Keep the positive frequencies, doubled */
+    for (k = 1; k < n/2; k++){
+      re[k] *= 2;
+      im[k] *= 2;
+    }
+    for (k = n/2 + 1; k < n; k++) re[k] = im[k] = 0;
+    fft_run(plan, re, im, FFT_INVERSE);
+
+    for (k = 0; k < no_samples; k++)
+      lines[i][k] = sqrt(re[k]*re[k] + im[k]*im[k]);
+  }
+  free(re);
+  fft_free_plan(plan);
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : metric_region_valid
+ * RETURNS  : TRUE if a region is not empty and lies in the image.
+ *********************************************************************/
+si32 metric_region_valid(TImageRegion *r, ui32 no_lines, ui32 no_samples)
+{
+  return r->no_samples > 0 && r->no_lines > 0
+         && r->first_sample + r->no_samples <= no_samples
+         && r->first_line + r->no_lines <= no_lines;
+}
+
+
+/*********************************************************************
+ * FUNCTION : metric_max_to_avg
+ * ABSTRACT : Largest value in the signal region over the mean value
+ *            in the clutter region (maxToAvg.m).
+ *********************************************************************/
+double metric_max_to_avg(double **lines, TImageRegion *signal,
+                         TImageRegion *clutter)
+{
+  double peak, sum = 0, *p;
+  ui32 i, k;
+
+  peak = lines[signal->first_line][signal->first_sample];
+  for (i = 0; i < signal->no_lines; i++){
+    p = lines[signal->first_line + i] + signal->first_sample;
+    for (k = 0; k < signal->no_samples; k++)
+      if (p[k] > peak) peak = p[k];
+  }
+
+  for (i = 0; i < clutter->no_lines; i++){
+    p = lines[clutter->first_line + i] + clutter->first_sample;
+    for (k = 0; k < clutter->no_samples; k++) sum += p[k];
+  }
+  return peak / (sum / ((double)clutter->no_lines * clutter->no_samples));
+}
+
+
+/*********************************************************************
+ * FUNCTION : walk_half
+ * ABSTRACT : Distance from the sample ('line', 'sample') to where
+ *            abs(image) first falls below 'half', going 'steps' steps
+ *            of (dl, ds). Linear interpolation between the samples.
+ * RETURNS  : The distance, or 'steps' if the value stays above.
+ *********************************************************************/
+static double walk_half(double **lines, ui32 line, ui32 sample, si32 dl,
+                        si32 ds, ui32 steps, double half)
+{
+  double prev, cur;
+  ui32 i;
+
+  prev = fabs(lines[line][sample]);
+  for (i = 1; i <= steps; i++){
+    cur = fabs(lines[line + (si32)i*dl][sample + (si32)i*ds]);
+    if (cur < half) return i - 1 + (prev - half) / (prev - cur);
+    prev = cur;
+  }
+  return steps;
+}
+
+
+/*********************************************************************
+ * FUNCTION : walk_minimum
+ * RETURNS  : Number of steps of (dl, ds) to the first minimum of
+ *            abs(image), at most 'steps'.
+ *********************************************************************/
+static ui32 walk_minimum(double **lines, ui32 line, ui32 sample, si32 dl,
+                         si32 ds, ui32 steps)
+{
+  double prev, cur;
+  ui32 i;
+
+  prev = fabs(lines[line][sample]);
+  for (i = 1; i <= steps; i++){
+    cur = fabs(lines[line + (si32)i*dl][sample + (si32)i*ds]);
+    if (cur > prev) return i - 1;
+    prev = cur;
+  }
+  return steps;
+}
+
+
+/*********************************************************************
+ * FUNCTION : metric_figures
+ * ABSTRACT : All figures of one image. The regions of 'setup' must be
+ *            valid. The envelope is not computed here.
+ *********************************************************************/
+void metric_figures(double **lines, TMetricSetup *setup, TImageMetrics *m)
+{
+  TImageRegion *r = &setup->signal;
+  ui32 s_lo, s_hi, l_lo, l_hi, last_s, last_l, i, k;
+  double half, v, side_peak = 0, side = 0, main = 0;
+
+  m->peak = -1;
+  for (i = r->first_line; i < r->first_line + r->no_lines; i++)
+    for (k = r->first_sample; k < r->first_sample + r->no_samples; k++)
+      if (fabs(lines[i][k]) > m->peak){
+        m->peak = fabs(lines[i][k]);
+        m->peak_line = i;
+        m->peak_sample = k;
+      }
+
+  last_s = r->first_sample + r->no_samples - 1;
+  last_l = r->first_line + r->no_lines - 1;
+  half = m->peak / 2;
+  m->axial_fwhm = 
+     walk_half(lines, m->peak_line, m->peak_sample, 0, -1, m->peak_sample - r->first_sample, half)
+   + walk_half(lines, m->peak_line, m->peak_sample, 0, 1, last_s - m->peak_sample, half);
+  m->lateral_fwhm =
+     walk_half(lines, m->peak_line, m->peak_sample, -1, 0, m->peak_line - r->first_line, half)
+   + walk_half(lines, m->peak_line, m->peak_sample, 1, 0, last_l - m->peak_line, half);
+
+  /* Main lobe */
+  s_lo = m->peak_sample - walk_minimum(lines, m->peak_line, m->peak_sample, 0, -1,
+                                       m->peak_sample - r->first_sample);
+  s_hi = m->peak_sample + walk_minimum(lines, m->peak_line, m->peak_sample, 0, 1,
+                                       last_s - m->peak_sample);
+  l_lo = m->peak_line - walk_minimum(lines, m->peak_line, m->peak_sample, -1, 0,
+                                     m->peak_line - r->first_line);
+  l_hi = m->peak_line + walk_minimum(lines, m->peak_line, m->peak_sample, 1, 0,
+                                     last_l - m->peak_line);
+
+  for (i = r->first_line; i <= last_l; i++)
+    for (k = r->first_sample; k <= last_s; k++){
+      v = lines[i][k];
+      if (i >= l_lo && i <= l_hi && k >= s_lo && k <= s_hi) main += v*v;
+      else{
+        side += v*v;
+        if (fabs(v) > side_peak) side_peak = fabs(v);
+      }
+    }
+  m->psl = (m->peak > 0) ? 20*log10(side_peak / m->peak) : 0;
+  m->isl = (main > 0) ? 10*log10(side / main) : 0;
+
+  if (setup->clutter.no_samples > 0 && setup->clutter.no_lines > 0)
+    m->max_to_avg = metric_max_to_avg(lines, &setup->signal, &setup->clutter);
+  else
+    m->max_to_avg = 0;
+}
+
+
+/*********************************************************************
+ * FUNCTION : metric_value
+ * RETURNS  : One of the figures, selected by METRIC_...
+ *********************************************************************/
+double metric_value(TImageMetrics *m, ui32 which)
+{
+  switch (which){
+    case METRIC_AXIAL_FWHM: return m->axial_fwhm;
+    case METRIC_LATERAL_FWHM: return m->lateral_fwhm;
+    case METRIC_PSL: return m->psl;
+    case METRIC_ISL: return m->isl;
+    default: return m->max_to_avg;
+  }
+}
+
+
+/*
+ *  One metric_frames()
+ */
+typedef struct{
+  double ***frames;       /* Images to rate                            */
+  double **lines;         /* All lines, frame after frame              */
+  ui32 no_lines;
+  ui32 no_samples;
+  ui32 chunk;             /* Lines per envelope task                   */
+  ui32 total;
+  TMetricSetup *setup;
+  TImageMetrics *m;
+  ui32 failed;
+}TMetricJob;
+
+
+static void envelope_task(void *ctx, ui32 item)
+{
+  TMetricJob *job = (TMetricJob*)ctx;
+  ui32 first = item * job->chunk;
+  ui32 count = (first + job->chunk <= job->total) ? job->chunk : job->total - first;
+
+  if (!metric_envelope(job->lines + first, count, job->no_samples))
+    job->failed = TRUE;
+}
+
+
+static void figures_task(void *ctx, ui32 item)
+{
+  TMetricJob *job = (TMetricJob*)ctx;
+
+  metric_figures(job->frames[item], job->setup, job->m + item);
+}
+
+
+/*********************************************************************
+ * FUNCTION : metric_frames
+ * ABSTRACT : Rate images, in parallel. The envelope is found on a
+ *            copy, first for all lines of all the images, and then
+ *            the figures for every image.
+ * ARGUMENTS: frames - no_frames images of no_lines lines
+ *            setup - Figures to compute
+ *            m - Receives no_frames results
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 metric_frames(double ***frames, ui32 no_frames, ui32 no_lines,
+                   ui32 no_samples, TMetricSetup *setup, TImageMetrics *m)
+{
+  TMetricJob job;
+  double *copy = NULL, ***env = NULL;
+  ui32 f, i, no_tasks;
+
+  PFUNC
+  if (!metric_region_valid(&setup->signal, no_lines, no_samples)
+      || (setup->clutter.no_samples > 0
+          && !metric_region_valid(&setup->clutter, no_lines, no_samples))){
+    printf("\007 metric_frames:\n");
+    printf("Error : the regions must lie in the image\n");
+    return FALSE;
+  }
+
+  job.frames = frames;
+  job.no_lines = no_lines;
+  job.no_samples = no_samples;
+  job.total = no_frames * no_lines;
+  job.setup = setup;
+  job.m = m;
+  job.failed = FALSE;
+
+  if (setup->envelope){
+    copy = (double*)malloc((size_t)job.total * no_samples * sizeof(double));
+    job.lines = (double**)malloc(job.total * sizeof(double*));
+    env = (double***)malloc(no_frames * sizeof(double**));
+    if (copy == NULL || job.lines == NULL || env == NULL) goto mf_fail;
+
+    for (f = 0; f < no_frames; f++){
+      env[f] = job.lines + (size_t)f * no_lines;
+      for (i = 0; i < no_lines; i++){
+        env[f][i] = copy + ((size_t)f * no_lines + i) * no_samples;
+        memcpy(env[f][i], frames[f][i], no_samples * sizeof(double));
+      }
+    }
+    no_tasks = 4 * bft_get_no_threads();
+    job.chunk = (job.total + no_tasks - 1) / no_tasks;
+    if (job.chunk == 0) job.chunk = 1;
+    bft_parallel_for((job.total + job.chunk - 1) / job.chunk, envelope_task, &job);
+    if (job.failed) goto mf_fail;
+    job.frames = env;
+  }
+
+  bft_parallel_for(no_frames, figures_task, &job);
+
+  if (setup->envelope){
+    free(env);
+    free(job.lines);
+    free(copy);
+  }
+  return TRUE;
+
+mf_fail:
+  free(env);
+  free(job.lines);
+  free(copy);
+  printf("\007 metric_frames:\n");
+  printf("Error : cannot allocate memory\n");
+  return FALSE;
+}
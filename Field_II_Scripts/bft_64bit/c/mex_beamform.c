@@ -9,6 +9,7 @@
 #include "../h/motion.h"
 #include <signal.h>
 #include <string.h>
+#include <stdlib.h>
 
 #ifdef SPECIAL_CASE
 	#include <unistd.h>
@@ -21,6 +22,8 @@ static TApoLineCollection *alc;
 static TApoLineCollection *salc;   /* Sum apo-line collection*/
 
 static int initialized = FALSE;
+static TMetricSetup stream_metric;   /* Rating of the submitted frames */
+static int use_stream_metric = FALSE;
 
 
 /******************************************************************
@@ -34,6 +37,13 @@ void mexBFTExit(void)
    mexNoEntries = 0;
    if (initialized == FALSE) return;
 
+   pipeline_clear();
+   autotune_clear();
+#ifndef BFT_NO_STATS
+   trace_stop();
+   trace_clear();
+#endif
+
 #ifdef  MALLOC_CHECK_
   printf("MALLOC_CHECK_ is %d \n", MALLOC_CHECK_);
 #endif
@@ -65,6 +75,9 @@ void mexBFTExit(void)
    printf("Freeing all transducers \n");
 #endif   
    bft_free_all_xdc();
+   rf_file_close_all();
+   scat_grid_free_all();
+   code_db_close_all();
    initialized = FALSE;
 #ifdef SPECIAL_CASE
    nice(0);
@@ -185,6 +198,28 @@ void bft_param(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
       sys.c = mxGetScalar(prhs[2]);
    }else if(!strcmp(param_name,"fs")){
       sys.fs = mxGetScalar(prhs[2]);
+   }else if(!strcmp(param_name,"queue_depth")){
+      pipeline_set_depth((ui32)floor(mxGetScalar(prhs[2]) + 0.5));
+   }else if(!strcmp(param_name,"threads")){
+      bft_set_no_threads((ui32)floor(mxGetScalar(prhs[2]) + 0.5));
+   }else if(!strcmp(param_name,"affinity")){
+      bft_set_affinity((ui32)floor(mxGetScalar(prhs[2]) + 0.5));
+   }else if(!strcmp(param_name,"numa")){
+      bft_set_numa((ui32)floor(mxGetScalar(prhs[2]) + 0.5));
+   }else if(!strcmp(param_name,"stats")){
+#ifndef BFT_NO_STATS
+      stats_enable(mxGetScalar(prhs[2]) != 0);
+#else
+      mexErrMsgTxt("\nThe toolbox is built without statistics (BFT_NO_STATS)\n");
+#endif
+   }else if(!strcmp(param_name,"perf")){
+#ifndef BFT_NO_STATS
+      perf_enable(mxGetScalar(prhs[2]) != 0);
+#else
+      mexErrMsgTxt("\nThe toolbox is built without statistics (BFT_NO_STATS)\n");
+#endif
+   }else if(!strcmp(param_name,"autotune")){
+      autotune_enable(mxGetScalar(prhs[2]) != 0);
    }else{
       printf("\nUnknown parameter name '%s'\n ",param_name);
       mexErrMsgTxt("");
@@ -709,7 +744,15 @@ void bft_dynamic_focus(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[]
 
 /*******************************************************************
  * FUNCTION : bft_beamform
- * ABSTRACT : Beamform the image.
+ * ABSTRACT : Beamform the image, or the region of it given by the
+ *            optional 'samples' ([first last], from 1) and 'lines' 
+ *            (line numbers, or a logical mask). Only that region is
+ *            beamformed and returned, every 'decimation'-th sample of
+ *            it, low-pass filtered by the optional 'taps'.
+ *            'element_no' here selects the synthetic aperture kernels
+ *            (bft_beamform_dsta.m, bft_beamform_pixels.m). It is not
+ *            the offset of bft_beamform.m, which is added afterwards
+ *            by bft_add_images and so is refused there with a region.
  *******************************************************************/
 void bft_beamform(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
 {
@@ -721,61 +764,133 @@ void bft_beamform(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
    double **rf_data;   /* 2D array, passed to the beamforming  routine   */
    double **bf_data;   /* 2D array with the beamformed data              */  
 	TPoint3D *xmt=NULL;
-   ui32 i; 
+   TBeamformROI roi;   /* Region to beamform                             */
+   TBeamformROI *region = NULL;
+   ui32 no_out;        /* Samples per output line                        */
+   ui32 no_lines;      /* Lines in the output                            */
+   ui32 i, n; 
+   STATS_VAR(t_total)
+   STATS_VAR(t)
    
     
+  STATS_START(t_total)
+  STATS_START(t)
   if (!initialized)
       mexErrMsgTxt("\nToolbox is not initialized\n");
    
-  if (nrhs!=3 && nrhs!=4)
-      mexErrMsgTxt("\nExpecting  'time', 'rf_data' and (optionally) 'element_no'\n");
+  if (nrhs < 3 || nrhs > 8)
+      mexErrMsgTxt("\nExpecting  'time', 'rf_data' and (optionally) 'element_no', 'samples', 'lines', 'decimation' and 'taps'\n");
   
   if (mxGetM(prhs[1])> 1 || mxGetN(prhs[1])>1)
       mexErrMsgTxt("\nExpecting a single value for 'time' \n");
 
-  if (nrhs==4){
+  if (nrhs >= 4){
     if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==1)
     	element_no = (ui32)floor(mxGetScalar(prhs[3])) - 1;
 	 else if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==3)
 	 	xmt = (TPoint3D*)mxGetPr(prhs[3]);
-	 else
+	 else if((mxGetM(prhs[3]) * mxGetN(prhs[3])) != 0 || nrhs == 4)
 	 	mexErrMsgTxt("The transmitting aperture must be given either as coordinates or as an index\n");
 	 
   }
   Time = mxGetScalar(prhs[1]);
+
+  roi.first_sample = 0;
+  roi.no_samples = 0;
+  roi.lines = NULL;
+  roi.decimation = 1;
+  roi.taps = NULL;
+  roi.no_taps = 0;
+  if (nrhs >= 7 && mxGetM(prhs[6]) * mxGetN(prhs[6]) > 0){
+    if (mxGetM(prhs[6]) * mxGetN(prhs[6]) != 1 || mxGetScalar(prhs[6]) < 1)
+      mexErrMsgTxt("'decimation' must be a single value of at least 1\n");
+    roi.decimation = (ui32)floor(mxGetScalar(prhs[6]));
+    region = &roi;
+  }
+  if (nrhs >= 8 && mxGetM(prhs[7]) * mxGetN(prhs[7]) > 0){
+    if (!mxIsDouble(prhs[7]) || mxIsComplex(prhs[7]))
+      mexErrMsgTxt("'taps' must be a real vector\n");
+    roi.taps = mxGetPr(prhs[7]);
+    roi.no_taps = mxGetM(prhs[7]) * mxGetN(prhs[7]);
+    region = &roi;
+  }
+  if (nrhs >= 5 && mxGetM(prhs[4]) * mxGetN(prhs[4]) > 0){
+    if (mxGetM(prhs[4]) * mxGetN(prhs[4]) != 2)
+      mexErrMsgTxt("'samples' must be [first last]\n");
+    ptr = mxGetPr(prhs[4]);
+    if (ptr[0] < 1 || ptr[1] < ptr[0])
+      mexErrMsgTxt("'samples' must be [first last], with 1 <= first <= last\n");
+    roi.first_sample = (ui32)floor(ptr[0]) - 1;
+    roi.no_samples = (ui32)floor(ptr[1]) - roi.first_sample;
+    region = &roi;
+  }
+  if (nrhs >= 6 && mxGetM(prhs[5]) * mxGetN(prhs[5]) > 0){
+    n = mxGetM(prhs[5]) * mxGetN(prhs[5]);
+    roi.lines = (ui8*)calloc(flc->no_focus_time_lines, sizeof(ui8));
+    if (roi.lines == NULL)
+      mexErrMsgTxt("Cannot allocate memory \n");
+    if (mxIsLogical(prhs[5])){
+      if (n != flc->no_focus_time_lines){
+        free(roi.lines);
+        mexErrMsgTxt("The mask 'lines' must have one value per line\n");
+      }
+      for (i = 0; i < n; i++) roi.lines[i] = ((mxLogical*)mxGetData(prhs[5]))[i] != 0;
+    }else{
+      ptr = mxGetPr(prhs[5]);
+      for (i = 0; i < n; i++){
+        if (ptr[i] < 1 || ptr[i] > flc->no_focus_time_lines){
+          free(roi.lines);
+          mexErrMsgTxt("The numbers in 'lines' must be between 1 and the number of lines\n");
+        }
+        roi.lines[(ui32)floor(ptr[i]) - 1] = 1;
+      }
+    }
+    region = &roi;
+  }
+  STATS_STOP(STAT_MARSHAL, t)
   
+  STATS_START(t)
   no_elements = mxGetN(prhs[2]);
   no_samples = mxGetM(prhs[2]);
   ptr = mxGetPr(prhs[2]);
   
   rf_data = (double**)calloc(no_elements, sizeof(double*));
-  if (rf_data == NULL)
+  if (rf_data == NULL){
+     free(roi.lines);
      mexErrMsgTxt("Cannot allocate memory \n");
+  }
   
   for (i = 0; i < no_elements; i++)
-     rf_data[i] = ptr + i*no_samples;
+     rf_data[i] = ptr + (size_t)i*no_samples;
+  STATS_STOP(STAT_RF_SETUP, t)
   
-  bf_data = beamform_image(flc, alc, &sys, Time, rf_data, no_samples, element_no, xmt);
+  no_out = beamform_roi_samples(flc, no_samples, region);
+  bf_data = beamform_image_roi(flc, alc, &sys, Time, rf_data, no_samples, 
+                               element_no, xmt, region);
+  free(rf_data);
   
-  if (bf_data == NULL)
+  if (bf_data == NULL){
+     free(roi.lines);
      mexErrMsgTxt("Beamforming is unsuccessful \n");
+  }
   
-  free(rf_data);
-  if ((flc->no_focus_time_lines == 1) && (flc->ftl[0].pixel == TRUE)){
-     plhs[0] = mxCreateDoubleMatrix(flc->ftl[0].no_times,1,mxREAL);
-     no_samples = flc->ftl[0].no_times;
-  }else
-     plhs[0] = mxCreateDoubleMatrix(no_samples,flc->no_focus_time_lines,mxREAL);
+  STATS_START(t)
+  for (i = 0, no_lines = 0; i < flc->no_focus_time_lines; i++)
+     if (roi.lines == NULL || roi.lines[i]) no_lines++;
+  plhs[0] = mxCreateDoubleMatrix(no_out,no_lines,mxREAL);
 
   ptr = mxGetPr(plhs[0]);
   
   for (i = 0; i<flc->no_focus_time_lines; i++){
-     memcpy(ptr, bf_data[i], no_samples*sizeof(double));
-     ptr += no_samples;
+     if (roi.lines != NULL && !roi.lines[i]) continue;
+     if (bf_data[i] != NULL) memcpy(ptr, bf_data[i], no_out*sizeof(double));
+     ptr += no_out;
      free(bf_data[i]);
   }
   free(bf_data);
-   
+  free(roi.lines);
+  STATS_STOP(STAT_COPY, t)
+  STATS_STOP(STAT_TOTAL, t_total)
 }
 
 /*******************************************************************
@@ -836,8 +951,8 @@ void bft_sum_images(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
   ptr2 = mxGetPr(prhs[3]);
   
   for (i = 0; i < flc->no_focus_time_lines; i++){
-     rf1[i] = ptr1 + no_samples*i;
-     rf2[i] = ptr2 + no_samples*i;
+     rf1[i] = ptr1 + (size_t)no_samples*i;
+     rf2[i] = ptr2 + (size_t)no_samples*i;
   }
   
   
@@ -917,8 +1032,8 @@ void bft_add_images(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
   ptr2 = mxGetPr(plhs[0]);
   
   for (i = 0; i < flc->no_focus_time_lines; i++){
-     lo_res[i] = ptr1 + no_samples*i;
-     hi_res[i] = ptr2 + no_samples*i;
+     lo_res[i] = ptr1 + (size_t)no_samples*i;
+     hi_res[i] = ptr2 + (size_t)no_samples*i;
   }
   
   add_images(flc, salc, &sys, hi_res, lo_res, element, time, no_samples);
@@ -988,8 +1103,8 @@ void bft_sub_images(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
   ptr2 = mxGetPr(plhs[0]);
   
   for (i = 0; i < flc->no_focus_time_lines; i++){
-     lo_res[i] = ptr1 + no_samples*i;
-     hi_res[i] = ptr2 + no_samples*i;
+     lo_res[i] = ptr1 + (size_t)no_samples*i;
+     hi_res[i] = ptr2 + (size_t)no_samples*i;
   }
   
   add_images(flc, salc, &sys, hi_res, lo_res, element, time, no_samples);
@@ -1295,45 +1410,1846 @@ void bft_xdc_set(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
 }
 
 
+/*******************************************************************
+ * FUNCTION : get_rf_file
+ * ABSTRACT : Get a handle to an opened RF file from an argument.
+ *******************************************************************/
+static TRFFile* get_rf_file(const mxArray *arg)
+{
+  TRFFile *f;
+
+  if (mxGetM(arg)>1 || mxGetN(arg)>1)
+     mexErrMsgTxt("The handle to the RF file must be a single value\n");
+
+  f = (TRFFile*)(uint64)mxGetScalar(arg);
+  if (!is_rf_file_valid(f))
+     mexErrMsgTxt("Invalid handle to an RF file\n");
+  return f;
+}
 
 
 /*******************************************************************
- * FUNCTION  : mexFunction 
- * ABSTRACT  : Entry function of the interface between Matlab and
- *             the beamforming library
- *******************************************************************/ 
-void mexFunction(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+ * FUNCTION : bft_rf_open
+ * ABSTRACT : Map an RF file and return a handle to it.
+ *******************************************************************/
+void bft_rf_open(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
 {
-   int function_id;
-   
+  TRFFile *f;
+  char *file_name;
 
-   if (!mexNoEntries){
-#ifdef DEBUG
-       printf("Debug mode\n");
-#endif
+  if (!initialized)
+     mexErrMsgTxt("\nToolbox is not initialized\n");
 
-#ifdef DEBUG_TRACE
-       printf("Tracing functions\n");
-#endif
+  if (nrhs!=2 || !mxIsChar(prhs[1]))
+     mexErrMsgTxt("\nExpecting the name of the RF file\n");
 
-#ifdef SHOW_ENTRIES
-       printf("Showing some the input arguments\n");
-#endif
+  file_name = mxArrayToString(prhs[1]);
+  if (file_name == NULL)
+     mexErrMsgTxt("\nBad string argument\n");
 
-#ifdef  SPECIAL_CASE
-      printf("Special case \n");
-      nice(-20);
-#endif
+  f = rf_file_open(file_name);
+  mxFree(file_name);
+  if (f == NULL)
+     mexErrMsgTxt("Cannot open the RF file\n");
 
-       signal(SIGABRT,atAbort);
-       mexAtExit(mexBFTExit);
-       mexNoEntries ++;
-   }
-  
-   if( nrhs < 1 )
-      mexErrMsgTxt("\nmexFunction\nERROR- needed at least one argument.\n");
+  plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL);
+  *mxGetPr(plhs[0]) = (uint64)f;
+}
 
-   function_id = (int)floor(mxGetScalar(prhs[0]) + 0.5);
+
+/*******************************************************************
+ * FUNCTION : bft_rf_close
+ *******************************************************************/
+void bft_rf_close(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  if (!initialized)
+     mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=2)
+     mexErrMsgTxt("\nExpecting a handle to the RF file\n");
+
+  rf_file_close(get_rf_file(prhs[1]));
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_rf_info
+ * ABSTRACT : Return the header of an RF file as a structure.
+ *******************************************************************/
+void bft_rf_info(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *fields[] = {"no_elements", "no_samples", "no_frames",
+                                 "fs", "c", "geometry", "times", "codes"};
+  TRFFile *f;
+  mxArray *a;
+  ui32 i;
+
+  if (!initialized)
+     mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=2)
+     mexErrMsgTxt("\nExpecting a handle to the RF file\n");
+
+  f = get_rf_file(prhs[1]);
+  plhs[0] = mxCreateStructMatrix(1, 1, 8, fields);
+
+  mxSetField(plhs[0], 0, "no_elements", mxCreateDoubleScalar(f->hdr->no_elements));
+  mxSetField(plhs[0], 0, "no_samples", mxCreateDoubleScalar(f->hdr->no_samples));
+  mxSetField(plhs[0], 0, "no_frames", mxCreateDoubleScalar(f->hdr->no_frames));
+  mxSetField(plhs[0], 0, "fs", mxCreateDoubleScalar(f->hdr->fs));
+  mxSetField(plhs[0], 0, "c", mxCreateDoubleScalar(f->hdr->c));
+
+  /* One row per element, as in BFT_TRANSDUCER */
+  a = mxCreateDoubleMatrix(f->hdr->no_elements, 3, mxREAL);
+  for (i = 0; i < f->hdr->no_elements; i++){
+     mxGetPr(a)[i] = f->geometry[i].x;
+     mxGetPr(a)[i + f->hdr->no_elements] = f->geometry[i].y;
+     mxGetPr(a)[i + 2*f->hdr->no_elements] = f->geometry[i].z;
+  }
+  mxSetField(plhs[0], 0, "geometry", a);
+
+  a = mxCreateDoubleMatrix(f->hdr->no_frames, 1, mxREAL);
+  memcpy(mxGetPr(a), f->times, f->hdr->no_frames*sizeof(double));
+  mxSetField(plhs[0], 0, "times", a);
+
+  a = mxCreateDoubleMatrix(f->hdr->code_length, f->hdr->no_codes, mxREAL);
+  memcpy(mxGetPr(a), f->codes,
+         (size_t)f->hdr->code_length*f->hdr->no_codes*sizeof(double));
+  mxSetField(plhs[0], 0, "codes", a);
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_rf_beamform
+ * ABSTRACT : Beamform a range of frames straight from an RF file.
+ *            The result has one page per frame.
+ *******************************************************************/
+void bft_rf_beamform(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   TRFFile *f;
+   double *frames;     /* Numbers of the frames to beamform              */
+   ui32 no_frames;
+   ui32 frame_no;
+   ui32 no_samples;    /* Number of samples per RF line                  */
+   ui32 no_out;        /* Number of samples per beamformed line          */
+   ui32 element_no=-1; /* No of element, which is used in transmit       */
+   TPoint3D *xmt=NULL;
+   double **rf_data;   /* Pointers into the mapping                      */
+   double **bf_data;
+   double *ptr;
+   mwSize dims[3];
+   ui32 i, j;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=3 && nrhs!=4)
+      mexErrMsgTxt("\nExpecting 'handle', 'frames' and (optionally) 'element_no'\n");
+
+  f = get_rf_file(prhs[1]);
+  if (f->hdr->fs != sys.fs || f->hdr->c != sys.c)
+      mexErrMsgTxt("The sampling frequency and the speed of sound must be set with 'bft_param' to the values in the file\n");
+
+  for (i = 0; i < flc->no_focus_time_lines; i++)
+     if (flc->ftl[i].xdc != NULL
+         && flc->ftl[i].xdc->no_elements > f->hdr->no_elements)
+        mexErrMsgTxt("The transducer has more elements than the file\n");
+
+  if (mxGetM(prhs[2]) > 1 && mxGetN(prhs[2]) > 1)
+      mexErrMsgTxt("'frames' must be a vector\n");
+  no_frames = mxGetM(prhs[2])*mxGetN(prhs[2]);
+  frames = mxGetPr(prhs[2]);
+  for (j = 0; j < no_frames; j++)
+     if (frames[j] < 1 || frames[j] > f->hdr->no_frames)
+        mexErrMsgTxt("Frame number out of range\n");
+
+  if (nrhs==4){
+    if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==1)
+       element_no = (ui32)floor(mxGetScalar(prhs[3])) - 1;
+    else if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==3)
+       xmt = (TPoint3D*)mxGetPr(prhs[3]);
+    else
+       mexErrMsgTxt("The transmitting aperture must be given either as coordinates or as an index\n");
+  }
+
+  no_samples = f->hdr->no_samples;
+  if ((flc->no_focus_time_lines == 1) && (flc->ftl[0].pixel == TRUE))
+     no_out = flc->ftl[0].no_times;
+  else
+     no_out = no_samples;
+
+  dims[0] = no_out; dims[1] = flc->no_focus_time_lines; dims[2] = no_frames;
+  plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+  ptr = mxGetPr(plhs[0]);
+
+  rf_data = (double**)calloc(f->hdr->no_elements, sizeof(double*));
+  if (rf_data == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+
+  if (no_frames > 0) rf_file_prefetch(f, (ui32)frames[0] - 1, 1);
+  for (j = 0; j < no_frames; j++){
+     frame_no = (ui32)frames[j] - 1;
+
+     /* Let the next frame be read while this one is beamformed */
+     if (j + 1 < no_frames) rf_file_prefetch(f, (ui32)frames[j+1] - 1, 1);
+
+     rf_file_frame(f, frame_no, rf_data);
+     bf_data = beamform_image(flc, alc, &sys, f->times[frame_no], rf_data,
+                              no_samples, element_no, xmt);
+     if (bf_data == NULL){
+        free(rf_data);
+        mexErrMsgTxt("Beamforming is unsuccessful \n");
+     }
+
+     for (i = 0; i<flc->no_focus_time_lines; i++){
+        memcpy(ptr, bf_data[i], no_out*sizeof(double));
+        ptr += no_out;
+        free(bf_data[i]);
+     }
+     free(bf_data);
+     rf_file_release(f, frame_no, 1);
+  }
+  free(rf_data);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : image_metrics_struct
+ * ABSTRACT : Return the figures of images as a structure array.
+ *******************************************************************/
+static mxArray* image_metrics_struct(TImageMetrics *m, ui32 no_images)
+{
+  static const char *fields[] = {"peak", "peak_sample", "peak_line",
+          "axial_fwhm", "lateral_fwhm", "psl", "isl", "max_to_avg"};
+  mxArray *res;
+  ui32 i;
+
+  res = mxCreateStructMatrix(1, no_images, 8, fields);
+  for (i = 0; i < no_images; i++){
+    mxSetField(res, i, "peak", mxCreateDoubleScalar(m[i].peak));
+    mxSetField(res, i, "peak_sample", mxCreateDoubleScalar(m[i].peak_sample + 1));
+    mxSetField(res, i, "peak_line", mxCreateDoubleScalar(m[i].peak_line + 1));
+    mxSetField(res, i, "axial_fwhm", mxCreateDoubleScalar(m[i].axial_fwhm));
+    mxSetField(res, i, "lateral_fwhm", mxCreateDoubleScalar(m[i].lateral_fwhm));
+    mxSetField(res, i, "psl", mxCreateDoubleScalar(m[i].psl));
+    mxSetField(res, i, "isl", mxCreateDoubleScalar(m[i].isl));
+    mxSetField(res, i, "max_to_avg", mxCreateDoubleScalar(m[i].max_to_avg));
+  }
+  return res;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_submit
+ * ABSTRACT : Submit a frame for asynchronous beamforming. Returns a
+ *            ticket for bft_collect.
+ *******************************************************************/
+void bft_submit(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   double Time;        /* Starting time of the first sample              */
+   ui32 element_no=-1; /* No of element, which is used in transmit       */
+   TPoint3D *xmt=NULL;
+   TPipelineJob *job;
+   ui32 ticket;
+   ui32 i;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=3 && nrhs!=4)
+      mexErrMsgTxt("\nExpecting  'time', 'rf_data' and (optionally) 'element_no'\n");
+
+  if (mxGetM(prhs[1])> 1 || mxGetN(prhs[1])>1)
+      mexErrMsgTxt("\nExpecting a single value for 'time' \n");
+
+  if (!mxIsDouble(prhs[2]) || mxIsComplex(prhs[2]))
+      mexErrMsgTxt("\n'rf_data' must be a real matrix of type 'double'\n");
+
+  if (nrhs==4){
+    if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==1)
+       element_no = (ui32)floor(mxGetScalar(prhs[3])) - 1;
+    else if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==3)
+       xmt = (TPoint3D*)mxGetPr(prhs[3]);
+    else
+       mexErrMsgTxt("The transmitting aperture must be given either as coordinates or as an index\n");
+  }
+  Time = mxGetScalar(prhs[1]);
+
+  /* The frame is beamformed in a worker, where a missing column
+     cannot be reported any more */
+  for (i = 0; i < flc->no_focus_time_lines; i++)
+     if (flc->ftl[i].xdc != NULL
+         && flc->ftl[i].xdc->no_elements > mxGetN(prhs[2]))
+        mexErrMsgTxt("'rf_data' has fewer columns than the transducer has elements\n");
+
+  job = pipeline_new_job(Time, mxGetPr(prhs[2]), mxGetM(prhs[2]),
+                         mxGetN(prhs[2]), element_no, xmt);
+  if (job == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+
+  job->use_metric = use_stream_metric;
+  job->metric = stream_metric;
+  ticket = pipeline_submit(flc, alc, &sys, job);
+  if (ticket == 0){
+     pipeline_free_job(job);
+     mexErrMsgTxt("The queue is full. Collect some of the frames first, or increase 'queue_depth'\n");
+  }
+
+  plhs[0] = mxCreateDoubleScalar(ticket);
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_collect
+ * ABSTRACT : Wait for a submitted frame and return the beamformed
+ *            lines.
+ *******************************************************************/
+void bft_collect(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   TPipelineJob *job;
+   double *ptr;
+   ui32 i;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=2 || mxGetM(prhs[1])>1 || mxGetN(prhs[1])>1)
+      mexErrMsgTxt("\nExpecting a single ticket\n");
+
+  job = pipeline_collect((ui32)floor(mxGetScalar(prhs[1]) + 0.5));
+  if (job == NULL)
+     mexErrMsgTxt("Unknown ticket \n");
+
+  if (job->bf_data == NULL){
+     pipeline_free_job(job);
+     mexErrMsgTxt("Beamforming is unsuccessful \n");
+  }
+
+  plhs[0] = mxCreateDoubleMatrix(job->no_out, job->no_lines, mxREAL);
+  ptr = mxGetPr(plhs[0]);
+  for (i = 0; i < job->no_lines; i++){
+     memcpy(ptr, job->bf_data[i], job->no_out*sizeof(double));
+     ptr += job->no_out;
+  }
+  if (nlhs > 1){
+     if (job->use_metric && job->metric_ok)
+        plhs[1] = image_metrics_struct(&job->metrics, 1);
+     else
+        plhs[1] = mxCreateDoubleMatrix(0, 0, mxREAL);
+  }
+  pipeline_free_job(job);
+}
+
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_beamform_ensemble
+ * ABSTRACT : Beamform an ensemble of frames with the same geometry.
+ *            The result has one page per frame.
+ *******************************************************************/
+void bft_beamform_ensemble(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   double Time;        /* Starting time of the first sample              */
+   ui32 no_samples;    /* Number of samples per RF line                  */
+   ui32 no_elements;   /* Number of elements that have recorded the data */
+   ui32 no_frames;     /* Number of frames in the ensemble               */
+   ui32 element_no=-1; /* No of element, which is used in transmit       */
+   TPoint3D *xmt=NULL;
+   const mwSize *rf_dims;
+   mwSize dims[3];
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=3 && nrhs!=4)
+      mexErrMsgTxt("\nExpecting  'time', 'rf_data' and (optionally) 'element_no'\n");
+
+  if (mxGetM(prhs[1])> 1 || mxGetN(prhs[1])>1)
+      mexErrMsgTxt("\nExpecting a single value for 'time' \n");
+
+  if (!mxIsDouble(prhs[2]) || mxIsComplex(prhs[2]) 
+      || mxGetNumberOfDimensions(prhs[2]) > 3)
+      mexErrMsgTxt("\n'rf_data' must be a real 3D array of type 'double'\n");
+
+  if (nrhs==4){
+    if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==1)
+       element_no = (ui32)floor(mxGetScalar(prhs[3])) - 1;
+    else if((mxGetM(prhs[3]) * mxGetN(prhs[3]))==3)
+       xmt = (TPoint3D*)mxGetPr(prhs[3]);
+    else
+       mexErrMsgTxt("The transmitting aperture must be given either as coordinates or as an index\n");
+  }
+  Time = mxGetScalar(prhs[1]);
+
+  rf_dims = mxGetDimensions(prhs[2]);
+  no_samples = rf_dims[0];
+  no_elements = rf_dims[1];
+  no_frames = (mxGetNumberOfDimensions(prhs[2]) == 3) ? rf_dims[2] : 1;
+
+  dims[0] = beamform_no_out(flc, no_samples);
+  dims[1] = flc->no_focus_time_lines;
+  dims[2] = no_frames;
+  plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+
+  if (beamform_ensemble(flc, alc, &sys, Time, mxGetPr(prhs[2]), no_samples,
+                        no_elements, no_frames, element_no, xmt,
+                        mxGetPr(plhs[0])) == NULL)
+     mexErrMsgTxt("Beamforming is unsuccessful \n");
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_flow
+ * ABSTRACT : Estimate velocity, variance and power from a beamformed
+ *            IQ ensemble.
+ *******************************************************************/
+void bft_flow(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   TFlowParams fp;
+   const mwSize *iq_dims;
+   ui32 no_depth, no_lines, no_frames;
+   double *kernel;
+   int i;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs<4 || nrhs>6)
+      mexErrMsgTxt("\nExpecting 'iq_data', 'prf', 'f0' and (optionally) 'wall_order' and 'kernel'\n");
+
+  if (!mxIsDouble(prhs[1]) || !mxIsComplex(prhs[1])
+      || mxGetNumberOfDimensions(prhs[1]) != 3)
+      mexErrMsgTxt("\n'iq_data' must be a complex 3D array of type 'double'\n");
+
+  iq_dims = mxGetDimensions(prhs[1]);
+  no_depth = iq_dims[0];
+  no_lines = iq_dims[1];
+  no_frames = iq_dims[2];
+
+  fp.prf = mxGetScalar(prhs[2]);
+  fp.f0 = mxGetScalar(prhs[3]);
+  fp.c = sys.c;
+  fp.wall_order = 0;
+  fp.kernel_z = 1;
+  fp.kernel_x = 1;
+
+  if (nrhs>4)
+     fp.wall_order = (si32)floor(mxGetScalar(prhs[4]) + 0.5);
+  if (nrhs>5){
+     if (mxGetM(prhs[5])*mxGetN(prhs[5]) != 2)
+        mexErrMsgTxt("\n'kernel' must be given as [samples lines]\n");
+     kernel = mxGetPr(prhs[5]);
+     if (kernel[0] < 1 || kernel[1] < 1)
+        mexErrMsgTxt("\nThe size of the kernel must be at least 1\n");
+     fp.kernel_z = (ui32)floor(kernel[0] + 0.5);
+     fp.kernel_x = (ui32)floor(kernel[1] + 0.5);
+  }
+
+  for (i = 0; i < 3; i++)
+     plhs[i] = mxCreateDoubleMatrix(no_depth, no_lines, mxREAL);
+
+  if (!flow_estimate(&fp, mxGetPr(prhs[1]), mxGetPi(prhs[1]), no_depth,
+                     no_lines, no_frames, mxGetPr(plhs[0]), mxGetPr(plhs[1]),
+                     mxGetPr(plhs[2])))
+     mexErrMsgTxt("Flow estimation is unsuccessful \n");
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_beamform_compound
+ * ABSTRACT : Beamform and compound the recordings of plane or 
+ *            diverging waves.
+ *******************************************************************/
+void bft_beamform_compound(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   char type[16];
+   TTransmitWave *waves;
+   ui32 no_waves;
+   ui32 no_samples, no_elements;
+   double *par, *times;
+   const mwSize *rf_dims;
+   ui32 i, m, n;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=5)
+      mexErrMsgTxt("\nExpecting 'type', 'params', 'times' and 'rf_data'\n");
+
+  if (!mxIsChar(prhs[1]) || mxGetN(prhs[1]) > 15 
+      || mxGetString(prhs[1], type, sizeof(type)))
+      mexErrMsgTxt("\n'type' must be 'plane' or 'diverging'\n");
+
+  if (!mxIsDouble(prhs[4]) || mxIsComplex(prhs[4])
+      || mxGetNumberOfDimensions(prhs[4]) > 3)
+      mexErrMsgTxt("\n'rf_data' must be a real 3D array of type 'double'\n");
+
+  rf_dims = mxGetDimensions(prhs[4]);
+  no_samples = rf_dims[0];
+  no_elements = rf_dims[1];
+  no_waves = (mxGetNumberOfDimensions(prhs[4]) == 3) ? rf_dims[2] : 1;
+
+  m = mxGetM(prhs[2]); n = mxGetN(prhs[2]);
+  par = mxGetPr(prhs[2]);
+  times = mxGetPr(prhs[3]);
+  if (mxGetM(prhs[3])*mxGetN(prhs[3]) != 1 
+      && mxGetM(prhs[3])*mxGetN(prhs[3]) != no_waves)
+      mexErrMsgTxt("\n'times' must have one value, or one value per wave\n");
+
+  waves = (TTransmitWave*)calloc(no_waves, sizeof(TTransmitWave));
+  if (waves == NULL)
+      mexErrMsgTxt("Cannot allocate memory \n");
+
+  if (!strcmp(type, "plane")){
+     if (!(m == no_waves && (n == 1 || n == 2)) && !(n == no_waves && m == 1)){
+        free(waves);
+        mexErrMsgTxt("\nExpecting one angle, or a row [dir_xz dir_yz], per wave\n");
+     }
+     for (i = 0; i < no_waves; i++){
+        waves[i].type = XMT_PLANE;
+        waves[i].dir_xz = par[i];
+        waves[i].dir_yz = (n == 2 && m == no_waves) ? par[i + m] : 0;
+     }
+  }else if (!strcmp(type, "diverging")){
+     if (m != no_waves || n != 3){
+        free(waves);
+        mexErrMsgTxt("\nExpecting one row [x y z] of the virtual source per wave\n");
+     }
+     for (i = 0; i < no_waves; i++){
+        waves[i].type = XMT_DIVERGING;
+        waves[i].source.x = par[i];
+        waves[i].source.y = par[i + m];
+        waves[i].source.z = par[i + 2*m];
+     }
+  }else{
+     free(waves);
+     mexErrMsgTxt("\n'type' must be 'plane' or 'diverging'\n");
+  }
+
+  for (i = 0; i < no_waves; i++)
+     waves[i].time = (mxGetM(prhs[3])*mxGetN(prhs[3]) == 1) ? times[0] : times[i];
+
+  plhs[0] = mxCreateDoubleMatrix(beamform_no_out(flc, no_samples),
+                                 flc->no_focus_time_lines, mxREAL);
+
+  if (beamform_compound(flc, alc, &sys, waves, no_waves, mxGetPr(prhs[4]),
+                        no_samples, no_elements, mxGetPr(plhs[0])) == NULL){
+     free(waves);
+     mexErrMsgTxt("Beamforming is unsuccessful \n");
+  }
+  free(waves);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_beamform_fk
+ * ABSTRACT : Reconstruct a compounded plane wave image with f-k 
+ *            migration.
+ *******************************************************************/
+void bft_beamform_fk(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   TTransducer *xdc;
+   uint64 address;
+   ui32 no_angles, no_samples, i;
+   double *angles, *times;
+   const mwSize *rf_dims;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=5)
+      mexErrMsgTxt("\nExpecting a pointer to aperture, 'angles', 'times' and 'rf_data'\n");
+
+  if (mxGetM(prhs[1])>1 || mxGetN(prhs[1])>1)
+     mexErrMsgTxt("The pointer must be a single value \n");
+  address = (uint64)mxGetScalar(prhs[1]);
+  xdc = (TTransducer*) address;
+  if (!is_xdc_valid(xdc))
+     mexErrMsgTxt("Invalid pointer to aperture \n");
+
+  if (!mxIsDouble(prhs[4]) || mxIsComplex(prhs[4])
+      || mxGetNumberOfDimensions(prhs[4]) > 3)
+      mexErrMsgTxt("\n'rf_data' must be a real 3D array of type 'double'\n");
+
+  rf_dims = mxGetDimensions(prhs[4]);
+  no_samples = rf_dims[0];
+  no_angles = (mxGetNumberOfDimensions(prhs[4]) == 3) ? rf_dims[2] : 1;
+  if (rf_dims[1] != xdc->no_elements)
+     mexErrMsgTxt("\n'rf_data' must have one column per element\n");
+
+  if (mxGetM(prhs[2])*mxGetN(prhs[2]) != no_angles)
+     mexErrMsgTxt("\nExpecting one angle per page of 'rf_data'\n");
+  angles = mxGetPr(prhs[2]);
+
+  times = (double*)malloc(no_angles * sizeof(double));
+  if (times == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+  if (mxGetM(prhs[3])*mxGetN(prhs[3]) == 1)
+     for (i = 0; i < no_angles; i++) times[i] = mxGetScalar(prhs[3]);
+  else if (mxGetM(prhs[3])*mxGetN(prhs[3]) == no_angles)
+     memcpy(times, mxGetPr(prhs[3]), no_angles * sizeof(double));
+  else{
+     free(times);
+     mexErrMsgTxt("\n'times' must have one value, or one value per angle\n");
+  }
+
+  plhs[0] = mxCreateDoubleMatrix(no_samples, xdc->no_elements, mxREAL);
+  if (fk_migrate(xdc, &sys, angles, times, no_angles, mxGetPr(prhs[4]),
+                 no_samples, mxGetPr(plhs[0])) == NULL){
+     free(times);
+     mexErrMsgTxt("The f-k migration is unsuccessful \n");
+  }
+  free(times);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : get_points
+ * ABSTRACT : Copy an N x 3 matrix of coordinates into points.
+ *******************************************************************/
+static TPoint3D* get_points(const mxArray *arg, ui32 no_points)
+{
+  TPoint3D *pos;
+  double *p;
+  ui32 i;
+
+  pos = (TPoint3D*)malloc((no_points > 0 ? no_points : 1) * sizeof(TPoint3D));
+  if (pos == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+  p = mxGetPr(arg);
+  for (i = 0; i < no_points; i++){
+    pos[i].x = p[i];
+    pos[i].y = p[i + no_points];
+    pos[i].z = p[i + 2*no_points];
+  }
+  return pos;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_calc_scat
+ * ABSTRACT : Simulate the RF signals received from point scatterers
+ *******************************************************************/
+void bft_calc_scat(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   TTransducer *xdc[2];
+   TSimSetup setup;
+   TScatGrid *grid;
+   TPoint3D *pos;
+   uint64 address;
+   ui32 no_scat, no_samples, i;
+   double start_time, *rf;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=7 && nrhs!=9 && nrhs!=10)
+      mexErrMsgTxt("\nExpecting pointers to the transmit and receive apertures, 'pulse', 'delays', 'pht_pos' and 'pht_amp'\n");
+
+  for (i = 0; i < 2; i++){
+    if (mxGetM(prhs[1+i])>1 || mxGetN(prhs[1+i])>1)
+       mexErrMsgTxt("The pointer must be a single value \n");
+    address = (uint64)mxGetScalar(prhs[1+i]);
+    xdc[i] = (TTransducer*) address;
+    if (!is_xdc_valid(xdc[i]))
+       mexErrMsgTxt("Invalid pointer to aperture \n");
+  }
+  setup.xmt = xdc[0];
+  setup.rcv = xdc[1];
+
+  setup.pulse = mxGetPr(prhs[3]);
+  setup.pulse_length = mxGetM(prhs[3])*mxGetN(prhs[3]);
+  if (setup.pulse_length == 0)
+     mexErrMsgTxt("\n'pulse' must not be empty\n");
+
+  if (mxGetM(prhs[4])*mxGetN(prhs[4]) != setup.xmt->no_elements)
+     mexErrMsgTxt("\nExpecting one delay per transmit element\n");
+  setup.xmt_delays = mxGetPr(prhs[4]);
+
+  /* Either the scatterers, or a grid and an empty 'pht_amp' */
+  grid = NULL;
+  if (mxGetM(prhs[5]) == 1 && mxGetN(prhs[5]) == 1){
+    grid = (TScatGrid*)(uint64)mxGetScalar(prhs[5]);
+    if (!is_scat_grid_valid(grid))
+       mexErrMsgTxt("Invalid pointer to a scatterer grid \n");
+    no_scat = 0;
+  }else{
+    no_scat = mxGetM(prhs[5]);
+    if (mxGetN(prhs[5]) != 3)
+       mexErrMsgTxt("\n'pht_pos' must have 3 columns\n");
+    if (mxGetM(prhs[6])*mxGetN(prhs[6]) != no_scat)
+       mexErrMsgTxt("\nExpecting one amplitude per scatterer\n");
+  }
+
+  setup.xmt_apo = NULL;
+  setup.rcv_apo = NULL;
+  if (nrhs > 7){
+    if (mxGetM(prhs[7])*mxGetN(prhs[7]) != setup.xmt->no_elements
+        || mxGetM(prhs[8])*mxGetN(prhs[8]) != setup.rcv->no_elements)
+       mexErrMsgTxt("\nExpecting one apodization value per element\n");
+    setup.xmt_apo = mxGetPr(prhs[7]);
+    setup.rcv_apo = mxGetPr(prhs[8]);
+  }
+
+  start_time = 0;
+  no_samples = 0;
+  if (nrhs == 10){
+    if (mxGetM(prhs[9])*mxGetN(prhs[9]) != 2 || mxGetPr(prhs[9])[1] < 1)
+       mexErrMsgTxt("\n'window' must be [start_time no_samples]\n");
+    start_time = mxGetPr(prhs[9])[0];
+    no_samples = (ui32)mxGetPr(prhs[9])[1];
+  }
+
+  if (grid != NULL)
+    rf = simulate_grid(&setup, &sys, grid, &start_time, &no_samples);
+  else{
+    pos = get_points(prhs[5], no_scat);
+    rf = simulate_scatterers(&setup, &sys, pos, mxGetPr(prhs[6]), no_scat,
+                             &start_time, &no_samples);
+    free(pos);
+  }
+  if (rf == NULL)
+     mexErrMsgTxt("The simulation is unsuccessful \n");
+
+  plhs[0] = mxCreateDoubleMatrix(no_samples, setup.rcv->no_elements, mxREAL);
+  memcpy(mxGetPr(plhs[0]), rf, (size_t)no_samples * setup.rcv->no_elements * sizeof(double));
+  free(rf);
+  if (nlhs > 1) plhs[1] = mxCreateDoubleScalar(start_time);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_scat_grid
+ * ABSTRACT : Sort a phantom into a grid for BFT_CALC_SCAT
+ *******************************************************************/
+void bft_scat_grid(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TScatGrid *g;
+  TPoint3D *pos;
+  ui32 no_scat;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=4)
+      mexErrMsgTxt("\nExpecting 'pht_pos', 'pht_amp' and 'bin_size'\n");
+
+  no_scat = mxGetM(prhs[1]);
+  if (mxGetN(prhs[1]) != 3)
+     mexErrMsgTxt("\n'pht_pos' must have 3 columns\n");
+  if (mxGetM(prhs[2])*mxGetN(prhs[2]) != no_scat)
+     mexErrMsgTxt("\nExpecting one amplitude per scatterer\n");
+
+  pos = get_points(prhs[1], no_scat);
+  g = scat_grid_create(pos, mxGetPr(prhs[2]), no_scat, mxGetScalar(prhs[3]));
+  free(pos);
+  if (g == NULL)
+     mexErrMsgTxt("Cannot create the grid \n");
+
+  plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL);
+  *mxGetPr(plhs[0]) = (uint64)g;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_free_scat_grid
+ * ABSTRACT : Release a grid created by BFT_SCAT_GRID
+ *******************************************************************/
+void bft_free_scat_grid(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TScatGrid *g;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=2)
+      mexErrMsgTxt("\nExpecting a pointer to the grid\n");
+
+  if (mxGetM(prhs[1])>1 || mxGetN(prhs[1])>1)
+     mexErrMsgTxt("The pointer must be a single value \n");
+  g = (TScatGrid*)(uint64)mxGetScalar(prhs[1]);
+  if (!is_scat_grid_valid(g))
+     mexErrMsgTxt("Invalid pointer to a scatterer grid \n");
+  scat_grid_free(g);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : code_metrics_struct
+ * ABSTRACT : Return the figures of merit of a code set as a structure.
+ *******************************************************************/
+static mxArray* code_metrics_struct(TCodeMetrics *m)
+{
+  static const char *fields[] = {"acf_sidelobe", "max_ccf", "max_all_ccf",
+                                 "max_self_ccf", "welch_ratio"};
+  mxArray *a;
+
+  a = mxCreateStructMatrix(1, 1, 5, fields);
+  mxSetField(a, 0, "acf_sidelobe", mxCreateDoubleScalar(m->acf_sidelobe));
+  mxSetField(a, 0, "max_ccf", mxCreateDoubleScalar(m->max_ccf));
+  mxSetField(a, 0, "max_all_ccf", mxCreateDoubleScalar(m->max_all_ccf));
+  mxSetField(a, 0, "max_self_ccf", mxCreateDoubleScalar(m->max_self_ccf));
+  mxSetField(a, 0, "welch_ratio",
+             mxCreateDoubleScalar(m->welch_ratio < 0 ? mxGetNaN() : m->welch_ratio));
+  return a;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_corr
+ * ABSTRACT : Figures of merit of a set of binary codes. The toolbox
+ *            state is not used, so no initialization is needed.
+ *******************************************************************/
+void bft_code_corr(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TCodeSet *s;
+  TCodeMetrics m;
+  si32 *sum_acf = NULL;
+  double *out;
+  ui32 set_size, no_sets, no_lags, g, i;
+
+  if (nrhs!=3)
+      mexErrMsgTxt("\nExpecting 'codes' and 'set_size'\n");
+
+  if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]) || mxGetN(prhs[1]) == 0)
+      mexErrMsgTxt("\n'codes' must be a real matrix of type 'double'\n");
+
+  set_size = (ui32)mxGetScalar(prhs[2]);
+  if (set_size == 0 || mxGetM(prhs[1]) % set_size != 0)
+      mexErrMsgTxt("\nThe number of codes must be a multiple of 'set_size'\n");
+
+  s = code_pack(mxGetPr(prhs[1]), mxGetM(prhs[1]), mxGetN(prhs[1]));
+  if (s == NULL)
+      mexErrMsgTxt("Cannot allocate memory \n");
+  no_sets = s->no_codes / set_size;
+  no_lags = 2*s->length - 1;
+
+  if (nlhs > 1){
+    sum_acf = (si32*)malloc((size_t)no_lags * no_sets * sizeof(si32));
+    if (sum_acf == NULL){
+      code_free(s);
+      mexErrMsgTxt("Cannot allocate memory \n");
+    }
+  }
+
+  if (!code_metrics(s, set_size, &m, sum_acf)){
+    free(sum_acf);
+    code_free(s);
+    mexErrMsgTxt("The correlation is unsuccessful \n");
+  }
+  code_free(s);
+
+  plhs[0] = code_metrics_struct(&m);
+
+  if (nlhs > 1){
+    /* One row per group, as sumACF */
+    plhs[1] = mxCreateDoubleMatrix(no_sets, no_lags, mxREAL);
+    out = mxGetPr(plhs[1]);
+    for (g = 0; g < no_sets; g++)
+      for (i = 0; i < no_lags; i++)
+        out[(size_t)i * no_sets + g] = sum_acf[(size_t)g * no_lags + i];
+    free(sum_acf);
+  }
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_search
+ * ABSTRACT : Improve a set of binary codes by tabu search or simulated
+ *            annealing. The toolbox state is not used.
+ *******************************************************************/
+void bft_code_search(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TCodeSearch *s;
+  TSearchParams p;
+  TCodeSet *cs;
+  TCodeMetrics m;
+  char method[20];
+  si8 *best;
+  double energy;
+  ui32 set_size;
+
+  if (nrhs!=7)
+      mexErrMsgTxt("\nExpecting 'codes', 'set_size', 'method', 'max_iter', 'ccf_weight' and 'seed'\n");
+
+  if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]) || mxGetN(prhs[1]) == 0)
+      mexErrMsgTxt("\n'codes' must be a real matrix of type 'double'\n");
+
+  set_size = (ui32)mxGetScalar(prhs[2]);
+  if (set_size == 0 || mxGetM(prhs[1]) % set_size != 0)
+      mexErrMsgTxt("\nThe number of codes must be a multiple of 'set_size'\n");
+
+  if (!mxIsChar(prhs[3]) || mxGetString(prhs[3], method, sizeof(method)))
+      mexErrMsgTxt("\n'method' must be 'tabu' or 'anneal'\n");
+  if (strcmp(method, "tabu") == 0) p.method = SEARCH_TABU;
+  else if (strcmp(method, "anneal") == 0) p.method = SEARCH_ANNEAL;
+  else mexErrMsgTxt("\n'method' must be 'tabu' or 'anneal'\n");
+
+  p.max_iter = (ui32)mxGetScalar(prhs[4]);
+  p.ccf_weight = mxGetScalar(prhs[5]);
+  p.seed = (ui64)mxGetScalar(prhs[6]);
+
+  s = search_create(mxGetPr(prhs[1]), mxGetM(prhs[1]), mxGetN(prhs[1]),
+                    set_size, p.ccf_weight);
+  if (s == NULL)
+      mexErrMsgTxt("Cannot set up the search \n");
+  best = (si8*)malloc((size_t)s->no_codes * s->length);
+  if (best == NULL){
+    search_free(s);
+    mexErrMsgTxt("Cannot allocate memory \n");
+  }
+
+  energy = search_run(s, &p, best);
+  if (energy < 0){
+    free(best);
+    search_free(s);
+    mexErrMsgTxt("The search is unsuccessful \n");
+  }
+
+  plhs[0] = mxCreateDoubleMatrix(s->no_codes, s->length, mxREAL);
+  search_get_codes(s, best, mxGetPr(plhs[0]));
+  free(best);
+  search_free(s);
+
+  if (nlhs > 1) plhs[1] = mxCreateDoubleScalar(energy);
+  if (nlhs > 2){
+    cs = code_pack(mxGetPr(plhs[0]), mxGetM(plhs[0]), mxGetN(plhs[0]));
+    if (cs == NULL || !code_metrics(cs, set_size, &m, NULL))
+      mexErrMsgTxt("Cannot find the figures of merit \n");
+    code_free(cs);
+    plhs[2] = code_metrics_struct(&m);
+  }
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_multistart
+ * ABSTRACT : Many searches for code sets from random codes, run on all
+ *            threads. The toolbox state is not used.
+ *******************************************************************/
+void bft_code_multistart(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *fields[] = {"no_feasible", "no_pruned"};
+  TMultiStart ms;
+  TMultiStartResult res;
+  char method[20], *prefix = NULL;
+
+  if (nrhs!=11)
+      mexErrMsgTxt("\nExpecting 'no_codes', 'length', 'set_size', 'no_restarts', 'method', 'max_iter', 'ccf_weight', 'ccf_limit', 'prefix' and 'seed'\n");
+
+  ms.no_codes = (ui32)mxGetScalar(prhs[1]);
+  ms.length = (ui32)mxGetScalar(prhs[2]);
+  ms.set_size = (ui32)mxGetScalar(prhs[3]);
+  ms.no_restarts = (ui32)mxGetScalar(prhs[4]);
+  if (ms.length == 0 || ms.set_size == 0 || ms.no_codes == 0
+      || ms.no_codes % ms.set_size != 0)
+      mexErrMsgTxt("\nThe number of codes must be a multiple of 'set_size'\n");
+
+  if (!mxIsChar(prhs[5]) || mxGetString(prhs[5], method, sizeof(method)))
+      mexErrMsgTxt("\n'method' must be 'tabu' or 'anneal'\n");
+  if (strcmp(method, "tabu") == 0) ms.search.method = SEARCH_TABU;
+  else if (strcmp(method, "anneal") == 0) ms.search.method = SEARCH_ANNEAL;
+  else mexErrMsgTxt("\n'method' must be 'tabu' or 'anneal'\n");
+
+  ms.search.max_iter = (ui32)mxGetScalar(prhs[6]);
+  ms.search.ccf_weight = mxGetScalar(prhs[7]);
+  ms.ccf_limit = mxGetScalar(prhs[8]);
+  ms.search.seed = (ui64)mxGetScalar(prhs[10]);
+  ms.no_stages = 4;
+  ms.prune_ratio = 1.5;
+
+  ms.prefix = NULL;
+  if (mxIsChar(prhs[9]) && mxGetN(prhs[9]) > 0){
+    prefix = mxArrayToString(prhs[9]);
+    if (prefix == NULL)
+       mexErrMsgTxt("\nBad string argument\n");
+    ms.prefix = prefix;
+  }
+
+  res.codes = (double*)malloc((size_t)ms.no_codes * ms.length * sizeof(double));
+  if (res.codes == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+  if (!multistart_run(&ms, &res)){
+    free(res.codes);
+    if (prefix != NULL) mxFree(prefix);
+    mexErrMsgTxt("The search is unsuccessful \n");
+  }
+  if (prefix != NULL) mxFree(prefix);
+
+  if (res.found){
+    plhs[0] = mxCreateDoubleMatrix(ms.no_codes, ms.length, mxREAL);
+    memcpy(mxGetPr(plhs[0]), res.codes, (size_t)ms.no_codes * ms.length * sizeof(double));
+  }else
+    plhs[0] = mxCreateDoubleMatrix(0, 0, mxREAL);
+  free(res.codes);
+
+  if (nlhs > 1)
+    plhs[1] = res.found ? code_metrics_struct(&res.metrics) 
+                        : mxCreateDoubleMatrix(0, 0, mxREAL);
+  if (nlhs > 2){
+    plhs[2] = mxCreateStructMatrix(1, 1, 2, fields);
+    mxSetField(plhs[2], 0, "no_feasible", mxCreateDoubleScalar(res.no_feasible));
+    mxSetField(plhs[2], 0, "no_pruned", mxCreateDoubleScalar(res.no_pruned));
+  }
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_enumerate
+ * ABSTRACT : Exhaustive search for short code sets within limits on
+ *            their correlations. The toolbox state is not used.
+ *******************************************************************/
+void bft_code_enumerate(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *fields[] = {"no_solutions", "no_nodes"};
+  TEnumParams p;
+  TEnumResult res;
+  char *checkpoint = NULL;
+  mwSize dims[3];
+  double *codes;
+  ui32 i, r, n;
+  si8 *x;
+
+  if (nrhs!=10)
+      mexErrMsgTxt("\nExpecting 'no_codes', 'length', 'set_size', 'acf_limit', 'ccf_limit', 'all_limit', 'max_solutions', 'checkpoint' and 'interval'\n");
+
+  p.no_codes = (ui32)mxGetScalar(prhs[1]);
+  p.length = (ui32)mxGetScalar(prhs[2]);
+  p.set_size = (ui32)mxGetScalar(prhs[3]);
+  if (p.length == 0 || p.length > ENUM_MAX_LENGTH || p.set_size == 0 
+      || p.no_codes == 0 || p.no_codes > ENUM_MAX_CODES 
+      || p.no_codes % p.set_size != 0)
+      mexErrMsgTxt("\nExpecting at most 16 codes of at most 32 chips, a multiple of 'set_size'\n");
+  p.acf_limit = (si32)mxGetScalar(prhs[4]);
+  p.ccf_limit = (si32)mxGetScalar(prhs[5]);
+  p.all_limit = (si32)mxGetScalar(prhs[6]);
+  p.max_solutions = (ui32)mxGetScalar(prhs[7]);
+  p.checkpoint_interval = (ui32)mxGetScalar(prhs[9]);
+
+  p.checkpoint = NULL;
+  if (mxIsChar(prhs[8]) && mxGetN(prhs[8]) > 0){
+    checkpoint = mxArrayToString(prhs[8]);
+    if (checkpoint == NULL)
+       mexErrMsgTxt("\nBad string argument\n");
+    p.checkpoint = checkpoint;
+  }
+
+  if (!enumerate_sets(&p, &res)){
+    if (checkpoint != NULL) mxFree(checkpoint);
+    mexErrMsgTxt("The enumeration is unsuccessful \n");
+  }
+  if (checkpoint != NULL) mxFree(checkpoint);
+
+  dims[0] = p.no_codes;  dims[1] = p.length;  dims[2] = res.no_stored;
+  plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+  codes = mxGetPr(plhs[0]);
+  for (i = 0; i < res.no_stored; i ++){
+    x = res.solutions + (size_t)i * p.no_codes * p.length;
+    for (r = 0; r < p.no_codes; r ++)
+      for (n = 0; n < p.length; n ++)
+        codes[((size_t)i*p.length + n)*p.no_codes + r] = x[r*p.length + n];
+  }
+  enumerate_free_result(&res);
+
+  if (nlhs > 1){
+    plhs[1] = mxCreateStructMatrix(1, 1, 2, fields);
+    mxSetField(plhs[1], 0, "no_solutions", mxCreateDoubleScalar((double)res.no_solutions));
+    mxSetField(plhs[1], 0, "no_nodes", mxCreateDoubleScalar((double)res.no_nodes));
+  }
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : get_code_family
+ * ABSTRACT : Family of complementary pairs from its name
+ *******************************************************************/
+static ui32 get_code_family(const mxArray *arg)
+{
+  char name[20];
+
+  if (!mxIsChar(arg) || mxGetString(arg, name, sizeof(name)))
+     mexErrMsgTxt("\nThe family must be 'all', 'golay' or 'recursive'\n");
+  if (strcmp(name, "all") == 0) return CODE_FAMILY_ANY;
+  if (strcmp(name, "golay") == 0) return CODE_FAMILY_GOLAY;
+  if (strcmp(name, "recursive") == 0) return CODE_FAMILY_RECURSIVE;
+  mexErrMsgTxt("\nThe family must be 'all', 'golay' or 'recursive'\n");
+  return CODE_FAMILY_ANY;
+}
+
+
+/*******************************************************************
+ * FUNCTION : get_code_db
+ * ABSTRACT : Get a handle to an opened code database from an argument.
+ *******************************************************************/
+static TCodeDB* get_code_db(const mxArray *arg)
+{
+  TCodeDB *db;
+
+  if (mxGetM(arg)>1 || mxGetN(arg)>1)
+     mexErrMsgTxt("The handle to the code database must be a single value\n");
+
+  db = (TCodeDB*)(uint64)mxGetScalar(arg);
+  if (!is_code_db_valid(db))
+     mexErrMsgTxt("Invalid handle to a code database\n");
+  return db;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_db_create
+ * ABSTRACT : Generate complementary pairs of many lengths in parallel
+ *            and write them to a database. The toolbox state is not
+ *            used.
+ *******************************************************************/
+void bft_code_db_create(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  char *file_name;
+  ui32 *lengths, no_lengths, family, no_records, i;
+  double *ptr;
+  si32 ok;
+
+  if (nrhs!=6 || !mxIsChar(prhs[1]))
+      mexErrMsgTxt("\nExpecting 'file_name', 'lengths', 'family', 'no_per_length' and 'seed'\n");
+
+  no_lengths = (ui32)mxGetNumberOfElements(prhs[2]);
+  ptr = mxGetPr(prhs[2]);
+  family = get_code_family(prhs[3]);
+
+  lengths = (ui32*)malloc((no_lengths + 1) * sizeof(ui32));
+  if (lengths == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+  for (i = 0; i < no_lengths; i ++){
+    if (ptr[i] < 1){
+      free(lengths);
+      mexErrMsgTxt("\nThe lengths must be positive\n");
+    }
+    lengths[i] = (ui32)ptr[i];
+  }
+
+  file_name = mxArrayToString(prhs[1]);
+  if (file_name == NULL){
+     free(lengths);
+     mexErrMsgTxt("\nBad string argument\n");
+  }
+  ok = code_db_create(file_name, lengths, no_lengths,
+                      (family == CODE_FAMILY_ANY) ? ~0u : 1u << family,
+                      (ui32)mxGetScalar(prhs[4]), (ui64)mxGetScalar(prhs[5]),
+                      &no_records);
+  mxFree(file_name);
+  free(lengths);
+  if (!ok)
+     mexErrMsgTxt("Cannot create the code database\n");
+
+  plhs[0] = mxCreateDoubleScalar(no_records);
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_db_open
+ * ABSTRACT : Map a code database and return a handle to it.
+ *******************************************************************/
+void bft_code_db_open(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TCodeDB *db;
+  char *file_name;
+
+  if (nrhs!=2 || !mxIsChar(prhs[1]))
+     mexErrMsgTxt("\nExpecting the name of the code database\n");
+
+  file_name = mxArrayToString(prhs[1]);
+  if (file_name == NULL)
+     mexErrMsgTxt("\nBad string argument\n");
+
+  db = code_db_open(file_name);
+  mxFree(file_name);
+  if (db == NULL)
+     mexErrMsgTxt("Cannot open the code database\n");
+
+  plhs[0] = mxCreateDoubleMatrix(1,1,mxREAL);
+  *mxGetPr(plhs[0]) = (uint64)db;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_db_close
+ *******************************************************************/
+void bft_code_db_close(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  if (nrhs!=2)
+     mexErrMsgTxt("\nExpecting a handle to the code database\n");
+
+  code_db_close(get_code_db(prhs[1]));
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_code_db_query
+ * ABSTRACT : The pairs of a length with the lowest cross-correlation
+ *            below a limit.
+ *******************************************************************/
+void bft_code_db_query(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *fields[] = {"family", "max_ccf", "sidelobe"};
+  static const char *family_names[] = {"all", "golay", "recursive"};
+  TCodeDB *db;
+  TCodeDBEntry *e;
+  ui32 length, no_wanted, no_found, *found, i, n;
+  mwSize dims[3];
+  double *codes, *src;
+
+  if (nrhs!=7)
+     mexErrMsgTxt("\nExpecting 'db', 'length', 'no_pairs', 'ccf_limit', 'family' and 'sidelobe_limit'\n");
+
+  db = get_code_db(prhs[1]);
+  length = (ui32)mxGetScalar(prhs[2]);
+  no_wanted = (ui32)mxGetScalar(prhs[3]);
+
+  found = (ui32*)malloc((no_wanted + 1) * sizeof(ui32));
+  if (found == NULL)
+     mexErrMsgTxt("Cannot allocate memory \n");
+  no_found = code_db_query(db, length, get_code_family(prhs[5]),
+                           mxGetScalar(prhs[4]), mxGetScalar(prhs[6]),
+                           no_wanted, found);
+
+  /* One pair per page, one code per row */
+  dims[0] = 2;  dims[1] = length;  dims[2] = no_found;
+  plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+  codes = mxGetPr(plhs[0]);
+  for (i = 0; i < no_found; i ++){
+    src = code_db_codes(db, found[i]);
+    for (n = 0; n < length; n ++){
+      codes[((size_t)i*length + n)*2] = src[n];
+      codes[((size_t)i*length + n)*2 + 1] = src[length + n];
+    }
+  }
+
+  if (nlhs > 1){
+    plhs[1] = mxCreateStructMatrix(1, no_found, 3, fields);
+    for (i = 0; i < no_found; i ++){
+      e = db->index + found[i];
+      mxSetField(plhs[1], i, "family", mxCreateString(family_names[e->family]));
+      mxSetField(plhs[1], i, "max_ccf", mxCreateDoubleScalar(e->max_ccf));
+      mxSetField(plhs[1], i, "sidelobe", mxCreateDoubleScalar(e->sidelobe));
+    }
+  }
+  free(found);
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : get_region
+ * ABSTRACT : Region of an image from [first_sample last_sample
+ *            first_line last_line], counted from 1. An empty matrix
+ *            gives an empty region.
+ *******************************************************************/
+static void get_region(const mxArray *arg, TImageRegion *r)
+{
+  double *p;
+
+  memset(r, 0, sizeof(TImageRegion));
+  if (mxGetM(arg)*mxGetN(arg) == 0) return;
+  if (mxGetM(arg)*mxGetN(arg) != 4)
+     mexErrMsgTxt("\nA region must be [first_sample last_sample first_line last_line]\n");
+  p = mxGetPr(arg);
+  if (p[0] < 1 || p[1] < p[0] || p[2] < 1 || p[3] < p[2])
+     mexErrMsgTxt("\nA region must be [first_sample last_sample first_line last_line]\n");
+  r->first_sample = (ui32)p[0] - 1;
+  r->no_samples = (ui32)p[1] - r->first_sample;
+  r->first_line = (ui32)p[2] - 1;
+  r->no_lines = (ui32)p[3] - r->first_line;
+}
+
+
+/*******************************************************************
+ * FUNCTION : get_metric_id
+ * ABSTRACT : Figure of an image from its name
+ *******************************************************************/
+static ui32 get_metric_id(const mxArray *arg)
+{
+  static const char *names[] = {"max_to_avg", "axial_fwhm", "lateral_fwhm",
+                                "psl", "isl"};
+  char name[20];
+  ui32 i;
+
+  if (mxIsChar(arg) && !mxGetString(arg, name, sizeof(name)))
+    for (i = 0; i < 5; i++)
+      if (!strcmp(name, names[i])) return METRIC_MAX_TO_AVG + i;
+  mexErrMsgTxt("\nThe metric must be 'max_to_avg', 'axial_fwhm', 'lateral_fwhm', 'psl' or 'isl'\n");
+  return 0;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_metrics
+ * ABSTRACT : Resolution and clutter figures of beamformed images
+ *******************************************************************/
+void bft_metrics(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TMetricSetup setup;
+  TImageMetrics *m;
+  const mwSize *dims;
+  double ***frames, **lines;
+  ui32 no_samples, no_lines, no_frames, f, i;
+
+  if (nrhs!=5)
+      mexErrMsgTxt("\nExpecting 'images', 'signal', 'clutter' and 'envelope'\n");
+
+  if (!mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]))
+      mexErrMsgTxt("\n'images' must be a real array of type 'double'\n");
+  dims = mxGetDimensions(prhs[1]);
+  no_samples = dims[0];
+  no_lines = dims[1];
+  no_frames = mxGetNumberOfDimensions(prhs[1]) > 2 ? dims[2] : 1;
+
+  get_region(prhs[2], &setup.signal);
+  get_region(prhs[3], &setup.clutter);
+  setup.envelope = mxGetScalar(prhs[4]) != 0;
+
+  m = (TImageMetrics*)malloc((no_frames > 0 ? no_frames : 1) * sizeof(TImageMetrics));
+  frames = (double***)malloc((no_frames > 0 ? no_frames : 1) * sizeof(double**));
+  lines = (double**)malloc(((size_t)no_frames * no_lines + 1) * sizeof(double*));
+  if (m == NULL || frames == NULL || lines == NULL){
+    free(m);  free(frames);  free(lines);
+    mexErrMsgTxt("Cannot allocate memory \n");
+  }
+  for (f = 0; f < no_frames; f++){
+    frames[f] = lines + (size_t)f * no_lines;
+    for (i = 0; i < no_lines; i++)
+      frames[f][i] = mxGetPr(prhs[1]) + ((size_t)f * no_lines + i) * no_samples;
+  }
+
+  if (!metric_frames(frames, no_frames, no_lines, no_samples, &setup, m)){
+    free(m);  free(frames);  free(lines);
+    mexErrMsgTxt("The figures cannot be computed \n");
+  }
+  plhs[0] = image_metrics_struct(m, no_frames);
+  free(m);  free(frames);  free(lines);
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_stream_metrics
+ * ABSTRACT : Rate the frames submitted by bft_submit, or stop
+ *******************************************************************/
+void bft_stream_metrics(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs==1){
+    use_stream_metric = FALSE;
+    return;
+  }
+  if (nrhs!=4)
+      mexErrMsgTxt("\nExpecting 'signal', 'clutter' and 'envelope', or nothing\n");
+
+  get_region(prhs[1], &stream_metric.signal);
+  if (stream_metric.signal.no_samples == 0)
+      mexErrMsgTxt("\nThe signal region must not be empty\n");
+  get_region(prhs[2], &stream_metric.clutter);
+  stream_metric.envelope = mxGetScalar(prhs[3]) != 0;
+  use_stream_metric = TRUE;
+}
+
+
+/*******************************************************************
+ * FUNCTION : bft_sweep
+ * ABSTRACT : Simulate, decode, beamform and rate many code sets with
+ *            the current focusing and apodization
+ *******************************************************************/
+void bft_sweep(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  TTransducer *xdc[2];
+  TSweepSetup setup;
+  TSweep *s;
+  TPoint3D *pos = NULL;
+  ui32 *line_groups = NULL, no_lines, no_codes, no_sets, i;
+  const mwSize *cdims;
+  mwSize dims[3];
+  double *images = NULL;
+  si32 ok;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs!=15 && nrhs!=16)
+      mexErrMsgTxt("\nExpecting 'xmt', 'rcv', 'impulse', 'delays', 'pht_pos', 'pht_amp', 'window', 'chip_samples', 'codes', 'set_size', 'signal', 'clutter', 'line_groups', 'envelope' and (optionally) 'metric'\n");
+
+  memset(&setup, 0, sizeof(setup));
+  for (i = 0; i < 2; i++){
+    if (mxGetM(prhs[1+i])>1 || mxGetN(prhs[1+i])>1)
+       mexErrMsgTxt("The pointer must be a single value \n");
+    xdc[i] = (TTransducer*)(uint64)mxGetScalar(prhs[1+i]);
+    if (!is_xdc_valid(xdc[i]))
+       mexErrMsgTxt("Invalid pointer to aperture \n");
+  }
+  setup.sim.xmt = xdc[0];
+  setup.sim.rcv = xdc[1];
+  setup.sim.pulse = mxGetPr(prhs[3]);
+  setup.sim.pulse_length = mxGetM(prhs[3])*mxGetN(prhs[3]);
+
+  if (mxGetM(prhs[4]) != setup.sim.xmt->no_elements || mxGetN(prhs[4]) == 0)
+     mexErrMsgTxt("\n'delays' must have one row per transmit element and one column per group\n");
+  setup.xmt_delays = mxGetPr(prhs[4]);
+  setup.no_groups = mxGetN(prhs[4]);
+
+  if (mxGetM(prhs[5]) == 1 && mxGetN(prhs[5]) == 1){
+    setup.grid = (TScatGrid*)(uint64)mxGetScalar(prhs[5]);
+    if (!is_scat_grid_valid(setup.grid))
+       mexErrMsgTxt("Invalid pointer to a scatterer grid \n");
+  }else{
+    setup.no_scat = mxGetM(prhs[5]);
+    if (mxGetN(prhs[5]) != 3)
+       mexErrMsgTxt("\n'pht_pos' must have 3 columns\n");
+    if (mxGetM(prhs[6])*mxGetN(prhs[6]) != setup.no_scat)
+       mexErrMsgTxt("\nExpecting one amplitude per scatterer\n");
+    setup.amp = mxGetPr(prhs[6]);
+  }
+
+  if (mxGetM(prhs[7])*mxGetN(prhs[7]) != 2 || mxGetPr(prhs[7])[1] < 1)
+     mexErrMsgTxt("\n'window' must be [start_time no_samples]\n");
+  setup.start_time = mxGetPr(prhs[7])[0];
+  setup.no_samples = (ui32)mxGetPr(prhs[7])[1];
+  setup.chip_samples = (ui32)mxGetScalar(prhs[8]);
+
+  setup.set_size = (ui32)mxGetScalar(prhs[10]);
+  no_codes = setup.no_groups * setup.set_size;
+  cdims = mxGetDimensions(prhs[9]);
+  if (setup.set_size == 0 || mxGetM(prhs[9]) != no_codes)
+     mexErrMsgTxt("\n'codes' must have set_size codes per group in its rows\n");
+  setup.code_length = cdims[1];
+  no_sets = mxGetNumberOfDimensions(prhs[9]) > 2 ? cdims[2] : 1;
+
+  no_lines = flc->no_focus_time_lines;
+  get_region(prhs[11], &setup.signal);
+  get_region(prhs[12], &setup.clutter);
+
+  if (mxGetM(prhs[13])*mxGetN(prhs[13]) > 0){
+    if (mxGetM(prhs[13])*mxGetN(prhs[13]) != no_lines)
+       mexErrMsgTxt("\nExpecting the group of every line\n");
+    line_groups = (ui32*)malloc(no_lines * sizeof(ui32));
+    if (line_groups == NULL)
+       mexErrMsgTxt("Cannot allocate memory \n");
+    for (i = 0; i < no_lines; i++)
+      line_groups[i] = mxGetPr(prhs[13])[i] < 1 ? setup.no_groups
+                                                : (ui32)mxGetPr(prhs[13])[i] - 1;
+    setup.line_groups = line_groups;
+  }
+  setup.envelope = mxGetScalar(prhs[14]) != 0;
+  setup.metric = (nrhs == 16) ? get_metric_id(prhs[15]) : METRIC_MAX_TO_AVG;
+
+  if (setup.grid == NULL)
+    setup.pos = pos = get_points(prhs[5], setup.no_scat);
+  s = sweep_create(&setup, flc, alc, &sys);
+  free(pos);
+  if (s == NULL){
+    free(line_groups);
+    mexErrMsgTxt("The sweep cannot be prepared \n");
+  }
+
+  plhs[0] = mxCreateDoubleMatrix(no_sets, 1, mxREAL);
+  if (nlhs > 1){
+    dims[0] = s->no_out;  dims[1] = no_lines;  dims[2] = no_sets;
+    plhs[1] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    images = mxGetPr(plhs[1]);
+  }
+  ok = sweep_run(s, mxGetPr(prhs[9]), no_sets, mxGetPr(plhs[0]), images);
+  sweep_free(s);
+  free(line_groups);
+  if (!ok)
+     mexErrMsgTxt("The sweep is unsuccessful \n");
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_stats
+ * ABSTRACT : Return the timing and counters of the beamforming, and
+ *            optionally reset them
+ *******************************************************************/
+void bft_stats(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+#ifndef BFT_NO_STATS
+  static const char *timer_fields[] = {"calls", "total", "min", "max", "mean"};
+  static const char *perf_fields[] = {"calls", "time", "cycles", "instructions",
+          "l1d_misses", "llc_misses", "ipc", "dram_bytes", "bandwidth"};
+  const char *names[STAT_NO_STAGES + STAT_NO_COUNTERS + 2];
+  const char *buckets[PERF_NO_BUCKETS];
+  TStats s;
+  TStatTimer *t;
+  TPerfStats ps;
+  TPerfCounters *pc;
+  mxArray *timer, *counters;
+  double v[PERF_NO_EVENTS];
+  ui32 i, k;
+
+  if (nrhs!=1 && nrhs!=2)
+      mexErrMsgTxt("\nExpecting (optionally) 'reset'\n");
+
+  stats_get(&s);
+  perf_get(&ps);
+  if (nrhs == 2 && mxGetScalar(prhs[1]) != 0){
+    stats_reset();
+    perf_reset();
+  }
+
+  for (i = 0; i < STAT_NO_STAGES; i++) names[i] = stats_stage_name(i);
+  for (i = 0; i < STAT_NO_COUNTERS; i++) names[STAT_NO_STAGES + i] = stats_counter_name(i);
+  names[STAT_NO_STAGES + STAT_NO_COUNTERS] = "max_threads";
+  names[STAT_NO_STAGES + STAT_NO_COUNTERS + 1] = "perf";
+  plhs[0] = mxCreateStructMatrix(1, 1, STAT_NO_STAGES + STAT_NO_COUNTERS + 2, names);
+
+  /* Times in seconds */
+  for (i = 0; i < STAT_NO_STAGES; i++){
+    t = s.stage + i;
+    timer = mxCreateStructMatrix(1, 1, 5, timer_fields);
+    mxSetField(timer, 0, "calls", mxCreateDoubleScalar((double)t->calls));
+    mxSetField(timer, 0, "total", mxCreateDoubleScalar(t->total_ns * 1e-9));
+    mxSetField(timer, 0, "min", mxCreateDoubleScalar(t->min_ns * 1e-9));
+    mxSetField(timer, 0, "max", mxCreateDoubleScalar(t->max_ns * 1e-9));
+    mxSetField(timer, 0, "mean", mxCreateDoubleScalar(t->calls > 0 ? 
+                                 t->total_ns * 1e-9 / t->calls : 0));
+    mxSetField(plhs[0], 0, names[i], timer);
+  }
+  for (i = 0; i < STAT_NO_COUNTERS; i++)
+    mxSetField(plhs[0], 0, names[STAT_NO_STAGES + i],
+               mxCreateDoubleScalar((double)s.counter[i]));
+  mxSetField(plhs[0], 0, "max_threads", mxCreateDoubleScalar(s.max_threads));
+
+  /* Hardware counters per bucket. NaN if the event is not counted */
+  for (i = 0; i < PERF_NO_BUCKETS; i++) buckets[i] = perf_bucket_name(i);
+  counters = mxCreateStructMatrix(1, 1, PERF_NO_BUCKETS, buckets);
+  for (i = 0; i < PERF_NO_BUCKETS; i++){
+    pc = ps.bucket + i;
+    for (k = 0; k < PERF_NO_EVENTS; k++)
+      v[k] = (ps.available & (1 << k)) ? (double)pc->value[k] : mxGetNaN();
+    timer = mxCreateStructMatrix(1, 1, 9, perf_fields);
+    mxSetField(timer, 0, "calls", mxCreateDoubleScalar((double)pc->calls));
+    mxSetField(timer, 0, "time", mxCreateDoubleScalar(pc->time_ns * 1e-9));
+    for (k = 0; k < PERF_NO_EVENTS; k++)
+      mxSetField(timer, 0, perf_event_name(k), mxCreateDoubleScalar(v[k]));
+    mxSetField(timer, 0, "ipc", mxCreateDoubleScalar(v[PERF_INSTRUCTIONS] / v[PERF_CYCLES]));
+    mxSetField(timer, 0, "dram_bytes", 
+               mxCreateDoubleScalar(v[PERF_LLC_MISSES] * PERF_CACHE_LINE));
+    mxSetField(timer, 0, "bandwidth", mxCreateDoubleScalar(pc->time_ns > 0 ? 
+               v[PERF_LLC_MISSES] * PERF_CACHE_LINE / (pc->time_ns * 1e-9) : 0));
+    mxSetField(counters, 0, buckets[i], timer);
+  }
+  mxSetField(plhs[0], 0, "perf", counters);
+#else
+  mexErrMsgTxt("\nThe toolbox is built without statistics (BFT_NO_STATS)\n");
+#endif
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_trace
+ * ABSTRACT : Start, stop, clear or dump the timeline of the threads
+ *******************************************************************/
+void bft_trace(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+#ifndef BFT_NO_STATS
+  char action[10], *file_name;
+  si64 no_events;
+
+  if (nrhs<2 || !mxIsChar(prhs[1]) || mxGetString(prhs[1], action, sizeof(action)))
+      mexErrMsgTxt("\nExpecting 'start', 'stop', 'clear' or 'dump'\n");
+
+  if (!strcmp(action, "start")){
+    trace_start(nrhs > 2 ? (ui32)mxGetScalar(prhs[2]) : 0);
+  }else if (!strcmp(action, "stop")){
+    trace_stop();
+  }else if (!strcmp(action, "clear")){
+    trace_clear();
+  }else if (!strcmp(action, "dump")){
+    if (nrhs != 3 || !mxIsChar(prhs[2]))
+        mexErrMsgTxt("\nExpecting the name of the file\n");
+    file_name = mxArrayToString(prhs[2]);
+    if (file_name == NULL)
+        mexErrMsgTxt("\nBad string argument\n");
+    no_events = trace_dump(file_name);
+    mxFree(file_name);
+    if (no_events < 0)
+        mexErrMsgTxt("The trace cannot be written \n");
+    plhs[0] = mxCreateDoubleScalar((double)no_events);
+  }else
+      mexErrMsgTxt("\nExpecting 'start', 'stop', 'clear' or 'dump'\n");
+#else
+  mexErrMsgTxt("\nThe toolbox is built without statistics (BFT_NO_STATS)\n");
+#endif
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_autotune
+ * ABSTRACT : Find the fastest number of threads and lines per task
+ *            of bft_beamform for the current lines, and keep them for
+ *            the later calls. The RF data are given, or only their
+ *            size [no_samples no_elements], and then random data are
+ *            used.
+ *******************************************************************/
+void bft_autotune(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *names[] = {"threads", "lines_per_task", "time", "hash"};
+  TTuneResult res;
+  double Time, *ptr, **rf_data, *random = NULL;
+  ui32 no_samples, no_elements, element_no = -1, repeats = 3, i;
+  size_t k;
+  TPoint3D *xmt = NULL;
+  char hash[20], *file_name;
+  si32 ok;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs == 3 && mxIsChar(prhs[1]) && mxIsChar(prhs[2])){
+    file_name = mxArrayToString(prhs[2]);
+    if (file_name == NULL)
+        mexErrMsgTxt("\nBad string argument\n");
+    ok = autotune_set_file(file_name);
+    mxFree(file_name);
+    if (!ok)
+        mexErrMsgTxt("The file name is not valid \n");
+    return;
+  }
+
+  if (nrhs < 3 || nrhs > 5)
+      mexErrMsgTxt("\nExpecting 'time', 'rf_data', (optionally) 'element_no' and 'repeats'\n");
+
+  if (mxGetM(prhs[1]) * mxGetN(prhs[1]) != 1)
+      mexErrMsgTxt("\nExpecting a single value for 'time' \n");
+  Time = mxGetScalar(prhs[1]);
+
+  if (nrhs > 3 && mxGetM(prhs[3]) * mxGetN(prhs[3]) > 0){
+    if ((mxGetM(prhs[3]) * mxGetN(prhs[3])) == 1)
+      element_no = (ui32)floor(mxGetScalar(prhs[3])) - 1;
+    else if ((mxGetM(prhs[3]) * mxGetN(prhs[3])) == 3)
+      xmt = (TPoint3D*)mxGetPr(prhs[3]);
+    else
+      mexErrMsgTxt("The transmitting aperture must be given either as coordinates or as an index\n");
+  }
+  if (nrhs > 4)
+    repeats = (ui32)floor(mxGetScalar(prhs[4]) + 0.5);
+
+  ptr = mxGetPr(prhs[2]);
+  if (mxGetM(prhs[2]) * mxGetN(prhs[2]) == 2){
+    no_samples = (ui32)ptr[0];
+    no_elements = (ui32)ptr[1];
+    random = (double*)malloc((size_t)no_samples * no_elements * sizeof(double));
+    if (random == NULL)
+       mexErrMsgTxt("Cannot allocate memory \n");
+    for (k = 0; k < (size_t)no_samples * no_elements; k++)
+      random[k] = 2.0 * rand() / RAND_MAX - 1;
+    ptr = random;
+  }else{
+    no_samples = mxGetM(prhs[2]);
+    no_elements = mxGetN(prhs[2]);
+  }
+
+  rf_data = (double**)calloc(no_elements, sizeof(double*));
+  if (rf_data == NULL){
+     free(random);
+     mexErrMsgTxt("Cannot allocate memory \n");
+  }
+  for (i = 0; i < no_elements; i++)
+     rf_data[i] = ptr + (size_t)i*no_samples;
+
+  ok = autotune_run(flc, alc, &sys, Time, rf_data, no_samples, element_no,
+                    xmt, repeats, &res);
+  free(rf_data);
+  free(random);
+  if (!ok)
+     mexErrMsgTxt("The tuning is unsuccessful \n");
+
+  sprintf(hash, "%016llx", (unsigned long long)res.hash);
+  plhs[0] = mxCreateStructMatrix(1, 1, 4, names);
+  mxSetField(plhs[0], 0, "threads", mxCreateDoubleScalar(res.best.no_threads));
+  mxSetField(plhs[0], 0, "lines_per_task", mxCreateDoubleScalar(res.best.lines_per_task));
+  mxSetField(plhs[0], 0, "time", mxCreateDoubleScalar(res.best_time));
+  mxSetField(plhs[0], 0, "hash", mxCreateString(hash));
+
+  if (nlhs > 1){
+    plhs[1] = mxCreateDoubleMatrix(res.no_tried, 3, mxREAL);
+    ptr = mxGetPr(plhs[1]);
+    for (i = 0; i < res.no_tried; i++){
+      ptr[i] = res.tried[i].no_threads;
+      ptr[i + res.no_tried] = res.tried[i].lines_per_task;
+      ptr[i + 2*res.no_tried] = res.time[i];
+    }
+  }
+}
+
+
+
+/*******************************************************************
+ * FUNCTION : bft_setup_lines
+ * ABSTRACT : Set the focusing or the apodization of all the lines in
+ *            one call. The arrays hold the values of every line, one
+ *            line after the other.
+ *******************************************************************/
+void bft_setup_lines(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+  static const char *kinds[] = {"center", "dynamic", "focus", "focus_2way",
+                                "focus_times", "pixels", "apodization",
+                                "sum_apodization"};
+  TLineSetup setup;
+  TApoLineCollection *apo = alc;
+  char kind[20];
+  ui32 no_lines, no_times, cols, k;
+
+  if (!initialized)
+      mexErrMsgTxt("\nToolbox is not initialized\n");
+
+  if (nrhs < 3 || !mxIsChar(prhs[1]) || mxGetString(prhs[1], kind, sizeof(kind)))
+      mexErrMsgTxt("\nExpecting the kind of setting and its values\n");
+
+  for (k = 0; k < sizeof(kinds)/sizeof(kinds[0]) && strcmp(kind, kinds[k]); k++);
+  if (k == sizeof(kinds)/sizeof(kinds[0])){
+      printf("\nUnknown setting '%s'\n", kind);
+      mexErrMsgTxt("");
+  }
+  if (k == 7){                 /* 'sum_apodization' */
+    apo = salc;
+    k = SETUP_APODIZATION;
+  }
+
+  memset(&setup, 0, sizeof(setup));
+  setup.kind = k;
+  no_lines = setup.no_lines = flc->no_focus_time_lines;
+  if (no_lines == 0)
+      mexErrMsgTxt("\nThe number of lines is 0. Use bft_no_lines first\n");
+
+  if (setup.kind == SETUP_CENTER){
+    if (nrhs != 3 || mxGetM(prhs[2]) != 3 || mxGetN(prhs[2]) != no_lines)
+        mexErrMsgTxt("\nExpecting 'centers', 3 by the number of lines\n");
+    setup.points = (TPoint3D*)mxGetPr(prhs[2]);
+  }else{
+    if (mxGetM(prhs[2]) * mxGetN(prhs[2]) != 1)
+        mexErrMsgTxt("The pointer to the transducer must be only one");
+    setup.xdc = (TTransducer*)(uint64)mxGetScalar(prhs[2]);
+  }
+
+  switch (setup.kind){
+    case SETUP_DYNAMIC:
+      if (nrhs != 5)
+          mexErrMsgTxt("\nExpecting 'xdc', 'dir_xz' and 'dir_yz'\n");
+      setup.dir_stride = (mxGetM(prhs[3]) * mxGetN(prhs[3]) == 1) ? 0 : 1;
+      if (mxGetM(prhs[3]) * mxGetN(prhs[3]) != (setup.dir_stride ? no_lines : 1)
+          || mxGetM(prhs[4]) * mxGetN(prhs[4]) != mxGetM(prhs[3]) * mxGetN(prhs[3]))
+          mexErrMsgTxt("\n'dir_xz' and 'dir_yz' must have one value, or one per line\n");
+      setup.dir_xz = mxGetPr(prhs[3]);
+      setup.dir_yz = mxGetPr(prhs[4]);
+      break;
+
+    case SETUP_PIXELS:
+      if (nrhs != 4 || mxGetM(prhs[3]) != 3 || mxGetN(prhs[3]) % no_lines != 0)
+          mexErrMsgTxt("\nExpecting 'xdc' and 'pixels', 3 by (pixels per line x lines)\n");
+      setup.no_times = mxGetN(prhs[3]) / no_lines;
+      setup.points = (TPoint3D*)mxGetPr(prhs[3]);
+      break;
+
+    case SETUP_FOCUS:
+    case SETUP_FOCUS_2WAY:
+    case SETUP_FOCUS_TIMES:
+    case SETUP_APODIZATION:
+      if (nrhs != 5)
+          mexErrMsgTxt("\nExpecting 'xdc', 'times' and the values of the lines\n");
+      if (setup.kind == SETUP_FOCUS || setup.kind == SETUP_FOCUS_2WAY){
+        if (mxGetM(prhs[4]) != 3)
+            mexErrMsgTxt("\nThere must be 3 coordinates (x,y,z) per point \n");
+        setup.points = (TPoint3D*)mxGetPr(prhs[4]);
+      }else{
+        if (!is_xdc_valid(setup.xdc))
+            mexErrMsgTxt("\nThe transducer is not valid\n");
+        if (mxGetM(prhs[4]) != setup.xdc->no_elements){
+            printf("The number of elements in the transducer is %d \n",setup.xdc->no_elements);
+            mexErrMsgTxt("The values must have one row per element\n");
+        }
+        setup.values = mxGetPr(prhs[4]);
+      }
+      cols = mxGetN(prhs[4]);
+      if (cols % no_lines != 0)
+          mexErrMsgTxt("\nThe values must have the same number of columns for every line\n");
+      no_times = setup.no_times = cols / no_lines;
+
+      /* The same times for all the lines, or a column per line */
+      setup.times = mxGetPr(prhs[3]);
+      if (mxGetM(prhs[3]) * mxGetN(prhs[3]) == no_times)
+        setup.times_stride = 0;
+      else if (mxGetM(prhs[3]) == no_times && mxGetN(prhs[3]) == no_lines)
+        setup.times_stride = no_times;
+      else{
+        printf("The values have %d columns per line \n", no_times);
+        mexErrMsgTxt("'times' must have as many values, or one column of them per line\n");
+      }
+      break;
+  }
+
+  if (!set_lines(flc, apo, &sys, &setup))
+      mexErrMsgTxt("The lines cannot be set \n");
+}
+
+
+
+/*******************************************************************
+ * FUNCTION  : mexFunction 
+ * ABSTRACT  : Entry function of the interface between Matlab and
+ *             the beamforming library
+ *******************************************************************/ 
+void mexFunction(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
+{
+   int function_id;
+   TRACE_VAR(t)
+   
+
+   if (!mexNoEntries){
+#ifdef DEBUG
+       printf("Debug mode\n");
+#endif
+
+#ifdef DEBUG_TRACE
+       printf("Tracing functions\n");
+#endif
+
+#ifdef SHOW_ENTRIES
+       printf("Showing some the input arguments\n");
+#endif
+
+#ifdef  SPECIAL_CASE
+      printf("Special case \n");
+      nice(-20);
+#endif
+
+       signal(SIGABRT,atAbort);
+       mexAtExit(mexBFTExit);
+       mexNoEntries ++;
+   }
+  
+   if( nrhs < 1 )
+      mexErrMsgTxt("\nmexFunction\nERROR- needed at least one argument.\n");
+
+   function_id = (int)floor(mxGetScalar(prhs[0]) + 0.5);
+
+   /* Frames in the pipeline use the current settings */
+   if (function_id != BFT_SUBMIT && function_id != BFT_COLLECT)
+      pipeline_wait_idle();
+
+   TRACE_START(t)
    switch(function_id){
        case BFT_INIT: bft_init(nlhs, plhs, nrhs, prhs); break;
        case BFT_END: bft_end(nlhs, plhs, nrhs, prhs); break;
@@ -1357,9 +3273,38 @@ void mexFunction(int nlhs, mxArray *plhs[],int nrhs, const mxArray *prhs[])
        case BFT_DELAY:   bft_delay(nlhs, plhs, nrhs, prhs); break;
        case BFT_DELAY_FILTER: bft_delay_filter(nlhs, plhs, nrhs, prhs); break;
 		 case BFT_XDC_SET: bft_xdc_set(nlhs, plhs, nrhs, prhs); break;
+       case BFT_RF_OPEN: bft_rf_open(nlhs, plhs, nrhs, prhs); break;
+       case BFT_RF_CLOSE: bft_rf_close(nlhs, plhs, nrhs, prhs); break;
+       case BFT_RF_INFO: bft_rf_info(nlhs, plhs, nrhs, prhs); break;
+       case BFT_RF_BEAMFORM: bft_rf_beamform(nlhs, plhs, nrhs, prhs); break;
+       case BFT_SUBMIT: bft_submit(nlhs, plhs, nrhs, prhs); break;
+       case BFT_COLLECT: bft_collect(nlhs, plhs, nrhs, prhs); break;
+       case BFT_BEAMFORM_ENSEMBLE: bft_beamform_ensemble(nlhs, plhs, nrhs, prhs); break;
+       case BFT_FLOW: bft_flow(nlhs, plhs, nrhs, prhs); break;
+       case BFT_BEAMFORM_COMPOUND: bft_beamform_compound(nlhs, plhs, nrhs, prhs); break;
+       case BFT_BEAMFORM_FK: bft_beamform_fk(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CALC_SCAT: bft_calc_scat(nlhs, plhs, nrhs, prhs); break;
+       case BFT_SCAT_GRID: bft_scat_grid(nlhs, plhs, nrhs, prhs); break;
+       case BFT_FREE_SCAT_GRID: bft_free_scat_grid(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_CORR: bft_code_corr(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_SEARCH: bft_code_search(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_MULTISTART: bft_code_multistart(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_ENUMERATE: bft_code_enumerate(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_DB_CREATE: bft_code_db_create(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_DB_OPEN: bft_code_db_open(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_DB_CLOSE: bft_code_db_close(nlhs, plhs, nrhs, prhs); break;
+       case BFT_CODE_DB_QUERY: bft_code_db_query(nlhs, plhs, nrhs, prhs); break;
+       case BFT_SWEEP: bft_sweep(nlhs, plhs, nrhs, prhs); break;
+       case BFT_METRICS: bft_metrics(nlhs, plhs, nrhs, prhs); break;
+       case BFT_STREAM_METRICS: bft_stream_metrics(nlhs, plhs, nrhs, prhs); break;
+       case BFT_STATS: bft_stats(nlhs, plhs, nrhs, prhs); break;
+       case BFT_TRACE: bft_trace(nlhs, plhs, nrhs, prhs); break;
+       case BFT_AUTOTUNE: bft_autotune(nlhs, plhs, nrhs, prhs); break;
+       case BFT_SETUP_LINES: bft_setup_lines(nlhs, plhs, nrhs, prhs); break;
 		 
        default: printf("\007 mexFunction :\n");
                 printf("Unknown function id. \n");
    }
+   TRACE_END(TRACE_COMMAND, t, function_id, TRACE_MODE_NONE, 0, 0)
  
 } 
@@ -0,0 +1,253 @@
+/*********************************************************************
+ * NAME     : multistart.c
+ * ABSTRACT : Multi-start search for binary code sets.
+ *
+ *            Every search is one item of bft_parallel_for(). It starts
+ *            from random codes with its own seed, and runs the local
+ *            search of search.c in stages. After every stage the best
+ *            codes of the search are rated with code_metrics(), and the
+ *            search stops if its sidelobe is far above the best result
+ *            of all searches. The best result is kept under a lock, and
+ *            is written to disk (after the lock is released) when it
+ *            improves, so that long runs leave their results behind as
+ *            they go. The metrics are computed serially, since every
+ *            search already runs in a worker thread.
+ *********************************************************************/
+
+#include "../h/multistart.h"
+#include "../h/matfile.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#endif
+
+
+/*
+ *  State shared by all searches
+ */
+typedef struct{
+  TMultiStart *ms;
+  TMultiStartResult *res;
+  ui32 failed;
+#ifndef NOTHREAD
+  pthread_mutex_t lock;
+#endif
+}TMultiJob;
+
+
+/*********************************************************************
+ * FUNCTION : lock_job, unlock_job
+ *********************************************************************/
+static void lock_job(TMultiJob *job)
+{
+#ifndef NOTHREAD
+  pthread_mutex_lock(&job->lock);
+#endif
+}
+
+static void unlock_job(TMultiJob *job)
+{
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&job->lock);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : restart_seed
+ * ABSTRACT : Seed of one search (splitmix64 of the base seed and the
+ *            search number), so that the searches are independent and
+ *            repeatable.
+ *********************************************************************/
+static ui64 restart_seed(ui64 seed, ui32 restart_no)
+{
+  ui64 z = seed + 0x9E3779B97F4A7C15ULL * (restart_no + 1);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return (z != 0) ? z : 1;
+}
+
+
+/*********************************************************************
+ * FUNCTION : write_result
+ * ABSTRACT : Write codes to <prefix><sidelobe>_<ccf>.mat as 'x'.
+ *********************************************************************/
+static void write_result(TMultiStart *ms, double *codes, TCodeMetrics *m)
+{
+  char *file_name;
+  FILE *f;
+
+  file_name = (char*)malloc(strlen(ms->prefix) + 64);
+  if (file_name == NULL) return;
+  sprintf(file_name, "%s%g_%g.mat", ms->prefix, m->acf_sidelobe, m->max_ccf);
+  f = mat_create(file_name);
+  if (f != NULL){
+    mat_write_matrix(f, "x", ms->no_codes, ms->length, codes);
+    fclose(f);
+  }
+  free(file_name);
+}
+
+
+/*********************************************************************
+ * FUNCTION : rate_codes
+ * ABSTRACT : Figures of merit of chips given code by code. 'codes'
+ *            receives the chips as a matrix stored by column.
+ *********************************************************************/
+static si32 rate_codes(TCodeSearch *s, si8 *x, double *codes, TCodeMetrics *m)
+{
+  TCodeSet *cs;
+  si32 ok;
+
+  search_get_codes(s, x, codes);
+  cs = code_pack(codes, s->no_codes, s->length);
+  if (cs == NULL) return FALSE;
+  ok = code_metrics_n(cs, s->set_size, m, NULL, 1);  /* In a worker already */
+  code_free(cs);
+  return ok;
+}
+
+
+/*********************************************************************
+ * FUNCTION : run_restart
+ * ABSTRACT : One search from random codes.
+ *********************************************************************/
+static void run_restart(void *ctx, ui32 restart_no)
+{
+  TMultiJob *job = (TMultiJob*)ctx;
+  TMultiStart *ms = job->ms;
+  TMultiStartResult *res = job->res;
+  ui32 size = ms->no_codes * ms->length, stage, i;
+  TSearchParams p = ms->search;
+  TCodeSearch *s;
+  TCodeMetrics m;
+  si8 *best, *stage_best;
+  double *codes, best_e, e, bound;
+  si32 feasible, improved = FALSE;
+  ui64 rng;
+
+  codes = (double*)malloc(size * sizeof(double));
+  best = (si8*)malloc(2 * (size_t)size);
+  if (codes == NULL || best == NULL) goto rr_fail_1;
+  stage_best = best + size;
+
+  rng = restart_seed(ms->search.seed, restart_no);
+  for (i = 0; i < size; i ++){
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    codes[i] = (rng >> 32) & 1 ? 1 : -1;
+  }
+  s = search_create(codes, ms->no_codes, ms->length, ms->set_size,
+                    ms->search.ccf_weight);
+  if (s == NULL) goto rr_fail_1;
+
+  best_e = s->energy;
+  memcpy(best, s->x, size);
+  p.seed = rng;
+  for (stage = 0; stage < ms->no_stages; stage ++){
+    p.max_iter = ms->search.max_iter / ms->no_stages;
+    if (stage == ms->no_stages - 1) p.max_iter += ms->search.max_iter % ms->no_stages;
+    e = search_run(s, &p, stage_best);
+    if (e < 0) goto rr_fail_2;
+    if (e < best_e){
+      best_e = e;
+      memcpy(best, stage_best, size);
+    }
+    p.seed = 0;                        /* Continue the random numbers */
+
+    if (!rate_codes(s, best, codes, &m)) goto rr_fail_2;
+    if (stage == ms->no_stages - 1) break;
+
+    lock_job(job);
+    bound = res->found ? ms->prune_ratio * res->metrics.acf_sidelobe : -1;
+    unlock_job(job);
+    if (bound >= 0 && m.acf_sidelobe > bound){
+      lock_job(job);
+      res->no_pruned ++;
+      unlock_job(job);
+      goto rr_done;
+    }
+  }
+
+  feasible = (ms->ccf_limit < 0 || m.max_ccf <= ms->ccf_limit);
+  if (feasible){
+    lock_job(job);
+    res->no_feasible ++;
+    if (!res->found || m.acf_sidelobe < res->metrics.acf_sidelobe
+        || (m.acf_sidelobe == res->metrics.acf_sidelobe
+            && m.max_ccf < res->metrics.max_ccf)){
+      res->found = TRUE;
+      res->metrics = m;
+      memcpy(res->codes, codes, size * sizeof(double));
+      improved = TRUE;
+    }
+    unlock_job(job);
+
+    /* 'codes' and 'm' are this search's own, no lock needed to write */
+    if (improved && ms->prefix != NULL) write_result(ms, codes, &m);
+  }
+
+rr_done:
+  search_free(s);
+  free(best);
+  free(codes);
+  return;
+
+rr_fail_2:
+  search_free(s);
+rr_fail_1:
+  free(best);
+  free(codes);
+  job->failed = TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : multistart_run
+ * ABSTRACT : Run all searches of a multi-start search.
+ * ARGUMENTS: ms - Settings
+ *            res - Result. res->codes must have room for
+ *                  no_codes x length values.
+ * RETURNS  : TRUE on success, also when no search met the ccf_limit.
+ *********************************************************************/
+si32 multistart_run(TMultiStart *ms, TMultiStartResult *res)
+{
+  TMultiJob job;
+
+  PFUNC
+  if (ms->set_size == 0 || ms->no_codes % ms->set_size != 0 || ms->length == 0
+      || ms->no_stages == 0){
+    printf("\007 multistart_run:\n");
+    printf("Error : the number of codes must be a multiple of the group size\n");
+    return FALSE;
+  }
+
+  res->found = FALSE;
+  res->no_feasible = 0;
+  res->no_pruned = 0;
+  memset(&res->metrics, 0, sizeof(res->metrics));
+
+  job.ms = ms;
+  job.res = res;
+  job.failed = FALSE;
+#ifndef NOTHREAD
+  pthread_mutex_init(&job.lock, NULL);
+#endif
+  bft_parallel_for(ms->no_restarts, run_restart, &job);
+#ifndef NOTHREAD
+  pthread_mutex_destroy(&job.lock);
+#endif
+
+  if (job.failed){
+    printf("\007 multistart_run:\n");
+    printf("Error : cannot allocate memory\n");
+    return FALSE;
+  }
+  return TRUE;
+}
@@ -0,0 +1,199 @@
+/*********************************************************************
+ * NAME     : perfctr.c
+ * ABSTRACT : Hardware performance counters of the beamforming, read
+ *            with perf_event_open(). Every piece of work opens its own
+ *            counters, so no counter is shared between threads, and
+ *            the results are summed under a lock.
+ *********************************************************************/
+
+#include "../h/perfctr.h"
+#include "../h/stats.h"
+#include "../h/error.h"
+
+#ifndef BFT_NO_STATS
+
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#ifndef NOTHREAD
+#include <pthread.h>
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static TPerfStats perf;
+static si32 enabled = FALSE;
+
+static const char *event_names[PERF_NO_EVENTS] = {"cycles", "instructions",
+   "l1d_misses", "llc_misses"};
+static const char *bucket_names[PERF_NO_BUCKETS] = {"image", "times",
+   "dynamic", "sta", "pixels"};
+
+
+static void lock_perf()
+{
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+#endif
+}
+
+
+static void unlock_perf()
+{
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&lock);
+#endif
+}
+
+
+#ifdef __linux__
+/*********************************************************************
+ * FUNCTION : open_event
+ * RETURNS  : A disabled counter of the calling thread, or -1.
+ *********************************************************************/
+static si32 open_event(ui32 event, si32 inherit)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.disabled = 1;
+  attr.inherit = inherit ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  switch (event){
+    case PERF_CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_L1D_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    default:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  }
+  return (si32)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : perf_enable
+ * ABSTRACT : Switch the collection on or off. It is off by default,
+ *            as opening the counters costs a few system calls per
+ *            line.
+ *********************************************************************/
+void perf_enable(si32 on)
+{
+  enabled = on;
+}
+
+
+si32 perf_enabled()
+{
+  return enabled;
+}
+
+
+void perf_reset()
+{
+  ui32 available;
+
+  lock_perf();
+  available = perf.available;
+  memset(&perf, 0, sizeof(perf));
+  perf.available = available;
+  unlock_perf();
+}
+
+
+void perf_get(TPerfStats *s)
+{
+  lock_perf();
+  *s = perf;
+  unlock_perf();
+}
+
+
+/*********************************************************************
+ * FUNCTION : perf_begin
+ * ABSTRACT : Open and start the counters of the calling thread. With
+ *            'inherit' the threads it creates are counted as well.
+ *********************************************************************/
+void perf_begin(TPerfSet *p, si32 inherit)
+{
+  ui32 i;
+
+  p->active = FALSE;
+  if (!enabled) return;
+#ifdef __linux__
+  for (i = 0; i < PERF_NO_EVENTS; i++){
+    p->fd[i] = open_event(i, inherit);
+    if (p->fd[i] >= 0) p->active = TRUE;
+  }
+  p->start_ns = stats_now();
+  for (i = 0; i < PERF_NO_EVENTS; i++)
+    if (p->fd[i] >= 0) ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : perf_end
+ * ABSTRACT : Stop and close the counters, and add them to 'bucket'.
+ *********************************************************************/
+void perf_end(TPerfSet *p, ui32 bucket)
+{
+#ifdef __linux__
+  ui64 value[PERF_NO_EVENTS], ns;
+  ui32 i, available = 0;
+
+  if (!p->active || bucket >= PERF_NO_BUCKETS) return;
+  for (i = 0; i < PERF_NO_EVENTS; i++)
+    if (p->fd[i] >= 0) ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+  ns = stats_now() - p->start_ns;
+
+  for (i = 0; i < PERF_NO_EVENTS; i++){
+    value[i] = 0;
+    if (p->fd[i] < 0) continue;
+    if (read(p->fd[i], value + i, sizeof(ui64)) == sizeof(ui64))
+      available |= 1 << i;
+    close(p->fd[i]);
+  }
+
+  lock_perf();
+  perf.available |= available;
+  perf.bucket[bucket].calls ++;
+  perf.bucket[bucket].time_ns += ns;
+  for (i = 0; i < PERF_NO_EVENTS; i++) perf.bucket[bucket].value[i] += value[i];
+  unlock_perf();
+  p->active = FALSE;
+#endif
+}
+
+
+const char* perf_event_name(ui32 event)
+{
+  return (event < PERF_NO_EVENTS) ? event_names[event] : "";
+}
+
+
+const char* perf_bucket_name(ui32 bucket)
+{
+  return (bucket < PERF_NO_BUCKETS) ? bucket_names[bucket] : "";
+}
+
+#endif
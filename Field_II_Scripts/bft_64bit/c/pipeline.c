@@ -0,0 +1,325 @@
+/*********************************************************************
+ * NAME     : pipeline.c
+ * ABSTRACT : Asynchronous, double-buffered beamforming of frames.
+ *            One worker thread takes the submitted frames in order
+ *            and beamforms them with beamform_image(). The number of
+ *            frames held by the pipeline (queued, in progress, or
+ *            beamformed but not collected) is bounded by the depth.
+ *
+ *            The focusing and apodization settings are read by the
+ *            worker without locking. The caller must therefore call
+ *            pipeline_wait_idle() before it changes them.
+ *********************************************************************/
+
+#include "../h/pipeline.h"
+#include "../h/stats.h"
+#include "../h/trace.h"
+#include "../h/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#endif
+
+static TPipelineJob *jobs = NULL;  /* Jobs in order of submission     */
+static ui32 no_jobs = 0;           /* Length of the chain 'jobs'       */
+static ui32 depth = PIPELINE_DEFAULT_DEPTH;
+static ui32 next_ticket = 1;
+
+#ifndef NOTHREAD
+static pthread_t worker;
+static ui32 worker_running = FALSE;
+static ui32 worker_stop = FALSE;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : run_job
+ * ABSTRACT : Beamform the frame of one job, and rate it.
+ *********************************************************************/
+static void run_job(TPipelineJob *job)
+{
+  TRACE_VAR(t)
+
+  TRACE_START(t)
+  job->bf_data = beamform_image(job->flc, job->alc, job->sys, job->time,
+                                job->rf_data, job->no_samples, job->element_no,
+                                job->use_xmt ? &job->xmt : NULL);
+  if (job->bf_data != NULL && job->use_metric)
+    job->metric_ok = metric_frames(&job->bf_data, 1, job->no_lines, job->no_out,
+                                   &job->metric, &job->metrics);
+  TRACE_END(TRACE_PIPELINE_JOB, t, job->no_lines, TRACE_MODE_NONE, job->no_samples,
+            job->no_elements)
+}
+
+
+#ifndef NOTHREAD
+/*********************************************************************
+ * FUNCTION : pipeline_worker
+ * ABSTRACT : The worker thread. Runs the queued jobs in order.
+ *********************************************************************/
+static void *pipeline_worker(void *param)
+{
+  TPipelineJob *job;
+
+  pthread_mutex_lock(&lock);
+  while (!worker_stop){
+    for (job = jobs; job != NULL && job->state != JOB_QUEUED; job = job->next);
+    if (job == NULL){
+      pthread_cond_wait(&job_ready, &lock);
+      continue;
+    }
+    job->state = JOB_RUNNING;
+    pthread_mutex_unlock(&lock);
+
+    run_job(job);
+
+    pthread_mutex_lock(&lock);
+    job->state = JOB_DONE;
+    pthread_cond_broadcast(&job_done);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_set_depth
+ * ABSTRACT : Set the maximal number of frames held by the pipeline.
+ *********************************************************************/
+void pipeline_set_depth(ui32 new_depth)
+{
+  depth = (new_depth > 0) ? new_depth : 1;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_get_depth
+ *********************************************************************/
+ui32 pipeline_get_depth()
+{
+  return depth;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_new_job
+ * ABSTRACT : Create a job with a private copy of the channel data.
+ * ARGUMENTS: time - Time of the first sample
+ *            rf - The channel data. One column per element.
+ *            no_samples, no_elements - Size of 'rf'
+ *            element_no - Transmitting element or -1
+ *            xmt - Origin of transmission or NULL
+ * RETURNS  : The job, or NULL if there is not enough memory
+ *********************************************************************/
+TPipelineJob* pipeline_new_job(double time, double *rf, ui32 no_samples,
+                               ui32 no_elements, ui32 element_no, TPoint3D *xmt)
+{
+  TPipelineJob *job;
+  ui32 i;
+
+  job = (TPipelineJob*)calloc(1, sizeof(TPipelineJob));
+  if (job == NULL) goto pnj_fail_1;
+
+  job->rf = (double*)malloc((size_t)no_samples * no_elements * sizeof(double));
+  if (job->rf == NULL) goto pnj_fail_2;
+
+  job->rf_data = (double**)malloc(no_elements * sizeof(double*));
+  if (job->rf_data == NULL) goto pnj_fail_3;
+
+  memcpy(job->rf, rf, (size_t)no_samples * no_elements * sizeof(double));
+  for (i = 0; i < no_elements; i++)
+    job->rf_data[i] = job->rf + (size_t)i * no_samples;
+
+  job->time = time;
+  job->no_samples = no_samples;
+  job->no_elements = no_elements;
+  job->element_no = element_no;
+  if (xmt != NULL){
+    job->xmt = *xmt;
+    job->use_xmt = TRUE;
+  }
+  return job;
+
+pnj_fail_3:
+  free(job->rf);
+pnj_fail_2:
+  free(job);
+pnj_fail_1:
+  errprintf("%s", "Cannot allocate memory for the frame\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_free_job
+ * ABSTRACT : Release a collected job and its result.
+ *********************************************************************/
+void pipeline_free_job(TPipelineJob *job)
+{
+  ui32 i;
+
+  if (job->bf_data != NULL){
+    for (i = 0; i < job->no_lines; i++) free(job->bf_data[i]);
+    free(job->bf_data);
+  }
+  free(job->rf_data);
+  free(job->rf);
+  free(job);
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_submit
+ * ABSTRACT : Queue a job for beamforming. The pipeline takes the
+ *            ownership of the job.
+ * RETURNS  : The ticket for pipeline_collect(), or 0 if the pipeline
+ *            is full. In that case the job is not queued.
+ *********************************************************************/
+ui32 pipeline_submit(TFocusLineCollection *flc, TApoLineCollection *alc,
+                     TSysParams *sys, TPipelineJob *job)
+{
+  TPipelineJob *last;
+
+  PFUNC
+  if (no_jobs >= depth) return 0;
+
+  job->flc = flc;
+  job->alc = alc;
+  job->sys = sys;
+
+  job->no_lines = flc->no_focus_time_lines;
+  if (flc->no_focus_time_lines == 1 && flc->ftl[0].pixel == TRUE)
+    job->no_out = flc->ftl[0].no_times;
+  else
+    job->no_out = job->no_samples;
+
+  job->state = JOB_QUEUED;
+  job->next = NULL;
+
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+  if (!worker_running){
+    worker_stop = FALSE;
+    if (pthread_create(&worker, NULL, pipeline_worker, NULL)){
+      pthread_mutex_unlock(&lock);
+      errprintf("%s", "Cannot create the worker thread\n");
+      return 0;
+    }
+    worker_running = TRUE;
+  }
+#endif
+
+  job->ticket = next_ticket++;
+  if (next_ticket == 0) next_ticket = 1;
+
+  if (jobs == NULL) jobs = job;
+  else{
+    for (last = jobs; last->next != NULL; last = last->next);
+    last->next = job;
+  }
+  no_jobs ++;
+
+#ifndef NOTHREAD
+  pthread_cond_signal(&job_ready);
+  pthread_mutex_unlock(&lock);
+#else
+  run_job(job);
+  job->state = JOB_DONE;
+#endif
+  return job->ticket;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_collect
+ * ABSTRACT : Wait for a job to finish and remove it from the pipeline
+ * RETURNS  : The job, or NULL if no job has this ticket. The caller
+ *            must release the job with pipeline_free_job().
+ *********************************************************************/
+TPipelineJob* pipeline_collect(ui32 ticket)
+{
+  TPipelineJob *job, *prev = NULL;
+
+  PFUNC
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+#endif
+  for (job = jobs; job != NULL && job->ticket != ticket; job = job->next)
+    prev = job;
+
+  if (job != NULL){
+#ifndef NOTHREAD
+    while (job->state != JOB_DONE) pthread_cond_wait(&job_done, &lock);
+#endif
+    if (prev == NULL) jobs = job->next;
+    else prev->next = job->next;
+    no_jobs --;
+  }
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&lock);
+#endif
+  return job;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_wait_idle
+ * ABSTRACT : Wait until all submitted jobs are beamformed. The results
+ *            stay in the pipeline until they are collected.
+ *********************************************************************/
+void pipeline_wait_idle()
+{
+#ifndef NOTHREAD
+  TPipelineJob *job;
+
+  pthread_mutex_lock(&lock);
+  for (;;){
+    for (job = jobs; job != NULL && job->state == JOB_DONE; job = job->next);
+    if (job == NULL) break;
+    pthread_cond_wait(&job_done, &lock);
+  }
+  pthread_mutex_unlock(&lock);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : pipeline_clear
+ * ABSTRACT : Finish all jobs, drop the results which are not collected
+ *            and stop the worker thread.
+ *********************************************************************/
+void pipeline_clear()
+{
+  TPipelineJob *job;
+
+  PFUNC
+  pipeline_wait_idle();
+
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+  if (worker_running){
+    worker_stop = TRUE;
+    pthread_cond_signal(&job_ready);
+    pthread_mutex_unlock(&lock);
+    pthread_join(worker, NULL);
+    pthread_mutex_lock(&lock);
+    worker_running = FALSE;
+  }
+#endif
+  while (jobs != NULL){
+    job = jobs;
+    jobs = job->next;
+    pipeline_free_job(job);
+  }
+  no_jobs = 0;
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&lock);
+#endif
+}
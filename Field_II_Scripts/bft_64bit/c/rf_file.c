@@ -0,0 +1,281 @@
+/*********************************************************************
+ * NAME     : rf_file.c
+ * ABSTRACT : Memory mapped, frame-indexed RF data files. The frames
+ *            are handed to the beamformer as pointers into the
+ *            mapping, so no copy of the channel data is made.
+ *********************************************************************/
+
+#include "../h/rf_file.h"
+#include "../h/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __MSCVC_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static TRFFile *rf_files = NULL;   /* Chain of the opened files */
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_check
+ * ABSTRACT : Check that the header and the tables of a mapped file
+ *            are consistent with the size of the file.
+ *********************************************************************/
+static si32 rf_file_check(TRFFile *f)
+{
+  TRFFileHeader *h = f->hdr;
+  ui64 tables_end;
+  ui32 i;
+
+  if (f->size < sizeof(TRFFileHeader)){
+    errprintf("%s", "The file is too short to be an RF file\n");
+    return FALSE;
+  }
+  if (memcmp(h->magic, RF_FILE_MAGIC, sizeof(h->magic))){
+    errprintf("%s", "The file is not an RF file (bad magic)\n");
+    return FALSE;
+  }
+  if (h->version != RF_FILE_VERSION || h->header_size != sizeof(TRFFileHeader)){
+    errprintf("Unsupported version %d of the RF file\n", h->version);
+    return FALSE;
+  }
+  if (h->no_frames > h->max_frames){
+    errprintf("%s", "The number of frames exceeds the size of the index\n");
+    return FALSE;
+  }
+  if (h->frame_size != (ui64)h->no_samples * h->no_elements * sizeof(double)){
+    errprintf("%s", "The frame size does not match the number of samples\n");
+    return FALSE;
+  }
+
+  tables_end = h->geometry_offset + (ui64)h->no_elements * sizeof(TPoint3D);
+  if (h->times_offset + (ui64)h->max_frames * sizeof(double) > tables_end)
+    tables_end = h->times_offset + (ui64)h->max_frames * sizeof(double);
+  if (h->codes_offset + (ui64)h->no_codes * h->code_length * sizeof(double) > tables_end)
+    tables_end = h->codes_offset + (ui64)h->no_codes * h->code_length * sizeof(double);
+  if (h->index_offset + (ui64)h->max_frames * sizeof(ui64) > tables_end)
+    tables_end = h->index_offset + (ui64)h->max_frames * sizeof(ui64);
+
+  if (tables_end > f->size || tables_end > h->data_offset){
+    errprintf("%s", "The tables in the header exceed the header size\n");
+    return FALSE;
+  }
+  if ((h->geometry_offset | h->times_offset | h->codes_offset
+       | h->index_offset) & (sizeof(double) - 1)){
+    errprintf("%s", "The tables in the header are not aligned\n");
+    return FALSE;
+  }
+
+  for (i = 0; i < h->no_frames; i++){
+    if (f->index[i] < h->data_offset || (f->index[i] & (sizeof(double) - 1))
+        || f->index[i] + h->frame_size > f->size){
+      errprintf("Frame %d lies outside the file\n", i + 1);
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_open
+ * ABSTRACT : Map a file and add it to the chain of opened files.
+ * RETURNS  : Pointer to the opened file, or NULL on error.
+ *********************************************************************/
+TRFFile* rf_file_open(const char *file_name)
+{
+#ifdef __MSCVC_
+  printf("rf_file_open: memory mapped files are not supported on this platform\n");
+  return NULL;
+#else
+  TRFFile *f;
+  struct stat st;
+
+  PFUNC
+  f = (TRFFile*)calloc(1, sizeof(TRFFile));
+  if (f == NULL){
+    errprintf("%s", "Cannot allocate memory\n");
+    goto rfo_fail_1;
+  }
+
+  f->fd = open(file_name, O_RDONLY);
+  if (f->fd < 0){
+    errprintf("Cannot open '%s'\n", file_name);
+    goto rfo_fail_2;
+  }
+
+  if (fstat(f->fd, &st) || st.st_size == 0){
+    errprintf("Cannot determine the size of '%s'\n", file_name);
+    goto rfo_fail_3;
+  }
+  f->size = (ui64)st.st_size;
+
+  f->base = (ui8*)mmap(NULL, f->size, PROT_READ, MAP_SHARED, f->fd, 0);
+  if (f->base == (ui8*)MAP_FAILED){
+    errprintf("Cannot map '%s'\n", file_name);
+    goto rfo_fail_3;
+  }
+
+  /* The frames are read on demand. Prefetching is done per frame */
+  madvise(f->base, f->size, MADV_RANDOM);
+
+  f->hdr = (TRFFileHeader*)f->base;
+  if (f->size < sizeof(TRFFileHeader) || f->hdr->index_offset
+      + (ui64)f->hdr->max_frames * sizeof(ui64) > f->size){
+    errprintf("'%s' is not a valid RF file\n", file_name);
+    goto rfo_fail_4;
+  }
+
+  f->geometry = (TPoint3D*)(f->base + f->hdr->geometry_offset);
+  f->times = (double*)(f->base + f->hdr->times_offset);
+  f->codes = (double*)(f->base + f->hdr->codes_offset);
+  f->index = (ui64*)(f->base + f->hdr->index_offset);
+  if (!rf_file_check(f)) goto rfo_fail_4;
+
+  f->next = rf_files;
+  rf_files = f;
+  return f;
+
+rfo_fail_4:
+  munmap(f->base, f->size);
+rfo_fail_3:
+  close(f->fd);
+rfo_fail_2:
+  free(f);
+rfo_fail_1:
+  return NULL;
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_close
+ * ABSTRACT : Unmap a file and remove it from the chain.
+ *********************************************************************/
+void rf_file_close(TRFFile *f)
+{
+  TRFFile *c, *p = NULL;
+
+  PFUNC
+  c = rf_files;
+  while (c != NULL && c != f){ p = c; c = c->next; }
+  if (c == NULL){
+    printf("rf_file_close: Cannot find file to close \n");
+    return;
+  }
+  if (p == NULL) rf_files = c->next;
+  else p->next = c->next;
+
+#ifndef __MSCVC_
+  munmap(f->base, f->size);
+  close(f->fd);
+#endif
+  free(f);
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_close_all
+ *********************************************************************/
+void rf_file_close_all()
+{
+  while (rf_files != NULL) rf_file_close(rf_files);
+}
+
+
+/*********************************************************************
+ * FUNCTION : is_rf_file_valid
+ * ABSTRACT : Check if a pointer points to an opened file
+ *********************************************************************/
+si32 is_rf_file_valid(TRFFile *f)
+{
+  TRFFile *c;
+
+  for (c = rf_files; c != NULL; c = c->next)
+    if (c == f) return TRUE;
+  return FALSE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_frame
+ * ABSTRACT : Set the channel pointers of one frame. 'rf_data' must
+ *            have room for 'no_elements' pointers. The pointers point
+ *            directly into the mapping, and are valid until the file
+ *            is closed.
+ * ARGUMENTS: f - Opened file
+ *            frame_no - Number of frame, starting from 0
+ *            rf_data - Array of pointers to fill in
+ * RETURNS  : 'rf_data' or NULL if the frame does not exist
+ *********************************************************************/
+double** rf_file_frame(TRFFile *f, ui32 frame_no, double **rf_data)
+{
+  double *ptr;
+  ui32 i;
+
+  if (frame_no >= f->hdr->no_frames) return NULL;
+
+  ptr = (double*)(f->base + f->index[frame_no]);
+  for (i = 0; i < f->hdr->no_elements; i++)
+    rf_data[i] = ptr + (ui64)i * f->hdr->no_samples;
+  return rf_data;
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_advise
+ * ABSTRACT : Give the kernel an advice for a range of frames. The
+ *            start of the range is rounded down to a page boundary.
+ *            The end is rounded up, or with 'inside' set down, so that
+ *            the page shared with the next frame is left alone.
+ *********************************************************************/
+static void rf_file_advise(TRFFile *f, ui32 first_frame, ui32 no_frames,
+                           int advice, int inside)
+{
+#ifndef __MSCVC_
+  ui64 page = (ui64)sysconf(_SC_PAGESIZE);
+  ui64 start, end;
+  ui32 i;
+
+  for (i = first_frame; i < first_frame + no_frames
+                        && i < f->hdr->no_frames; i++){
+    start = f->index[i] & ~(page - 1);
+    end = f->index[i] + f->hdr->frame_size;
+    if (inside)
+      end &= ~(page - 1);
+    if (end > start)
+      madvise(f->base + start, end - start, advice);
+  }
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_prefetch
+ * ABSTRACT : Start reading frames ahead of their use
+ *********************************************************************/
+void rf_file_prefetch(TRFFile *f, ui32 first_frame, ui32 no_frames)
+{
+#ifndef __MSCVC_
+  rf_file_advise(f, first_frame, no_frames, MADV_WILLNEED, 0);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : rf_file_release
+ * ABSTRACT : Drop the pages of frames that are no longer needed, so
+ *            that streaming through a long file does not fill the
+ *            memory. The data is read again from the file if needed.
+ *********************************************************************/
+void rf_file_release(TRFFile *f, ui32 first_frame, ui32 no_frames)
+{
+#ifndef __MSCVC_
+  rf_file_advise(f, first_frame, no_frames, MADV_DONTNEED, 1);
+#endif
+}
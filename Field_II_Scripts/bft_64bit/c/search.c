@@ -0,0 +1,376 @@
+/*********************************************************************
+ * NAME     : search.c
+ * ABSTRACT : Local search for binary code sets by single chip flips.
+ *
+ *            When chip n of a code x flips, every lag of a correlation
+ *            that involves x changes in at most two terms:
+ *
+ *              ACF of x, lag m     : -2 x[n] (x[n+m] + x[n-m])
+ *              CCF of x and y, lag m: -2 x[n] y[n-m]
+ *              CCF of y and x, lag m: -2 x[n] y[n+m]
+ *
+ *            (x[n] before the flip, chips outside the code are 0).
+ *            The change of the cost is thus found from the summed
+ *            correlations of the group of x and of the group pairs
+ *            with that group in O(length) each, and a flip is applied
+ *            in the same time.
+ *
+ *            Tabu search evaluates all flips in every iteration, takes
+ *            the best one that is not tabu (or that gives a new best
+ *            cost), and forbids flipping the chip back for a random
+ *            number of iterations. Simulated annealing tries random
+ *            flips with a geometric cooling schedule, starting from
+ *            the mean cost change of random flips.
+ *********************************************************************/
+
+#include "../h/search.h"
+#include "../h/error.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+
+/*********************************************************************
+ * FUNCTION : next_random
+ * ABSTRACT : xorshift64* generator. Every search has its own state,
+ *            so that searches can run in parallel.
+ *********************************************************************/
+static ui64 next_random(ui64 *state)
+{
+  ui64 x = *state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : uniform_random
+ * RETURNS  : Uniform random number in [0, 1)
+ *********************************************************************/
+static double uniform_random(ui64 *state)
+{
+  return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/*********************************************************************
+ * FUNCTION : pair_index
+ * RETURNS  : Index of the group pair g < h
+ *********************************************************************/
+static ui32 pair_index(TCodeSearch *s, ui32 g, ui32 h)
+{
+  return g*s->no_sets - g*(g + 1)/2 + (h - g - 1);
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_energy
+ * ABSTRACT : Cost of the current correlations.
+ *********************************************************************/
+static double search_energy(TCodeSearch *s)
+{
+  ui32 N = s->length, L = 2*N - 1, no_pairs, i, m;
+  si64 e_acf = 0, e_ccf = 0;
+  si32 *c;
+
+  for (i = 0; i < s->no_sets; i ++)
+    for (m = 1, c = s->acf + (size_t)i*N; m < N; m ++)
+      e_acf += (si64)c[m]*c[m];
+  no_pairs = s->no_sets*(s->no_sets - 1)/2;
+  for (i = 0; i < no_pairs; i ++)
+    for (m = 0, c = s->ccf + (size_t)i*L; m < L; m ++)
+      e_ccf += (si64)c[m]*c[m];
+  return (double)e_acf + s->ccf_weight * (double)e_ccf;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_create
+ * ABSTRACT : Set up a search from codes given as a no_codes x length
+ *            matrix, stored column by column. Negative values are -1,
+ *            other values +1. The codes are taken in groups of
+ *            'set_size' consecutive codes.
+ * RETURNS  : The search, or NULL on error.
+ *********************************************************************/
+TCodeSearch* search_create(double *codes, ui32 no_codes, ui32 length,
+                           ui32 set_size, double ccf_weight)
+{
+  TCodeSearch *s;
+  ui32 N = length, L = 2*length - 1, no_pairs, g, h, k, m, i;
+  si8 *a, *b;
+  si32 *c;
+
+  PFUNC
+  if (set_size == 0 || no_codes % set_size != 0 || length == 0){
+    printf("\007 search_create:\n");
+    printf("Error : the number of codes must be a multiple of the group size\n");
+    return NULL;
+  }
+
+  s = (TCodeSearch*)calloc(1, sizeof(TCodeSearch));
+  if (s == NULL) goto sc_fail_1;
+  s->no_codes = no_codes;
+  s->length = length;
+  s->set_size = set_size;
+  s->no_sets = no_codes / set_size;
+  s->ccf_weight = ccf_weight;
+  s->rng = 0x9E3779B97F4A7C15ULL;
+  no_pairs = s->no_sets*(s->no_sets - 1)/2;
+
+  s->x = (si8*)malloc((size_t)no_codes * N);
+  s->acf = (si32*)calloc((size_t)s->no_sets * N, sizeof(si32));
+  s->ccf = (si32*)calloc((size_t)no_pairs * L + 1, sizeof(si32));
+  if (s->x == NULL || s->acf == NULL || s->ccf == NULL) goto sc_fail_2;
+
+  for (i = 0; i < no_codes; i ++)
+    for (m = 0; m < N; m ++)
+      s->x[(size_t)i*N + m] = (codes[(size_t)m*no_codes + i] < 0) ? -1 : 1;
+
+  /* Summed correlations from scratch */
+  for (g = 0; g < s->no_sets; g ++)
+    for (k = 0; k < set_size; k ++){
+      a = s->x + (size_t)(g*set_size + k)*N;
+      c = s->acf + (size_t)g*N;
+      for (m = 0; m < N; m ++)
+        for (i = 0; i + m < N; i ++) c[m] += a[i + m]*a[i];
+
+      for (h = g + 1; h < s->no_sets; h ++){
+        b = s->x + (size_t)(h*set_size + k)*N;
+        c = s->ccf + (size_t)pair_index(s, g, h)*L + (N - 1);
+        for (m = 0; m < N; m ++)
+          for (i = 0; i + m < N; i ++){
+            c[m] += a[i + m]*b[i];
+            if (m > 0) c[-(si32)m] += a[i]*b[i + m];
+          }
+      }
+    }
+  s->energy = search_energy(s);
+  return s;
+
+sc_fail_2:
+  free(s->ccf);
+  free(s->acf);
+  free(s->x);
+  free(s);
+sc_fail_1:
+  printf("\007 search_create:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_free
+ *********************************************************************/
+void search_free(TCodeSearch *s)
+{
+  free(s->ccf);
+  free(s->acf);
+  free(s->x);
+  free(s);
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_flip_delta
+ * ABSTRACT : Change of the cost if chip n of code 'code_no' flipped.
+ *********************************************************************/
+double search_flip_delta(TCodeSearch *s, ui32 code_no, ui32 n)
+{
+  ui32 N = s->length, L = 2*N - 1;
+  ui32 g = code_no / s->set_size, k = code_no % s->set_size, h, m;
+  si8 *x = s->x + (size_t)code_no*N, *y;
+  si32 xn2 = -2*x[n], d, *c;
+  si64 d_acf = 0, d_ccf = 0;
+  si32 lag;
+
+  /* Own group: lags 1..N-1 */
+  c = s->acf + (size_t)g*N;
+  for (m = 1; m < N; m ++){
+    d = 0;
+    if (n + m < N) d += x[n + m];
+    if (n >= m) d += x[n - m];
+    d *= xn2;
+    d_acf += (si64)d*(2*c[m] + d);
+  }
+
+  /* Pairs with the other groups */
+  if (s->ccf_weight != 0)
+    for (h = 0; h < s->no_sets; h ++){
+      if (h == g) continue;
+      y = s->x + (size_t)(h*s->set_size + k)*N;
+      if (g < h){
+        /* x first: lags m = n - i for the chips i of y */
+        c = s->ccf + (size_t)pair_index(s, g, h)*L + (N - 1);
+        for (m = 0; m < N; m ++){
+          lag = (si32)n - (si32)m;
+          d = xn2*y[m];
+          d_ccf += (si64)d*(2*c[lag] + d);
+        }
+      }else{
+        /* x second: lags m = i - n */
+        c = s->ccf + (size_t)pair_index(s, h, g)*L + (N - 1);
+        for (m = 0; m < N; m ++){
+          lag = (si32)m - (si32)n;
+          d = xn2*y[m];
+          d_ccf += (si64)d*(2*c[lag] + d);
+        }
+      }
+    }
+  return (double)d_acf + s->ccf_weight * (double)d_ccf;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_flip
+ * ABSTRACT : Flip chip n of code 'code_no' and update the
+ *            correlations and the cost.
+ *********************************************************************/
+void search_flip(TCodeSearch *s, ui32 code_no, ui32 n)
+{
+  ui32 N = s->length, L = 2*N - 1;
+  ui32 g = code_no / s->set_size, k = code_no % s->set_size, h, m;
+  si8 *x = s->x + (size_t)code_no*N, *y;
+  si32 xn2 = -2*x[n], d, *c;
+
+  s->energy += search_flip_delta(s, code_no, n);
+
+  c = s->acf + (size_t)g*N;
+  for (m = 1; m < N; m ++){
+    d = 0;
+    if (n + m < N) d += x[n + m];
+    if (n >= m) d += x[n - m];
+    c[m] += xn2*d;
+  }
+
+  for (h = 0; h < s->no_sets; h ++){
+    if (h == g) continue;
+    y = s->x + (size_t)(h*s->set_size + k)*N;
+    if (g < h){
+      c = s->ccf + (size_t)pair_index(s, g, h)*L + (N - 1) + n;
+      for (m = 0; m < N; m ++) c[-(si32)m] += xn2*y[m];
+    }else{
+      c = s->ccf + (size_t)pair_index(s, h, g)*L + (N - 1) - n;
+      for (m = 0; m < N; m ++) c[m] += xn2*y[m];
+    }
+  }
+  x[n] = -x[n];
+}
+
+
+/*********************************************************************
+ * FUNCTION : tabu_search
+ *********************************************************************/
+static double tabu_search(TCodeSearch *s, TSearchParams *p, si8 *best)
+{
+  ui32 no_moves = s->no_codes * s->length, i, mv, best_mv;
+  ui32 tenure_min = 1 + no_moves/10, tenure_range = 1 + no_moves/10;
+  double best_e = s->energy, d, best_d;
+  ui32 *until;
+
+  until = (ui32*)calloc(no_moves, sizeof(ui32));
+  if (until == NULL) return -1;
+
+  for (i = 1; i <= p->max_iter; i ++){
+    best_mv = no_moves;
+    best_d = 0;
+    for (mv = 0; mv < no_moves; mv ++){
+      d = search_flip_delta(s, mv / s->length, mv % s->length);
+      if (until[mv] >= i && s->energy + d >= best_e) continue;
+      if (best_mv == no_moves || d < best_d){
+        best_mv = mv;
+        best_d = d;
+      }
+    }
+    if (best_mv == no_moves) continue;     /* Everything is tabu */
+
+    search_flip(s, best_mv / s->length, best_mv % s->length);
+    until[best_mv] = i + tenure_min + (ui32)(next_random(&s->rng) % tenure_range);
+    if (s->energy < best_e){
+      best_e = s->energy;
+      memcpy(best, s->x, no_moves);
+    }
+  }
+  free(until);
+  return best_e;
+}
+
+
+/*********************************************************************
+ * FUNCTION : anneal_search
+ *********************************************************************/
+static double anneal_search(TCodeSearch *s, TSearchParams *p, si8 *best)
+{
+  ui32 no_moves = s->no_codes * s->length, i, mv;
+  double best_e = s->energy, d, t, t_start, t_end, cooling;
+
+  /* Start so that an average uphill flip is taken with probability 1/e */
+  t_start = 0;
+  for (i = 0; i < 64; i ++){
+    mv = (ui32)(next_random(&s->rng) % no_moves);
+    t_start += fabs(search_flip_delta(s, mv / s->length, mv % s->length));
+  }
+  t_start = (t_start > 0) ? t_start / 64 : 1;
+  t_end = t_start / 1000;
+  cooling = (p->max_iter > 1) ? pow(t_end / t_start, 1.0 / (p->max_iter - 1)) : 1;
+
+  t = t_start;
+  for (i = 0; i < p->max_iter; i ++, t *= cooling){
+    mv = (ui32)(next_random(&s->rng) % no_moves);
+    d = search_flip_delta(s, mv / s->length, mv % s->length);
+    if (d > 0 && uniform_random(&s->rng) >= exp(-d / t)) continue;
+
+    search_flip(s, mv / s->length, mv % s->length);
+    if (s->energy < best_e){
+      best_e = s->energy;
+      memcpy(best, s->x, no_moves);
+    }
+  }
+  return best_e;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_run
+ * ABSTRACT : Search from the current codes.
+ * ARGUMENTS: s - The search. Left at the codes of the last iteration.
+ *            p - Settings. The weight of the cross-correlations is
+ *                taken from the search.
+ *            best - The best codes found, no_codes x length chips
+ * RETURNS  : The cost of the best codes, or -1 on error.
+ *********************************************************************/
+double search_run(TCodeSearch *s, TSearchParams *p, si8 *best)
+{
+  PFUNC
+  if (p->seed != 0) s->rng = p->seed;
+  memcpy(best, s->x, (size_t)s->no_codes * s->length);
+
+  if (p->method == SEARCH_TABU) return tabu_search(s, p, best);
+  if (p->method == SEARCH_ANNEAL) return anneal_search(s, p, best);
+
+  printf("\007 search_run:\n");
+  printf("Error : unknown search method %d\n", p->method);
+  return -1;
+}
+
+
+/*********************************************************************
+ * FUNCTION : search_get_codes
+ * ABSTRACT : Copy chips (no_codes x length, code by code) into a
+ *            matrix stored column by column. 'x' is the current codes
+ *            if NULL.
+ *********************************************************************/
+void search_get_codes(TCodeSearch *s, si8 *x, double *codes)
+{
+  ui32 i, n;
+
+  if (x == NULL) x = s->x;
+  for (i = 0; i < s->no_codes; i ++)
+    for (n = 0; n < s->length; n ++)
+      codes[(size_t)n*s->no_codes + i] = x[(size_t)i*s->length + n];
+}
@@ -0,0 +1,596 @@
+/*********************************************************************
+ * NAME     : simulate.c
+ * ABSTRACT : Simulation of the RF signals from point scatterers.
+ *
+ *            The sum over transmit elements does not depend on the
+ *            receive element. It is therefore calculated once per
+ *            scatterer, as the wave arriving at the scatterer, and
+ *            every receive element adds a delayed copy of that wave.
+ *            The scatterers are processed in blocks, and for every
+ *            block the transmit waves are found in parallel over the
+ *            scatterers, and the received signals in parallel over the
+ *            receive elements. A scatterer whose echo falls outside
+ *            the recorded window of an element is skipped.
+ *
+ *            All delays are applied with linear interpolation of the
+ *            sampled signals.
+ *
+ *            A phantom sorted into a grid is culled bin by bin before
+ *            the simulation: the earliest and latest echo of a bin are
+ *            bounded with the distances from the elements to the
+ *            bounding box of its scatterers.
+ *********************************************************************/
+
+#include "../h/simulate.h"
+#include "../h/geometry.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define SIM_BLOCK  1024        /* Scatterers processed together        */
+#define GRID_MAX_BINS  1024    /* Maximum number of bins in x and in z */
+
+static TScatGrid *scat_grids = NULL;   /* Chain of the created grids */
+
+
+/*
+ *  The setup, the scatterers and the result, shared by all threads
+ */
+typedef struct{
+  TSimSetup *setup;
+  TSysParams *sys;
+  TPoint3D *pos;
+  double *amp;
+  ui32 first;             /* First scatterer of the current block      */
+  ui32 no_block;          /* Scatterers in the current block           */
+  ui32 wave_length;       /* Samples reserved for every transmit wave  */
+  double *wave;           /* Waves at the scatterers, SIM_BLOCK x wave_length */
+  double *wave_start;     /* First sample of every wave                */
+  ui32 *wave_used;        /* Samples in use of every wave              */
+  double *t_min;          /* Earliest and latest echo of every         */
+  double *t_max;          /*   scatterer [s]                           */
+  double start_index;     /* Time of the first RF sample in samples    */
+  double *rf;             /* no_samples x no_rcv                       */
+  ui32 no_samples;
+}TSimJob;
+
+
+/*********************************************************************
+ * FUNCTION : add_delayed
+ * ABSTRACT : dst[n] += g * src(n - d) for 0 <= n < dst_len, where src
+ *            is interpolated linearly and is zero outside
+ *            0..src_len-1.
+ *********************************************************************/
+static void add_delayed(double *dst, ui32 dst_len, double *src, ui32 src_len,
+                        double d, double g)
+{
+  double k0, a0, a1;
+  si32 m, m_first, m_last, k;
+
+  k0 = floor(d);
+  a1 = g * (d - k0);            /* weight of src[m-1] */
+  a0 = g - a1;                  /* weight of src[m]   */
+  if (k0 >= dst_len || k0 + src_len < 0) return;
+  k = (si32)k0;
+
+  m_first = (k < 0) ? -k : 0;
+  m_last = (si32)src_len;
+  if (k + m_last > (si32)dst_len - 1) m_last = (si32)dst_len - 1 - k;
+
+  m = m_first;
+  if (m == 0){
+    dst[k] += a0 * src[0];
+    m = 1;
+  }
+  if (m_last == (si32)src_len){
+    dst[k + m_last] += a1 * src[src_len - 1];
+    m_last --;
+  }
+  for (; m <= m_last; m ++)
+    dst[k + m] += a0 * src[m] + a1 * src[m - 1];
+}
+
+
+/*********************************************************************
+ * FUNCTION : sim_window
+ * ABSTRACT : Earliest and latest echo of one scatterer.
+ *********************************************************************/
+static void sim_window(void *ctx, ui32 s)
+{
+  TSimJob *job = (TSimJob*)ctx;
+  TSimSetup *setup = job->setup;
+  double t, tx_min, tx_max, rx_min, rx_max;
+  ui32 i;
+
+  tx_min = tx_max = setup->xmt_delays[0]
+                    + distance(setup->xmt->c, job->pos + s) / job->sys->c;
+  for (i = 1; i < setup->xmt->no_elements; i ++){
+    t = setup->xmt_delays[i] + distance(setup->xmt->c + i, job->pos + s) / job->sys->c;
+    if (t < tx_min) tx_min = t;
+    if (t > tx_max) tx_max = t;
+  }
+  rx_min = rx_max = distance(setup->rcv->c, job->pos + s) / job->sys->c;
+  for (i = 1; i < setup->rcv->no_elements; i ++){
+    t = distance(setup->rcv->c + i, job->pos + s) / job->sys->c;
+    if (t < rx_min) rx_min = t;
+    if (t > rx_max) rx_max = t;
+  }
+  job->t_min[s] = tx_min + rx_min;
+  job->t_max[s] = tx_max + rx_max + (setup->pulse_length + 1) / job->sys->fs;
+}
+
+
+/*********************************************************************
+ * FUNCTION : sim_transmit
+ * ABSTRACT : The wave arriving at one scatterer of the block: the sum
+ *            of the pulses of all transmit elements, delayed and
+ *            scaled with 1/r.
+ *********************************************************************/
+static void sim_transmit(void *ctx, ui32 ib)
+{
+  TSimJob *job = (TSimJob*)ctx;
+  TSimSetup *setup = job->setup;
+  TPoint3D *p = job->pos + job->first + ib;
+  double *wave = job->wave + (size_t)ib * job->wave_length;
+  ui32 no_elements = setup->xmt->no_elements;
+  double t, t_min, t_max, r, a, scaler;
+  ui32 i;
+
+  scaler = job->sys->fs / job->sys->c;
+  t_min = t_max = setup->xmt_delays[0] * job->sys->fs
+                  + distance(setup->xmt->c, p) * scaler;
+  for (i = 1; i < no_elements; i ++){
+    t = setup->xmt_delays[i] * job->sys->fs + distance(setup->xmt->c + i, p) * scaler;
+    if (t < t_min) t_min = t;
+    if (t > t_max) t_max = t;
+  }
+  job->wave_start[ib] = floor(t_min);
+  job->wave_used[ib] = (ui32)ceil(t_max - job->wave_start[ib]) + setup->pulse_length + 1;
+  if (job->wave_used[ib] > job->wave_length) job->wave_used[ib] = job->wave_length;
+
+  memset(wave, 0, job->wave_used[ib] * sizeof(double));
+  for (i = 0; i < no_elements; i ++){
+    a = (setup->xmt_apo == NULL) ? 1 : setup->xmt_apo[i];
+    r = distance(setup->xmt->c + i, p);
+    if (a == 0 || r <= 0) continue;
+    t = setup->xmt_delays[i] * job->sys->fs + r * scaler;
+    add_delayed(wave, job->wave_used[ib], setup->pulse, setup->pulse_length,
+                t - job->wave_start[ib], a / r);
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : sim_receive
+ * ABSTRACT : Add the echoes of the scatterers of the block to the
+ *            signal of one receive element.
+ *********************************************************************/
+static void sim_receive(void *ctx, ui32 element_no)
+{
+  TSimJob *job = (TSimJob*)ctx;
+  TSimSetup *setup = job->setup;
+  TPoint3D *c = setup->rcv->c + element_no;
+  double *rf = job->rf + (size_t)element_no * job->no_samples;
+  double a, r, d, scaler;
+  ui32 ib, s;
+
+  a = (setup->rcv_apo == NULL) ? 1 : setup->rcv_apo[element_no];
+  if (a == 0) return;
+  scaler = job->sys->fs / job->sys->c;
+
+  for (ib = 0; ib < job->no_block; ib ++){
+    s = job->first + ib;
+    if (job->amp[s] == 0) continue;
+    r = distance(c, job->pos + s);
+    if (r <= 0) continue;
+    d = job->wave_start[ib] + r * scaler - job->start_index;
+    if (d >= job->no_samples || d + job->wave_used[ib] < 0) continue;
+    add_delayed(rf, job->no_samples, job->wave + (size_t)ib * job->wave_length,
+                job->wave_used[ib], d, a * job->amp[s] / r);
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : simulate_scatterers
+ * ABSTRACT : Simulate the signals received by all receive elements
+ *            from a collection of point scatterers.
+ * ARGUMENTS: setup - Transducers, delays, apodizations and pulse
+ *            sys - Speed of sound and sampling frequency
+ *            pos, amp - Position [m] and amplitude of the scatterers
+ *            start_time, no_samples - Window of the result. If
+ *               *no_samples is 0, the window is set to hold all echoes,
+ *               and *start_time and *no_samples are returned.
+ * RETURNS  : RF signals, no_samples x number of receive elements,
+ *            or NULL on error.
+ *********************************************************************/
+double* simulate_scatterers(TSimSetup *setup, TSysParams *sys,
+                            TPoint3D *pos, double *amp, ui32 no_scat,
+                            double *start_time, ui32 *no_samples)
+{
+  TSimJob job;
+  TPoint3D lo, hi;
+  double t_first, t_last, spread;
+  ui32 i, no_xmt;
+
+  PFUNC
+  no_xmt = setup->xmt->no_elements;
+  if (no_xmt == 0 || setup->rcv->no_elements == 0 || setup->pulse_length == 0){
+    printf("\007 simulate_scatterers:\n");
+    printf("Error : the transducers and the pulse must not be empty\n");
+    return NULL;
+  }
+
+  job.setup = setup;
+  job.sys = sys;
+  job.pos = pos;
+  job.amp = amp;
+
+  /* The window of the result */
+  if (*no_samples == 0){
+    if (no_scat == 0){
+      printf("\007 simulate_scatterers:\n");
+      printf("Error : the window cannot be found without scatterers\n");
+      return NULL;
+    }
+    job.t_min = (double*)malloc(2 * (size_t)no_scat * sizeof(double));
+    if (job.t_min == NULL) goto sim_fail_1;
+    job.t_max = job.t_min + no_scat;
+    bft_parallel_for(no_scat, sim_window, &job);
+    t_first = job.t_min[0];
+    t_last = job.t_max[0];
+    for (i = 1; i < no_scat; i ++){
+      if (job.t_min[i] < t_first) t_first = job.t_min[i];
+      if (job.t_max[i] > t_last) t_last = job.t_max[i];
+    }
+    free(job.t_min);
+    *start_time = floor(t_first * sys->fs) / sys->fs;
+    *no_samples = (ui32)(ceil(t_last * sys->fs) - floor(t_first * sys->fs)) + 1;
+  }
+  job.start_index = *start_time * sys->fs;
+  job.no_samples = *no_samples;
+
+  /* Longest transmit wave: spread of the firing times plus the size of
+     the transmit aperture */
+  lo = hi = setup->xmt->c[0];
+  t_first = t_last = setup->xmt_delays[0];
+  for (i = 1; i < no_xmt; i ++){
+    if (setup->xmt->c[i].x < lo.x) lo.x = setup->xmt->c[i].x;
+    if (setup->xmt->c[i].y < lo.y) lo.y = setup->xmt->c[i].y;
+    if (setup->xmt->c[i].z < lo.z) lo.z = setup->xmt->c[i].z;
+    if (setup->xmt->c[i].x > hi.x) hi.x = setup->xmt->c[i].x;
+    if (setup->xmt->c[i].y > hi.y) hi.y = setup->xmt->c[i].y;
+    if (setup->xmt->c[i].z > hi.z) hi.z = setup->xmt->c[i].z;
+    if (setup->xmt_delays[i] < t_first) t_first = setup->xmt_delays[i];
+    if (setup->xmt_delays[i] > t_last) t_last = setup->xmt_delays[i];
+  }
+  spread = (t_last - t_first) * sys->fs + distance(&lo, &hi) * sys->fs / sys->c;
+  job.wave_length = (ui32)ceil(spread) + setup->pulse_length + 2;
+
+  job.rf = (double*)calloc((size_t)job.no_samples * setup->rcv->no_elements,
+                           sizeof(double));
+  if (job.rf == NULL) goto sim_fail_1;
+  job.wave = (double*)malloc((size_t)SIM_BLOCK * job.wave_length * sizeof(double));
+  if (job.wave == NULL) goto sim_fail_2;
+  job.wave_start = (double*)malloc(SIM_BLOCK * sizeof(double));
+  if (job.wave_start == NULL) goto sim_fail_3;
+  job.wave_used = (ui32*)malloc(SIM_BLOCK * sizeof(ui32));
+  if (job.wave_used == NULL) goto sim_fail_4;
+
+  for (job.first = 0; job.first < no_scat; job.first += SIM_BLOCK){
+    job.no_block = no_scat - job.first;
+    if (job.no_block > SIM_BLOCK) job.no_block = SIM_BLOCK;
+    bft_parallel_for(job.no_block, sim_transmit, &job);
+    bft_parallel_for(setup->rcv->no_elements, sim_receive, &job);
+  }
+
+  free(job.wave_used);
+  free(job.wave_start);
+  free(job.wave);
+  return job.rf;
+
+sim_fail_4:
+  free(job.wave_start);
+sim_fail_3:
+  free(job.wave);
+sim_fail_2:
+  free(job.rf);
+sim_fail_1:
+  printf("\007 simulate_scatterers:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : box_distance
+ * ABSTRACT : Smallest and largest distance from a point to a box.
+ *********************************************************************/
+static void box_distance(TPoint3D *p, TPoint3D *lo, TPoint3D *hi,
+                         double *d_min, double *d_max)
+{
+  double v[3], l[3], h[3], near, far;
+  double s_min = 0, s_max = 0;
+  ui32 k;
+
+  v[0] = p->x;  v[1] = p->y;  v[2] = p->z;
+  l[0] = lo->x; l[1] = lo->y; l[2] = lo->z;
+  h[0] = hi->x; h[1] = hi->y; h[2] = hi->z;
+  for (k = 0; k < 3; k ++){
+    near = (v[k] < l[k]) ? l[k] - v[k] : (v[k] > h[k]) ? v[k] - h[k] : 0;
+    far = (fabs(v[k] - l[k]) > fabs(v[k] - h[k])) ? fabs(v[k] - l[k]) : fabs(v[k] - h[k]);
+    s_min += near*near;
+    s_max += far*far;
+  }
+  *d_min = sqrt(s_min);
+  *d_max = sqrt(s_max);
+}
+
+
+/*
+ *  Culling of the bins of a grid
+ */
+typedef struct{
+  TSimSetup *setup;
+  TSysParams *sys;
+  TScatGrid *grid;
+  double t_start, t_end;  /* Window of the result [s]                  */
+  ui8 *visible;           /* One flag per bin                          */
+}TGridJob;
+
+
+/*********************************************************************
+ * FUNCTION : grid_cull_bin
+ * ABSTRACT : Decide if the echoes of one bin can reach the window.
+ *********************************************************************/
+static void grid_cull_bin(void *ctx, ui32 bin)
+{
+  TGridJob *job = (TGridJob*)ctx;
+  TSimSetup *setup = job->setup;
+  TScatGrid *g = job->grid;
+  double d_min, d_max, tx_min, tx_max, rx_min, rx_max, t;
+  ui32 i;
+
+  job->visible[bin] = FALSE;
+  if (g->first[bin] == g->first[bin + 1]) return;
+
+  tx_min = 1e300; tx_max = -1e300;
+  for (i = 0; i < setup->xmt->no_elements; i ++){
+    box_distance(setup->xmt->c + i, g->lo + bin, g->hi + bin, &d_min, &d_max);
+    t = setup->xmt_delays[i] + d_min / job->sys->c;
+    if (t < tx_min) tx_min = t;
+    t = setup->xmt_delays[i] + d_max / job->sys->c;
+    if (t > tx_max) tx_max = t;
+  }
+  rx_min = 1e300; rx_max = -1e300;
+  for (i = 0; i < setup->rcv->no_elements; i ++){
+    box_distance(setup->rcv->c + i, g->lo + bin, g->hi + bin, &d_min, &d_max);
+    if (d_min < rx_min) rx_min = d_min;
+    if (d_max > rx_max) rx_max = d_max;
+  }
+  t = tx_min + rx_min / job->sys->c - 1 / job->sys->fs;
+  if (t > job->t_end) return;
+  t = tx_max + rx_max / job->sys->c + (setup->pulse_length + 1) / job->sys->fs;
+  if (t < job->t_start) return;
+  job->visible[bin] = TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : simulate_grid
+ * ABSTRACT : Simulate the signals received from the scatterers of a
+ *            grid. Only the bins that can reach the window are used.
+ * ARGUMENTS: As for simulate_scatterers(). If *no_samples is 0, all
+ *            bins are used.
+ * RETURNS  : RF signals, no_samples x number of receive elements,
+ *            or NULL on error.
+ *********************************************************************/
+double* simulate_grid(TSimSetup *setup, TSysParams *sys, TScatGrid *g,
+                      double *start_time, ui32 *no_samples)
+{
+  TGridJob job;
+  TPoint3D *pos;
+  double *amp, *rf;
+  ui32 no_bins, no_visible, bin, n;
+
+  PFUNC
+  if (*no_samples == 0)
+    return simulate_scatterers(setup, sys, g->pos, g->amp, g->no_scat,
+                               start_time, no_samples);
+
+  no_bins = g->no_x * g->no_z;
+  job.setup = setup;
+  job.sys = sys;
+  job.grid = g;
+  job.t_start = *start_time;
+  job.t_end = *start_time + *no_samples / sys->fs;
+  job.visible = (ui8*)malloc(no_bins);
+  if (job.visible == NULL) goto sg_fail_1;
+  bft_parallel_for(no_bins, grid_cull_bin, &job);
+
+  no_visible = 0;
+  for (bin = 0; bin < no_bins; bin ++)
+    if (job.visible[bin]) no_visible += g->first[bin + 1] - g->first[bin];
+
+  pos = (TPoint3D*)malloc((no_visible > 0 ? no_visible : 1) * sizeof(TPoint3D));
+  if (pos == NULL) goto sg_fail_2;
+  amp = (double*)malloc((no_visible > 0 ? no_visible : 1) * sizeof(double));
+  if (amp == NULL) goto sg_fail_3;
+
+  no_visible = 0;
+  for (bin = 0; bin < no_bins; bin ++){
+    if (!job.visible[bin]) continue;
+    n = g->first[bin + 1] - g->first[bin];
+    memcpy(pos + no_visible, g->pos + g->first[bin], n * sizeof(TPoint3D));
+    memcpy(amp + no_visible, g->amp + g->first[bin], n * sizeof(double));
+    no_visible += n;
+  }
+  free(job.visible);
+
+  rf = simulate_scatterers(setup, sys, pos, amp, no_visible, start_time, no_samples);
+  free(amp);
+  free(pos);
+  return rf;
+
+sg_fail_3:
+  free(pos);
+sg_fail_2:
+  free(job.visible);
+sg_fail_1:
+  printf("\007 simulate_grid:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : scat_grid_create
+ * ABSTRACT : Sort a phantom into bins of size 'bin_size' in x and z.
+ *            The bins are made larger if more than GRID_MAX_BINS would
+ *            be needed in one direction.
+ * RETURNS  : The grid, or NULL on error.
+ *********************************************************************/
+TScatGrid* scat_grid_create(TPoint3D *pos, double *amp, ui32 no_scat,
+                            double bin_size)
+{
+  TScatGrid *g;
+  ui32 *bin_of, no_bins, i, b, ix, iz;
+  double x1, z1;
+
+  PFUNC
+  if (no_scat == 0 || !(bin_size > 0)){
+    printf("\007 scat_grid_create:\n");
+    printf("Error : expecting scatterers and a positive bin size\n");
+    return NULL;
+  }
+
+  g = (TScatGrid*)calloc(1, sizeof(TScatGrid));
+  if (g == NULL) goto sgc_fail_1;
+
+  g->no_scat = no_scat;
+  g->x0 = x1 = pos[0].x;
+  g->z0 = z1 = pos[0].z;
+  for (i = 1; i < no_scat; i ++){
+    if (pos[i].x < g->x0) g->x0 = pos[i].x;
+    if (pos[i].x > x1) x1 = pos[i].x;
+    if (pos[i].z < g->z0) g->z0 = pos[i].z;
+    if (pos[i].z > z1) z1 = pos[i].z;
+  }
+  g->dx = g->dz = bin_size;
+  if ((x1 - g->x0) / g->dx >= GRID_MAX_BINS) g->dx = (x1 - g->x0) / (GRID_MAX_BINS - 1);
+  if ((z1 - g->z0) / g->dz >= GRID_MAX_BINS) g->dz = (z1 - g->z0) / (GRID_MAX_BINS - 1);
+  g->no_x = (ui32)((x1 - g->x0) / g->dx) + 1;
+  g->no_z = (ui32)((z1 - g->z0) / g->dz) + 1;
+  no_bins = g->no_x * g->no_z;
+
+  g->pos = (TPoint3D*)malloc(no_scat * sizeof(TPoint3D));
+  g->amp = (double*)malloc(no_scat * sizeof(double));
+  g->first = (ui32*)calloc(no_bins + 1, sizeof(ui32));
+  g->lo = (TPoint3D*)malloc(no_bins * sizeof(TPoint3D));
+  g->hi = (TPoint3D*)malloc(no_bins * sizeof(TPoint3D));
+  bin_of = (ui32*)malloc(no_scat * sizeof(ui32));
+  if (g->pos == NULL || g->amp == NULL || g->first == NULL || g->lo == NULL
+      || g->hi == NULL || bin_of == NULL) goto sgc_fail_2;
+
+  /* Counting sort of the scatterers by bin */
+  for (i = 0; i < no_scat; i ++){
+    ix = (ui32)((pos[i].x - g->x0) / g->dx);
+    iz = (ui32)((pos[i].z - g->z0) / g->dz);
+    if (ix >= g->no_x) ix = g->no_x - 1;
+    if (iz >= g->no_z) iz = g->no_z - 1;
+    bin_of[i] = iz * g->no_x + ix;
+    g->first[bin_of[i] + 1] ++;
+  }
+  for (b = 0; b < no_bins; b ++) g->first[b + 1] += g->first[b];
+  for (i = 0; i < no_scat; i ++){
+    b = bin_of[i];
+    g->pos[g->first[b]] = pos[i];
+    g->amp[g->first[b]] = amp[i];
+    g->first[b] ++;
+  }
+  for (b = no_bins; b > 0; b --) g->first[b] = g->first[b - 1];
+  g->first[0] = 0;
+  free(bin_of);
+
+  /* Bounding boxes */
+  for (b = 0; b < no_bins; b ++){
+    if (g->first[b] == g->first[b + 1]) continue;
+    g->lo[b] = g->hi[b] = g->pos[g->first[b]];
+    for (i = g->first[b] + 1; i < g->first[b + 1]; i ++){
+      if (g->pos[i].x < g->lo[b].x) g->lo[b].x = g->pos[i].x;
+      if (g->pos[i].y < g->lo[b].y) g->lo[b].y = g->pos[i].y;
+      if (g->pos[i].z < g->lo[b].z) g->lo[b].z = g->pos[i].z;
+      if (g->pos[i].x > g->hi[b].x) g->hi[b].x = g->pos[i].x;
+      if (g->pos[i].y > g->hi[b].y) g->hi[b].y = g->pos[i].y;
+      if (g->pos[i].z > g->hi[b].z) g->hi[b].z = g->pos[i].z;
+    }
+  }
+
+  g->next = scat_grids;
+  scat_grids = g;
+  return g;
+
+sgc_fail_2:
+  free(bin_of);
+  free(g->hi);
+  free(g->lo);
+  free(g->first);
+  free(g->amp);
+  free(g->pos);
+  free(g);
+sgc_fail_1:
+  printf("\007 scat_grid_create:\n");
+  printf("Error : cannot allocate memory\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : scat_grid_free
+ * ABSTRACT : Release a grid created by scat_grid_create().
+ *********************************************************************/
+void scat_grid_free(TScatGrid *g)
+{
+  TScatGrid *c, *p = NULL;
+
+  c = scat_grids;
+  while (c != NULL && c != g){ p = c; c = c->next; }
+  if (c == NULL){
+    printf("scat_grid_free: Cannot find grid to free \n");
+    return;
+  }
+  if (p == NULL) scat_grids = c->next;
+  else p->next = c->next;
+
+  free(g->hi);
+  free(g->lo);
+  free(g->first);
+  free(g->amp);
+  free(g->pos);
+  free(g);
+}
+
+
+/*********************************************************************
+ * FUNCTION : scat_grid_free_all
+ *********************************************************************/
+void scat_grid_free_all()
+{
+  while (scat_grids != NULL) scat_grid_free(scat_grids);
+}
+
+
+/*********************************************************************
+ * FUNCTION : is_scat_grid_valid
+ * ABSTRACT : Check if a pointer points to a created grid
+ *********************************************************************/
+si32 is_scat_grid_valid(TScatGrid *g)
+{
+  TScatGrid *c;
+
+  for (c = scat_grids; c != NULL; c = c->next)
+    if (c == g) return TRUE;
+  return FALSE;
+}
@@ -0,0 +1,157 @@
+/*********************************************************************
+ * NAME     : stats.c
+ * ABSTRACT : Timing and counters of the beamforming stages. The line
+ *            kernels report from many threads, so the sums are kept
+ *            under a lock. One report per line costs far less than
+ *            the line itself.
+ *********************************************************************/
+
+#include "../h/stats.h"
+
+#ifndef BFT_NO_STATS
+
+#include <string.h>
+#include <time.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static TStats stats;
+static si32 enabled = TRUE;
+
+static const char *stage_names[STAT_NO_STAGES] = {"total", "marshal",
+   "rf_setup", "spawn", "lines", "line", "copy"};
+static const char *counter_names[STAT_NO_COUNTERS] = {"samples", "bytes",
+   "threads"};
+
+
+static void lock_stats()
+{
+#ifndef NOTHREAD
+  pthread_mutex_lock(&lock);
+#endif
+}
+
+
+static void unlock_stats()
+{
+#ifndef NOTHREAD
+  pthread_mutex_unlock(&lock);
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_enable
+ * ABSTRACT : Switch the collection on or off. It is on by default.
+ *********************************************************************/
+void stats_enable(si32 on)
+{
+  enabled = on;
+}
+
+
+si32 stats_enabled()
+{
+  return enabled;
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_reset
+ *********************************************************************/
+void stats_reset()
+{
+  lock_stats();
+  memset(&stats, 0, sizeof(stats));
+  unlock_stats();
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_get
+ * ABSTRACT : Copy of the statistics since the last reset.
+ *********************************************************************/
+void stats_get(TStats *s)
+{
+  lock_stats();
+  *s = stats;
+  unlock_stats();
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_now
+ * RETURNS  : Monotonic time in ns.
+ *********************************************************************/
+ui64 stats_now()
+{
+#ifdef __MSCVC_
+  return (ui64)clock() * (1000000000 / CLOCKS_PER_SEC);
+#else
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (ui64)t.tv_sec * 1000000000 + t.tv_nsec;
+#endif
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_add_time
+ * ABSTRACT : Record one pass through a stage, of 'ns' ns.
+ *********************************************************************/
+void stats_add_time(ui32 stage, ui64 ns)
+{
+  TStatTimer *t = stats.stage + stage;
+
+  if (!enabled || stage >= STAT_NO_STAGES) return;
+  lock_stats();
+  if (t->calls == 0 || ns < t->min_ns) t->min_ns = ns;
+  if (ns > t->max_ns) t->max_ns = ns;
+  t->calls ++;
+  t->total_ns += ns;
+  unlock_stats();
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_add_count
+ *********************************************************************/
+void stats_add_count(ui32 counter, ui64 n)
+{
+  if (!enabled || counter >= STAT_NO_COUNTERS) return;
+  lock_stats();
+  stats.counter[counter] += n;
+  unlock_stats();
+}
+
+
+/*********************************************************************
+ * FUNCTION : stats_add_threads
+ * ABSTRACT : Record the threads used by one parallel loop.
+ *********************************************************************/
+void stats_add_threads(ui32 n)
+{
+  if (!enabled) return;
+  lock_stats();
+  stats.counter[STAT_THREADS] += n;
+  if (n > stats.max_threads) stats.max_threads = n;
+  unlock_stats();
+}
+
+
+const char* stats_stage_name(ui32 stage)
+{
+  return (stage < STAT_NO_STAGES) ? stage_names[stage] : "";
+}
+
+
+const char* stats_counter_name(ui32 counter)
+{
+  return (counter < STAT_NO_COUNTERS) ? counter_names[counter] : "";
+}
+
+#endif
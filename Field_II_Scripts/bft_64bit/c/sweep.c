@@ -0,0 +1,380 @@
+/*********************************************************************
+ * NAME     : sweep.c
+ * ABSTRACT : Simulation, decoding, beamforming and image metric of
+ *            many code sets, one code set per thread.
+ *
+ *            With u the chips of a code repeated chip_samples times,
+ *            p = impulse * u the emitted pulse and H the response of
+ *            the phantom to a unit pulse, the decoded signal of group
+ *            g at an element is
+ *
+ *              d_g[n] = sum_h (H_h * G_gh)[n],
+ *              G_gh[t] = sum_e sum_k p_he[t + k] u_ge[k]
+ *
+ *            G_gh is short, and the convolutions with H_h are done with
+ *            the spectra of H_h computed by sweep_create().
+ *********************************************************************/
+
+#include "../h/sweep.h"
+#include "../h/threads.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+ *  One sweep_run()
+ */
+typedef struct{
+  TSweep *s;
+  double *codes;          /* no_codes x code_length x no_sets          */
+  double *metrics;
+  double *images;         /* no_out x no_lines x no_sets, or NULL      */
+  ui32 failed;
+}TSweepJob;
+
+
+/*********************************************************************
+ * FUNCTION : sweep_free
+ *********************************************************************/
+void sweep_free(TSweep *s)
+{
+  if (s == NULL) return;
+  if (s->plan != NULL) fft_free_plan(s->plan);
+  free(s->h_re);
+  free(s);
+}
+
+
+/*********************************************************************
+ * FUNCTION : region_union
+ * ABSTRACT : Grow 'r' to the smallest region that also holds 'add'.
+ *********************************************************************/
+static void region_union(TImageRegion *r, TImageRegion *add)
+{
+  ui32 s_end, l_end;
+
+  s_end = r->first_sample + r->no_samples;
+  if (add->first_sample + add->no_samples > s_end) s_end = add->first_sample + add->no_samples;
+  l_end = r->first_line + r->no_lines;
+  if (add->first_line + add->no_lines > l_end) l_end = add->first_line + add->no_lines;
+  if (add->first_sample < r->first_sample) r->first_sample = add->first_sample;
+  if (add->first_line < r->first_line) r->first_line = add->first_line;
+  r->no_samples = s_end - r->first_sample;
+  r->no_lines = l_end - r->first_line;
+}
+
+
+/*********************************************************************
+ * FUNCTION : sweep_create
+ * ABSTRACT : Check the settings and simulate the phantom with a unit
+ *            pulse for every group. The beamforming uses 'flc', 'alc'
+ *            and 'sys', which must not change until sweep_free().
+ * RETURNS  : The prepared sweep, or NULL on error.
+ *********************************************************************/
+TSweep* sweep_create(TSweepSetup *setup, TFocusLineCollection *flc,
+                     TApoLineCollection *alc, TSysParams *sys)
+{
+  TSweep *s;
+  TSimSetup sim;
+  double unit = 1, start, *rf;
+  ui32 n, nfft, no_lines = flc->no_focus_time_lines, g, i;
+
+  PFUNC
+  if (setup->no_groups == 0 || setup->set_size == 0 || setup->code_length == 0
+      || setup->chip_samples == 0 || setup->no_samples == 0
+      || setup->sim.pulse_length == 0){
+    printf("\007 sweep_create:\n");
+    printf("Error : the codes, the impulse response and the window must not be empty\n");
+    return NULL;
+  }
+  if (no_lines == 0 || alc->no_apo_time_lines != no_lines){
+    printf("\007 sweep_create:\n");
+    printf("Error : the focus and apodization lines are not defined\n");
+    return NULL;
+  }
+  for (i = 0; setup->line_groups != NULL && i < no_lines; i++)
+    if (setup->line_groups[i] >= setup->no_groups){
+      printf("\007 sweep_create:\n");
+      printf("Error : line %d belongs to group %d of %d\n", i + 1,
+             setup->line_groups[i] + 1, setup->no_groups);
+      return NULL;
+    }
+
+  s = (TSweep*)calloc(1, sizeof(TSweep));
+  if (s == NULL) goto swc_fail_1;
+  s->setup = *setup;
+  s->flc = flc;
+  s->alc = alc;
+  s->sys = sys;
+  s->no_elements = setup->sim.rcv->no_elements;
+  s->pulse_length = setup->sim.pulse_length + setup->code_length * setup->chip_samples - 1;
+  s->kernel_length = s->pulse_length + setup->code_length * setup->chip_samples - 1;
+  s->no_out = beamform_no_out(flc, setup->no_samples);
+
+  if (!metric_region_valid(&setup->signal, no_lines, s->no_out)
+      || ((setup->metric == METRIC_MAX_TO_AVG || setup->clutter.no_samples > 0)
+          && !metric_region_valid(&setup->clutter, no_lines, s->no_out))){
+    printf("\007 sweep_create:\n");
+    printf("Error : the signal and clutter regions must lie in the image\n");
+    free(s);
+    return NULL;
+  }
+  s->roi = setup->signal;
+  if (setup->clutter.no_samples > 0 && setup->clutter.no_lines > 0)
+    region_union(&s->roi, &setup->clutter);
+
+  /* H_h from the start of the first pulse that reaches the window */
+  n = setup->no_samples + s->kernel_length - 1;
+  nfft = fft_next_pow2(n);
+  s->plan = fft_plan(nfft);
+  s->h_re = (double*)calloc(2 * (size_t)setup->no_groups * s->no_elements * nfft,
+                            sizeof(double));
+  if (s->plan == NULL || s->h_re == NULL) goto swc_fail_2;
+  s->h_im = s->h_re + (size_t)setup->no_groups * s->no_elements * nfft;
+
+  sim = setup->sim;
+  sim.pulse = &unit;
+  sim.pulse_length = 1;
+  for (g = 0; g < setup->no_groups; g++){
+    sim.xmt_delays = setup->xmt_delays + (size_t)g * sim.xmt->no_elements;
+    start = setup->start_time - (s->pulse_length - 1) / sys->fs;
+    if (setup->grid != NULL)
+      rf = simulate_grid(&sim, sys, setup->grid, &start, &n);
+    else
+      rf = simulate_scatterers(&sim, sys, setup->pos, setup->amp, setup->no_scat,
+                               &start, &n);
+    if (rf == NULL) goto swc_fail_2;
+    for (i = 0; i < s->no_elements; i++)
+      memcpy(s->h_re + ((size_t)g * s->no_elements + i) * nfft,
+             rf + (size_t)i * n, n * sizeof(double));
+    free(rf);
+    fft_many(s->plan, s->h_re + (size_t)g * s->no_elements * nfft,
+             s->h_im + (size_t)g * s->no_elements * nfft,
+             s->no_elements, nfft, 1, FFT_FORWARD);
+  }
+  return s;
+
+swc_fail_2:
+  sweep_free(s);
+swc_fail_1:
+  printf("\007 sweep_create:\n");
+  printf("Error : cannot prepare the sweep\n");
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : decode_kernels
+ * ABSTRACT : Spectra of G_gh for one code set. 'g_re' and 'g_im' have
+ *            room for no_groups^2 spectra, and 'u' and 'p' for the
+ *            repeated and emitted codes of the set.
+ *********************************************************************/
+static void decode_kernels(TSweep *s, double *codes, double *u, double *p,
+                           double *g_re, double *g_im)
+{
+  TSweepSetup *st = &s->setup;
+  ui32 no_codes = st->no_groups * st->set_size, nfft = s->plan->n;
+  ui32 lm = st->code_length * st->chip_samples, lp = s->pulse_length;
+  ui32 r, j, k, g, h, e, t;
+  double *gk, v, *pp, *uu;
+
+  /* Repeated chips, and the emitted pulses */
+  for (r = 0; r < no_codes; r++){
+    for (j = 0; j < lm; j++)
+      u[(size_t)r * lm + j] = codes[(size_t)(j / st->chip_samples) * no_codes + r];
+    pp = p + (size_t)r * lp;
+    memset(pp, 0, lp * sizeof(double));
+    for (j = 0; j < lm; j++)
+      if (u[(size_t)r * lm + j] != 0)
+        for (k = 0; k < st->sim.pulse_length; k++)
+          pp[j + k] += u[(size_t)r * lm + j] * st->sim.pulse[k];
+  }
+
+  /* G_gh[t], stored from t = -(lm-1) */
+  for (g = 0; g < st->no_groups; g++)
+    for (h = 0; h < st->no_groups; h++){
+      gk = g_re + ((size_t)g * st->no_groups + h) * nfft;
+      memset(gk, 0, nfft * sizeof(double));
+      memset(g_im + ((size_t)g * st->no_groups + h) * nfft, 0, nfft * sizeof(double));
+      for (e = 0; e < st->set_size; e++){
+        pp = p + (size_t)(h * st->set_size + e) * lp;
+        uu = u + (size_t)(g * st->set_size + e) * lm;
+        for (t = 0; t < s->kernel_length; t++){
+          v = 0;
+          /* p index t - (lm-1) + k must lie in 0 .. lp-1 */
+          k = (t < lm - 1) ? lm - 1 - t : 0;
+          for (; k < lm && t + k < lm - 1 + lp; k++)
+            v += pp[t + k - (lm - 1)] * uu[k];
+          gk[t] += v;
+        }
+      }
+      fft_run(s->plan, gk, g_im + ((size_t)g * st->no_groups + h) * nfft, FFT_FORWARD);
+    }
+}
+
+
+/*********************************************************************
+ * FUNCTION : run_set
+ * ABSTRACT : Decode, beamform and rate one code set.
+ *********************************************************************/
+static void run_set(void *ctx, ui32 set_no)
+{
+  TSweepJob *job = (TSweepJob*)ctx;
+  TSweep *s = job->s;
+  TSweepSetup *st = &s->setup;
+  ui32 no_codes = st->no_groups * st->set_size, nfft = s->plan->n;
+  ui32 no_lines = s->flc->no_focus_time_lines, ns = st->no_samples;
+  ui32 lm = st->code_length * st->chip_samples;
+  ui32 g, h, i, k, l, n;
+  double *u, *p, *g_re, *g_im, *re, *im, *rf, **rf_data, **lines, **bf, **env;
+  double *hr, *hi, *gr, *gi;
+  si32 whole;
+  ui8 *mask;
+  TBeamformROI roi;
+  TBeamformConfig cfg;
+  TMetricSetup figures;
+  TImageMetrics m;
+  size_t size;
+
+  size = (size_t)no_codes * (lm + s->pulse_length)
+         + 2 * (size_t)st->no_groups * st->no_groups * nfft + 2 * (size_t)nfft
+         + (size_t)ns * s->no_elements;
+  u = (double*)malloc(size * sizeof(double));
+  rf_data = (double**)malloc((s->no_elements + 2 * (size_t)no_lines) * sizeof(double*));
+  mask = (ui8*)malloc(no_lines);
+  if (u == NULL || rf_data == NULL || mask == NULL) goto rs_fail_1;
+  p = u + (size_t)no_codes * lm;
+  g_re = p + (size_t)no_codes * s->pulse_length;
+  g_im = g_re + (size_t)st->no_groups * st->no_groups * nfft;
+  re = g_im + (size_t)st->no_groups * st->no_groups * nfft;
+  im = re + nfft;
+  rf = im + nfft;
+  lines = rf_data + s->no_elements;
+  env = lines + no_lines;
+  for (i = 0; i < no_lines; i++) lines[i] = NULL;
+
+  /*
+   *  Without the images only the region of the metric is beamformed,
+   *  all its samples if the envelope is found
+   */
+  whole = (job->images != NULL);
+  roi.first_sample = (whole || st->envelope) ? 0 : s->roi.first_sample;
+  roi.no_samples = (whole || st->envelope) ? s->no_out : s->roi.no_samples;
+  roi.lines = mask;
+  roi.decimation = 1;
+  roi.taps = NULL;
+  roi.no_taps = 0;
+
+  /* The sets are shared by the threads, so every set is beamformed in
+     the calling thread alone */
+  cfg.no_threads = 1;
+  cfg.lines_per_task = no_lines;
+
+  decode_kernels(s, job->codes + (size_t)set_no * no_codes * st->code_length,
+                 u, p, g_re, g_im);
+
+  for (g = 0; g < st->no_groups; g++){
+    for (l = 0, n = 0; l < no_lines; l++){
+      mask[l] = (st->line_groups == NULL ? 0 : st->line_groups[l]) == g
+                && (whole || (l >= s->roi.first_line 
+                              && l < s->roi.first_line + s->roi.no_lines));
+      n += mask[l];
+    }
+    if (n == 0) continue;
+
+    for (i = 0; i < s->no_elements; i++){
+      memset(re, 0, nfft * sizeof(double));
+      memset(im, 0, nfft * sizeof(double));
+      for (h = 0; h < st->no_groups; h++){
+        hr = s->h_re + ((size_t)h * s->no_elements + i) * nfft;
+        hi = s->h_im + ((size_t)h * s->no_elements + i) * nfft;
+        gr = g_re + ((size_t)g * st->no_groups + h) * nfft;
+        gi = g_im + ((size_t)g * st->no_groups + h) * nfft;
+        for (k = 0; k < nfft; k++){
+          re[k] += hr[k]*gr[k] - hi[k]*gi[k];
+          im[k] += hr[k]*gi[k] + hi[k]*gr[k];
+        }
+      }
+      fft_run(s->plan, re, im, FFT_INVERSE);
+      rf_data[i] = rf + (size_t)i * ns;
+      memcpy(rf_data[i], re + s->kernel_length - 1, ns * sizeof(double));
+    }
+
+    bf = beamform_image_config(s->flc, s->alc, s->sys, st->start_time, rf_data,
+                               ns, (ui32)-1, NULL, &roi, &cfg);
+    if (bf == NULL) goto rs_fail_2;
+    for (l = 0; l < no_lines; l++)
+      if (mask[l]) lines[l] = bf[l];
+    free(bf);
+  }
+
+  if (st->envelope){
+    for (l = 0, n = 0; l < no_lines; l++)
+      if (lines[l] != NULL) env[n++] = lines[l];
+    if (!metric_envelope(env, n, s->no_out)) goto rs_fail_2;
+  }
+  /* The regions, relative to the beamformed samples */
+  figures.envelope = FALSE;
+  figures.signal = st->signal;
+  figures.clutter = st->clutter;
+  figures.signal.first_sample -= roi.first_sample;
+  if (figures.clutter.no_samples > 0 && figures.clutter.no_lines > 0)
+    figures.clutter.first_sample -= roi.first_sample;
+  metric_figures(lines, &figures, &m);
+  job->metrics[set_no] = metric_value(&m, st->metric);
+  if (job->images != NULL)
+    for (l = 0; l < no_lines; l++)
+      memcpy(job->images + ((size_t)set_no * no_lines + l) * s->no_out, lines[l],
+             s->no_out * sizeof(double));
+
+  for (l = 0; l < no_lines; l++) free(lines[l]);
+  free(mask);
+  free(rf_data);
+  free(u);
+  return;
+
+rs_fail_2:
+  for (l = 0; l < no_lines; l++) free(lines[l]);
+rs_fail_1:
+  free(mask);
+  free(rf_data);
+  free(u);
+  job->failed = TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : sweep_run
+ * ABSTRACT : Rate code sets, in parallel.
+ * ARGUMENTS: s - Prepared sweep
+ *            codes - Code sets, no_groups*set_size x code_length x
+ *                    no_sets, by column
+ *            no_sets - Number of code sets
+ *            metrics - Receives one value per set
+ *            images - Receives the images (no_out x no_lines per set),
+ *                     or NULL
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 sweep_run(TSweep *s, double *codes, ui32 no_sets, double *metrics,
+               double *images)
+{
+  TSweepJob job;
+
+  PFUNC
+  job.s = s;
+  job.codes = codes;
+  job.metrics = metrics;
+  job.images = images;
+  job.failed = FALSE;
+  bft_parallel_for(no_sets, run_set, &job);
+
+  if (job.failed){
+    printf("\007 sweep_run:\n");
+    printf("Error : cannot allocate memory\n");
+    return FALSE;
+  }
+  return TRUE;
+}
@@ -0,0 +1,483 @@
+/*********************************************************************
+ * NAME     : threads.c
+ * ABSTRACT : Distribution of independent items over worker threads,
+ *            and placement of the workers on the NUMA nodes.
+ *
+ *            The nodes and their processors are read from
+ *            /sys/devices/system/node once. Without it (or out of
+ *            Linux) all processors form one node and the workers are
+ *            not pinned.
+ *********************************************************************/
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "../h/threads.h"
+#include "../h/stats.h"
+#include "../h/error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#ifndef __MSCVC_
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#define HAVE_AFFINITY
+#endif
+#endif
+
+static ui32 no_threads = 0;        /* 0 - one thread per processor */
+static ui32 affinity = BFT_AFFINITY_NONE;
+static ui32 numa = 0;              /* BFT_NUMA_... flags           */
+
+
+/*
+ *  Processors available to the process, node after node
+ */
+#define MAX_CPUS   1024
+
+static struct{
+  si32 read;              /* The topology has been read                */
+  ui32 no_nodes;
+  ui32 no_cpus;
+  ui32 cpu[MAX_CPUS];     /* Processors sorted by node                 */
+  ui32 node[MAX_CPUS];    /* Node of every cpu[]                       */
+  ui32 first[BFT_MAX_NODES + 1];  /* cpu[first[n]..first[n+1]-1] on n   */
+}topo;
+
+#ifdef __GNUC__
+static __thread si32 worker_node = -1;
+#else
+static si32 worker_node = -1;
+#endif
+
+
+/*
+ *  State shared by the workers of one bft_parallel_for()
+ */
+typedef struct{
+  TBftTask task;
+  void *ctx;
+  ui32 no_items;
+  ui32 next_item;
+  ui32 no_ranges;         /* 1, or one range of items per node         */
+  ui32 next[BFT_MAX_NODES];
+  ui32 end[BFT_MAX_NODES];
+#ifndef NOTHREAD
+  pthread_mutex_t lock;
+#endif
+}TParallelFor;
+
+
+/*
+ *  One worker of a bft_parallel_for()
+ */
+typedef struct{
+  TParallelFor *pf;
+  si32 cpu;               /* Processor to run on, or -1                */
+  si32 node;              /* Its node, or -1                           */
+}TWorker;
+
+
+/*********************************************************************
+ * FUNCTION : bft_set_no_threads
+ * ABSTRACT : Set the number of worker threads. 0 means one thread 
+ *            per processor.
+ *********************************************************************/
+void bft_set_no_threads(ui32 n)
+{
+  no_threads = n;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_get_no_threads
+ * RETURNS  : The number of worker threads that will be used.
+ *********************************************************************/
+ui32 bft_get_no_threads()
+{
+  long n;
+
+  if (no_threads > 0) return no_threads;
+#ifdef NOTHREAD
+  n = 1;
+#elif defined(__MSCVC_)
+  n = pthread_num_processors_np();
+#else
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (n > 0) ? (ui32)n : 1;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_set_affinity
+ * ABSTRACT : Set the placement of the workers, BFT_AFFINITY_...
+ *********************************************************************/
+void bft_set_affinity(ui32 policy)
+{
+  affinity = policy;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_get_affinity
+ *********************************************************************/
+ui32 bft_get_affinity()
+{
+  return affinity;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_set_numa
+ * ABSTRACT : Set the BFT_NUMA_... flags. They only act when the
+ *            workers are pinned.
+ *********************************************************************/
+void bft_set_numa(ui32 flags)
+{
+  numa = flags;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_get_numa
+ *********************************************************************/
+ui32 bft_get_numa()
+{
+  return numa;
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_worker_node
+ * RETURNS  : The node of the pinned worker calling it, or -1.
+ *********************************************************************/
+si32 bft_worker_node()
+{
+  return worker_node;
+}
+
+
+#ifdef HAVE_AFFINITY
+static pthread_once_t topo_once = PTHREAD_ONCE_INIT;
+static cpu_set_t allowed;          /* Processors of the process    */
+
+
+/*********************************************************************
+ * FUNCTION : add_cpus
+ * ABSTRACT : Add the allowed processors of a list "0-3,8,10-11" to
+ *            the current node.
+ *********************************************************************/
+static void add_cpus(const char *list, ui32 node)
+{
+  char *end;
+  long lo, hi, c;
+
+  while (*list != 0 && *list != '\n'){
+    lo = hi = strtol(list, &end, 10);
+    if (end == list) return;
+    if (*end == '-') hi = strtol(end + 1, &end, 10);
+    for (c = lo; c <= hi && topo.no_cpus < MAX_CPUS; c++)
+      if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)){
+        topo.cpu[topo.no_cpus] = (ui32)c;
+        topo.node[topo.no_cpus++] = node;
+      }
+    list = (*end == ',') ? end + 1 : end;
+  }
+}
+
+
+/*********************************************************************
+ * FUNCTION : read_topology
+ * ABSTRACT : Find the nodes and their processors. Nodes without an
+ *            allowed processor are left out.
+ *********************************************************************/
+static void read_topology()
+{
+  char name[64], list[4096];
+  FILE *f;
+  ui32 n, count;
+  long c;
+
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    for (c = 0; c < CPU_SETSIZE; c++) CPU_SET(c, &allowed);
+
+  for (n = 0; n < 4096 && topo.no_nodes < BFT_MAX_NODES; n++){
+    sprintf(name, "/sys/devices/system/node/node%u/cpulist", n);
+    f = fopen(name, "r");
+    if (f == NULL){
+      if (n > 0) break;   /* Nodes are numbered from 0, gaps are rare */
+      continue;
+    }
+    count = topo.no_cpus;
+    if (fgets(list, sizeof(list), f) != NULL)
+      add_cpus(list, topo.no_nodes);
+    fclose(f);
+    if (topo.no_cpus > count)
+      topo.first[++topo.no_nodes] = topo.no_cpus;
+  }
+
+  if (topo.no_nodes == 0){
+    topo.no_cpus = 0;
+    for (c = 0; c < CPU_SETSIZE && topo.no_cpus < MAX_CPUS; c++)
+      if (CPU_ISSET(c, &allowed)){
+        topo.cpu[topo.no_cpus] = (ui32)c;
+        topo.node[topo.no_cpus++] = 0;
+      }
+    topo.no_nodes = 1;
+    topo.first[1] = topo.no_cpus;
+  }
+  topo.read = TRUE;
+}
+
+
+/*********************************************************************
+ * FUNCTION : place_worker
+ * ABSTRACT : Processor of worker 'w' (0 is the calling thread).
+ *            Compact fills node 0 first, scatter deals the workers
+ *            to the nodes in turn.
+ * RETURNS  : Index in topo.cpu[], or -1 if not pinned.
+ *********************************************************************/
+static si32 place_worker(ui32 w)
+{
+  ui32 n, size;
+
+  if (affinity == BFT_AFFINITY_NONE) return -1;
+  pthread_once(&topo_once, read_topology);
+  if (topo.no_cpus == 0) return -1;
+  if (affinity == BFT_AFFINITY_SCATTER){
+    n = w % topo.no_nodes;
+    size = topo.first[n + 1] - topo.first[n];
+    return topo.first[n] + (w / topo.no_nodes) % size;
+  }
+  return w % topo.no_cpus;
+}
+
+
+/*********************************************************************
+ * FUNCTION : pin_set
+ * ABSTRACT : The set with one processor.
+ *********************************************************************/
+static void pin_set(cpu_set_t *set, si32 k)
+{
+  CPU_ZERO(set);
+  CPU_SET(topo.cpu[k], set);
+}
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : bft_no_nodes
+ * RETURNS  : The number of NUMA nodes the process can run on.
+ *********************************************************************/
+ui32 bft_no_nodes()
+{
+#ifdef HAVE_AFFINITY
+  pthread_once(&topo_once, read_topology);
+  return topo.no_nodes;
+#else
+  return 1;
+#endif
+}
+
+
+#ifndef NOTHREAD
+/*********************************************************************
+ * FUNCTION : claim_item
+ * ABSTRACT : Take the next item, from the range of 'node' first.
+ * RETURNS  : FALSE when all the items are taken.
+ *********************************************************************/
+static si32 claim_item(TParallelFor *pf, si32 node, ui32 *item)
+{
+  ui32 k, r;
+  si32 found = FALSE;
+
+  pthread_mutex_lock(&pf->lock);
+  if (pf->no_ranges == 1){
+    *item = pf->next_item++;
+    found = (*item < pf->no_items);
+  }else{
+    if (node < 0) node = 0;
+    for (k = 0; k < pf->no_ranges && !found; k++){
+      r = (node + k) % pf->no_ranges;
+      if (pf->next[r] < pf->end[r]){
+        *item = pf->next[r]++;
+        found = TRUE;
+      }
+    }
+  }
+  pthread_mutex_unlock(&pf->lock);
+  return found;
+}
+
+
+/*********************************************************************
+ * FUNCTION : parallel_for_worker
+ * ABSTRACT : Take items one by one until all are done.
+ *********************************************************************/
+static void *parallel_for_worker(void *param)
+{
+  TWorker *w = (TWorker*)param;
+  ui32 item;
+
+  worker_node = w->node;
+  while (claim_item(w->pf, w->node, &item))
+    w->pf->task(w->pf->ctx, item);
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : split_ranges
+ * ABSTRACT : With BFT_NUMA_PARTITION, give every node a contiguous
+ *            range of items, in proportion to its workers. Items 
+ *            that are close (neighbouring lines) then share a node.
+ *********************************************************************/
+static void split_ranges(TParallelFor *pf, TWorker *w, ui32 no_workers)
+{
+  ui32 count[BFT_MAX_NODES], n, i, before = 0, no_nodes = 0;
+
+  pf->no_ranges = 1;
+  if (!(numa & BFT_NUMA_PARTITION)) return;
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < no_workers; i++)
+    if (w[i].node >= 0){
+      count[w[i].node] ++;
+      if ((ui32)w[i].node + 1 > no_nodes) no_nodes = w[i].node + 1;
+    }else
+      return;
+  if (no_nodes < 2) return;
+
+  for (n = 0; n < no_nodes; n++){
+    pf->next[n] = (ui32)((ui64)pf->no_items * before / no_workers);
+    before += count[n];
+    pf->end[n] = (ui32)((ui64)pf->no_items * before / no_workers);
+  }
+  pf->no_ranges = no_nodes;
+}
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : bft_parallel_for
+ * ABSTRACT : Call 'task' for the items 0 .. no_items-1 in parallel.
+ *            Returns when all the items are done. The calling thread
+ *            takes part in the work.
+ *********************************************************************/
+void bft_parallel_for(ui32 no_items, TBftTask task, void *ctx)
+{
+  bft_parallel_for_n(no_items, task, ctx, bft_get_no_threads());
+}
+
+
+/*********************************************************************
+ * FUNCTION : bft_parallel_for_n
+ * ABSTRACT : As bft_parallel_for(), with at most 'no_workers' threads
+ *            (0 - the number of bft_get_no_threads()). The workers 
+ *            are pinned as set by bft_set_affinity(); the calling
+ *            thread too, for the time of the loop.
+ *********************************************************************/
+void bft_parallel_for_n(ui32 no_items, TBftTask task, void *ctx,
+                        ui32 no_workers)
+{
+  TParallelFor pf;
+  ui32 i;
+#ifndef NOTHREAD
+  pthread_t *workers;
+  TWorker *w;
+  si32 caller_node;
+#ifdef HAVE_AFFINITY
+  pthread_attr_t attr;
+  cpu_set_t set, caller_set;
+  si32 k, caller_pinned = FALSE;
+#endif
+#endif
+  STATS_VAR(t)
+
+  pf.task = task;
+  pf.ctx = ctx;
+  pf.no_items = no_items;
+  pf.next_item = 0;
+  pf.no_ranges = 1;
+
+  if (no_workers == 0) no_workers = bft_get_no_threads();
+  if (no_workers > no_items) no_workers = no_items;
+
+#ifndef NOTHREAD
+  if (no_workers > 1){
+    workers = (pthread_t*)calloc(no_workers - 1, sizeof(pthread_t));
+    w = (TWorker*)calloc(no_workers, sizeof(TWorker));
+    if (workers != NULL && w != NULL){
+      for (i = 0; i < no_workers; i++){
+        w[i].pf = &pf;
+        w[i].cpu = w[i].node = -1;
+#ifdef HAVE_AFFINITY
+        if ((k = place_worker(i)) >= 0){
+          w[i].cpu = topo.cpu[k];
+          w[i].node = topo.node[k];
+        }
+#endif
+      }
+      split_ranges(&pf, w, no_workers);
+      pthread_mutex_init(&pf.lock, NULL);
+
+      STATS_START(t)
+      for (i = 1; i < no_workers; i++){
+#ifdef HAVE_AFFINITY
+        if (w[i].cpu >= 0 && !pthread_attr_init(&attr)){
+          pin_set(&set, place_worker(i));
+          pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+          k = pthread_create(workers + i - 1, &attr, parallel_for_worker, w + i);
+          pthread_attr_destroy(&attr);
+          if (k) break;
+          continue;
+        }
+#endif
+        if (pthread_create(workers + i - 1, NULL, parallel_for_worker, w + i))
+          break;
+      }
+      STATS_STOP(STAT_SPAWN, t)
+      STATS_THREADS(i)
+      no_workers = i;
+
+      /* The calling thread is worker 0 */
+      caller_node = worker_node;
+#ifdef HAVE_AFFINITY
+      if (w[0].cpu >= 0
+          && !pthread_getaffinity_np(pthread_self(), sizeof(caller_set), &caller_set)){
+        pin_set(&set, place_worker(0));
+        caller_pinned = !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      }
+      if (!caller_pinned) w[0].node = -1;
+#endif
+      parallel_for_worker(w);
+      worker_node = caller_node;
+#ifdef HAVE_AFFINITY
+      if (caller_pinned)
+        pthread_setaffinity_np(pthread_self(), sizeof(caller_set), &caller_set);
+#endif
+
+      for (i = 0; i + 1 < no_workers; i++)
+        pthread_join(workers[i], NULL);
+      pthread_mutex_destroy(&pf.lock);
+      free(workers);
+      free(w);
+      return;
+    }
+    free(workers);
+    free(w);
+  }
+#endif
+
+  STATS_THREADS(1)
+  for (i = 0; i < no_items; i++)
+    task(ctx, i);
+}
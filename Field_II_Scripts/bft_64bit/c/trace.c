@@ -0,0 +1,239 @@
+/*********************************************************************
+ * NAME     : trace.c
+ * ABSTRACT : Per-thread rings of timeline events, and their export
+ *            as Chrome trace JSON.
+ *
+ *            A ring has one writer, the thread that owns it, so the
+ *            events are written without locks. A thread takes a free
+ *            ring with an atomic exchange at its first event, and a
+ *            key destructor gives it back when the thread ends. The
+ *            rings are read by trace_dump() only while no beamforming
+ *            runs (the MEX function waits for the pipeline first).
+ *********************************************************************/
+
+#include "../h/trace.h"
+#include "../h/stats.h"
+#include "../h/error.h"
+
+#ifndef BFT_NO_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef NOTHREAD
+#include <pthread.h>
+#endif
+
+#ifdef __MSCVC_
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL __thread
+#endif
+
+
+/*
+ *  Events of one thread
+ */
+typedef struct{
+   TTraceEvent *events;    /* 'capacity' events, allocated at first use */
+   ui64 count;             /* Events written since the last clear       */
+   volatile si32 owner;    /* TRUE while a thread holds the ring        */
+}TTraceRing;
+
+static TTraceRing rings[TRACE_MAX_RINGS];
+static ui32 capacity = TRACE_DEFAULT_EVENTS;
+static volatile si32 enabled = FALSE;
+static ui64 origin = 0;               /* Time 0 of the trace            */
+static volatile ui32 next_tid = 0;
+static volatile ui32 no_dropped = 0;  /* Events without a free ring     */
+
+static THREAD_LOCAL TTraceRing *my_ring = NULL;
+static THREAD_LOCAL ui32 my_tid = 0;
+
+#ifndef NOTHREAD
+static pthread_key_t ring_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+#endif
+
+static const char *type_names[] = {"command", "beamform_image", "line",
+                                   "pipeline_job"};
+static const char *mode_names[] = {"", "times", "dynamic", "sta", "pixels"};
+
+
+#ifndef NOTHREAD
+/*********************************************************************
+ * FUNCTION : release_ring
+ * ABSTRACT : Destructor of the key. Gives the ring of an ending
+ *            thread back to the pool.
+ *********************************************************************/
+static void release_ring(void *ring)
+{
+  __sync_lock_release(&((TTraceRing*)ring)->owner);
+}
+
+
+static void create_key()
+{
+  pthread_key_create(&ring_key, release_ring);
+}
+#endif
+
+
+/*********************************************************************
+ * FUNCTION : claim_ring
+ * RETURNS  : A free ring for the calling thread, or NULL.
+ *********************************************************************/
+static TTraceRing* claim_ring()
+{
+  ui32 i;
+
+  for (i = 0; i < TRACE_MAX_RINGS; i++)
+    if (__sync_lock_test_and_set(&rings[i].owner, TRUE) == FALSE){
+#ifndef NOTHREAD
+      pthread_once(&key_once, create_key);
+      pthread_setspecific(ring_key, rings + i);
+#endif
+      return rings + i;
+    }
+  return NULL;
+}
+
+
+/*********************************************************************
+ * FUNCTION : trace_start
+ * ABSTRACT : Start tracing, keeping at most 'events_per_thread' last
+ *            events of every thread. The events of an earlier trace
+ *            are kept if the size does not change.
+ * RETURNS  : TRUE on success.
+ *********************************************************************/
+si32 trace_start(ui32 events_per_thread)
+{
+  if (events_per_thread == 0) events_per_thread = TRACE_DEFAULT_EVENTS;
+  if (events_per_thread != capacity){
+    trace_clear();
+    capacity = events_per_thread;
+  }
+  if (origin == 0) origin = stats_now();
+  enabled = TRUE;
+  return TRUE;
+}
+
+
+void trace_stop()
+{
+  enabled = FALSE;
+}
+
+
+si32 trace_enabled()
+{
+  return enabled;
+}
+
+
+/*********************************************************************
+ * FUNCTION : trace_clear
+ * ABSTRACT : Drop all events. Must not be called while beamforming.
+ *********************************************************************/
+void trace_clear()
+{
+  ui32 i;
+
+  for (i = 0; i < TRACE_MAX_RINGS; i++){
+    free(rings[i].events);
+    rings[i].events = NULL;
+    rings[i].count = 0;
+  }
+  no_dropped = 0;
+  origin = enabled ? stats_now() : 0;
+}
+
+
+/*********************************************************************
+ * FUNCTION : trace_event
+ * ABSTRACT : Record an event that began at 'begin_ns' and ends now.
+ *********************************************************************/
+void trace_event(ui32 type, ui64 begin_ns, ui32 id, ui32 mode,
+                 ui32 no_samples, ui32 no_channels)
+{
+  TTraceEvent *e;
+  ui64 end_ns = stats_now();
+
+  if (!enabled) return;
+  if (my_ring == NULL && (my_ring = claim_ring()) == NULL){
+    __sync_fetch_and_add(&no_dropped, 1);
+    return;
+  }
+  if (my_tid == 0) my_tid = __sync_add_and_fetch(&next_tid, 1);
+  if (my_ring->events == NULL){
+    my_ring->events = (TTraceEvent*)malloc(capacity * sizeof(TTraceEvent));
+    if (my_ring->events == NULL) return;
+  }
+
+  e = my_ring->events + my_ring->count % capacity;
+  e->begin_ns = begin_ns;
+  e->end_ns = end_ns;
+  e->tid = my_tid;
+  e->type = type;
+  e->id = id;
+  e->mode = mode;
+  e->no_samples = no_samples;
+  e->no_channels = no_channels;
+  my_ring->count ++;
+}
+
+
+/*********************************************************************
+ * FUNCTION : trace_dump
+ * ABSTRACT : Write the events as Chrome trace JSON. The times are in
+ *            us from the start of the trace.
+ * RETURNS  : The number of events written, or -1 on error.
+ *********************************************************************/
+si64 trace_dump(char *file_name)
+{
+  FILE *f;
+  TTraceEvent *e;
+  ui64 k, first;
+  si64 no_events = 0;
+  ui32 i;
+
+  f = fopen(file_name, "w");
+  if (f == NULL){
+    errprintf(": cannot create \"%s\"\n", file_name);
+    return -1;
+  }
+
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+             "\"args\":{\"name\":\"bft\"}}");
+  for (i = 0; i < TRACE_MAX_RINGS; i++){
+    if (rings[i].events == NULL) continue;
+    first = (rings[i].count > capacity) ? rings[i].count - capacity : 0;
+    for (k = first; k < rings[i].count; k++){
+      e = rings[i].events + k % capacity;
+      if (e->begin_ns < origin) continue;
+      fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"bft\",\"ph\":\"X\",\"pid\":1,"
+                 "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+              type_names[e->type], e->tid, (e->begin_ns - origin) * 1e-3,
+              (e->end_ns - e->begin_ns) * 1e-3);
+      if (e->type == TRACE_COMMAND)
+        fprintf(f, "\"id\":%u}}", e->id);
+      else if (e->type == TRACE_LINE)
+        fprintf(f, "\"line\":%u,\"mode\":\"%s\",\"samples\":%u,\"channels\":%u}}",
+                e->id, mode_names[e->mode], e->no_samples, e->no_channels);
+      else
+        fprintf(f, "\"lines\":%u,\"samples\":%u,\"channels\":%u}}",
+                e->id, e->no_samples, e->no_channels);
+      no_events ++;
+    }
+  }
+  fprintf(f, "\n],\"otherData\":{\"dropped\":%u}}\n", no_dropped);
+
+  if (fclose(f) != 0){
+    errprintf(": cannot write \"%s\"\n", file_name);
+    return -1;
+  }
+  return no_events;
+}
+
+#endif
@@ -113,7 +113,7 @@ si32 is_xdc_valid(TTransducer* x)
   if (xdc!= NULL && x!= NULL){
      c = xdc;
      while ((c != NULL) && (c!=x)){c = c->next;}
-     if (c == xdc) return TRUE;
+     if (c == x) return TRUE;
    }
    return FALSE;
 }
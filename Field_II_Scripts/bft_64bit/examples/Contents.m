@@ -1,6 +1,7 @@
 %Examples for Beamformation Toolbox
 %by Svetoslav Nikolov
 %   
+%FK_VS_DAS        - Compare f-k migration with delay-and-sum for plane waves.
 %PHASED_DYN_IMAGE - Create a phased-array B-mode image, using the
 %PHASED_IMAGE     - Create phased array B-mode image with BFT.
 %SYNTHETIC        - Synthetic aperture beamforming with BFT
@@ -0,0 +1,95 @@
+%FK_VS_DAS - Compare f-k migration with delay-and-sum for plane waves.
+%
+%  Plane wave recordings of a few point scatterers are synthesized
+%  with a Gaussian pulse, and reconstructed with delay-and-sum
+%  (BFT_BEAMFORM_COMPOUND, dynamic lines centered on the elements) and
+%  with f-k migration (BFT_BEAMFORM_FK). The two images are on the same
+%  grid. The script reports the position of the peak of every
+%  scatterer, the normalized RMS difference of the envelopes, and the
+%  time for both reconstructions.
+%
+%VERSION: 1.0, Oct 19, 2026
+
+f0 = 5e6;              %  Central frequency                        [Hz]
+fs = 20e6;             %  Sampling frequency                       [Hz]
+c = 1540;              %  Speed of sound                           [m/s]
+no_elements = 128;     %  Number of elements in the transducer
+pitch = c/f0/2;        %  Pitch - center-to-center                 [m]
+
+angles = (-10:2:10)*pi/180;   %  Angles of the plane waves          [rad]
+t0 = 5e-6;                    %  Time of the first sample           [s]
+no_samples = 2000;
+
+pht_pos = [0 0 15; -5 0 25; 5 0 35; 0 0 45]/1000;  %  Scatterers      [m]
+
+%  Synthesize the recordings
+
+x = ((0:no_elements-1) - (no_elements-1)/2) * pitch;
+t = t0 + (0:no_samples-1)'/fs;
+rf = zeros(no_samples, no_elements, length(angles));
+for ia = 1:length(angles)
+  for is = 1:size(pht_pos,1)
+    p = pht_pos(is,:);
+    tx = (p(1)*sin(angles(ia)) + p(3)*cos(angles(ia)))/c;
+    rx = sqrt((p(1) - x).^2 + p(3)^2)/c;
+    d = (t*ones(1,no_elements) - ones(no_samples,1)*(tx + rx)) * f0;
+    rf(:,:,ia) = rf(:,:,ia) + exp(-d.^2/1.5).*cos(2*pi*d);
+  end
+end
+
+%  Initialize the toolbox
+
+bft_init;
+bft_param('c', c);
+bft_param('fs', fs);
+xdc = bft_linear_array(no_elements, pitch);
+
+bft_no_lines(no_elements);
+for j = 1:no_elements
+  bft_center_focus([x(j) 0 0], j);
+  bft_dynamic_focus(xdc, 0, 0, j);
+end
+
+%  Reconstruct
+
+tic; das = bft_beamform_compound('plane', angles', t0, rf); t_das = toc;
+tic; fk = bft_beamform_fk(xdc, angles, t0, rf); t_fk = toc;
+
+bft_free_xdc(xdc);
+bft_end;
+
+%  Compare
+
+env_das = abs(hilbert(das)); env_das = env_das / max(env_das(:));
+env_fk = abs(hilbert(fk));   env_fk = env_fk / max(env_fk(:));
+
+z = (floor(t0*fs) + (0:no_samples-1)') * c/fs/2;
+
+fprintf('Delay-and-sum : %6.3f s\n', t_das);
+fprintf('f-k migration : %6.3f s\n', t_fk);
+fprintf('\n   Scatterer [mm]       DAS peak [mm]      f-k peak [mm]\n');
+for is = 1:size(pht_pos,1)
+  [dummy, ix] = min(abs(x - pht_pos(is,1)));
+  lines = max(1,ix-5):min(no_elements,ix+5);
+  [dummy, iz] = min(abs(z - pht_pos(is,3)));
+  rows = max(1,iz-40):min(no_samples,iz+40);
+  [m, k] = max(reshape(env_das(rows,lines),[],1));
+  [r1, l1] = ind2sub([length(rows) length(lines)], k);
+  [m, k] = max(reshape(env_fk(rows,lines),[],1));
+  [r2, l2] = ind2sub([length(rows) length(lines)], k);
+  fprintf('  (%5.1f, %5.1f)    (%5.2f, %5.2f)    (%5.2f, %5.2f)\n', ...
+          pht_pos(is,1)*1000, pht_pos(is,3)*1000, ...
+          x(lines(l1))*1000, z(rows(r1))*1000, ...
+          x(lines(l2))*1000, z(rows(r2))*1000);
+end
+fprintf('\nNormalized RMS difference of the envelopes: %5.1f dB\n', ...
+        20*log10(norm(env_das(:) - env_fk(:))/norm(env_das(:))));
+
+figure;
+subplot(1,2,1);
+imagesc(x*1000, z*1000, 20*log10(env_das+eps), [-50 0]);
+title('Delay-and-sum'); xlabel('x [mm]'); ylabel('z [mm]'); axis image;
+subplot(1,2,2);
+imagesc(x*1000, z*1000, 20*log10(env_fk+eps), [-50 0]);
+title('f-k migration'); xlabel('x [mm]'); axis image;
+colormap(gray);
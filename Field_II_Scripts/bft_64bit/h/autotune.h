@@ -0,0 +1,59 @@
+#ifndef __autotune_h
+  #define __autotune_h
+/*********************************************************************
+ * NAME     : autotune.h
+ * ABSTRACT : Choice of the number of threads and of the lines per
+ *            task of beamform_image() for a geometry. The candidates
+ *            are timed on the current focusing and apodization, and
+ *            the fastest is kept in a table keyed by a hash of the
+ *            geometry. The table is stored in a text file, which is
+ *            read at the first beamforming, so that later sessions
+ *            use the tuned settings too.
+ *
+ *            The hash covers the sizes and the modes of the lines,
+ *            the number of elements, the number of samples and the
+ *            system parameters, but not the focal points themselves.
+ *********************************************************************/
+
+#include "beamform.h"
+
+#define TUNE_MAX_CANDIDATES  64
+#define TUNE_DEFAULT_FILE    ".bft_autotune"   /* In the home directory */
+
+
+/*
+ *  Outcome of autotune_run()
+ */
+typedef struct{
+   ui64 hash;              /* Key of the geometry                       */
+   TBeamformConfig best;
+   double best_time;       /* Seconds per image                         */
+   ui32 no_tried;
+   TBeamformConfig tried[TUNE_MAX_CANDIDATES];
+   double time[TUNE_MAX_CANDIDATES];
+}TTuneResult;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+ui64 autotune_hash(TFocusLineCollection *flc, TApoLineCollection *alc,
+                   TSysParams *sys, ui32 no_samples, si32 sta);
+void autotune_config(TFocusLineCollection *flc, TApoLineCollection *alc,
+                     TSysParams *sys, ui32 no_samples, si32 sta,
+                     TBeamformConfig *cfg);
+si32 autotune_run(TFocusLineCollection *flc, TApoLineCollection *alc,
+                  TSysParams *sys, double time, double **rf_data,
+                  ui32 no_samples, ui32 element_no, TPoint3D *xmt,
+                  ui32 repeats, TTuneResult *res);
+
+void autotune_enable(si32 on);
+si32 autotune_set_file(char *file_name);
+void autotune_clear();
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -14,6 +14,20 @@
   extern"C"{
 #endif
 
+/*
+ *  Output samples of one line: 'count' samples, from the full rate
+ *  sample 'first' in steps of 'step'. With a filter, every output is
+ *  the sum of 'no_taps' full rate samples around it, weighted by 'taps'
+ */
+typedef struct{
+  ui32 first;
+  ui32 count;
+  ui32 step;
+  double *taps;           /* Anti-alias filter, or NULL                */
+  ui32 no_taps;
+} TLineWindow;
+
+
 typedef struct {
   TFocusLineCollection *flc;
   TApoLineCollection* alc;
@@ -21,22 +35,89 @@ typedef struct {
   double time;
   double **rf_data;
   ui32 no_samples;
+  TLineWindow *window;    /* Output samples to beamform                */
   TPoint3D* elem;
   double** line;
   ui32 i;
 } BFT_ThreadData;
 
 
+/*
+ *  How the lines of an image are shared by the threads
+ */
+typedef struct{
+  ui32 no_threads;        /* 0 - as bft_get_no_threads()               */
+  ui32 lines_per_task;    /* Lines taken by a thread at a time         */
+} TBeamformConfig;
+
+
+/*
+ *  Part of an image to beamform. The output has only these samples of
+ *  the selected lines
+ */
+typedef struct{
+  ui32 first_sample;      /* First output sample (pixel) from 0         */
+  ui32 no_samples;        /* Samples per line, 0 - to the end           */
+  ui8 *lines;             /* Non-zero for the lines to beamform, one    */
+                          /*   per line, or NULL - all lines            */
+  ui32 decimation;        /* Keep every decimation-th sample, 0 or 1 -  */
+                          /*   all of them                              */
+  double *taps;           /* Low-pass applied before the decimation, or */
+  ui32 no_taps;           /*   NULL. Centered on the kept samples       */
+} TBeamformROI;
+
+
 double* beamform_apo_line_dynamic(TFocusTimeLine *ftl, TApoTimeLine* atl,
         TSysParams* sys, double time,  double **rf_data, ui32 no_samples);
 
+ui32 beamform_no_out(TFocusLineCollection *flc, ui32 no_samples);
+
+si32 beamform_is_element(TFocusLineCollection *flc, ui32 element_no);
+
+ui32 beamform_roi_samples(TFocusLineCollection *flc, ui32 no_samples,
+   TBeamformROI *roi);
+
 double** beamform_image(TFocusLineCollection *flc, TApoLineCollection* alc,
    TSysParams* sys, double time, double **rf_data, ui32 no_samples, ui32 element_no, TPoint3D* xmt);
 
+double** beamform_image_roi(TFocusLineCollection *flc, TApoLineCollection* alc,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples, ui32 element_no,
+   TPoint3D* xmt, TBeamformROI *roi);
+
+double** beamform_image_config(TFocusLineCollection *flc, TApoLineCollection* alc,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples, ui32 element_no,
+   TPoint3D* xmt, TBeamformROI *roi, TBeamformConfig *cfg);
+
 double* beamform_apo_line_times(TFocusTimeLine *ftl, TApoTimeLine* atl,
                             TSysParams* sys, double time, 
                             double **rf_data, ui32 no_samples);
 
+/*
+ *  The kernels for a window of output samples
+ */
+double* beamform_line_times_window(TFocusTimeLine *ftl, TSysParams* sys,
+   double time, double **rf_data, ui32 no_samples, TLineWindow *w);
+double* beamform_apo_line_times_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+   TLineWindow *w);
+double* beamform_line_dynamic_window(TFocusTimeLine *ftl, TSysParams* sys,
+   double time, double **rf_data, ui32 no_samples, TLineWindow *w);
+double* beamform_apo_line_dynamic_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+   TLineWindow *w);
+double* beamform_line_dynamic_sta_window(TFocusTimeLine *ftl, TSysParams* sys,
+   double time, double **rf_data, ui32 no_samples, TPoint3D* xmt,
+   TLineWindow *w);
+double* beamform_apo_line_dynamic_sta_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+   TPoint3D *xmt, TLineWindow *w);
+double* beamform_line_pixels_window(TFocusTimeLine *ftl, TSysParams* sys,
+   double time, double **rf_data, ui32 no_samples, ui32 element_no,
+   TLineWindow *w);
+double* beamform_apo_line_pixels_window(TFocusTimeLine *ftl, TApoTimeLine* atl,
+   TSysParams* sys, double time, double **rf_data, ui32 no_samples,
+   ui32 element_no, TLineWindow *w);
+
 double** apodize_fix(TApoTimeLine *atl, double **rf_data,
                                      ui32 no_samples, ui32 no_channels);
 
@@ -0,0 +1,96 @@
+#ifndef __codedb_h
+  #define __codedb_h
+/*********************************************************************
+ * NAME     : codedb.h
+ * ABSTRACT : On-disk database of complementary pairs. The file is
+ *            memory mapped, and the pairs are found through an index
+ *            sorted by length, family, largest cross-correlation and
+ *            sidelobe level, so that a query is a binary search.
+ *
+ *            Layout (little endian, offsets in bytes from the
+ *            beginning of the file):
+ *
+ *              TCodeDBHeader
+ *              index  - no_records x TCodeDBEntry, sorted
+ *              codes  - 2 x length doubles per pair (first code, then
+ *                       second code), in the order of the index
+ *
+ *            The correlations are normalized to the main lobe of the
+ *            summed ACF of the pair, so that pairs of any amplitude
+ *            can be compared.
+ *********************************************************************/
+
+#include "types.h"
+
+#define CODE_DB_MAGIC     "BFTCDB\0\0"
+#define CODE_DB_VERSION   1
+
+#define CODE_FAMILY_ANY        0   /* All families (queries only)       */
+#define CODE_FAMILY_GOLAY      1   /* Binary Golay pairs of length      */
+                                   /*   2^a 10^b 26^c (Turyn products)  */
+#define CODE_FAMILY_RECURSIVE  2   /* Multilevel pairs as genCompPair   */
+                                   /*   with shifts of 1                */
+#define CODE_DB_NO_FAMILIES    2
+
+
+/*
+ *  Header of the file
+ */
+typedef struct{
+   char   magic[8];         /* CODE_DB_MAGIC                             */
+   ui32   version;          /* CODE_DB_VERSION                           */
+   ui32   header_size;      /* sizeof(TCodeDBHeader)                     */
+   ui32   no_records;       /* Number of pairs                           */
+   ui32   reserved;
+   ui64   index_offset;
+   ui64   data_offset;
+}TCodeDBHeader;
+
+
+/*
+ *  One entry of the index
+ */
+typedef struct{
+   ui32   length;           /* Chips per code                            */
+   ui32   family;           /* CODE_FAMILY_...                           */
+   double max_ccf;          /* Largest |CCF| of the two codes            */
+   double sidelobe;         /* Largest |summed ACF| off the main lobe    */
+   ui64   offset;           /* Offset of the codes                       */
+}TCodeDBEntry;
+
+
+/*
+ *  An opened (mapped) database
+ */
+typedef struct code_db{
+   int    fd;               /* File descriptor                           */
+   ui8   *base;             /* Start of the mapping                      */
+   ui64   size;             /* Size of the mapping                       */
+   TCodeDBHeader *hdr;      /* Points into the mapping                   */
+   TCodeDBEntry *index;
+   struct code_db *next;
+}TCodeDB;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 code_db_create(const char *file_name, ui32 *lengths, ui32 no_lengths,
+                    ui32 families, ui32 no_per_length, ui64 seed,
+                    ui32 *no_records);
+TCodeDB* code_db_open(const char *file_name);
+void code_db_close(TCodeDB *db);
+void code_db_close_all();
+si32 is_code_db_valid(TCodeDB *db);
+ui32 code_db_range(TCodeDB *db, ui32 length, ui32 family, double ccf_limit,
+                   ui32 *first);
+ui32 code_db_query(TCodeDB *db, ui32 length, ui32 family, double ccf_limit,
+                   double sidelobe_limit, ui32 no_wanted, ui32 *found);
+double* code_db_codes(TCodeDB *db, ui32 record_no);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
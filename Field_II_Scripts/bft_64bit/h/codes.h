@@ -0,0 +1,63 @@
+#ifndef __codes_h
+  #define __codes_h
+/*********************************************************************
+ * NAME     : codes.h
+ * ABSTRACT : Correlation of binary (+1/-1) transmit codes. The codes
+ *            are stored as bit vectors, one bit per chip, and the
+ *            aperiodic correlations are found with XOR and population
+ *            count.
+ *
+ *            A code set holds no_sets groups of set_size codes. The
+ *            codes of one group are sent in set_size transmit events
+ *            (e.g. the two codes of a complementary pair), and the
+ *            groups are sent in parallel.
+ *********************************************************************/
+
+#include "types.h"
+
+/*
+ *  Codes packed as bits. A set bit is a chip of -1.
+ */
+typedef struct{
+   ui32 no_codes;          /* Number of codes                           */
+   ui32 length;            /* Number of chips in every code             */
+   ui32 no_words;          /* 64 bit words per code                     */
+   ui64 *bits;             /* no_codes x no_words. Unused bits are 0    */
+}TCodeSet;
+
+
+/*
+ *  Figures of merit of a code set. The correlations are not normalized.
+ */
+typedef struct{
+   double acf_sidelobe;    /* Largest |sum of the ACFs of a group| off  */
+                           /*   the main lobe (sumACF)                  */
+   double max_ccf;         /* Largest |sum of the CCFs of the codes of  */
+                           /*   two groups, event by event| (maxXcorr)  */
+   double max_all_ccf;     /* Largest |CCF| of any two codes            */
+                           /*   (maxAllXCorr)                           */
+   double max_self_ccf;    /* Largest |CCF| of two codes of the same    */
+                           /*   group (maxSelfCCFun)                    */
+   double welch_ratio;     /* max(acf_sidelobe, max_ccf) with unit      */
+                           /*   energy per group, over the Welch bound. */
+                           /*   -1 if the bound is not positive         */
+}TCodeMetrics;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+TCodeSet* code_pack(double *codes, ui32 no_codes, ui32 length);
+void code_free(TCodeSet *s);
+void code_xcorr(TCodeSet *s, ui32 i, ui32 j, si32 *c);
+double code_welch_bound(ui32 length, ui32 no_parallel, ui32 no_events);
+si32 code_metrics(TCodeSet *s, ui32 set_size, TCodeMetrics *m, si32 *sum_acf);
+si32 code_metrics_n(TCodeSet *s, ui32 set_size, TCodeMetrics *m,
+                    si32 *sum_acf, ui32 no_threads);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
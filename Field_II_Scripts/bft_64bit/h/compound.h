@@ -0,0 +1,45 @@
+#ifndef __compound_h
+  #define __compound_h
+/*********************************************************************
+ * NAME     : compound.h
+ * ABSTRACT : Coherent compounding of unfocused transmits. Every 
+ *            transmitted wave is either a plane wave, or a diverging
+ *            wave from a virtual source behind the transducer. The
+ *            images beamformed for all the waves are summed.
+ *
+ *            Time zero of a wave is when it passes the origin of the
+ *            coordinate system.
+ *********************************************************************/
+
+#include "beamform.h"
+
+#define XMT_PLANE       1
+#define XMT_DIVERGING   2
+
+
+/*
+ *  One transmitted wave
+ */
+typedef struct{
+   ui32 type;              /* XMT_PLANE or XMT_DIVERGING                 */
+   double dir_xz;          /* Direction of a plane wave, as for the      */
+   double dir_yz;          /* dynamic focusing                  [rad]    */
+   TPoint3D source;        /* Virtual source of a diverging wave [m]     */
+   double time;            /* Time of the first recorded sample  [s]     */
+}TTransmitWave;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+double* beamform_compound(TFocusLineCollection *flc, TApoLineCollection *alc,
+                          TSysParams *sys, TTransmitWave *waves, ui32 no_waves,
+                          double *rf, ui32 no_samples, ui32 no_channels,
+                          double *image);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __ensemble_h
+  #define __ensemble_h
+/*********************************************************************
+ * NAME     : ensemble.h
+ * ABSTRACT : Beamforming of a slow-time ensemble. A number of frames
+ *            recorded with the same geometry (e.g. for flow estimation)
+ *            are beamformed in one pass. The delays are calculated once
+ *            per output sample and channel and are applied to all the
+ *            frames.
+ *********************************************************************/
+
+#include "beamform.h"
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+double* beamform_ensemble(TFocusLineCollection *flc, TApoLineCollection *alc,
+                          TSysParams *sys, double time, double *rf,
+                          ui32 no_samples, ui32 no_channels, ui32 no_frames,
+                          ui32 element_no, TPoint3D *xmt, double *ens);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
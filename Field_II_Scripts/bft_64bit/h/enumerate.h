@@ -0,0 +1,63 @@
+#ifndef __enumerate_h
+  #define __enumerate_h
+/*********************************************************************
+ * NAME     : enumerate.h
+ * ABSTRACT : Exhaustive search for short binary code sets whose
+ *            correlations are all within given limits. The groups of
+ *            codes are as in codes.h. The limits are on
+ *
+ *              - the summed ACF of every group, off the main lobe,
+ *              - the summed CCF of every two groups,
+ *              - the CCF of every two codes.
+ *
+ *            Sets that only differ by the negation of groups, by
+ *            reversal or by alternation (multiplying chip i by (-1)^i)
+ *            have the same correlation magnitudes, and only one of
+ *            them is returned.
+ *********************************************************************/
+
+#include "types.h"
+
+#define ENUM_MAX_LENGTH  32    /* Longest code                         */
+#define ENUM_MAX_CODES   16    /* Most codes in a set                  */
+
+
+/*
+ *  Settings of an enumeration. A negative limit is no limit.
+ */
+typedef struct{
+   ui32 no_codes;          /* Codes per set                             */
+   ui32 length;            /* Chips per code                            */
+   ui32 set_size;          /* Codes per group                           */
+   si32 acf_limit;         /* Largest |summed ACF| off the main lobe    */
+   si32 ccf_limit;         /* Largest |summed CCF| of two groups        */
+   si32 all_limit;         /* Largest |CCF| of two codes                */
+   ui32 max_solutions;     /* Most sets kept. All are counted           */
+   const char *checkpoint; /* File for checkpoint and resume, or NULL   */
+   ui32 checkpoint_interval; /* Seconds between checkpoints             */
+}TEnumParams;
+
+
+/*
+ *  Result of an enumeration
+ */
+typedef struct{
+   ui64 no_solutions;      /* Number of sets found                      */
+   ui64 no_nodes;          /* Number of visited nodes of the tree       */
+   ui32 no_stored;         /* Number of sets kept                       */
+   si8 *solutions;         /* no_stored x no_codes x length chips       */
+}TEnumResult;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 enumerate_sets(TEnumParams *p, TEnumResult *r);
+void enumerate_free_result(TEnumResult *r);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
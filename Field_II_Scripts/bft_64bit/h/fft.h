@@ -0,0 +1,43 @@
+#ifndef __fft_h
+  #define __fft_h
+/*********************************************************************
+ * NAME     : fft.h
+ * ABSTRACT : Radix-2 complex FFT. The real and imaginary parts are
+ *            kept in separate arrays, as in MATLAB.
+ *********************************************************************/
+
+#include "types.h"
+
+#define FFT_FORWARD   -1
+#define FFT_INVERSE    1
+
+
+/*
+ *  Precomputed tables for one length
+ */
+typedef struct{
+   ui32 n;                 /* Length of the transform. A power of 2     */
+   ui32 *bitrev;           /* Bit reversed index of every sample        */
+   double *cos_tab;        /* cos(2*pi*k/n), k = 0 .. n/2-1             */
+   double *sin_tab;        /* sin(2*pi*k/n), k = 0 .. n/2-1             */
+}TFftPlan;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+ui32 fft_next_pow2(ui32 n);
+
+TFftPlan* fft_plan(ui32 n);
+void fft_free_plan(TFftPlan *plan);
+
+void fft_run(TFftPlan *plan, double *re, double *im, si32 direction);
+void fft_many(TFftPlan *plan, double *re, double *im, ui32 no_transforms,
+              ui32 dist, ui32 stride, si32 direction);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __fk_h
+  #define __fk_h
+/*********************************************************************
+ * NAME     : fk.h
+ * ABSTRACT : Fourier domain (f-k, Stolt) migration of plane wave
+ *            recordings made with a linear array. A fast alternative
+ *            to the delay-and-sum beamforming of beamform_compound().
+ *********************************************************************/
+
+#include "types.h"
+#include "sys_params.h"
+#include "transducer.h"
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+double* fk_migrate(TTransducer *xdc, TSysParams *sys, double *angles,
+                   double *times, ui32 no_angles, double *rf,
+                   ui32 no_samples, double *image);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __flow_h
+  #define __flow_h
+/*********************************************************************
+ * NAME     : flow.h
+ * ABSTRACT : Color flow estimation with the lag-one autocorrelation
+ *            (Kasai) estimator. The input is a beamformed IQ ensemble,
+ *            no_depth x no_lines x no_frames, as produced by 
+ *            beamform_ensemble().
+ *********************************************************************/
+
+#include "types.h"
+
+/*
+ *  Settings of the estimator
+ */
+typedef struct{
+   si32 wall_order;        /* Order of the regression wall filter. -1 is */
+                           /* no filter, 0 removes the mean              */
+   ui32 kernel_z;          /* Averaging kernel in depth [samples]        */
+   ui32 kernel_x;          /* Averaging kernel across the lines [lines]  */
+   double prf;             /* Pulse repetition frequency  [Hz]           */
+   double f0;              /* Center frequency            [Hz]           */
+   double c;               /* Speed of sound              [m/s]          */
+}TFlowParams;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 flow_estimate(TFlowParams *fp, double *iq_re, double *iq_im,
+                   ui32 no_depth, ui32 no_lines, ui32 no_frames,
+                   double *v, double *var, double *power);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
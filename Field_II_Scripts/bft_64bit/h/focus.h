@@ -10,9 +10,15 @@
 
 #include "transducer.h" 
 #include "sys_params.h"
+#include <float.h>
 
 
-#define MAX_SAMPLE_NO   65365
+/*
+ *  Start time of the zero delay and apodization after the last zone.
+ *  It must lie past any sample of any line, so that the kernels never
+ *  walk beyond it.
+ */
+#define MAX_SAMPLE_NO   DBL_MAX
 
 /*
  *  Definition of focus delay
@@ -67,9 +73,24 @@ typedef struct focus_time_line{
    double dir_yz;          /* Direction in YZ                               */
    TTransducer* xdc;       /* Used in the dynamic focusing                  */
    TDelay *delay;          /* Array of delays. One entry per focal zone     */
+   TPoint3D *zones;        /* Focal points of set_focus(), whose delays are */
+                           /*   computed by focus_prepare(), or NULL       */
+   double ways;            /* 1 (set_focus) or 2 (set_focus_2way)           */
+   TSysParams zone_sys;    /* System parameters at the setting              */
+   TPoint3D zone_center;   /* Center of the focus at the setting            */
+   TPoint3D *zone_elements;/* Element positions at the setting, in 'zones'  */
 }TFocusTimeLine;
 
 
+/*
+ *  The delays of the lines set by set_focus() and set_focus_2way() are
+ *  computed at the first beamforming that needs them, and only for the
+ *  zones that the beamformed samples fall in. The kernels that use the
+ *  delays call focus_prepare() first. A zone is computed once and
+ *  kept, its 'd' is NULL until then. The delays are those of the 
+ *  center, the elements and the system parameters at the setting.
+ */
+
 /*
  *  Collection of focus time-lines makes one whole image
  */
@@ -103,6 +124,33 @@ typedef struct{
 
 
 
+/*
+ *  One property of all the lines, for set_lines()
+ */
+#define SETUP_CENTER       0   /* Centers of the focus, 'points'          */
+#define SETUP_DYNAMIC      1   /* Dynamic focus, 'dir_xz' and 'dir_yz'    */
+#define SETUP_FOCUS        2   /* Focal points, 'times' and 'points'      */
+#define SETUP_FOCUS_2WAY   3   /* The same, with two-way delays           */
+#define SETUP_FOCUS_TIMES  4   /* Delays, 'times' and 'values'            */
+#define SETUP_PIXELS       5   /* Pixels, 'points'                        */
+#define SETUP_APODIZATION  6   /* Apodization, 'times' and 'values'       */
+
+typedef struct{
+   ui32 kind;              /* SETUP_...                                    */
+   ui32 no_lines;
+   TTransducer *xdc;       /* Not used by SETUP_CENTER                     */
+   ui32 no_times;          /* Focal zones, pixels or apodizations per line */
+   double *times;          /* no_times per line                       [s]  */
+   ui32 times_stride;      /* no_times, or 0 if all lines have the same    */
+   TPoint3D *points;       /* One center, or no_times points per line      */
+   double *values;         /* no_elements x no_times per line, delays [s]  */
+                           /*   or apodizations                            */
+   double *dir_xz;         /* Directions per line                          */
+   double *dir_yz;
+   ui32 dir_stride;        /* 1, or 0 if all lines have the same           */
+}TLineSetup;
+
+
 /**********************************************************************
  *                                                                    *
  *       Here follow the definitions of the exported functions        *
@@ -152,6 +200,11 @@ void set_apodization(TApoLineCollection *alc, TSysParams* sys,
 
 
 
+void focus_prepare(TFocusTimeLine *ftl, TSysParams *sys, double time,
+                   ui32 no_samples);
+void focus_prepare_zones(TFocusTimeLine *ftl, ui32 first, ui32 o_last);
+si32 set_lines(TFocusLineCollection *flc, TApoLineCollection *alc,
+               TSysParams *sys, TLineSetup *setup);
 void set_filter_bank( TFocusLineCollection *flc, ui32 Nf, ui32 Ntaps, 
                                                          double *coef);
                      
@@ -0,0 +1,27 @@
+#ifndef __matfile_h
+  #define __matfile_h
+/*********************************************************************
+ * NAME     : matfile.h
+ * ABSTRACT : Minimal writer of Matlab MAT files (level 5, without
+ *            compression). Only real double matrices are written, so
+ *            that results can be stored from worker threads without
+ *            going through Matlab.
+ *********************************************************************/
+
+#include "types.h"
+#include <stdio.h>
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+FILE* mat_create(const char *file_name);
+si32 mat_write_matrix(FILE *f, const char *name, ui32 no_rows, ui32 no_cols,
+                      double *data);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __metrics_h
+  #define __metrics_h
+/*********************************************************************
+ * NAME     : metrics.h
+ * ABSTRACT : Image quality figures computed on beamformed images.
+ *            An image is given as its lines, as returned by
+ *            beamform_image(): no_lines pointers to no_samples values.
+ *
+ *            The point spread function is measured around the peak of
+ *            abs(image) in the signal region, and only inside it:
+ *            the full widths at half maximum along the line and across
+ *            the lines, and the peak and integrated sidelobe levels
+ *            outside the main lobe. The main lobe is the rectangle
+ *            between the first minima on both sides of the peak, along
+ *            and across the lines. The widths are meaningful on the
+ *            envelope.
+ *********************************************************************/
+
+#include "types.h"
+
+
+/*
+ *  A rectangle of an image, in samples and lines (from 0)
+ */
+typedef struct{
+   ui32 first_sample;
+   ui32 no_samples;
+   ui32 first_line;
+   ui32 no_lines;
+}TImageRegion;
+
+
+/*
+ *  Figures to compute
+ */
+typedef struct{
+   si32 envelope;          /* TRUE: use the envelope of the lines       */
+   TImageRegion signal;    /* Region with the point target              */
+   TImageRegion clutter;   /* Region for max_to_avg, or no_samples = 0  */
+}TMetricSetup;
+
+
+/*
+ *  Figures of one image
+ */
+typedef struct{
+   double peak;            /* Largest abs value in the signal region    */
+   ui32 peak_sample;       /* Its position in the image                 */
+   ui32 peak_line;
+   double axial_fwhm;      /* Widths at half the peak        [samples]  */
+   double lateral_fwhm;    /*                                  [lines]  */
+   double psl;             /* Peak sidelobe over the peak         [dB]  */
+   double isl;             /* Sidelobe energy over main lobe energy[dB] */
+   double max_to_avg;      /* max(signal) / mean(clutter), or 0         */
+}TImageMetrics;
+
+#define METRIC_MAX_TO_AVG     1
+#define METRIC_AXIAL_FWHM     2
+#define METRIC_LATERAL_FWHM   3
+#define METRIC_PSL            4
+#define METRIC_ISL            5
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 metric_envelope(double **lines, ui32 no_lines, ui32 no_samples);
+si32 metric_region_valid(TImageRegion *r, ui32 no_lines, ui32 no_samples);
+double metric_max_to_avg(double **lines, TImageRegion *signal,
+                         TImageRegion *clutter);
+void metric_figures(double **lines, TMetricSetup *setup, TImageMetrics *m);
+double metric_value(TImageMetrics *m, ui32 which);
+si32 metric_frames(double ***frames, ui32 no_frames, ui32 no_lines,
+                   ui32 no_samples, TMetricSetup *setup, TImageMetrics *m);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -10,6 +10,24 @@
 #include "beamform.h"
 #include "focus.h"
 #include "transducer.h"
+#include "rf_file.h"
+#include "pipeline.h"
+#include "ensemble.h"
+#include "threads.h"
+#include "flow.h"
+#include "compound.h"
+#include "fk.h"
+#include "simulate.h"
+#include "codes.h"
+#include "search.h"
+#include "multistart.h"
+#include "enumerate.h"
+#include "codedb.h"
+#include "sweep.h"
+#include "stats.h"
+#include "trace.h"
+#include "perfctr.h"
+#include "autotune.h"
 
 #include <math.h>
 
@@ -35,5 +53,33 @@
 #define BFT_DELAY            19
 #define BFT_DELAY_FILTER     20
 #define BFT_XDC_SET          21
+#define BFT_RF_OPEN          22
+#define BFT_RF_CLOSE         23
+#define BFT_RF_INFO          24
+#define BFT_RF_BEAMFORM      25
+#define BFT_SUBMIT           26
+#define BFT_COLLECT          27
+#define BFT_BEAMFORM_ENSEMBLE 28
+#define BFT_FLOW             29
+#define BFT_BEAMFORM_COMPOUND 30
+#define BFT_BEAMFORM_FK      31
+#define BFT_CALC_SCAT        32
+#define BFT_SCAT_GRID        33
+#define BFT_FREE_SCAT_GRID   34
+#define BFT_CODE_CORR        35
+#define BFT_CODE_SEARCH      36
+#define BFT_CODE_MULTISTART  37
+#define BFT_CODE_ENUMERATE   38
+#define BFT_CODE_DB_CREATE   39
+#define BFT_CODE_DB_OPEN     40
+#define BFT_CODE_DB_CLOSE    41
+#define BFT_CODE_DB_QUERY    42
+#define BFT_SWEEP            43
+#define BFT_METRICS          44
+#define BFT_STREAM_METRICS   45
+#define BFT_STATS            46
+#define BFT_TRACE            47
+#define BFT_AUTOTUNE         48
+#define BFT_SETUP_LINES      49
 
 #endif
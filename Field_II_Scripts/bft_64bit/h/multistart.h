@@ -0,0 +1,60 @@
+#ifndef __multistart_h
+  #define __multistart_h
+/*********************************************************************
+ * NAME     : multistart.h
+ * ABSTRACT : Many independent searches for binary code sets, started
+ *            from random codes and run on all threads. The goal is the
+ *            lowest summed ACF sidelobe, subject to a limit on the
+ *            summed cross-correlation of two groups (as with
+ *            ACFSumFuncConst.m and maxXcorr.m in the optimizers).
+ *
+ *            The best result so far is shared by all searches. A
+ *            search that is far behind it after a stage is abandoned,
+ *            and every new best result is written to a MAT file.
+ *********************************************************************/
+
+#include "search.h"
+#include "codes.h"
+
+
+/*
+ *  Settings of a multi-start search
+ */
+typedef struct{
+   ui32 no_codes;          /* Codes per set                             */
+   ui32 length;            /* Chips per code                            */
+   ui32 set_size;          /* Codes per group                           */
+   ui32 no_restarts;       /* Number of searches                        */
+   ui32 no_stages;         /* Checks against the best result per search */
+   TSearchParams search;   /* max_iter is per search. seed is the base  */
+   double ccf_limit;       /* Largest allowed max_ccf. < 0: no limit    */
+   double prune_ratio;     /* Abandon a search when its sidelobe is     */
+                           /*   above prune_ratio x the best sidelobe   */
+   const char *prefix;     /* Results are written to <prefix><sidelobe> */
+                           /*   _<ccf>.mat as 'x'. NULL: not written    */
+}TMultiStart;
+
+
+/*
+ *  Result of a multi-start search
+ */
+typedef struct{
+   double *codes;          /* Best codes, no_codes x length, by column  */
+   TCodeMetrics metrics;   /* Their figures of merit                    */
+   si32 found;             /* TRUE if any search met the ccf_limit      */
+   ui32 no_feasible;       /* Searches that met the ccf_limit           */
+   ui32 no_pruned;         /* Searches abandoned                        */
+}TMultiStartResult;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 multistart_run(TMultiStart *ms, TMultiStartResult *res);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
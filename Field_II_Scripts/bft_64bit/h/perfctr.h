@@ -0,0 +1,96 @@
+#ifndef __perfctr_h
+  #define __perfctr_h
+/*********************************************************************
+ * NAME     : perfctr.h
+ * ABSTRACT : Hardware performance counters (Linux perf_event_open)
+ *            around beamform_image() and around every line kernel.
+ *            The counts are summed per focusing mode, to tell if a
+ *            kernel is bound by the gathers, the arithmetic or the
+ *            memory.
+ *
+ *            The counters of a line are opened in the thread of the
+ *            line. Those of an image are opened in the calling thread
+ *            and inherited by the line threads. The memory traffic is
+ *            estimated as one cache line per last level cache miss.
+ *
+ *            Collection is off until perf_enable(). Counters that the
+ *            system does not allow (see perf_event_paranoid) are not
+ *            reported. Removed with BFT_NO_STATS, and empty outside
+ *            Linux.
+ *********************************************************************/
+
+#include "types.h"
+
+#define PERF_CYCLES           0
+#define PERF_INSTRUCTIONS     1
+#define PERF_L1D_MISSES       2
+#define PERF_LLC_MISSES       3
+#define PERF_NO_EVENTS        4
+
+#define PERF_IMAGE            0    /* Bucket of beamform_image()        */
+#define PERF_NO_BUCKETS       5    /* And one per TRACE_MODE_...        */
+
+#define PERF_CACHE_LINE       64   /* Bytes per last level cache miss   */
+
+
+/*
+ *  Sums of one bucket
+ */
+typedef struct{
+   ui64 calls;
+   ui64 time_ns;
+   ui64 value[PERF_NO_EVENTS];
+}TPerfCounters;
+
+
+/*
+ *  All the buckets since the last perf_reset()
+ */
+typedef struct{
+   TPerfCounters bucket[PERF_NO_BUCKETS];
+   ui32 available;         /* Bit i set if event i could be counted     */
+}TPerfStats;
+
+
+/*
+ *  Counters open around one piece of work
+ */
+typedef struct{
+   si32 fd[PERF_NO_EVENTS];
+   ui64 start_ns;
+   si32 active;
+}TPerfSet;
+
+
+#ifndef BFT_NO_STATS
+
+#define PERF_VAR(p)              TPerfSet p;
+#define PERF_BEGIN(p, inherit)   perf_begin(&(p), inherit);
+#define PERF_END(p, bucket)      perf_end(&(p), bucket);
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+void perf_enable(si32 on);
+si32 perf_enabled();
+void perf_reset();
+void perf_get(TPerfStats *s);
+void perf_begin(TPerfSet *p, si32 inherit);
+void perf_end(TPerfSet *p, ui32 bucket);
+const char* perf_event_name(ui32 event);
+const char* perf_bucket_name(ui32 bucket);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#else
+
+#define PERF_VAR(p)
+#define PERF_BEGIN(p, inherit)
+#define PERF_END(p, bucket)
+
+#endif
+
+#endif
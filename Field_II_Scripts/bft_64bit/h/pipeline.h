@@ -0,0 +1,71 @@
+#ifndef __pipeline_h
+  #define __pipeline_h
+/*********************************************************************
+ * NAME     : pipeline.h
+ * ABSTRACT : Asynchronous beamforming of frames. Frames are submitted
+ *            to a bounded queue and beamformed by a worker thread,
+ *            while the caller prepares the next frame. The results
+ *            are collected by ticket. The worker can also rate every
+ *            beamformed frame with metric_frames().
+ *********************************************************************/
+
+#include "beamform.h"
+#include "metrics.h"
+
+#define PIPELINE_DEFAULT_DEPTH   2
+
+#define JOB_QUEUED     0
+#define JOB_RUNNING    1
+#define JOB_DONE       2
+
+
+/*
+ *  One submitted frame
+ */
+typedef struct pipeline_job{
+   ui32 ticket;            /* Identifies the job for the collection     */
+   ui32 state;             /* JOB_QUEUED, JOB_RUNNING or JOB_DONE        */
+   TFocusLineCollection *flc; /* Settings used for the beamforming      */
+   TApoLineCollection *alc;
+   TSysParams *sys;
+   double time;            /* Time of the first sample                  */
+   double *rf;             /* Copy of the channel data                  */
+   double **rf_data;       /* Pointers to the channels in 'rf'          */
+   ui32 no_samples;        /* Number of samples per channel             */
+   ui32 no_elements;       /* Number of channels                        */
+   ui32 element_no;        /* Transmitting element, or -1               */
+   TPoint3D xmt;           /* Origin of transmission, if 'use_xmt'      */
+   ui32 use_xmt;
+   ui32 no_lines;          /* Size of the result                        */
+   ui32 no_out;            /* Samples per beamformed line               */
+   double **bf_data;       /* The result, when 'state' is JOB_DONE      */
+   ui32 use_metric;        /* TRUE: rate the result with 'metric'       */
+   TMetricSetup metric;
+   TImageMetrics metrics;  /* The figures, if 'metric_ok'               */
+   ui32 metric_ok;
+   struct pipeline_job *next;
+}TPipelineJob;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+void pipeline_set_depth(ui32 depth);
+ui32 pipeline_get_depth();
+
+TPipelineJob* pipeline_new_job(double time, double *rf, ui32 no_samples,
+                               ui32 no_elements, ui32 element_no, TPoint3D *xmt);
+ui32 pipeline_submit(TFocusLineCollection *flc, TApoLineCollection *alc,
+                     TSysParams *sys, TPipelineJob *job);
+TPipelineJob* pipeline_collect(ui32 ticket);
+void pipeline_free_job(TPipelineJob *job);
+
+void pipeline_wait_idle();
+void pipeline_clear();
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
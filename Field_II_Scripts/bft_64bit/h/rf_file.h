@@ -0,0 +1,89 @@
+#ifndef __rf_file_h
+  #define __rf_file_h
+/*********************************************************************
+ * NAME     : rf_file.h
+ * ABSTRACT : Frame-indexed on-disk container for recorded RF data.
+ *            The file is memory mapped, and the beamformer reads the
+ *            channel data directly from the mapping.
+ *
+ *            Layout (little endian, all offsets in bytes from the
+ *            beginning of the file):
+ *
+ *              TRFFileHeader
+ *              geometry   - no_elements  x TPoint3D
+ *              times      - max_frames   x double  (start time of frame)
+ *              codes      - no_codes*code_length x double
+ *              index      - max_frames   x ui64    (offset of frame)
+ *              ... padding up to data_offset (page aligned) ...
+ *              frames     - no_samples x no_elements doubles per frame,
+ *                           one column per element (as in 'rf_data')
+ *
+ *            The files are written by BFT_RF_CREATE and BFT_RF_APPEND.
+ *********************************************************************/
+
+#include "types.h"
+#include "sys_params.h"
+
+#define RF_FILE_MAGIC     "BFTRF\0\0\0"
+#define RF_FILE_VERSION   1
+
+
+/*
+ *  Header of the file. All fields are fixed width, so that the
+ *  MATLAB writer and the native reader agree on the layout.
+ */
+typedef struct rf_file_header{
+   char   magic[8];         /* RF_FILE_MAGIC                             */
+   ui32   version;          /* RF_FILE_VERSION                           */
+   ui32   header_size;      /* sizeof(TRFFileHeader) on the writer side  */
+   ui32   no_elements;      /* Number of receive channels                */
+   ui32   no_samples;       /* Samples per channel in one frame          */
+   ui32   no_frames;        /* Number of frames written so far           */
+   ui32   max_frames;       /* Capacity of the 'times' and 'index' tables*/
+   ui32   no_codes;         /* Number of excitation codes                */
+   ui32   code_length;      /* Length of one excitation code             */
+   double fs;               /* Sampling frequency            [Hz]        */
+   double c;                /* Speed of sound                [m/s]       */
+   ui64   geometry_offset;
+   ui64   times_offset;
+   ui64   codes_offset;
+   ui64   index_offset;
+   ui64   data_offset;      /* First frame. Aligned to a page            */
+   ui64   frame_size;       /* Bytes in one frame                        */
+}TRFFileHeader;
+
+
+/*
+ *  An opened (mapped) file
+ */
+typedef struct rf_file{
+   int    fd;               /* File descriptor                           */
+   ui8   *base;             /* Start of the mapping                      */
+   ui64   size;             /* Size of the mapping                       */
+   TRFFileHeader *hdr;      /* Points into the mapping                   */
+   TPoint3D *geometry;      /* Centers of the elements                   */
+   double *times;           /* Start time of every frame                 */
+   double *codes;           /* Excitation codes, one column per code     */
+   ui64   *index;           /* Offset of every frame                     */
+   struct rf_file *next;
+}TRFFile;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+TRFFile* rf_file_open(const char *file_name);
+void rf_file_close(TRFFile *f);
+void rf_file_close_all();
+si32 is_rf_file_valid(TRFFile *f);
+
+double** rf_file_frame(TRFFile *f, ui32 frame_no, double **rf_data);
+void rf_file_prefetch(TRFFile *f, ui32 first_frame, ui32 no_frames);
+void rf_file_release(TRFFile *f, ui32 first_frame, ui32 no_frames);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __search_h
+  #define __search_h
+/*********************************************************************
+ * NAME     : search.h
+ * ABSTRACT : Local search for binary code sets with low correlation
+ *            sidelobes. The codes are grouped as in codes.h, and the
+ *            cost is the energy of the sidelobes of the summed ACF of
+ *            every group, plus a weighted energy of the summed CCF of
+ *            every two groups:
+ *
+ *              E = sum_g sum_{m>0} S_g[m]^2 + w * sum_{g<h} sum_m C_gh[m]^2
+ *
+ *            The correlations are kept up to date as single chips are
+ *            flipped, so that a flip costs O(length) per group.
+ *********************************************************************/
+
+#include "types.h"
+
+#define SEARCH_TABU     1      /* Tabu search                          */
+#define SEARCH_ANNEAL   2      /* Simulated annealing                  */
+
+
+/*
+ *  Settings of a search
+ */
+typedef struct{
+   ui32 method;            /* SEARCH_TABU or SEARCH_ANNEAL              */
+   ui32 max_iter;          /* Number of flips                           */
+   double ccf_weight;      /* Weight w of the cross-correlations        */
+   ui64 seed;              /* Seed of the random numbers                */
+}TSearchParams;
+
+
+/*
+ *  State of a search. The correlations are integers.
+ */
+typedef struct{
+   ui32 no_codes;          /* Number of codes                           */
+   ui32 length;            /* Chips per code                            */
+   ui32 set_size;          /* Codes per group                           */
+   ui32 no_sets;           /* Number of groups                          */
+   double ccf_weight;      /* Weight of the cross-correlations          */
+   si8 *x;                 /* Chips, no_codes x length, +1 or -1        */
+   si32 *acf;              /* S_g[m], 0 <= m < length, per group        */
+   si32 *ccf;              /* C_gh[m], -(length-1) <= m < length, per   */
+                           /*   group pair g < h, stored at m+length-1  */
+   double energy;          /* E of the current codes                    */
+   ui64 rng;               /* State of the random numbers               */
+}TCodeSearch;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+TCodeSearch* search_create(double *codes, ui32 no_codes, ui32 length,
+                           ui32 set_size, double ccf_weight);
+void search_free(TCodeSearch *s);
+double search_flip_delta(TCodeSearch *s, ui32 code_no, ui32 n);
+void search_flip(TCodeSearch *s, ui32 code_no, ui32 n);
+double search_run(TCodeSearch *s, TSearchParams *p, si8 *best);
+void search_get_codes(TCodeSearch *s, si8 *x, double *codes);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
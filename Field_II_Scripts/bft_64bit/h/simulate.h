@@ -0,0 +1,73 @@
+#ifndef __simulate_h
+  #define __simulate_h
+/*********************************************************************
+ * NAME     : simulate.h
+ * ABSTRACT : Simulation of the RF signals received from point
+ *            scatterers. The elements are points, so that the pulse
+ *            reaches a scatterer as a sum of delayed copies, and
+ *            returns to every element as a delayed copy of that sum
+ *            (as in BeamIntSim/focusBeam.m). The amplitude falls as 
+ *            1/r on the way to the scatterer and back.
+ *
+ *            Large phantoms can be sorted once into a grid of bins in
+ *            x and z. A simulation with a given window then only visits
+ *            the bins whose echoes can reach that window.
+ *********************************************************************/
+
+#include "types.h"
+#include "sys_params.h"
+#include "transducer.h"
+
+/*
+ *  Transmit and receive setup of one simulation
+ */
+typedef struct{
+   TTransducer *xmt;       /* Transmitting elements                     */
+   TTransducer *rcv;       /* Receiving elements. One RF line per element */
+   double *xmt_delays;     /* Firing time of every transmit element [s] */
+   double *xmt_apo;        /* Apodization of the transmit elements, or  */
+   double *rcv_apo;        /*   of the receive elements. NULL means 1   */
+   double *pulse;          /* Emitted pulse, sampled at sys->fs. E.g.   */
+   ui32 pulse_length;      /*   the excitation code convolved with the  */
+                           /*   impulse responses of the transducer     */
+}TSimSetup;
+
+
+/*
+ *  Scatterers sorted into bins in x (lateral) and z (depth)
+ */
+typedef struct scat_grid{
+   ui32 no_scat;           /* Number of scatterers                      */
+   TPoint3D *pos;          /* Position and amplitude of the scatterers, */
+   double *amp;            /*   sorted by bin                           */
+   ui32 no_x, no_z;        /* Number of bins in x and z                 */
+   double x0, z0;          /* Corner of the first bin              [m]  */
+   double dx, dz;          /* Size of the bins                     [m]  */
+   ui32 *first;            /* First scatterer of every bin. The bin     */
+                           /*   (ix,iz) has index iz*no_x + ix          */
+   TPoint3D *lo, *hi;      /* Bounding box of the scatterers of a bin   */
+   struct scat_grid *next;
+}TScatGrid;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+double* simulate_scatterers(TSimSetup *setup, TSysParams *sys,
+                            TPoint3D *pos, double *amp, ui32 no_scat,
+                            double *start_time, ui32 *no_samples);
+double* simulate_grid(TSimSetup *setup, TSysParams *sys, TScatGrid *g,
+                      double *start_time, ui32 *no_samples);
+
+TScatGrid* scat_grid_create(TPoint3D *pos, double *amp, ui32 no_scat,
+                            double bin_size);
+void scat_grid_free(TScatGrid *g);
+void scat_grid_free_all();
+si32 is_scat_grid_valid(TScatGrid *g);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef __stats_h
+  #define __stats_h
+/*********************************************************************
+ * NAME     : stats.h
+ * ABSTRACT : Timing and counters of the beamforming stages. The
+ *            kernels record their work with the STATS_ macros. With
+ *            BFT_NO_STATS defined the macros are empty and stats.c
+ *            holds no code, so a production build pays nothing.
+ *
+ *            The times are taken with a monotonic clock, in ns. The
+ *            per-line kernel times add the time of all threads, and
+ *            can exceed the time of the STAT_LINES stage.
+ *********************************************************************/
+
+#include "types.h"
+
+#define STAT_TOTAL          0  /* Whole BFT_BEAMFORM command            */
+#define STAT_MARSHAL        1  /* Checks of the arguments               */
+#define STAT_RF_SETUP       2  /* Pointers to the channels              */
+#define STAT_SPAWN          3  /* Creation of the worker threads        */
+#define STAT_LINES          4  /* All lines, from spawn to join         */
+#define STAT_LINE           5  /* One line kernel                       */
+#define STAT_COPY           6  /* Copy of the result to Matlab          */
+#define STAT_NO_STAGES      7
+
+#define STAT_SAMPLES        0  /* Samples x channels processed          */
+#define STAT_BYTES          1  /* Bytes read and written by the kernels */
+#define STAT_THREADS        2  /* Threads used by the parallel loops    */
+#define STAT_NO_COUNTERS    3
+
+
+/*
+ *  Time spent in one stage
+ */
+typedef struct{
+   ui64 calls;
+   ui64 total_ns;
+   ui64 min_ns;
+   ui64 max_ns;
+}TStatTimer;
+
+
+/*
+ *  All the statistics since the last stats_reset()
+ */
+typedef struct{
+   TStatTimer stage[STAT_NO_STAGES];
+   ui64 counter[STAT_NO_COUNTERS];
+   ui32 max_threads;       /* Most threads used by one parallel loop    */
+}TStats;
+
+
+#ifndef BFT_NO_STATS
+
+#define STATS_VAR(t)             ui64 t;
+#define STATS_START(t)           t = stats_now();
+#define STATS_STOP(stage, t)     stats_add_time(stage, stats_now() - (t));
+#define STATS_COUNT(counter, n)  stats_add_count(counter, n);
+#define STATS_THREADS(n)         stats_add_threads(n);
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+void stats_enable(si32 on);
+si32 stats_enabled();
+void stats_reset();
+void stats_get(TStats *s);
+ui64 stats_now();
+void stats_add_time(ui32 stage, ui64 ns);
+void stats_add_count(ui32 counter, ui64 n);
+void stats_add_threads(ui32 n);
+const char* stats_stage_name(ui32 stage);
+const char* stats_counter_name(ui32 counter);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#else
+
+#define STATS_VAR(t)
+#define STATS_START(t)
+#define STATS_STOP(stage, t)
+#define STATS_COUNT(counter, n)
+#define STATS_THREADS(n)
+
+#endif
+
+#endif
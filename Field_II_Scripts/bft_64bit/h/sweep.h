@@ -0,0 +1,91 @@
+#ifndef __sweep_h
+  #define __sweep_h
+/*********************************************************************
+ * NAME     : sweep.h
+ * ABSTRACT : Evaluation of many code sets with one imaging setup:
+ *            simulation of the phantom, decoding with the transmitted
+ *            codes, beamforming and an image metric, all in memory
+ *            (as imageAndGetMetric.m with Field II and QuinnWidth).
+ *
+ *            The codes are grouped as in codes.h. Group g is sent with
+ *            its own transmit delays, and its code e in transmit event
+ *            e, all groups at the same time. The received signals of
+ *            event e are correlated with code e of group g and summed
+ *            over the events, and the lines of group g are beamformed
+ *            from the result.
+ *
+ *            The simulation is linear in the emitted pulse, so the
+ *            phantom is simulated once per group with a unit pulse.
+ *            A code set then costs one convolution per element (by
+ *            FFT) with the emitted and decoded codes, the beamforming
+ *            and the metric.
+ *********************************************************************/
+
+#include "simulate.h"
+#include "beamform.h"
+#include "metrics.h"
+#include "fft.h"
+
+
+/*
+ *  Settings of a sweep
+ */
+typedef struct{
+   TSimSetup sim;          /* Apertures and apodizations. 'pulse' is    */
+                           /*   the two-way impulse response of the     */
+                           /*   transducer. 'xmt_delays' is not used    */
+   double *xmt_delays;     /* Firing times, one column of xmt elements  */
+   ui32 no_groups;         /*   per group                          [s]  */
+   ui32 set_size;          /* Codes per group (transmit events)         */
+   ui32 code_length;       /* Chips per code                            */
+   ui32 chip_samples;      /* Samples per chip                          */
+   TPoint3D *pos;          /* Phantom, or NULL if 'grid' is used        */
+   double *amp;
+   ui32 no_scat;
+   TScatGrid *grid;
+   double start_time;      /* First sample of the decoded signals  [s]  */
+   ui32 no_samples;        /* Samples per decoded signal                */
+   ui32 *line_groups;      /* Group of every line, or NULL: all group 0 */
+   si32 envelope;          /* TRUE: the metric is found on the envelope */
+   ui32 metric;            /* METRIC_...                                */
+   TImageRegion signal;    /* Regions of the image for the metric. The  */
+   TImageRegion clutter;   /*   clutter is used by METRIC_MAX_TO_AVG    */
+}TSweepSetup;
+
+
+/*
+ *  A prepared sweep
+ */
+typedef struct{
+   TSweepSetup setup;
+   TFocusLineCollection *flc;
+   TApoLineCollection *alc;
+   TSysParams *sys;
+   ui32 no_elements;       /* Receive elements                          */
+   ui32 pulse_length;      /* Samples of an emitted code                */
+   ui32 kernel_length;     /* Samples of an emitted and decoded code    */
+   ui32 no_out;            /* Samples per beamformed line               */
+   TImageRegion roi;       /* Smallest region with the signal and the   */
+                           /*   clutter regions, the part beamformed    */
+                           /*   when the images are not returned        */
+   TFftPlan *plan;
+   double *h_re, *h_im;    /* Spectra of the unit pulse responses,      */
+                           /*   no_groups x no_elements x plan->n       */
+}TSweep;
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+TSweep* sweep_create(TSweepSetup *setup, TFocusLineCollection *flc,
+                     TApoLineCollection *alc, TSysParams *sys);
+void sweep_free(TSweep *s);
+si32 sweep_run(TSweep *s, double *codes, ui32 no_sets, double *metrics,
+               double *images);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __threads_h
+  #define __threads_h
+/*********************************************************************
+ * NAME     : threads.h
+ * ABSTRACT : A pool-less "parallel for" used by the kernels that are
+ *            split in independent items (lines, columns, ...). 
+ *            The items are handed to a fixed number of worker threads
+ *            one at a time, so that uneven items are balanced.
+ *
+ *            On NUMA machines the workers can be pinned to processors,
+ *            filling one node after the other (compact) or taking the
+ *            nodes in turn (scatter). With BFT_NUMA_PARTITION, the 
+ *            workers of a node take their items from a contiguous range
+ *            first, so that the outputs of neighbouring items are
+ *            allocated (first touched) on the same node.
+ *            BFT_NUMA_REPLICATE asks the kernels to copy their input
+ *            once per node, by a worker of that node.
+ *********************************************************************/
+
+#include "types.h"
+
+/*
+ *  Task executed for every item. 'ctx' is shared by all the items
+ */
+typedef void (*TBftTask)(void *ctx, ui32 item);
+
+#define BFT_AFFINITY_NONE     0   /* The workers are not pinned         */
+#define BFT_AFFINITY_COMPACT  1   /* Fill node 0, then node 1, ...      */
+#define BFT_AFFINITY_SCATTER  2   /* Worker i on node i % no_nodes      */
+
+#define BFT_NUMA_PARTITION    1   /* Contiguous items per node          */
+#define BFT_NUMA_REPLICATE    2   /* A copy of the input per node       */
+
+#define BFT_MAX_NODES        64
+
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+void bft_set_no_threads(ui32 no_threads);
+ui32 bft_get_no_threads();
+void bft_set_affinity(ui32 policy);
+ui32 bft_get_affinity();
+void bft_set_numa(ui32 flags);
+ui32 bft_get_numa();
+ui32 bft_no_nodes();
+si32 bft_worker_node();
+
+void bft_parallel_for(ui32 no_items, TBftTask task, void *ctx);
+void bft_parallel_for_n(ui32 no_items, TBftTask task, void *ctx,
+                        ui32 no_workers);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef __trace_h
+  #define __trace_h
+/*********************************************************************
+ * NAME     : trace.h
+ * ABSTRACT : Timeline of the work of the beamformer threads, written
+ *            as Chrome trace JSON (chrome://tracing, Perfetto).
+ *
+ *            Every thread writes its events to its own ring, without
+ *            locks, and the oldest events are overwritten when the
+ *            ring is full. The rings are taken from a fixed pool and
+ *            returned when a thread ends, so the short-lived line
+ *            threads reuse them. Every event is a complete event: a
+ *            begin and an end time with the line, the mode and the
+ *            size of the work.
+ *
+ *            Tracing is off until trace_start(). Like the statistics
+ *            it is removed by BFT_NO_STATS.
+ *********************************************************************/
+
+#include "types.h"
+
+#define TRACE_MAX_RINGS       256  /* Threads that trace at one time    */
+#define TRACE_DEFAULT_EVENTS  4096 /* Events kept per thread            */
+
+#define TRACE_COMMAND         0    /* One call of the MEX function      */
+#define TRACE_IMAGE           1    /* beamform_image()                  */
+#define TRACE_LINE            2    /* One line kernel                   */
+#define TRACE_PIPELINE_JOB    3    /* One frame of the pipeline worker  */
+
+#define TRACE_MODE_NONE       0
+#define TRACE_MODE_TIMES      1
+#define TRACE_MODE_DYNAMIC    2
+#define TRACE_MODE_STA        3
+#define TRACE_MODE_PIXELS     4
+
+/* Mode of a focus time line, with 'elem' the transmitting element */
+#define TRACE_LINE_MODE(ftl, elem) ((ftl)->dynamic == TRUE                    \
+        ? ((elem) != NULL ? TRACE_MODE_STA : TRACE_MODE_DYNAMIC)              \
+        : ((ftl)->pixel == TRUE ? TRACE_MODE_PIXELS : TRACE_MODE_TIMES))
+
+
+/*
+ *  One event
+ */
+typedef struct{
+   ui64 begin_ns;
+   ui64 end_ns;
+   ui32 tid;               /* Thread, numbered from 1                   */
+   ui32 type;              /* TRACE_...                                 */
+   ui32 id;                /* Line, or command of TRACE_COMMAND         */
+   ui32 mode;              /* TRACE_MODE_...                            */
+   ui32 no_samples;
+   ui32 no_channels;
+}TTraceEvent;
+
+
+#ifndef BFT_NO_STATS
+
+#define TRACE_VAR(t)             ui64 t;
+#define TRACE_START(t)           t = trace_enabled() ? stats_now() : 0;
+#define TRACE_END(type, t, id, mode, no_samples, no_channels) \
+        if (t) trace_event(type, t, id, mode, no_samples, no_channels);
+
+#ifdef __cplusplus
+  extern"C"{
+#endif
+
+si32 trace_start(ui32 events_per_thread);
+void trace_stop();
+si32 trace_enabled();
+void trace_clear();
+void trace_event(ui32 type, ui64 begin_ns, ui32 id, ui32 mode,
+                 ui32 no_samples, ui32 no_channels);
+si64 trace_dump(char *file_name);
+
+#ifdef __cplusplus
+  };
+#endif
+
+#else
+
+#define TRACE_VAR(t)
+#define TRACE_START(t)
+#define TRACE_END(type, t, id, mode, no_samples, no_channels)
+
+#endif
+
+#endif
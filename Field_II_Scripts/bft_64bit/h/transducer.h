@@ -5,7 +5,7 @@
 #include "types.h"
 
 typedef struct transducer{
-   ui16 no_elements;              /* Number of elements             */
+   ui32 no_elements;              /* Number of elements             */
    TPoint3D* c;                   /*  Center of the transducer      */
    struct transducer *next;
 }TTransducer;
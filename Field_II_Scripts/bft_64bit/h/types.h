@@ -22,6 +22,8 @@
  *   Definition of some basic scalar type
  */
 typedef unsigned long  uint64;
+typedef unsigned long long ui64;
+typedef signed long long   si64;
 typedef unsigned int   ui32;
 typedef signed int     si32;
 typedef signed short   si16;
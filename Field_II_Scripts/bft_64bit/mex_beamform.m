@@ -15,7 +15,7 @@ if (nargin > 0)
 else
   debug = '';  
 end
-file_names = ['c/mex_beamform.c c/focus.c c/beamform.c c/geometry.c c/transducer.c c/motion.c'];
+file_names = ['c/mex_beamform.c c/focus.c c/beamform.c c/geometry.c c/transducer.c c/motion.c c/rf_file.c c/pipeline.c c/threads.c c/ensemble.c c/flow.c c/compound.c c/fft.c c/fk.c c/simulate.c c/codes.c c/search.c c/matfile.c c/multistart.c c/enumerate.c c/codedb.c c/metrics.c c/sweep.c c/stats.c c/trace.c c/perfctr.c c/autotune.c'];
 host = computer;
 if (strcmp(host,'PCWIN') || strcmp(host,'PCWIN64'))
    cmd = ['mex ' debug ' -D__MSCVC_' ' -O -output bft ' file_names];